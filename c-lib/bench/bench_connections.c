@@ -0,0 +1,534 @@
+/**
+ * bench_connections - C10K/C100K connection-scale harness
+ *
+ * Usage: bench_connections [--steps=1000,10000,50000,100000] [--active=0.01]
+ *                          [--rate=10000] [--size=64] [--duration-ms=2000]
+ *                          [--handshake] [--accept-batch] [--port=47100]
+ *
+ * Grows the number of open connections to an in-process event-loop echo
+ * server (06_async_server style) step by step. At each step a fraction of
+ * the connections is kept active at a fixed aggregate message rate (open
+ * loop), while the rest stay idle. Reports per-connection memory, setup
+ * cost, server loop iteration cost and echo latency for each N, so the
+ * knee shows up here before it shows up in production.
+ *
+ * With --handshake every connection runs the full handshake and traffic
+ * is encrypted. With --accept-batch the server drains the accept queue
+ * with p2p_socket_accept_batch() per readiness event instead of one
+ * blocking p2p_socket_accept() per connection.
+ *
+ * Client sockets are spread over 127.0.0.2, 127.0.0.3, ... so N is not
+ * capped by the ephemeral port range of a single source address. Needs
+ * RLIMIT_NOFILE >= 2N (raised to the hard limit automatically).
+ *
+ * Output: one JSON object per step (machine-readable)
+ *
+ * POSIX only (threads + socket_unix.c).
+ */
+
+#include <p2pnet/p2pnet.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_STEPS 16
+#define CONNS_PER_SOURCE_IP 20000
+#define STOP_WORD "STOP"
+#define ACCEPT_BATCH 64
+
+typedef struct {
+    size_t steps[MAX_STEPS];
+    int num_steps;
+    double active;
+    double rate;
+    size_t size;
+    int duration_ms;
+    int handshake;
+    int accept_batch;
+    uint16_t port;
+} options_t;
+
+/**
+ * One end of a connection
+ */
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_session_t* session;     // NULL without --handshake
+    p2p_event_loop_t* loop;     // Server side only
+    int is_control;             // Connection 0 carries the STOP word
+} conn_t;
+
+static options_t g_opts;
+static p2p_keypair_t* g_server_kp;
+static p2p_keypair_t* g_client_kp;
+static p2p_histogram_t* g_latency;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until_ns(uint64_t t) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(t / 1000000000ULL);
+    ts.tv_nsec = (long)(t % 1000000000ULL);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static size_t rss_bytes(void) {
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+
+    unsigned long size = 0, resident = 0;
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(f);
+
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static int conn_send(conn_t* c, const void* data, size_t len) {
+    if (c->session) {
+        return p2p_session_send(c->session, c->sock, data, len);
+    }
+
+    p2p_message_t msg;
+    msg.data = (uint8_t*)data;
+    msg.length = (uint32_t)len;
+    return p2p_message_send(c->sock, &msg);
+}
+
+static p2p_message_t* conn_recv(conn_t* c) {
+    return c->session ? p2p_session_recv(c->session, c->sock) : p2p_message_recv(c->sock);
+}
+
+static int is_stop(const p2p_message_t* msg) {
+    return msg->length == strlen(STOP_WORD) && memcmp(msg->data, STOP_WORD, msg->length) == 0;
+}
+
+// ============================================================================
+// Server side
+// ============================================================================
+
+static void on_server_read(p2p_socket_t* sock, void* user_data) {
+    conn_t* c = (conn_t*)user_data;
+    (void)sock;
+
+    p2p_message_t* msg = conn_recv(c);
+    if (!msg) {
+        p2p_event_loop_remove_socket(c->loop, c->sock);
+        return;
+    }
+
+    conn_send(c, msg->data, msg->length);
+
+    if (c->is_control && is_stop(msg)) {
+        p2p_event_loop_stop(c->loop);
+    }
+
+    p2p_message_free(msg);
+}
+
+static void on_server_error(p2p_socket_t* sock, int error, void* user_data) {
+    (void)error;
+    conn_t* c = (conn_t*)user_data;
+    p2p_event_loop_remove_socket(c->loop, sock);
+}
+
+typedef struct {
+    p2p_socket_t* listener;
+    conn_t* conns;
+    size_t from;
+    size_t to;
+    int failed;
+} acceptor_t;
+
+/**
+ * --accept-batch: wait for readiness, then take everything queued
+ */
+static p2p_socket_t* accept_next(p2p_socket_t* listener) {
+    static p2p_socket_t* batch[ACCEPT_BATCH];
+    static int count = 0;
+    static int next = 0;
+
+    while (next == count) {
+        struct pollfd pfd = {p2p_socket_get_handle(listener), POLLIN, 0};
+        if (poll(&pfd, 1, 5000) <= 0) return NULL;
+
+        count = p2p_socket_accept_batch(listener, batch, ACCEPT_BATCH, NULL, 0);
+        next = 0;
+        if (count < 0) {
+            count = 0;
+            return NULL;
+        }
+    }
+
+    return batch[next++];
+}
+
+static void* acceptor_main(void* arg) {
+    acceptor_t* a = (acceptor_t*)arg;
+
+    for (size_t i = a->from; i < a->to; i++) {
+        conn_t* c = &a->conns[i];
+        c->sock = g_opts.accept_batch ? accept_next(a->listener)
+                                      : p2p_socket_accept(a->listener);
+        if (!c->sock) {
+            a->failed = 1;
+            break;
+        }
+        p2p_socket_set_nodelay(c->sock, 1);
+
+        if (g_opts.handshake) {
+            c->session = p2p_handshake_server(c->sock, g_server_kp, NULL, 0);
+            if (!c->session) {
+                a->failed = 1;
+                break;
+            }
+        }
+
+        // Loop is not running during setup, so registering here is safe
+        c->is_control = (i == 0);
+        p2p_event_loop_add_socket(c->loop, c->sock, on_server_read, on_server_error, c);
+    }
+
+    return NULL;
+}
+
+// ============================================================================
+// Client side
+// ============================================================================
+
+/**
+ * Client receiver: plain poll() over the active connections, so the
+ * built-in loop histograms only see the server loop
+ */
+typedef struct {
+    conn_t* conns;              // conns[0] is control, conns[1..count] are active
+    size_t count;
+} receiver_t;
+
+static void* receiver_main(void* arg) {
+    receiver_t* r = (receiver_t*)arg;
+    size_t n = r->count + 1;
+
+    struct pollfd* fds = (struct pollfd*)calloc(n, sizeof(struct pollfd));
+    if (!fds) return NULL;
+
+    for (size_t i = 0; i < n; i++) {
+        fds[i].fd = p2p_socket_get_handle(r->conns[i].sock);
+        fds[i].events = POLLIN;
+    }
+
+    int running = 1;
+    while (running) {
+        if (poll(fds, (nfds_t)n, 1000) <= 0) continue;
+
+        for (size_t i = 0; i < n; i++) {
+            if (!(fds[i].revents & (POLLIN | POLLERR | POLLHUP))) continue;
+
+            conn_t* c = &r->conns[i];
+            p2p_message_t* msg = conn_recv(c);
+            uint64_t t = now_ns();
+            if (!msg) {
+                fds[i].fd = -1;
+                if (c->is_control) running = 0;
+                continue;
+            }
+
+            if (c->is_control && is_stop(msg)) {
+                running = 0;
+            } else if (msg->length >= sizeof(uint64_t)) {
+                uint64_t intended;
+                memcpy(&intended, msg->data, sizeof(intended));
+                p2p_histogram_record(g_latency, t - intended);
+            }
+
+            p2p_message_free(msg);
+        }
+    }
+
+    free(fds);
+    return NULL;
+}
+
+static int client_connect(conn_t* c, size_t index) {
+    char source_ip[32];
+    snprintf(source_ip, sizeof(source_ip), "127.0.0.%zu", 2 + index / CONNS_PER_SOURCE_IP);
+
+    c->sock = p2p_socket_create(P2P_TCP);
+    if (!c->sock ||
+        p2p_socket_bind(c->sock, source_ip, 0) != 0 ||
+        p2p_socket_connect(c->sock, "127.0.0.1", g_opts.port) != 0) {
+        return -1;
+    }
+    p2p_socket_set_nodelay(c->sock, 1);
+
+    if (g_opts.handshake) {
+        c->session = p2p_handshake_client(c->sock, g_client_kp, NULL);
+        if (!c->session) return -1;
+    }
+
+    return 0;
+}
+
+static void* server_main(void* arg) {
+    p2p_event_loop_run((p2p_event_loop_t*)arg);
+    return NULL;
+}
+
+// ============================================================================
+// Options
+// ============================================================================
+
+static int parse_options(int argc, char** argv) {
+    static const size_t default_steps[] = {1000, 10000, 50000, 100000};
+
+    g_opts.num_steps = (int)(sizeof(default_steps) / sizeof(default_steps[0]));
+    memcpy(g_opts.steps, default_steps, sizeof(default_steps));
+    g_opts.active = 0.01;
+    g_opts.rate = 10000.0;
+    g_opts.size = 64;
+    g_opts.duration_ms = 2000;
+    g_opts.port = 47100;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (strncmp(a, "--steps=", 8) == 0) {
+            g_opts.num_steps = 0;
+            char* copy = strdup(a + 8);
+            for (char* tok = strtok(copy, ","); tok && g_opts.num_steps < MAX_STEPS;
+                 tok = strtok(NULL, ",")) {
+                g_opts.steps[g_opts.num_steps++] = (size_t)strtoull(tok, NULL, 10);
+            }
+            free(copy);
+        } else if (strncmp(a, "--active=", 9) == 0) {
+            g_opts.active = atof(a + 9);
+        } else if (strncmp(a, "--rate=", 7) == 0) {
+            g_opts.rate = atof(a + 7);
+        } else if (strncmp(a, "--size=", 7) == 0) {
+            g_opts.size = (size_t)strtoull(a + 7, NULL, 10);
+        } else if (strncmp(a, "--duration-ms=", 14) == 0) {
+            g_opts.duration_ms = atoi(a + 14);
+        } else if (strcmp(a, "--handshake") == 0) {
+            g_opts.handshake = 1;
+        } else if (strcmp(a, "--accept-batch") == 0) {
+            g_opts.accept_batch = 1;
+        } else if (strncmp(a, "--port=", 7) == 0) {
+            g_opts.port = (uint16_t)atoi(a + 7);
+        } else {
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < g_opts.num_steps; i++) {
+        // Steps must grow, connection 0 is the control connection
+        if (g_opts.steps[i] < 2 || (i > 0 && g_opts.steps[i] <= g_opts.steps[i - 1])) {
+            return -1;
+        }
+    }
+
+    if (g_opts.num_steps == 0 || g_opts.active <= 0.0 || g_opts.active > 1.0 ||
+        g_opts.rate <= 0.0 || g_opts.size < sizeof(uint64_t) ||
+        g_opts.size > P2P_MAX_MESSAGE_SIZE || g_opts.duration_ms <= 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Raise open file limit to the hard limit, return usable connection count
+ */
+static size_t raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return 0;
+
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    getrlimit(RLIMIT_NOFILE, &rl);
+
+    // Both ends are in this process, keep some headroom
+    return rl.rlim_cur > 64 ? (size_t)(rl.rlim_cur - 64) / 2 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (parse_options(argc, argv) != 0) {
+        fprintf(stderr, "usage: %s [--steps=1000,10000,...] [--active=0.01] [--rate=10000]\n"
+                        "       [--size=64] [--duration-ms=2000] [--handshake] [--accept-batch]\n"
+                        "       [--port=47100]\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (p2p_init() < 0 || p2p_crypto_init() < 0) {
+        return 1;
+    }
+    p2p_latency_set_enabled(1);             // Reports LOOP_ITERATION percentiles
+
+    size_t max_conns = raise_fd_limit();
+    size_t total = g_opts.steps[g_opts.num_steps - 1];
+    if (total > max_conns) {
+        fprintf(stderr, "fd limit allows %zu connections, capping steps\n", max_conns);
+    }
+
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    if (!listener ||
+        p2p_socket_bind(listener, "127.0.0.1", g_opts.port) != 0 ||
+        p2p_socket_listen(listener, 4096) != 0 ||
+        (g_opts.accept_batch && p2p_socket_set_nonblocking(listener, 1) != 0)) {
+        fprintf(stderr, "listen failed: %s\n", p2p_get_error());
+        return 1;
+    }
+
+    if (g_opts.handshake) {
+        g_server_kp = p2p_keypair_generate();
+        g_client_kp = p2p_keypair_generate();
+    }
+
+    conn_t* server_conns = (conn_t*)calloc(total, sizeof(conn_t));
+    conn_t* client_conns = (conn_t*)calloc(total, sizeof(conn_t));
+    uint8_t* payload = (uint8_t*)calloc(1, g_opts.size);
+    p2p_event_loop_t* server_loop = p2p_event_loop_create();
+    g_latency = p2p_histogram_create();
+    if (!server_conns || !client_conns || !payload || !server_loop || !g_latency) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    size_t rss_base = rss_bytes();
+    size_t open = 0;
+    int status = 0;
+
+    for (int step = 0; step < g_opts.num_steps; step++) {
+        size_t target = g_opts.steps[step];
+        if (target > max_conns) break;
+
+        // ---- Grow to target ------------------------------------------------
+
+        for (size_t i = open; i < target; i++) {
+            server_conns[i].loop = server_loop;
+        }
+
+        acceptor_t acceptor = {listener, server_conns, open, target, 0};
+        pthread_t acceptor_thread;
+        pthread_create(&acceptor_thread, NULL, acceptor_main, &acceptor);
+
+        uint64_t setup_start = now_ns();
+        int connect_failed = 0;
+        for (size_t i = open; i < target; i++) {
+            if (client_connect(&client_conns[i], i) != 0) {
+                fprintf(stderr, "connect %zu failed: %s\n", i, p2p_get_error());
+                connect_failed = 1;
+                break;
+            }
+        }
+        pthread_join(acceptor_thread, NULL);
+        uint64_t setup_ns = now_ns() - setup_start;
+
+        if (connect_failed || acceptor.failed) {
+            status = 1;
+            break;
+        }
+
+        size_t added = target - open;
+        open = target;
+
+        // Connection 0 is control, the active fraction is taken from 1..N-1
+        size_t num_active = (size_t)((double)(open - 1) * g_opts.active);
+        if (num_active < 1) num_active = 1;
+        client_conns[0].is_control = 1;
+
+        size_t rss = rss_bytes();
+
+        // ---- Measure ---------------------------------------------------------
+
+        p2p_histogram_reset(g_latency);
+        p2p_latency_reset();
+        p2p_metrics_t before, after;
+        p2p_event_loop_metrics(server_loop, &before);
+
+        receiver_t receiver = {client_conns, num_active};
+        pthread_t server_thread, receiver_thread;
+        pthread_create(&server_thread, NULL, server_main, server_loop);
+        pthread_create(&receiver_thread, NULL, receiver_main, &receiver);
+
+        // Open loop: message k is due at start + k / rate, whether or not
+        // earlier echoes came back. Latency is measured from that due time.
+        uint64_t interval = (uint64_t)(1e9 / g_opts.rate);
+        uint64_t start = now_ns() + 1000000;
+        uint64_t end = start + (uint64_t)g_opts.duration_ms * 1000000ULL;
+        uint64_t sent = 0;
+
+        for (uint64_t due = start; due < end; due += interval) {
+            sleep_until_ns(due);
+            memcpy(payload, &due, sizeof(due));
+            conn_t* c = &client_conns[1 + sent % num_active];
+            if (conn_send(c, payload, g_opts.size) != 0) {
+                status = 1;
+                break;
+            }
+            sent++;
+        }
+
+        // Let the last echoes drain, then stop server and receiver via the control connection
+        usleep(100000);
+        conn_send(&client_conns[0], STOP_WORD, strlen(STOP_WORD));
+        pthread_join(server_thread, NULL);
+        pthread_join(receiver_thread, NULL);
+
+        p2p_event_loop_metrics(server_loop, &after);
+        p2p_histogram_t* iter = p2p_latency_histogram(P2P_LATENCY_LOOP_ITERATION);
+        double seconds = (double)g_opts.duration_ms / 1000.0;
+
+        printf("{\"bench\":\"connections\",\"conns\":%zu,\"active\":%zu,\"handshake\":%d,"
+               "\"accept_batch\":%d,"
+               "\"setup_seconds\":%.3f,\"connects_per_sec\":%.0f,\"rss_bytes_per_conn\":%.0f,"
+               "\"target_rate\":%.0f,\"sent\":%llu,\"received\":%llu,\"achieved_rate\":%.0f,"
+               "\"p50_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f,"
+               "\"loop_iterations\":%llu,\"loop_iter_p50_us\":%.1f,\"loop_iter_p99_us\":%.1f}\n",
+               open, num_active, g_opts.handshake, g_opts.accept_batch,
+               (double)setup_ns / 1e9, (double)added / ((double)setup_ns / 1e9),
+               (double)(rss - rss_base) / (double)open,
+               g_opts.rate, (unsigned long long)sent,
+               (unsigned long long)p2p_histogram_count(g_latency),
+               (double)p2p_histogram_count(g_latency) / seconds,
+               p2p_histogram_percentile(g_latency, 50.0) / 1e3,
+               p2p_histogram_percentile(g_latency, 99.0) / 1e3,
+               p2p_histogram_percentile(g_latency, 99.9) / 1e3,
+               p2p_histogram_max(g_latency) / 1e3,
+               (unsigned long long)(after.values[P2P_METRIC_LOOP_ITERATIONS] -
+                                    before.values[P2P_METRIC_LOOP_ITERATIONS]),
+               p2p_histogram_percentile(iter, 50.0) / 1e3,
+               p2p_histogram_percentile(iter, 99.0) / 1e3);
+        fflush(stdout);
+
+        if (status != 0) break;
+    }
+
+    for (size_t i = 0; i < open; i++) {
+        p2p_session_free(client_conns[i].session);
+        p2p_socket_close(client_conns[i].sock);
+        p2p_session_free(server_conns[i].session);
+        p2p_socket_close(server_conns[i].sock);
+    }
+
+    p2p_event_loop_free(server_loop);
+    p2p_histogram_free(g_latency);
+    p2p_keypair_free(g_server_kp);
+    p2p_keypair_free(g_client_kp);
+    p2p_socket_close(listener);
+    free(payload);
+    free(server_conns);
+    free(client_conns);
+    p2p_cleanup();
+
+    return status;
+}
@@ -0,0 +1,293 @@
+/**
+ * bench_ipc - Same-host peers: loopback TCP vs shared-memory transport
+ *
+ * Usage: bench_ipc [--transport=tcp|shm|both] [--mode=plain|encrypted|both]
+ *                  [--sizes=16,1024,65536] [--count=20000] [--port=47300]
+ *
+ * For every (transport, mode, size) combination a child process connects
+ * over 127.0.0.1 and echoes every message back. With `shm` both ends call
+ * p2p_socket_upgrade_local() right after connect/accept, so the same
+ * message and session code runs over the shared-memory rings instead of
+ * the TCP stack. Two phases per configuration:
+ *
+ *   ping-pong   one message in flight, round-trip latency per message
+ *   pipelined   up to 64 KB in flight, throughput
+ *
+ * Output: one JSON object per configuration (machine-readable)
+ *
+ * POSIX only (fork + socket_unix.c); shm needs Linux.
+ */
+
+#include <p2pnet/p2pnet.h>
+#include "../src/platform/clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_LIST 32
+#define PIPELINE_BYTES (64 * 1024)
+
+static const size_t default_sizes[] = {16, 1024, 65536};
+
+typedef struct {
+    int tcp;
+    int shm;
+    int plain;
+    int encrypted;
+    size_t sizes[MAX_LIST];
+    int num_sizes;
+    int count;
+    uint16_t port;
+} options_t;
+
+/**
+ * One end of the connection: plaintext framing or an encrypted session
+ */
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_session_t* session;         // NULL in plaintext mode
+} peer_t;
+
+static int peer_send(peer_t* peer, const uint8_t* data, size_t size) {
+    if (peer->session) {
+        return p2p_session_send(peer->session, peer->sock, data, size);
+    }
+    p2p_message_t msg = {.length = (uint32_t)size, .data = (uint8_t*)data};
+    return p2p_message_send(peer->sock, &msg);
+}
+
+static p2p_message_t* peer_recv(peer_t* peer) {
+    return peer->session ? p2p_session_recv(peer->session, peer->sock)
+                         : p2p_message_recv(peer->sock);
+}
+
+// ============================================================================
+// Child: connect, upgrade, echo until EOF
+// ============================================================================
+
+static int child_main(uint16_t port, int use_shm, p2p_keypair_t* client_kp,
+                      const uint8_t* server_pubkey) {
+    peer_t peer = {0};
+    peer.sock = p2p_socket_create(P2P_TCP);
+    if (!peer.sock || p2p_socket_connect(peer.sock, "127.0.0.1", port) != 0) {
+        return 1;
+    }
+    p2p_socket_set_nodelay(peer.sock, 1);
+
+    if (use_shm && p2p_socket_upgrade_local(peer.sock, 1) != 1) {
+        return 1;
+    }
+
+    if (server_pubkey) {
+        peer.session = p2p_handshake_client(peer.sock, client_kp, server_pubkey);
+        if (!peer.session) return 1;
+    }
+
+    p2p_message_t* msg;
+    while ((msg = peer_recv(&peer)) != NULL) {
+        int rc = peer_send(&peer, msg->data, msg->length);
+        p2p_message_free(msg);
+        if (rc != 0) break;
+    }
+
+    p2p_session_free(peer.session);
+    p2p_socket_close(peer.sock);
+    return 0;
+}
+
+// ============================================================================
+// Parent: measure
+// ============================================================================
+
+static int run_config(const options_t* opts, p2p_socket_t* listener, int use_shm,
+                      int encrypted, size_t size, p2p_keypair_t* client_kp,
+                      p2p_keypair_t* server_kp) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        p2p_socket_close(listener);
+        _exit(child_main(opts->port, use_shm, client_kp,
+                         encrypted ? server_kp->public_key : NULL));
+    }
+
+    int ok = 0;
+    peer_t peer = {0};
+    uint8_t* payload = (uint8_t*)calloc(1, size);
+    p2p_histogram_t* rtt = p2p_histogram_create();
+
+    peer.sock = p2p_socket_accept(listener);
+    if (!peer.sock || !payload || !rtt) goto done;
+    p2p_socket_set_nodelay(peer.sock, 1);
+
+    if (use_shm && p2p_socket_upgrade_local(peer.sock, 0) != 1) {
+        fprintf(stderr, "shm upgrade failed: %s\n", p2p_get_error());
+        goto done;
+    }
+
+    if (encrypted) {
+        peer.session = p2p_handshake_server(peer.sock, server_kp, NULL, 0);
+        if (!peer.session) goto done;
+    }
+
+    p2p_metrics_t before, after;
+    p2p_socket_metrics(peer.sock, &before);
+
+    // ---- Ping-pong ----------------------------------------------------------
+    uint64_t start = p2p_clock_ns();
+    for (int i = 0; i < opts->count; i++) {
+        uint64_t t0 = p2p_clock_ns();
+        if (peer_send(&peer, payload, size) != 0) goto done;
+        p2p_message_t* echo = peer_recv(&peer);
+        if (!echo) goto done;
+        p2p_message_free(echo);
+        p2p_histogram_record(rtt, p2p_clock_ns() - t0);
+    }
+    double pingpong_seconds = (double)(p2p_clock_ns() - start) / 1e9;
+
+    // ---- Pipelined ----------------------------------------------------------
+    int window = (int)(PIPELINE_BYTES / (size + 64));
+    if (window < 1) window = 1;
+
+    int sent = 0, received = 0;
+    start = p2p_clock_ns();
+    while (received < opts->count) {
+        while (sent < opts->count && sent - received < window) {
+            if (peer_send(&peer, payload, size) != 0) goto done;
+            sent++;
+        }
+        p2p_message_t* echo = peer_recv(&peer);
+        if (!echo) goto done;
+        p2p_message_free(echo);
+        received++;
+    }
+    double pipelined_seconds = (double)(p2p_clock_ns() - start) / 1e9;
+
+    p2p_socket_metrics(peer.sock, &after);
+    double syscalls = (double)(after.values[P2P_METRIC_SYSCALLS] - before.values[P2P_METRIC_SYSCALLS]);
+
+    printf("{\"bench\":\"ipc\",\"transport\":\"%s\",\"mode\":\"%s\",\"size\":%zu,\"count\":%d,"
+           "\"rtt_p50_us\":%.2f,\"rtt_p99_us\":%.2f,\"rtt_max_us\":%.2f,"
+           "\"pingpong_msgs_per_sec\":%.0f,\"pipelined_msgs_per_sec\":%.0f,"
+           "\"pipelined_mb_per_sec\":%.1f,\"syscalls_per_msg\":%.2f}\n",
+           p2p_socket_transport(peer.sock), encrypted ? "encrypted" : "plain", size, opts->count,
+           p2p_histogram_percentile(rtt, 50.0) / 1e3,
+           p2p_histogram_percentile(rtt, 99.0) / 1e3,
+           p2p_histogram_max(rtt) / 1e3,
+           opts->count / pingpong_seconds,
+           opts->count / pipelined_seconds,
+           (double)opts->count * (double)size / pipelined_seconds / 1e6,
+           syscalls / (4.0 * opts->count));    // Per message sent or received, both phases
+    ok = 1;
+
+done:
+    // Closing our end makes the child's recv fail and exit
+    p2p_session_free(peer.session);
+    p2p_socket_close(peer.sock);
+    free(payload);
+    p2p_histogram_free(rtt);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok ? 0 : -1;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+static int parse_sizes(const char* list, size_t* out, int* count) {
+    *count = 0;
+    while (*list && *count < MAX_LIST) {
+        char* end;
+        unsigned long value = strtoul(list, &end, 10);
+        if (end == list || value == 0 || value > P2P_MAX_MESSAGE_SIZE) return -1;
+        out[(*count)++] = (size_t)value;
+        list = (*end == ',') ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return *count > 0 ? 0 : -1;
+}
+
+static int parse_options(int argc, char** argv, options_t* opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->tcp = opts->shm = 1;
+    opts->plain = opts->encrypted = 1;
+    opts->count = 20000;
+    opts->port = 47300;
+    opts->num_sizes = (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+    memcpy(opts->sizes, default_sizes, sizeof(default_sizes));
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (strncmp(a, "--transport=", 12) == 0) {
+            opts->tcp = strcmp(a + 12, "shm") != 0;
+            opts->shm = strcmp(a + 12, "tcp") != 0;
+        } else if (strncmp(a, "--mode=", 7) == 0) {
+            opts->plain = strcmp(a + 7, "encrypted") != 0;
+            opts->encrypted = strcmp(a + 7, "plain") != 0;
+        } else if (strncmp(a, "--sizes=", 8) == 0) {
+            if (parse_sizes(a + 8, opts->sizes, &opts->num_sizes) != 0) return -1;
+        } else if (strncmp(a, "--count=", 8) == 0) {
+            opts->count = atoi(a + 8);
+        } else if (strncmp(a, "--port=", 7) == 0) {
+            opts->port = (uint16_t)atoi(a + 7);
+        } else {
+            return -1;
+        }
+    }
+
+    return opts->count > 0 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    options_t opts;
+    if (parse_options(argc, argv, &opts) != 0) {
+        fprintf(stderr, "usage: %s [--transport=tcp|shm|both] [--mode=plain|encrypted|both]\n"
+                        "          [--sizes=16,1024,65536] [--count=20000] [--port=47300]\n", argv[0]);
+        return 1;
+    }
+
+    if (p2p_init() < 0 || p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    p2p_keypair_t* client_kp = p2p_keypair_generate();
+    p2p_keypair_t* server_kp = p2p_keypair_generate();
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    if (!client_kp || !server_kp || !listener ||
+        p2p_socket_bind(listener, "127.0.0.1", opts.port) != 0 ||
+        p2p_socket_listen(listener, 4) != 0) {
+        fprintf(stderr, "listen failed: %s\n", p2p_get_error());
+        return 1;
+    }
+
+    int errors = 0;
+    for (int t = 0; t < 2; t++) {
+        int use_shm = t == 1;
+        if (use_shm ? !opts.shm : !opts.tcp) continue;
+
+        for (int m = 0; m < 2; m++) {
+            int encrypted = m == 1;
+            if (encrypted ? !opts.encrypted : !opts.plain) continue;
+
+            for (int s = 0; s < opts.num_sizes; s++) {
+                if (run_config(&opts, listener, use_shm, encrypted, opts.sizes[s],
+                               client_kp, server_kp) != 0) {
+                    fprintf(stderr, "%s/%s/%zu failed\n", use_shm ? "shm" : "tcp",
+                            encrypted ? "encrypted" : "plain", opts.sizes[s]);
+                    errors++;
+                }
+            }
+        }
+    }
+
+    p2p_socket_close(listener);
+    p2p_keypair_free(client_kp);
+    p2p_keypair_free(server_kp);
+    p2p_cleanup();
+
+    return errors ? 1 : 0;
+}
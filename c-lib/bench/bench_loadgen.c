@@ -0,0 +1,692 @@
+/**
+ * bench_loadgen - Open-loop encrypted load generator
+ *
+ * Usage: bench_loadgen [--threads=4] [--sessions=64] [--identities=16]
+ *                      [--rate=20000] [--sizes=64:70,1024:25,16384:5]
+ *                      [--churn=0] [--duration-ms=10000]
+ *                      [--connect=IP:PORT --server-pubkey=FINGERPRINT]
+ *                      [--server-key=FILE] [--port=47200] [--hgrm=PREFIX]
+ *
+ * A swarm of client threads, each owning sessions/threads sessions. Every
+ * session is a TCP connection + p2p_handshake_client() with one of
+ * `identities` client identities (round-robin), like 11_secure_client.
+ * Threads then send p2p_session_send() traffic at a fixed aggregate rate:
+ * message k of a thread is due at start + k / (rate / threads), no matter
+ * whether earlier echoes came back (open loop). Latency is measured from
+ * the due time, not from when the send actually happened, so stalls are
+ * charged to every message that should have gone out during the stall
+ * (coordinated-omission correction).
+ *
+ * With --churn=C, C sessions per second (aggregate) are closed and
+ * replaced by a fresh connection + handshake; handshake latency is
+ * reported separately.
+ *
+ * By default the target is an in-process event-loop echo server (like
+ * 10_secure_server, allow-listing the client identities). With --connect
+ * the swarm targets an external server that echoes session messages;
+ * --server-pubkey pins its identity (Base64 fingerprint, see 09_verify_identity).
+ * --server-key loads the in-process server identity from a file made by
+ * 08_generate_identity instead of generating one.
+ *
+ * Output: one JSON summary object, plus HdrHistogram-style percentile
+ * distributions in PREFIX.latency.hgrm and PREFIX.handshake.hgrm with
+ * --hgrm (values in microseconds).
+ *
+ * POSIX only (threads + socket_unix.c).
+ */
+
+#include <p2pnet/p2pnet.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SIZES 16
+#define WINDOW_BYTES (256 * 1024)  // Unread echo bytes per session before the sender drains
+#define DRAIN_MS 500
+
+typedef struct {
+    size_t size;
+    unsigned weight;
+} size_class_t;
+
+typedef struct {
+    int threads;
+    int sessions;
+    int identities;
+    double rate;
+    double churn;
+    int duration_ms;
+    size_class_t sizes[MAX_SIZES];
+    int num_sizes;
+    unsigned total_weight;
+    char connect_ip[64];
+    uint16_t port;
+    int external;
+    uint8_t server_pubkey[32];
+    int pin_server;
+    const char* server_key_file;
+    const char* hgrm_prefix;
+} options_t;
+
+/**
+ * Client session slot
+ */
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_session_t* session;
+    size_t outstanding;         // Bytes sent but not yet echoed
+} slot_t;
+
+typedef struct {
+    int id;
+    slot_t* slots;
+    struct pollfd* fds;
+    int num_slots;
+    int next_identity;
+    uint64_t seed;
+    uint8_t* payload;
+
+    p2p_histogram_t* latency;
+    p2p_histogram_t* handshake;
+    uint64_t sent;
+    uint64_t received;
+    uint64_t bytes;
+    uint64_t churned;
+    int failed;
+} worker_t;
+
+static options_t g_opts;
+static p2p_keypair_t** g_identities;
+static pthread_barrier_t g_ready;     // Sessions established
+static pthread_barrier_t g_go;        // g_start_ns is set
+static uint64_t g_start_ns;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * xorshift64* - per-thread, deterministic for a given --threads
+ */
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t pick_size(uint64_t* seed) {
+    unsigned r = (unsigned)(next_random(seed) % g_opts.total_weight);
+    for (int i = 0; i < g_opts.num_sizes; i++) {
+        if (r < g_opts.sizes[i].weight) return g_opts.sizes[i].size;
+        r -= g_opts.sizes[i].weight;
+    }
+    return g_opts.sizes[g_opts.num_sizes - 1].size;
+}
+
+// ============================================================================
+// In-process server (event loop echo)
+// ============================================================================
+
+typedef struct {
+    p2p_event_loop_t* loop;
+    p2p_keypair_t* keypair;
+    const uint8_t** allowed;
+    size_t num_allowed;
+    atomic_int stopping;
+} server_t;
+
+typedef struct {
+    p2p_event_loop_t* loop;
+    p2p_session_t* session;
+} server_conn_t;
+
+static void server_close(p2p_socket_t* sock, server_conn_t* conn) {
+    p2p_event_loop_remove_socket(conn->loop, sock);
+    p2p_socket_close(sock);
+    p2p_session_free(conn->session);
+    free(conn);
+}
+
+static void on_server_read(p2p_socket_t* sock, void* user_data) {
+    server_conn_t* conn = (server_conn_t*)user_data;
+
+    p2p_message_t* msg = p2p_session_recv(conn->session, sock);
+    if (!msg) {
+        server_close(sock, conn);
+        return;
+    }
+
+    int rc = p2p_session_send(conn->session, sock, msg->data, msg->length);
+    p2p_message_free(msg);
+
+    if (rc != 0) {
+        server_close(sock, conn);
+    }
+}
+
+static void on_server_error(p2p_socket_t* sock, int error, void* user_data) {
+    (void)error;
+    server_close(sock, (server_conn_t*)user_data);
+}
+
+static void on_server_accept(p2p_socket_t* listener, void* user_data) {
+    server_t* server = (server_t*)user_data;
+
+    p2p_socket_t* sock = p2p_socket_accept(listener);
+    if (!sock) return;
+
+    // Wake-up connection from main: stop accepting, loop ends with the last client
+    if (atomic_load(&server->stopping)) {
+        p2p_socket_close(sock);
+        p2p_event_loop_remove_socket(server->loop, listener);
+        return;
+    }
+
+    p2p_socket_set_nodelay(sock, 1);
+
+    // Blocking handshake on the loop thread, like 10_secure_server
+    p2p_session_t* session = p2p_handshake_server(sock, server->keypair,
+                                                  server->allowed, server->num_allowed);
+    server_conn_t* conn = session ? (server_conn_t*)malloc(sizeof(server_conn_t)) : NULL;
+    if (!conn) {
+        p2p_session_free(session);
+        p2p_socket_close(sock);
+        return;
+    }
+
+    conn->loop = server->loop;
+    conn->session = session;
+    p2p_event_loop_add_socket(server->loop, sock, on_server_read, on_server_error, conn);
+}
+
+static void* server_main(void* arg) {
+    p2p_event_loop_run((p2p_event_loop_t*)arg);
+    return NULL;
+}
+
+// ============================================================================
+// Client swarm
+// ============================================================================
+
+static int slot_open(worker_t* w, int i) {
+    slot_t* s = &w->slots[i];
+    p2p_keypair_t* identity = g_identities[w->next_identity];
+    w->next_identity = (w->next_identity + 1) % g_opts.identities;
+
+    uint64_t start = now_ns();
+
+    s->sock = p2p_socket_create(P2P_TCP);
+    if (!s->sock || p2p_socket_connect(s->sock, g_opts.connect_ip, g_opts.port) != 0) {
+        fprintf(stderr, "worker %d: connect failed: %s\n", w->id, p2p_get_error());
+        return -1;
+    }
+    p2p_socket_set_nodelay(s->sock, 1);
+
+    s->session = p2p_handshake_client(s->sock, identity,
+                                      g_opts.pin_server ? g_opts.server_pubkey : NULL);
+    if (!s->session) {
+        fprintf(stderr, "worker %d: handshake failed\n", w->id);
+        return -1;
+    }
+
+    p2p_histogram_record(w->handshake, now_ns() - start);
+    s->outstanding = 0;
+    w->fds[i].fd = p2p_socket_get_handle(s->sock);
+    w->fds[i].events = POLLIN;
+    return 0;
+}
+
+static void slot_close(worker_t* w, int i) {
+    slot_t* s = &w->slots[i];
+    p2p_session_free(s->session);
+    p2p_socket_close(s->sock);
+    s->session = NULL;
+    s->sock = NULL;
+    w->fds[i].fd = -1;
+}
+
+/**
+ * Read one echo from slot i and record its latency from the due time
+ */
+static int slot_read(worker_t* w, int i) {
+    slot_t* s = &w->slots[i];
+
+    p2p_message_t* msg = p2p_session_recv(s->session, s->sock);
+    uint64_t t = now_ns();
+    if (!msg) {
+        fprintf(stderr, "worker %d: recv failed\n", w->id);
+        return -1;
+    }
+
+    uint64_t due;
+    memcpy(&due, msg->data, sizeof(due));
+    p2p_histogram_record(w->latency, t - due);
+
+    s->outstanding -= msg->length;
+    w->received++;
+    p2p_message_free(msg);
+    return 0;
+}
+
+/**
+ * Wait until `until_ns` at most, reading any echoes that arrive
+ */
+static int poll_echoes(worker_t* w, uint64_t until_ns) {
+    uint64_t now = now_ns();
+    uint64_t wait = until_ns > now ? until_ns - now : 0;
+    struct timespec ts = {(time_t)(wait / 1000000000ULL), (long)(wait % 1000000000ULL)};
+
+    int ready = ppoll(w->fds, (nfds_t)w->num_slots, &ts, NULL);
+    if (ready <= 0) return 0;
+
+    for (int i = 0; i < w->num_slots; i++) {
+        if (w->fds[i].fd < 0 || !(w->fds[i].revents & (POLLIN | POLLERR | POLLHUP))) continue;
+        if (slot_read(w, i) != 0) return -1;
+    }
+    return 0;
+}
+
+static void* worker_main(void* arg) {
+    worker_t* w = (worker_t*)arg;
+
+    for (int i = 0; i < w->num_slots; i++) {
+        w->fds[i].fd = -1;
+    }
+    for (int i = 0; i < w->num_slots && !w->failed; i++) {
+        w->failed = slot_open(w, i) != 0;
+    }
+
+    pthread_barrier_wait(&g_ready);
+    pthread_barrier_wait(&g_go);
+    if (w->failed) {
+        for (int i = 0; i < w->num_slots; i++) {
+            slot_close(w, i);
+        }
+        return NULL;
+    }
+
+    // Setup handshakes are not part of the run
+    p2p_histogram_reset(w->handshake);
+
+    uint64_t interval = (uint64_t)(1e9 * g_opts.threads / g_opts.rate);
+    uint64_t churn_interval = g_opts.churn > 0.0 ? (uint64_t)(1e9 * g_opts.threads / g_opts.churn) : 0;
+
+    // Stagger threads so their due times interleave
+    uint64_t next_send = g_start_ns + interval * (uint64_t)w->id / (uint64_t)g_opts.threads;
+    uint64_t next_churn = churn_interval ? g_start_ns + churn_interval : UINT64_MAX;
+    uint64_t end = g_start_ns + (uint64_t)g_opts.duration_ms * 1000000ULL;
+    int send_slot = 0;
+    int churn_slot = 0;
+
+    while (!w->failed) {
+        uint64_t now = now_ns();
+        if (next_send >= end && next_churn >= end) break;
+
+        if (now >= next_churn) {
+            slot_close(w, churn_slot);
+            w->failed = slot_open(w, churn_slot) != 0;
+            churn_slot = (churn_slot + 1) % w->num_slots;
+            next_churn += churn_interval;
+            w->churned++;
+            continue;
+        }
+
+        if (now >= next_send) {
+            slot_t* s = &w->slots[send_slot];
+
+            // Server is behind: drain before writing more (the delay counts as latency)
+            while (s->outstanding > WINDOW_BYTES && !w->failed) {
+                w->failed = poll_echoes(w, now_ns() + 1000000000ULL) != 0;
+            }
+
+            size_t size = pick_size(&w->seed);
+            memcpy(w->payload, &next_send, sizeof(next_send));
+            if (p2p_session_send(s->session, s->sock, w->payload, size) != 0) {
+                fprintf(stderr, "worker %d: send failed\n", w->id);
+                w->failed = 1;
+                break;
+            }
+
+            s->outstanding += size;
+            w->sent++;
+            w->bytes += size;
+            send_slot = (send_slot + 1) % w->num_slots;
+            next_send += interval;
+            continue;
+        }
+
+        uint64_t until = next_send < next_churn ? next_send : next_churn;
+        w->failed = poll_echoes(w, until < end ? until : end) != 0;
+    }
+
+    // Collect echoes still in flight
+    uint64_t drain_end = now_ns() + DRAIN_MS * 1000000ULL;
+    while (!w->failed && w->received < w->sent && now_ns() < drain_end) {
+        int pending = 0;
+        for (int i = 0; i < w->num_slots; i++) {
+            pending |= w->slots[i].outstanding > 0;
+        }
+        if (!pending) break;
+        w->failed = poll_echoes(w, drain_end) != 0;
+    }
+
+    for (int i = 0; i < w->num_slots; i++) {
+        slot_close(w, i);
+    }
+
+    return NULL;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+/**
+ * Percentile distribution in HdrHistogram's text format (values in us)
+ *
+ * Five percentile levels per halving of the remaining tail, like
+ * HdrHistogram's outputPercentileDistribution(), so the file can be fed
+ * to the usual HdrHistogram plotters.
+ */
+static int write_hgrm(const char* path, const p2p_histogram_t* hist) {
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+
+    uint64_t count = p2p_histogram_count(hist);
+    fprintf(f, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+    double tail = 1.0;
+    while (count > 0 && (1.0 - tail) * (double)count < (double)count - 0.5) {
+        double p = 1.0 - tail;
+        uint64_t total = (uint64_t)(p * (double)count + 0.999999);
+        if (total == 0) total = 1;
+        fprintf(f, "%12.3f %2.12f %10llu %14.2f\n",
+                (double)p2p_histogram_percentile(hist, p * 100.0) / 1e3, p,
+                (unsigned long long)total, 1.0 / tail);
+        tail *= 0.87055056329612413;    // 2^(-1/5)
+    }
+    fprintf(f, "%12.3f %2.12f %10llu\n",
+            (double)p2p_histogram_max(hist) / 1e3, 1.0, (unsigned long long)count);
+
+    fprintf(f, "#[Mean    = %12.3f, Max            = %12.3f]\n",
+            p2p_histogram_mean(hist) / 1e3, (double)p2p_histogram_max(hist) / 1e3);
+    fprintf(f, "#[Total count    = %12llu]\n", (unsigned long long)count);
+
+    fclose(f);
+    return 0;
+}
+
+// ============================================================================
+// Options
+// ============================================================================
+
+static int parse_sizes(const char* value) {
+    g_opts.num_sizes = 0;
+    g_opts.total_weight = 0;
+
+    char* copy = strdup(value);
+    for (char* tok = strtok(copy, ","); tok && g_opts.num_sizes < MAX_SIZES; tok = strtok(NULL, ",")) {
+        size_class_t* c = &g_opts.sizes[g_opts.num_sizes++];
+        char* colon = strchr(tok, ':');
+        c->size = (size_t)strtoull(tok, NULL, 10);
+        c->weight = colon ? (unsigned)atoi(colon + 1) : 1;
+        g_opts.total_weight += c->weight;
+
+        if (c->size < sizeof(uint64_t) || c->size > P2P_MAX_MESSAGE_SIZE) {
+            free(copy);
+            return -1;
+        }
+    }
+    free(copy);
+
+    return g_opts.num_sizes > 0 && g_opts.total_weight > 0 ? 0 : -1;
+}
+
+static int parse_options(int argc, char** argv) {
+    g_opts.threads = 4;
+    g_opts.sessions = 64;
+    g_opts.identities = 16;
+    g_opts.rate = 20000.0;
+    g_opts.duration_ms = 10000;
+    g_opts.port = 47200;
+    strcpy(g_opts.connect_ip, "127.0.0.1");
+    parse_sizes("64:70,1024:25,16384:5");
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (strncmp(a, "--threads=", 10) == 0) {
+            g_opts.threads = atoi(a + 10);
+        } else if (strncmp(a, "--sessions=", 11) == 0) {
+            g_opts.sessions = atoi(a + 11);
+        } else if (strncmp(a, "--identities=", 13) == 0) {
+            g_opts.identities = atoi(a + 13);
+        } else if (strncmp(a, "--rate=", 7) == 0) {
+            g_opts.rate = atof(a + 7);
+        } else if (strncmp(a, "--sizes=", 8) == 0) {
+            if (parse_sizes(a + 8) != 0) return -1;
+        } else if (strncmp(a, "--churn=", 8) == 0) {
+            g_opts.churn = atof(a + 8);
+        } else if (strncmp(a, "--duration-ms=", 14) == 0) {
+            g_opts.duration_ms = atoi(a + 14);
+        } else if (strncmp(a, "--connect=", 10) == 0) {
+            const char* colon = strrchr(a + 10, ':');
+            size_t len = colon ? (size_t)(colon - (a + 10)) : 0;
+            if (!colon || len == 0 || len >= sizeof(g_opts.connect_ip)) return -1;
+            memcpy(g_opts.connect_ip, a + 10, len);
+            g_opts.connect_ip[len] = '\0';
+            g_opts.port = (uint16_t)atoi(colon + 1);
+            g_opts.external = 1;
+        } else if (strncmp(a, "--server-pubkey=", 16) == 0) {
+            if (p2p_pubkey_from_fingerprint(g_opts.server_pubkey, a + 16) != 0) return -1;
+            g_opts.pin_server = 1;
+        } else if (strncmp(a, "--server-key=", 13) == 0) {
+            g_opts.server_key_file = a + 13;
+        } else if (strncmp(a, "--port=", 7) == 0) {
+            g_opts.port = (uint16_t)atoi(a + 7);
+        } else if (strncmp(a, "--hgrm=", 7) == 0) {
+            g_opts.hgrm_prefix = a + 7;
+        } else {
+            return -1;
+        }
+    }
+
+    if (g_opts.threads < 1 || g_opts.sessions < g_opts.threads || g_opts.identities < 1 ||
+        g_opts.rate <= 0.0 || g_opts.churn < 0.0 || g_opts.duration_ms <= 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (p2p_init() < 0 || p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    if (parse_options(argc, argv) != 0) {
+        fprintf(stderr, "usage: %s [--threads=4] [--sessions=64] [--identities=16] [--rate=20000]\n"
+                        "       [--sizes=64:70,1024:25,16384:5] [--churn=0] [--duration-ms=10000]\n"
+                        "       [--connect=IP:PORT --server-pubkey=FP] [--server-key=FILE]\n"
+                        "       [--port=47200] [--hgrm=PREFIX]\n",
+                argv[0]);
+        return 1;
+    }
+
+    // ---- Identities ---------------------------------------------------------
+
+    g_identities = (p2p_keypair_t**)calloc((size_t)g_opts.identities, sizeof(p2p_keypair_t*));
+    const uint8_t** allowed = (const uint8_t**)calloc((size_t)g_opts.identities, sizeof(uint8_t*));
+    if (!g_identities || !allowed) return 1;
+
+    for (int i = 0; i < g_opts.identities; i++) {
+        g_identities[i] = p2p_keypair_generate();
+        if (!g_identities[i]) return 1;
+        allowed[i] = g_identities[i]->public_key;
+    }
+
+    // ---- In-process server ----------------------------------------------------
+
+    server_t server;
+    memset(&server, 0, sizeof(server));
+    p2p_socket_t* listener = NULL;
+    pthread_t server_thread;
+
+    if (!g_opts.external) {
+        server.keypair = g_opts.server_key_file ? p2p_keypair_load(g_opts.server_key_file)
+                                                : p2p_keypair_generate();
+        server.allowed = allowed;
+        server.num_allowed = (size_t)g_opts.identities;
+        server.loop = p2p_event_loop_create();
+        atomic_init(&server.stopping, 0);
+
+        listener = p2p_socket_create(P2P_TCP);
+        if (!server.keypair || !server.loop || !listener ||
+            p2p_socket_bind(listener, "127.0.0.1", g_opts.port) != 0 ||
+            p2p_socket_listen(listener, 1024) != 0) {
+            fprintf(stderr, "server setup failed: %s\n", p2p_get_error());
+            return 1;
+        }
+
+        // Pin the in-process server too, so the client path matches production
+        memcpy(g_opts.server_pubkey, server.keypair->public_key, sizeof(g_opts.server_pubkey));
+        g_opts.pin_server = 1;
+
+        p2p_event_loop_add_socket(server.loop, listener, on_server_accept, NULL, &server);
+        pthread_create(&server_thread, NULL, server_main, server.loop);
+    }
+
+    // ---- Swarm ---------------------------------------------------------------
+
+    size_t max_size = 0;
+    for (int i = 0; i < g_opts.num_sizes; i++) {
+        if (g_opts.sizes[i].size > max_size) max_size = g_opts.sizes[i].size;
+    }
+
+    worker_t* workers = (worker_t*)calloc((size_t)g_opts.threads, sizeof(worker_t));
+    pthread_t* threads = (pthread_t*)calloc((size_t)g_opts.threads, sizeof(pthread_t));
+    if (!workers || !threads) return 1;
+
+    pthread_barrier_init(&g_ready, NULL, (unsigned)g_opts.threads + 1);
+
+    for (int t = 0; t < g_opts.threads; t++) {
+        worker_t* w = &workers[t];
+        w->id = t;
+        w->num_slots = g_opts.sessions / g_opts.threads + (t < g_opts.sessions % g_opts.threads);
+        w->slots = (slot_t*)calloc((size_t)w->num_slots, sizeof(slot_t));
+        w->fds = (struct pollfd*)calloc((size_t)w->num_slots, sizeof(struct pollfd));
+        w->payload = (uint8_t*)calloc(1, max_size);
+        w->latency = p2p_histogram_create();
+        w->handshake = p2p_histogram_create();
+        w->next_identity = t % g_opts.identities;
+        w->seed = 0x9E3779B97F4A7C15ULL * (uint64_t)(t + 1);
+        if (!w->slots || !w->fds || !w->payload || !w->latency || !w->handshake) return 1;
+    }
+
+    pthread_barrier_init(&g_go, NULL, (unsigned)g_opts.threads + 1);
+    for (int t = 0; t < g_opts.threads; t++) {
+        pthread_create(&threads[t], NULL, worker_main, &workers[t]);
+    }
+
+    // Workers connect + handshake, then start together
+    pthread_barrier_wait(&g_ready);
+    g_start_ns = now_ns() + 10000000ULL;
+    pthread_barrier_wait(&g_go);
+
+    p2p_histogram_t* latency = p2p_histogram_create();
+    p2p_histogram_t* handshake = p2p_histogram_create();
+    uint64_t sent = 0, received = 0, bytes = 0, churned = 0;
+    int failed = 0;
+
+    for (int t = 0; t < g_opts.threads; t++) {
+        worker_t* w = &workers[t];
+        pthread_join(threads[t], NULL);
+
+        p2p_histogram_merge(latency, w->latency);
+        p2p_histogram_merge(handshake, w->handshake);
+        sent += w->sent;
+        received += w->received;
+        bytes += w->bytes;
+        churned += w->churned;
+        failed |= w->failed;
+    }
+
+    if (!g_opts.external) {
+        // Wake the accept callback so it drops the listener; the loop ends
+        // once every client connection has been closed
+        atomic_store(&server.stopping, 1);
+        p2p_socket_t* wake = p2p_socket_create(P2P_TCP);
+        if (wake && p2p_socket_connect(wake, "127.0.0.1", g_opts.port) == 0) {
+            pthread_join(server_thread, NULL);
+        }
+        p2p_socket_close(wake);
+    }
+
+    double seconds = (double)g_opts.duration_ms / 1000.0;
+
+    printf("{\"bench\":\"loadgen\",\"threads\":%d,\"sessions\":%d,\"identities\":%d,"
+           "\"target_rate\":%.0f,\"churn\":%.1f,\"seconds\":%.3f,\"sent\":%llu,\"received\":%llu,"
+           "\"achieved_rate\":%.0f,\"mb_per_sec\":%.2f,\"churned\":%llu,"
+           "\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f,"
+           "\"hs_p50_us\":%.1f,\"hs_p99_us\":%.1f,\"errors\":%d}\n",
+           g_opts.threads, g_opts.sessions, g_opts.identities,
+           g_opts.rate, g_opts.churn, seconds,
+           (unsigned long long)sent, (unsigned long long)received,
+           (double)received / seconds, (double)bytes / seconds / 1e6,
+           (unsigned long long)churned,
+           p2p_histogram_percentile(latency, 50.0) / 1e3,
+           p2p_histogram_percentile(latency, 90.0) / 1e3,
+           p2p_histogram_percentile(latency, 99.0) / 1e3,
+           p2p_histogram_percentile(latency, 99.9) / 1e3,
+           p2p_histogram_max(latency) / 1e3,
+           p2p_histogram_percentile(handshake, 50.0) / 1e3,
+           p2p_histogram_percentile(handshake, 99.0) / 1e3,
+           failed);
+    fflush(stdout);
+
+    if (g_opts.hgrm_prefix) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s.latency.hgrm", g_opts.hgrm_prefix);
+        failed |= write_hgrm(path, latency) != 0;
+        snprintf(path, sizeof(path), "%s.handshake.hgrm", g_opts.hgrm_prefix);
+        failed |= write_hgrm(path, handshake) != 0;
+    }
+
+    for (int t = 0; t < g_opts.threads; t++) {
+        free(workers[t].slots);
+        free(workers[t].fds);
+        free(workers[t].payload);
+        p2p_histogram_free(workers[t].latency);
+        p2p_histogram_free(workers[t].handshake);
+    }
+    for (int i = 0; i < g_opts.identities; i++) {
+        p2p_keypair_free(g_identities[i]);
+    }
+
+    if (!g_opts.external) {
+        p2p_event_loop_free(server.loop);
+        p2p_socket_close(listener);
+        p2p_keypair_free(server.keypair);
+    }
+
+    pthread_barrier_destroy(&g_ready);
+    pthread_barrier_destroy(&g_go);
+    p2p_histogram_free(latency);
+    p2p_histogram_free(handshake);
+    free(g_identities);
+    free(allowed);
+    free(workers);
+    free(threads);
+    p2p_cleanup();
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,538 @@
+/**
+ * bench_loopback - Framed plaintext and encrypted echo over loopback
+ *
+ * Usage: bench_loopback [--mode=plain|encrypted|both] [--sizes=16,1024,...]
+ *                       [--conns=1,4,16] [--depth=1,16] [--duration-ms=500]
+ *                       [--zerocopy=BYTES] [--busy-poll=NS] [--so-busy-poll=US]
+ *                       [--port=47000]
+ *
+ * For every (mode, size, conns, depth) combination, an event-loop echo
+ * server (like 06_async_server / 10_secure_server) serves `conns` client
+ * connections. Each client keeps up to `depth` messages in flight: a sender
+ * thread writes whenever a window slot is free, a receiver thread reads
+ * echoes and records round-trip latency from the moment the message was
+ * handed to p2p_message_send() / p2p_session_send().
+ *
+ * --zerocopy enables MSG_ZEROCOPY on both ends for messages of at least
+ * that size (p2p_socket_set_zerocopy()).
+ *
+ * --busy-poll makes the server loop spin for up to NS nanoseconds before
+ * blocking (p2p_event_loop_set_busy_poll()), --so-busy-poll also sets
+ * SO_BUSY_POLL on its sockets. server_cpu_pct is the loop thread's CPU
+ * time over the run, so latency gains can be weighed against CPU cost.
+ *
+ * Output: one JSON object per configuration (machine-readable)
+ *
+ * POSIX only (threads + socket_unix.c).
+ */
+
+#include <p2pnet/p2pnet.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_LIST 32
+
+static const size_t default_sizes[] = {16, 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576};
+static const int default_conns[] = {1, 4, 16};
+static const int default_depth[] = {1, 16};
+
+typedef struct {
+    int plain;
+    int encrypted;
+    size_t sizes[MAX_LIST];
+    int num_sizes;
+    int conns[MAX_LIST];
+    int num_conns;
+    int depth[MAX_LIST];
+    int num_depth;
+    int duration_ms;
+    size_t zerocopy;                // Threshold, 0 = copy path
+    uint64_t busy_poll_ns;          // Server loop spin, 0 = off
+    int so_busy_poll_us;            // SO_BUSY_POLL on server sockets, 0 = off
+    uint16_t port;
+} options_t;
+
+/**
+ * One client connection (sender + receiver thread)
+ */
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_session_t* session;         // NULL in plaintext mode
+    p2p_keypair_t* keypair;
+    uint16_t port;
+    size_t size;
+    int depth;
+    int encrypted;
+    size_t zerocopy;
+
+    pthread_mutex_t lock;
+    pthread_cond_t window;          // Signalled when sent/received change
+    uint64_t* sent_at;              // [depth] send timestamp per in-flight slot
+    uint64_t sent;                  // Messages sent
+    uint64_t received;              // Echoes received
+    int done_sending;
+    int failed;
+
+    pthread_t sender;
+    pthread_t receiver;
+} client_t;
+
+/**
+ * Shared state for one configuration
+ */
+typedef struct {
+    pthread_barrier_t start;        // Clients connected + handshaken
+    pthread_barrier_t go;           // Server loop ready, start traffic
+    uint64_t deadline_ns;
+    p2p_histogram_t* latency;
+    uint64_t server_cpu_ns;         // Loop thread CPU time
+} run_t;
+
+static run_t g_run;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// ============================================================================
+// Server (event loop echo)
+// ============================================================================
+
+static void server_close(p2p_event_loop_t* loop, p2p_socket_t* sock, p2p_session_t* session) {
+    p2p_event_loop_remove_socket(loop, sock);
+    p2p_socket_close(sock);
+    p2p_session_free(session);
+}
+
+typedef struct {
+    p2p_event_loop_t* loop;
+    p2p_session_t* session;
+    int zerocopy;
+} server_conn_t;
+
+static void on_server_read(p2p_socket_t* sock, void* user_data) {
+    server_conn_t* conn = (server_conn_t*)user_data;
+
+    p2p_message_t* msg = conn->session ? p2p_session_recv(conn->session, sock)
+                                       : p2p_message_recv(sock);
+    if (!msg) {
+        server_close(conn->loop, sock, conn->session);
+        conn->session = NULL;
+        return;
+    }
+
+    int rc;
+    if (conn->session) {
+        rc = p2p_session_send(conn->session, sock, msg->data, msg->length);
+        p2p_message_free(msg);
+    } else if (conn->zerocopy) {
+        rc = p2p_message_send_owned(sock, msg);     // Freed once the kernel is done
+    } else {
+        rc = p2p_message_send(sock, msg);
+        p2p_message_free(msg);
+    }
+
+    if (rc != 0) {
+        server_close(conn->loop, sock, conn->session);
+        conn->session = NULL;
+    }
+}
+
+static void on_server_error(p2p_socket_t* sock, int error, void* user_data) {
+    (void)error;
+    server_conn_t* conn = (server_conn_t*)user_data;
+    server_close(conn->loop, sock, conn->session);
+    conn->session = NULL;
+}
+
+static uint64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void* server_main(void* arg) {
+    uint64_t cpu = thread_cpu_ns();
+    p2p_event_loop_run((p2p_event_loop_t*)arg);
+    g_run.server_cpu_ns = thread_cpu_ns() - cpu;
+    return NULL;
+}
+
+// ============================================================================
+// Client
+// ============================================================================
+
+// The payload is never modified, so zero-copy sends need no release
+static void keep_payload(void* ctx) {
+    (void)ctx;
+}
+
+static int send_plain_zerocopy(p2p_socket_t* sock, const uint8_t* payload, size_t size) {
+    uint8_t header[4] = {(uint8_t)(size >> 24), (uint8_t)(size >> 16),
+                         (uint8_t)(size >> 8), (uint8_t)size};
+    if (p2p_socket_send(sock, header, sizeof(header)) != (intptr_t)sizeof(header)) {
+        return -1;
+    }
+    return p2p_socket_send_zerocopy(sock, payload, size, keep_payload, NULL);
+}
+
+static void* client_sender(void* arg) {
+    client_t* c = (client_t*)arg;
+    uint8_t* payload = (uint8_t*)malloc(c->size);
+    p2p_message_t msg;
+
+    if (!payload) {
+        c->failed = 1;
+    } else {
+        memset(payload, 0xA5, c->size);
+        msg.data = payload;
+        msg.length = (uint32_t)c->size;
+    }
+
+    while (!c->failed && now_ns() < g_run.deadline_ns) {
+        pthread_mutex_lock(&c->lock);
+        while (c->sent - c->received >= (uint64_t)c->depth && !c->failed) {
+            pthread_cond_wait(&c->window, &c->lock);
+        }
+        c->sent_at[c->sent % (uint64_t)c->depth] = now_ns();
+        pthread_mutex_unlock(&c->lock);
+
+        int rc = c->encrypted ? p2p_session_send(c->session, c->sock, payload, c->size)
+               : c->zerocopy  ? send_plain_zerocopy(c->sock, payload, c->size)
+                              : p2p_message_send(c->sock, &msg);
+        if (rc != 0) {
+            c->failed = 1;
+            break;
+        }
+
+        pthread_mutex_lock(&c->lock);
+        c->sent++;
+        pthread_cond_broadcast(&c->window);
+        pthread_mutex_unlock(&c->lock);
+    }
+
+    pthread_mutex_lock(&c->lock);
+    c->done_sending = 1;
+    pthread_cond_broadcast(&c->window);
+    pthread_mutex_unlock(&c->lock);
+
+    // Every echo is in, so the kernel is done with the payload pages
+    p2p_socket_zerocopy_reap(c->sock);
+    free(payload);
+    return NULL;
+}
+
+static void* client_receiver(void* arg) {
+    client_t* c = (client_t*)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&c->lock);
+        while (c->received == c->sent && !c->done_sending) {
+            pthread_cond_wait(&c->window, &c->lock);
+        }
+        int finished = (c->received == c->sent && c->done_sending) || c->failed;
+        pthread_mutex_unlock(&c->lock);
+
+        if (finished) break;
+
+        // Echo for message `received` may arrive before sender bumps `sent`,
+        // which is fine: recv blocks until it is there
+        p2p_message_t* echo = c->encrypted ? p2p_session_recv(c->session, c->sock)
+                                           : p2p_message_recv(c->sock);
+        uint64_t t = now_ns();
+
+        if (!echo || echo->length != c->size) {
+            p2p_message_free(echo);
+            pthread_mutex_lock(&c->lock);
+            c->failed = 1;
+            pthread_cond_broadcast(&c->window);
+            pthread_mutex_unlock(&c->lock);
+            break;
+        }
+        p2p_message_free(echo);
+
+        pthread_mutex_lock(&c->lock);
+        p2p_histogram_record(g_run.latency, t - c->sent_at[c->received % (uint64_t)c->depth]);
+        c->received++;
+        pthread_cond_broadcast(&c->window);
+        pthread_mutex_unlock(&c->lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * Connect + optional handshake, wait for go, then run sender/receiver
+ */
+static void* client_main(void* arg) {
+    client_t* c = (client_t*)arg;
+
+    c->sock = p2p_socket_create(P2P_TCP);
+    if (!c->sock || p2p_socket_connect(c->sock, "127.0.0.1", c->port) != 0) {
+        c->failed = 1;
+    } else {
+        p2p_socket_set_nodelay(c->sock, 1);
+        if (c->zerocopy && p2p_socket_set_zerocopy(c->sock, c->zerocopy) != 0) {
+            c->failed = 1;
+        }
+        if (c->encrypted && !c->failed) {
+            c->session = p2p_handshake_client(c->sock, c->keypair, NULL);
+            if (!c->session) c->failed = 1;
+        }
+    }
+
+    pthread_barrier_wait(&g_run.start);
+    pthread_barrier_wait(&g_run.go);
+
+    if (!c->failed) {
+        pthread_create(&c->receiver, NULL, client_receiver, c);
+        client_sender(c);
+        pthread_join(c->receiver, NULL);
+    }
+
+    p2p_session_free(c->session);
+    p2p_socket_close(c->sock);
+    return NULL;
+}
+
+// ============================================================================
+// One configuration
+// ============================================================================
+
+static int run_config(const options_t* opts, p2p_socket_t* listener,
+                      p2p_keypair_t* server_kp, p2p_keypair_t* client_kp,
+                      int encrypted, size_t size, int conns, int depth) {
+    client_t* clients = (client_t*)calloc((size_t)conns, sizeof(client_t));
+    server_conn_t* server_conns = (server_conn_t*)calloc((size_t)conns, sizeof(server_conn_t));
+    pthread_t* threads = (pthread_t*)calloc((size_t)conns, sizeof(pthread_t));
+    p2p_event_loop_t* loop = p2p_event_loop_create();
+    if (!clients || !server_conns || !threads || !loop) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+
+    g_run.latency = p2p_histogram_create();
+    p2p_event_loop_set_busy_poll(loop, opts->busy_poll_ns, opts->so_busy_poll_us);
+    pthread_barrier_init(&g_run.start, NULL, (unsigned)conns + 1);
+    pthread_barrier_init(&g_run.go, NULL, (unsigned)conns + 1);
+
+    for (int i = 0; i < conns; i++) {
+        client_t* c = &clients[i];
+        c->port = opts->port;
+        c->size = size;
+        c->depth = depth;
+        c->encrypted = encrypted;
+        c->zerocopy = opts->zerocopy;
+        c->keypair = client_kp;
+        c->sent_at = (uint64_t*)calloc((size_t)depth, sizeof(uint64_t));
+        pthread_mutex_init(&c->lock, NULL);
+        pthread_cond_init(&c->window, NULL);
+        pthread_create(&threads[i], NULL, client_main, c);
+    }
+
+    // Accept (and handshake) every client, register with the loop
+    int accepted = 0;
+    for (int i = 0; i < conns; i++) {
+        p2p_socket_t* sock = p2p_socket_accept(listener);
+        if (!sock) break;
+        p2p_socket_set_nodelay(sock, 1);
+        if (opts->zerocopy && p2p_socket_set_zerocopy(sock, opts->zerocopy) == 0) {
+            server_conns[i].zerocopy = 1;
+        }
+
+        server_conns[i].loop = loop;
+        if (encrypted) {
+            server_conns[i].session = p2p_handshake_server(sock, server_kp, NULL, 0);
+            if (!server_conns[i].session) {
+                p2p_socket_close(sock);
+                break;
+            }
+        }
+
+        p2p_event_loop_add_socket(loop, sock, on_server_read, on_server_error, &server_conns[i]);
+        accepted++;
+    }
+
+    pthread_barrier_wait(&g_run.start);
+
+    pthread_t server;
+    pthread_create(&server, NULL, server_main, loop);
+
+    uint64_t start = now_ns();
+    g_run.deadline_ns = start + (uint64_t)opts->duration_ms * 1000000ULL;
+    pthread_barrier_wait(&g_run.go);
+
+    for (int i = 0; i < conns; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    // Clients closed their sockets - loop stops when the last one is removed
+    pthread_join(server, NULL);
+
+    uint64_t messages = 0;
+    int failed = (accepted != conns);
+    for (int i = 0; i < conns; i++) {
+        messages += clients[i].received;
+        failed |= clients[i].failed;
+        free(clients[i].sent_at);
+        pthread_mutex_destroy(&clients[i].lock);
+        pthread_cond_destroy(&clients[i].window);
+    }
+
+    double seconds = (double)elapsed / 1e9;
+    p2p_histogram_t* h = g_run.latency;
+
+    printf("{\"bench\":\"loopback\",\"mode\":\"%s\",\"size\":%zu,\"conns\":%d,\"depth\":%d,\"zerocopy\":%zu,"
+           "\"busy_poll_ns\":%llu,\"messages\":%llu,\"seconds\":%.3f,\"msgs_per_sec\":%.0f,\"mb_per_sec\":%.2f,"
+           "\"p50_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f,"
+           "\"server_cpu_pct\":%.1f,\"errors\":%d}\n",
+           encrypted ? "encrypted" : "plain", size, conns, depth, opts->zerocopy,
+           (unsigned long long)opts->busy_poll_ns,
+           (unsigned long long)messages, seconds,
+           (double)messages / seconds,
+           (double)messages * (double)size / seconds / 1e6,
+           p2p_histogram_percentile(h, 50.0) / 1e3,
+           p2p_histogram_percentile(h, 99.0) / 1e3,
+           p2p_histogram_percentile(h, 99.9) / 1e3,
+           p2p_histogram_max(h) / 1e3,
+           100.0 * (double)g_run.server_cpu_ns / (double)elapsed,
+           failed);
+    fflush(stdout);
+
+    p2p_histogram_free(h);
+    pthread_barrier_destroy(&g_run.start);
+    pthread_barrier_destroy(&g_run.go);
+    p2p_event_loop_free(loop);
+    free(threads);
+    free(server_conns);
+    free(clients);
+
+    return failed ? -1 : 0;
+}
+
+// ============================================================================
+// Options
+// ============================================================================
+
+static int parse_list(const char* value, void* out, int is_size) {
+    int n = 0;
+    char* copy = strdup(value);
+    for (char* tok = strtok(copy, ","); tok && n < MAX_LIST; tok = strtok(NULL, ",")) {
+        if (is_size) {
+            ((size_t*)out)[n++] = (size_t)strtoull(tok, NULL, 10);
+        } else {
+            ((int*)out)[n++] = atoi(tok);
+        }
+    }
+    free(copy);
+    return n;
+}
+
+static int parse_options(int argc, char** argv, options_t* opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->plain = 1;
+    opts->encrypted = 1;
+    opts->duration_ms = 500;
+    opts->port = 47000;
+
+    opts->num_sizes = (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+    memcpy(opts->sizes, default_sizes, sizeof(default_sizes));
+    opts->num_conns = (int)(sizeof(default_conns) / sizeof(default_conns[0]));
+    memcpy(opts->conns, default_conns, sizeof(default_conns));
+    opts->num_depth = (int)(sizeof(default_depth) / sizeof(default_depth[0]));
+    memcpy(opts->depth, default_depth, sizeof(default_depth));
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (strncmp(a, "--mode=", 7) == 0) {
+            opts->plain = strcmp(a + 7, "encrypted") != 0;
+            opts->encrypted = strcmp(a + 7, "plain") != 0;
+        } else if (strncmp(a, "--sizes=", 8) == 0) {
+            opts->num_sizes = parse_list(a + 8, opts->sizes, 1);
+        } else if (strncmp(a, "--conns=", 8) == 0) {
+            opts->num_conns = parse_list(a + 8, opts->conns, 0);
+        } else if (strncmp(a, "--depth=", 8) == 0) {
+            opts->num_depth = parse_list(a + 8, opts->depth, 0);
+        } else if (strncmp(a, "--duration-ms=", 14) == 0) {
+            opts->duration_ms = atoi(a + 14);
+        } else if (strncmp(a, "--zerocopy=", 11) == 0) {
+            opts->zerocopy = (size_t)strtoull(a + 11, NULL, 10);
+        } else if (strncmp(a, "--busy-poll=", 12) == 0) {
+            opts->busy_poll_ns = strtoull(a + 12, NULL, 10);
+        } else if (strncmp(a, "--so-busy-poll=", 15) == 0) {
+            opts->so_busy_poll_us = atoi(a + 15);
+        } else if (strncmp(a, "--port=", 7) == 0) {
+            opts->port = (uint16_t)atoi(a + 7);
+        } else {
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < opts->num_sizes; i++) {
+        if (opts->sizes[i] == 0 || opts->sizes[i] > P2P_MAX_MESSAGE_SIZE) return -1;
+    }
+    for (int i = 0; i < opts->num_conns; i++) {
+        if (opts->conns[i] < 1) return -1;
+    }
+    for (int i = 0; i < opts->num_depth; i++) {
+        if (opts->depth[i] < 1) return -1;
+    }
+
+    return opts->duration_ms > 0 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    options_t opts;
+    if (parse_options(argc, argv, &opts) != 0) {
+        fprintf(stderr, "usage: %s [--mode=plain|encrypted|both] [--sizes=16,1024,...]\n"
+                        "       [--conns=1,4,16] [--depth=1,16] [--duration-ms=500]\n"
+                        "       [--zerocopy=BYTES] [--busy-poll=NS] [--so-busy-poll=US]\n"
+                        "       [--port=47000]\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (p2p_init() < 0 || p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    if (!listener ||
+        p2p_socket_bind(listener, "127.0.0.1", opts.port) != 0 ||
+        p2p_socket_listen(listener, 1024) != 0) {
+        fprintf(stderr, "listen failed: %s\n", p2p_get_error());
+        return 1;
+    }
+
+    p2p_keypair_t* server_kp = p2p_keypair_generate();
+    p2p_keypair_t* client_kp = p2p_keypair_generate();
+
+    int status = 0;
+    for (int mode = 0; mode < 2; mode++) {
+        if ((mode == 0 && !opts.plain) || (mode == 1 && !opts.encrypted)) continue;
+
+        for (int s = 0; s < opts.num_sizes; s++) {
+            for (int c = 0; c < opts.num_conns; c++) {
+                for (int d = 0; d < opts.num_depth; d++) {
+                    if (run_config(&opts, listener, server_kp, client_kp, mode,
+                                   opts.sizes[s], opts.conns[c], opts.depth[d]) != 0) {
+                        status = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    p2p_keypair_free(server_kp);
+    p2p_keypair_free(client_kp);
+    p2p_socket_close(listener);
+    p2p_cleanup();
+
+    return status;
+}
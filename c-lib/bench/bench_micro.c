@@ -0,0 +1,518 @@
+/**
+ * bench_micro - Microbenchmarks for message, framing and crypto hot paths
+ *
+ * Usage: bench_micro [--filter=NAME] [--samples=15] [--sample-ms=20]
+ *
+ * Runs each hot-path primitive in isolation (no network, except the
+ * handshake which runs over p2p_socket_pair()):
+ *
+ *   message_create_free   p2p_message_create_binary() + p2p_message_free()
+ *   frame_encode          Length header + payload into a wire buffer
+ *   frame_decode          Header parse + size check + message allocation
+ *   message_send_recv_unix    p2p_message_send() + recv() over an AF_UNIX pair
+ *   message_send_recv_memory  The same over the in-memory transport
+ *   nonce_construct       p2p_construct_nonce()
+ *   nonce_extract         p2p_extract_counter()
+ *   aead_seal             p2p_session_seal_record() by size
+ *   aead_open             p2p_session_open_record() by size (incl. message alloc)
+ *   derive_session_key    p2p_derive_session_key()
+ *   handshake             Full client + server handshake, per handshake
+ *   fingerprint           p2p_keypair_fingerprint()
+ *   pubkey_from_fingerprint  p2p_pubkey_from_fingerprint()
+ *
+ * Each benchmark is calibrated to ~sample-ms per sample, warmed up with one
+ * discarded sample, then timed over `samples` samples. The median is
+ * reported together with the interquartile spread, so a run on a noisy
+ * machine is visible as such instead of silently shifting the number.
+ *
+ * Output: one JSON object per benchmark and size (machine-readable)
+ */
+
+#include <p2pnet/p2pnet.h>
+#include "../src/crypto/session_internal.h"
+#include "../src/protocol/frame.h"
+#include "../src/platform/clock.h"
+#include "../src/platform/thread.h"
+#include <sodium.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SAMPLES 101
+
+// Internal (session.c)
+p2p_session_t* p2p_session_create(const uint8_t* session_key,
+                                   const uint8_t* peer_pubkey);
+
+static const size_t message_sizes[] = {16, 1024, 65536};
+static const size_t aead_sizes[] = {64, 1024, 16384, 65536, 1048576};
+
+typedef void (*bench_fn)(void* ctx, uint64_t iterations);
+
+typedef struct {
+    const char* filter;
+    int samples;
+    uint64_t sample_ns;
+} options_t;
+
+static options_t g_opts;
+
+// Results are folded in here so the compiler cannot drop the work
+static volatile uint64_t g_sink;
+
+// ============================================================================
+// Runner
+// ============================================================================
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t time_run(bench_fn fn, void* ctx, uint64_t iterations) {
+    uint64_t start = p2p_clock_ns();
+    fn(ctx, iterations);
+    return p2p_clock_ns() - start;
+}
+
+static void run(const char* name, size_t size, bench_fn fn, void* ctx) {
+    if (g_opts.filter && strstr(name, g_opts.filter) == NULL) return;
+
+    // Calibrate: grow until a run is long enough to scale from
+    uint64_t iterations = 1;
+    uint64_t elapsed = time_run(fn, ctx, iterations);
+    while (elapsed < g_opts.sample_ns / 10 && iterations < (1ULL << 40)) {
+        iterations *= 2;
+        elapsed = time_run(fn, ctx, iterations);
+    }
+    if (elapsed > 0) {
+        iterations = iterations * g_opts.sample_ns / elapsed;
+    }
+    if (iterations == 0) iterations = 1;
+
+    // Warm-up sample (caches, branch predictors, allocator, CPU clocks)
+    time_run(fn, ctx, iterations);
+
+    double ns_per_op[MAX_SAMPLES];
+    for (int i = 0; i < g_opts.samples; i++) {
+        ns_per_op[i] = (double)time_run(fn, ctx, iterations) / (double)iterations;
+    }
+    qsort(ns_per_op, (size_t)g_opts.samples, sizeof(double), compare_double);
+
+    int n = g_opts.samples;
+    double median = ns_per_op[n / 2];
+    double spread = ns_per_op[(3 * n) / 4] - ns_per_op[n / 4];
+
+    printf("{\"bench\":\"micro\",\"name\":\"%s\",\"size\":%zu,\"iterations\":%llu,"
+           "\"ns_per_op\":%.1f,\"min_ns\":%.1f,\"spread_pct\":%.1f",
+           name, size, (unsigned long long)iterations,
+           median, ns_per_op[0], median > 0.0 ? 100.0 * spread / median : 0.0);
+    if (size > 0) {
+        printf(",\"mb_per_sec\":%.1f", (double)size * 1e3 / median);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+// ============================================================================
+// Message + framing
+// ============================================================================
+
+typedef struct {
+    uint8_t* payload;
+    uint8_t* wire;
+    size_t size;
+} frame_ctx_t;
+
+static void bench_message_create_free(void* arg, uint64_t iterations) {
+    frame_ctx_t* ctx = (frame_ctx_t*)arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        p2p_message_t* msg = p2p_message_create_binary(ctx->payload, ctx->size);
+        g_sink += msg->length;
+        p2p_message_free(msg);
+    }
+}
+
+static void bench_frame_encode(void* arg, uint64_t iterations) {
+    frame_ctx_t* ctx = (frame_ctx_t*)arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        p2p_frame_encode_header((uint32_t)ctx->size, ctx->wire);
+        memcpy(ctx->wire + P2P_FRAME_HEADER_SIZE, ctx->payload, ctx->size);
+        g_sink += ctx->wire[P2P_FRAME_HEADER_SIZE];
+    }
+}
+
+static void bench_frame_decode(void* arg, uint64_t iterations) {
+    frame_ctx_t* ctx = (frame_ctx_t*)arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint32_t length = p2p_frame_decode_header(ctx->wire);
+        if (length == 0 || length > P2P_MAX_MESSAGE_SIZE) abort();
+
+        p2p_message_t* msg = p2p_message_create_binary(ctx->wire + P2P_FRAME_HEADER_SIZE, length);
+        g_sink += msg->data[0];
+        p2p_message_free(msg);
+    }
+}
+
+// ============================================================================
+// Transports (same thread sends then receives, so no scheduler in the path)
+// ============================================================================
+
+typedef struct {
+    p2p_socket_t* a;
+    p2p_socket_t* b;
+    p2p_message_t msg;
+} transport_ctx_t;
+
+static void bench_message_send_recv(void* arg, uint64_t iterations) {
+    transport_ctx_t* ctx = (transport_ctx_t*)arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (p2p_message_send(ctx->a, &ctx->msg) != 0) abort();
+
+        p2p_message_t* msg = p2p_message_recv(ctx->b);
+        if (!msg) abort();
+        g_sink += msg->data[0];
+        p2p_message_free(msg);
+    }
+}
+
+// ============================================================================
+// Broadcast fan-out (per-recipient copy vs one shared buffer)
+// ============================================================================
+
+#define FANOUT 64
+
+typedef struct {
+    p2p_socket_t* senders[FANOUT];
+    p2p_socket_t* receivers[FANOUT];
+    uint8_t* payload;
+    uint8_t* scratch;
+    size_t size;
+} fanout_ctx_t;
+
+static void drain_fanout(fanout_ctx_t* ctx) {
+    size_t frame = P2P_FRAME_HEADER_SIZE + ctx->size;
+    for (int r = 0; r < FANOUT; r++) {
+        for (size_t got = 0; got < frame; ) {
+            intptr_t n = p2p_socket_recv(ctx->receivers[r], ctx->scratch, frame - got);
+            if (n <= 0) abort();
+            got += (size_t)n;
+        }
+    }
+}
+
+static void bench_broadcast_copy(void* arg, uint64_t iterations) {
+    fanout_ctx_t* ctx = (fanout_ctx_t*)arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (int r = 0; r < FANOUT; r++) {
+            p2p_message_t* msg = p2p_message_create_binary(ctx->payload, ctx->size);
+            if (p2p_message_send(ctx->senders[r], msg) != 0) abort();
+            p2p_message_free(msg);
+        }
+        drain_fanout(ctx);
+    }
+}
+
+static void bench_broadcast_shared(void* arg, uint64_t iterations) {
+    fanout_ctx_t* ctx = (fanout_ctx_t*)arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        p2p_shared_message_t* msg = p2p_shared_message_create(ctx->payload, ctx->size);
+        if (p2p_message_broadcast(ctx->senders, FANOUT, msg) != FANOUT) abort();
+        p2p_shared_message_unref(msg);
+        drain_fanout(ctx);
+    }
+}
+
+// ============================================================================
+// Nonce
+// ============================================================================
+
+static void bench_nonce_construct(void* arg, uint64_t iterations) {
+    (void)arg;
+    uint8_t nonce[P2P_NONCE_SIZE];
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        p2p_construct_nonce(i, nonce);
+        acc += nonce[7];
+    }
+    g_sink += acc;
+}
+
+static void bench_nonce_extract(void* arg, uint64_t iterations) {
+    (void)arg;
+    uint8_t nonce[P2P_NONCE_SIZE] = {0};
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        nonce[7] = (uint8_t)i;
+        acc += p2p_extract_counter(nonce);
+    }
+    g_sink += acc;
+}
+
+// ============================================================================
+// AEAD + key derivation
+// ============================================================================
+
+typedef struct {
+    p2p_session_t* session;
+    uint8_t nonce[P2P_NONCE_SIZE];
+    uint8_t* plaintext;
+    uint8_t* ciphertext;
+    size_t size;
+} aead_ctx_t;
+
+static void bench_aead_seal(void* arg, uint64_t iterations) {
+    aead_ctx_t* ctx = (aead_ctx_t*)arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        p2p_construct_nonce(i, ctx->nonce);
+        if (p2p_session_seal_record(ctx->session, ctx->nonce, ctx->plaintext, ctx->size,
+                                    ctx->ciphertext) != 0) {
+            abort();
+        }
+        g_sink += ctx->ciphertext[0];
+    }
+}
+
+static void bench_aead_open(void* arg, uint64_t iterations) {
+    aead_ctx_t* ctx = (aead_ctx_t*)arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        p2p_message_t* msg = p2p_session_open_record(ctx->session, ctx->nonce, ctx->ciphertext,
+                                                     ctx->size + P2P_MAC_SIZE);
+        if (!msg) abort();
+        g_sink += msg->data[0];
+        p2p_message_free(msg);
+    }
+}
+
+static void bench_derive_session_key(void* arg, uint64_t iterations) {
+    (void)arg;
+    uint8_t shared[32] = {1}, alice[32] = {2}, bob[32] = {3}, key[32];
+    for (uint64_t i = 0; i < iterations; i++) {
+        shared[0] = (uint8_t)i;
+        p2p_derive_session_key(key, shared, alice, bob);
+        g_sink += key[0];
+    }
+}
+
+// ============================================================================
+// Handshake (socket pair, server side in its own thread)
+// ============================================================================
+
+typedef struct {
+    p2p_socket_t* client;
+    p2p_socket_t* server;
+    p2p_keypair_t* client_kp;
+    p2p_keypair_t* server_kp;
+} handshake_ctx_t;
+
+static P2P_THREAD_FUNC(handshake_server_main) {
+    handshake_ctx_t* ctx = (handshake_ctx_t*)arg;
+
+    // Serve handshakes back to back until the client end is closed
+    p2p_session_t* session;
+    while ((session = p2p_handshake_server(ctx->server, ctx->server_kp, NULL, 0)) != NULL) {
+        p2p_session_free(session);
+    }
+
+    P2P_THREAD_EXIT;
+}
+
+static void bench_handshake(void* arg, uint64_t iterations) {
+    handshake_ctx_t* ctx = (handshake_ctx_t*)arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        p2p_session_t* session = p2p_handshake_client(ctx->client, ctx->client_kp,
+                                                      ctx->server_kp->public_key);
+        if (!session) abort();
+        p2p_session_free(session);
+    }
+}
+
+// ============================================================================
+// Fingerprints
+// ============================================================================
+
+typedef struct {
+    p2p_keypair_t* keypair;
+    char fingerprint[64];
+} fingerprint_ctx_t;
+
+static void bench_fingerprint(void* arg, uint64_t iterations) {
+    fingerprint_ctx_t* ctx = (fingerprint_ctx_t*)arg;
+    char out[64];
+    for (uint64_t i = 0; i < iterations; i++) {
+        p2p_keypair_fingerprint(ctx->keypair, out, sizeof(out));
+        g_sink += (uint8_t)out[0];
+    }
+}
+
+static void bench_pubkey_from_fingerprint(void* arg, uint64_t iterations) {
+    fingerprint_ctx_t* ctx = (fingerprint_ctx_t*)arg;
+    uint8_t pubkey[32];
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (p2p_pubkey_from_fingerprint(pubkey, ctx->fingerprint) != 0) abort();
+        g_sink += pubkey[0];
+    }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+static int parse_options(int argc, char** argv) {
+    g_opts.samples = 15;
+    g_opts.sample_ns = 20ULL * 1000000ULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (strncmp(a, "--filter=", 9) == 0) {
+            g_opts.filter = a + 9;
+        } else if (strncmp(a, "--samples=", 10) == 0) {
+            g_opts.samples = atoi(a + 10);
+        } else if (strncmp(a, "--sample-ms=", 12) == 0) {
+            g_opts.sample_ns = (uint64_t)atoi(a + 12) * 1000000ULL;
+        } else {
+            return -1;
+        }
+    }
+
+    return (g_opts.samples >= 1 && g_opts.samples <= MAX_SAMPLES && g_opts.sample_ns > 0) ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    if (parse_options(argc, argv) != 0) {
+        fprintf(stderr, "usage: %s [--filter=NAME] [--samples=15] [--sample-ms=20]\n", argv[0]);
+        return 1;
+    }
+
+    if (p2p_init() < 0 || p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    size_t max_size = aead_sizes[sizeof(aead_sizes) / sizeof(aead_sizes[0]) - 1];
+    uint8_t* payload = (uint8_t*)malloc(max_size);
+    uint8_t* wire = (uint8_t*)malloc(max_size + P2P_FRAME_HEADER_SIZE + P2P_MAC_SIZE);
+    if (!payload || !wire) return 1;
+    randombytes_buf(payload, max_size);
+
+    // ---- Message + framing ----------------------------------------------------
+
+    for (size_t i = 0; i < sizeof(message_sizes) / sizeof(message_sizes[0]); i++) {
+        frame_ctx_t ctx = {payload, wire, message_sizes[i]};
+        run("message_create_free", ctx.size, bench_message_create_free, &ctx);
+        run("frame_encode", ctx.size, bench_frame_encode, &ctx);
+
+        bench_frame_encode(&ctx, 1);    // Decode needs a valid frame even when filtered
+        run("frame_decode", ctx.size, bench_frame_decode, &ctx);
+    }
+
+    // ---- Transports -------------------------------------------------------------
+
+    transport_ctx_t unix_pair, memory_pair;
+    if (p2p_socket_pair(&unix_pair.a, &unix_pair.b) != 0 ||
+        p2p_socket_pair_memory(&memory_pair.a, &memory_pair.b, 0) != 0) {
+        fprintf(stderr, "socket pair failed: %s\n", p2p_get_error());
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(message_sizes) / sizeof(message_sizes[0]); i++) {
+        p2p_message_t msg = {.length = (uint32_t)message_sizes[i], .data = payload};
+        unix_pair.msg = msg;
+        memory_pair.msg = msg;
+        run("message_send_recv_unix", msg.length, bench_message_send_recv, &unix_pair);
+        run("message_send_recv_memory", msg.length, bench_message_send_recv, &memory_pair);
+    }
+
+    p2p_socket_close(unix_pair.a);
+    p2p_socket_close(unix_pair.b);
+    p2p_socket_close(memory_pair.a);
+    p2p_socket_close(memory_pair.b);
+
+    // ---- Broadcast ----------------------------------------------------------------
+
+    fanout_ctx_t fanout;
+    fanout.payload = payload;
+    fanout.scratch = wire;
+    for (int r = 0; r < FANOUT; r++) {
+        if (p2p_socket_pair_memory(&fanout.senders[r], &fanout.receivers[r], 0) != 0) return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(message_sizes) / sizeof(message_sizes[0]); i++) {
+        fanout.size = message_sizes[i];
+        run("broadcast_copy_64", fanout.size, bench_broadcast_copy, &fanout);
+        run("broadcast_shared_64", fanout.size, bench_broadcast_shared, &fanout);
+    }
+
+    for (int r = 0; r < FANOUT; r++) {
+        p2p_socket_close(fanout.senders[r]);
+        p2p_socket_close(fanout.receivers[r]);
+    }
+
+    // ---- Nonce ------------------------------------------------------------------
+
+    run("nonce_construct", 0, bench_nonce_construct, NULL);
+    run("nonce_extract", 0, bench_nonce_extract, NULL);
+
+    // ---- AEAD + key derivation ----------------------------------------------------
+
+    uint8_t key[32], peer[32];
+    randombytes_buf(key, sizeof(key));
+    randombytes_buf(peer, sizeof(peer));
+    p2p_session_t* session = p2p_session_create(key, peer);
+    sodium_memzero(key, sizeof(key));
+    if (!session) return 1;
+
+    for (size_t i = 0; i < sizeof(aead_sizes) / sizeof(aead_sizes[0]); i++) {
+        aead_ctx_t ctx;
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.session = session;
+        ctx.plaintext = payload;
+        ctx.ciphertext = wire;
+        ctx.size = aead_sizes[i];
+
+        run("aead_seal", ctx.size, bench_aead_seal, &ctx);
+
+        // Open always decrypts the same valid record
+        p2p_construct_nonce(1, ctx.nonce);
+        p2p_session_seal_record(session, ctx.nonce, payload, ctx.size, wire);
+        run("aead_open", ctx.size, bench_aead_open, &ctx);
+    }
+
+    p2p_session_free(session);
+    run("derive_session_key", 0, bench_derive_session_key, NULL);
+
+    // ---- Handshake ------------------------------------------------------------------
+
+    handshake_ctx_t hs;
+    hs.client_kp = p2p_keypair_generate();
+    hs.server_kp = p2p_keypair_generate();
+    if (!hs.client_kp || !hs.server_kp || p2p_socket_pair(&hs.client, &hs.server) != 0) {
+        fprintf(stderr, "handshake setup failed: %s\n", p2p_get_error());
+        return 1;
+    }
+
+    p2p_thread_t server_thread;
+    p2p_thread_start(&server_thread, handshake_server_main, &hs);
+    run("handshake", 0, bench_handshake, &hs);
+
+    // Closing the client end makes the server's next handshake fail
+    p2p_socket_close(hs.client);
+    p2p_thread_join(server_thread);
+    p2p_socket_close(hs.server);
+
+    // ---- Fingerprints -----------------------------------------------------------------
+
+    fingerprint_ctx_t fp;
+    fp.keypair = hs.client_kp;
+    p2p_keypair_fingerprint(fp.keypair, fp.fingerprint, sizeof(fp.fingerprint));
+    run("fingerprint", 0, bench_fingerprint, &fp);
+    run("pubkey_from_fingerprint", 0, bench_pubkey_from_fingerprint, &fp);
+
+    p2p_keypair_free(hs.client_kp);
+    p2p_keypair_free(hs.server_kp);
+    free(payload);
+    free(wire);
+    p2p_cleanup();
+
+    return 0;
+}
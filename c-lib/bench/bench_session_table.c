@@ -0,0 +1,156 @@
+/**
+ * bench_session_table - Memory footprint and lookup cost at 1M sessions
+ *
+ * Usage: bench_session_table [num_sessions]   (default 1000000)
+ *
+ * Output: one JSON object per line (machine-readable)
+ */
+
+#include <p2pnet/p2pnet.h>
+#include <sodium.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <time.h>
+#endif
+
+static uint64_t now_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart * 1000000000.0 / freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Resident set size in bytes (0 if unknown)
+ */
+static size_t rss_bytes(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return pmc.WorkingSetSize;
+    }
+    return 0;
+#else
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+
+    unsigned long size = 0, resident = 0;
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(f);
+
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+int main(int argc, char** argv) {
+    size_t n = (argc > 1) ? (size_t)strtoull(argv[1], NULL, 10) : 1000000;
+    if (n == 0) {
+        fprintf(stderr, "usage: %s [num_sessions]\n", argv[0]);
+        return 1;
+    }
+
+    if (p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    // Peer keys and a shuffled lookup order, allocated before measuring RSS
+    uint8_t (*pubkeys)[32] = malloc(n * 32);
+    uint64_t* order = malloc(n * sizeof(uint64_t));
+    if (!pubkeys || !order) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    randombytes_buf(pubkeys, n * 32);
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = randombytes_uniform((uint32_t)(i + 1));
+        uint64_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    size_t rss_before = rss_bytes();
+
+    p2p_session_table_t* table = p2p_session_table_create(n);
+    if (!table) {
+        fprintf(stderr, "failed to create table\n");
+        return 1;
+    }
+
+    // Insert
+    uint8_t key[32];
+    randombytes_buf(key, sizeof(key));
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        p2p_session_t* s = p2p_session_create(key, pubkeys[i]);
+        if (!s || !p2p_session_table_adopt(table, s, (uint64_t)i + 1)) {
+            fprintf(stderr, "insert %zu failed\n", i);
+            return 1;
+        }
+    }
+    uint64_t insert_ns = now_ns() - start;
+
+    size_t rss_after = rss_bytes();
+
+    // Lookup by connection id (random order)
+    uint64_t found = 0;
+    start = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        found += (p2p_session_table_find_conn(table, order[i] + 1) != NULL);
+    }
+    uint64_t conn_ns = now_ns() - start;
+
+    // Lookup by peer public key (random order)
+    start = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        found += (p2p_session_table_find_peer(table, pubkeys[order[i]]) != NULL);
+    }
+    uint64_t peer_ns = now_ns() - start;
+
+    // Remove all
+    start = now_ns();
+    for (size_t i = 0; i < n; i++) {
+        p2p_session_free(p2p_session_table_find_conn(table, order[i] + 1));
+    }
+    uint64_t remove_ns = now_ns() - start;
+
+    size_t table_bytes = p2p_session_table_memory_usage(table);
+
+    printf("{\"bench\":\"session_table\",\"sessions\":%zu,"
+           "\"table_bytes\":%zu,\"table_bytes_per_session\":%.1f,"
+           "\"key_bytes_per_session\":32,"
+           "\"rss_delta_bytes\":%zu,\"rss_bytes_per_session\":%.1f,"
+           "\"insert_ns_per_op\":%.1f,\"find_conn_ns_per_op\":%.1f,"
+           "\"find_peer_ns_per_op\":%.1f,\"remove_ns_per_op\":%.1f,"
+           "\"found\":%llu}\n",
+           n, table_bytes, (double)table_bytes / n,
+           rss_after > rss_before ? rss_after - rss_before : 0,
+           rss_after > rss_before ? (double)(rss_after - rss_before) / n : 0.0,
+           (double)insert_ns / n, (double)conn_ns / n,
+           (double)peer_ns / n, (double)remove_ns / n,
+           (unsigned long long)found);
+
+    p2p_session_table_free(table);
+    free(pubkeys);
+    free(order);
+
+    return 0;
+}
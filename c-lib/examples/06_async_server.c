@@ -20,21 +20,34 @@ void signal_handler(int signum) {
     }
 }
 
-// Callback når server socket har ny connection
+// Opptaksregler: stopper reconnect-stormer før de koster noe
+static p2p_admission_t* g_admission = NULL;
+
+#define ACCEPT_BATCH 32
+
+// Callback når server socket har nye connections (kan være mange per event)
 void on_server_accept(p2p_socket_t* server_sock, void* user_data) {
     p2p_event_loop_t* loop = (p2p_event_loop_t*)user_data;
     
-    p2p_socket_t* client = p2p_socket_accept(server_sock);
-    if (!client) {
-        printf("[ERROR] Failed to accept client\n");
-        return;
+    p2p_socket_t* clients[ACCEPT_BATCH];
+    int count;
+    while ((count = p2p_socket_accept_batch(server_sock, clients, ACCEPT_BATCH,
+                                            g_admission, 0)) > 0) {
+        for (int i = 0; i < count; i++) {
+            // Ingen handshake i dette eksempelet: ferdig med en gang
+            p2p_socket_admitted(clients[i]);
+            
+            // Legg til client i event loop
+            p2p_event_loop_add_socket(loop, clients[i], on_client_data, on_client_error, loop);
+        }
+        
+        printf("[OK] %d new client(s) connected (total: %d)\n",
+               count, p2p_event_loop_socket_count(loop) - 1);
     }
     
-    printf("[OK] New client connected (total: %d)\n", 
-           p2p_event_loop_socket_count(loop));
-    
-    // Legg til client i event loop
-    p2p_event_loop_add_socket(loop, client, on_client_data, on_client_error, loop);
+    if (count < 0) {
+        printf("[ERROR] Failed to accept client: %s\n", p2p_get_error());
+    }
 }
 
 // Callback når client har data
@@ -99,13 +112,17 @@ int main() {
         return 1;
     }
     
-    if (p2p_socket_listen(server, 10) != 0) {
+    if (p2p_socket_listen(server, SOMAXCONN) != 0 ||
+        p2p_socket_set_nonblocking(server, 1) != 0) {
         printf("[ERROR] Listen failed\n");
         p2p_socket_close(server);
         p2p_cleanup();
         return 1;
     }
     
+    // Maks 128 uferdige handshakes, maks 16 tilkoblinger per IP
+    g_admission = p2p_admission_create(128, 16);
+    
     printf("[OK] Server listening on port 8080\n");
     printf("[OK] Using async event loop (WSAPoll)\n");
     printf("[OK] Can handle multiple concurrent clients\n\n");
@@ -133,6 +150,7 @@ int main() {
     // Cleanup
     p2p_event_loop_free(loop);
     p2p_socket_close(server);
+    p2p_admission_free(g_admission);
     p2p_cleanup();
     
     printf("\n[OK] Server shutdown complete\n");
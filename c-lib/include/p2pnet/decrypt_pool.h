@@ -0,0 +1,91 @@
+#ifndef P2PNET_DECRYPT_POOL_H
+#define P2PNET_DECRYPT_POOL_H
+
+#include <p2pnet/session.h>
+#include <p2pnet/socket.h>
+#include <p2pnet/message.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Decrypt Pipeline
+ *
+ * Offloads ChaCha20-Poly1305 decryption from the I/O thread:
+ *
+ *   I/O thread          Worker threads           Reorder buffer
+ *   ───────────         ──────────────           ──────────────
+ *   read record  ──►    verify MAC + decrypt ──► deliver in original
+ *   (framing only)      (in parallel)            order to callback
+ *
+ * The I/O thread only frames records and dispatches them. Records are
+ * delivered to the application callback in exactly the order they were
+ * submitted, so replay protection (strictly increasing nonce) still holds.
+ */
+
+/**
+ * Opaque decrypt pool
+ */
+typedef struct p2p_decrypt_pool p2p_decrypt_pool_t;
+
+/**
+ * Callback for a decrypted message
+ *
+ * @param session Session the record belonged to
+ * @param msg Decrypted message, or NULL if MAC verification failed or
+ *            the nonce was replayed (caller must p2p_message_free() it)
+ * @param user_data User data passed to p2p_session_recv_async()
+ *
+ * @note Called from a worker thread, never concurrently with itself
+ */
+typedef void (*p2p_decrypt_callback)(p2p_session_t* session,
+                                     p2p_message_t* msg,
+                                     void* user_data);
+
+/**
+ * Create decrypt pool
+ *
+ * @param num_workers Number of decrypt threads (>= 1)
+ * @param max_in_flight Reorder buffer size - max records submitted but not
+ *                      yet delivered (0 = default 64)
+ * @return New pool, or NULL on error
+ */
+p2p_decrypt_pool_t* p2p_decrypt_pool_create(int num_workers, size_t max_in_flight);
+
+/**
+ * Deliver all pending records, stop workers and free pool
+ *
+ * @param pool Pool to free (can be NULL)
+ */
+void p2p_decrypt_pool_free(p2p_decrypt_pool_t* pool);
+
+/**
+ * Receive one encrypted record and hand it to the decrypt pool
+ *
+ * Reads exactly one record from the socket (blocking) and returns as soon
+ * as it is queued. Blocks if max_in_flight records are already pending.
+ *
+ * @param pool Decrypt pool
+ * @param session Session with shared encryption key
+ * @param sock Connected socket
+ * @param on_message Callback for the decrypted message
+ * @param user_data User data passed to callback
+ * @return 0 if queued, -1 on framing error or disconnect
+ *
+ * @note Session must stay alive until its records are delivered
+ *       (see p2p_decrypt_pool_flush())
+ * @note Do not mix with p2p_session_recv() on the same session
+ */
+int p2p_session_recv_async(p2p_decrypt_pool_t* pool,
+                           p2p_session_t* session,
+                           p2p_socket_t* sock,
+                           p2p_decrypt_callback on_message,
+                           void* user_data);
+
+/**
+ * Wait until every submitted record has been delivered
+ *
+ * @param pool Decrypt pool
+ */
+void p2p_decrypt_pool_flush(p2p_decrypt_pool_t* pool);
+
+#endif /* P2PNET_DECRYPT_POOL_H */
@@ -2,6 +2,9 @@
 #define P2PNET_EVENT_LOOP_H
 
 #include "p2pnet/socket.h"
+#include "p2pnet/message.h"
+#include <stddef.h>
+#include <stdint.h>
 
 /**
  * Opaque event loop structure
@@ -25,6 +28,27 @@ typedef void (*p2p_read_callback)(p2p_socket_t* sock, void* user_data);
  */
 typedef void (*p2p_error_callback)(p2p_socket_t* sock, int error, void* user_data);
 
+/**
+ * Callback med en batch ferdig framede meldinger (batch-modus)
+ * 
+ * @param sock Socket meldingene kom fra
+ * @param messages Meldinger i mottatt rekkefølge. Views inn i loopens
+ *                 lesebuffer: kun gyldige under kallet, skal ikke frigjøres
+ * @param count Antall meldinger (1..max_batch)
+ * @param user_data User-supplied data fra add_socket_batch()
+ */
+typedef void (*p2p_batch_callback)(p2p_socket_t* sock, const p2p_message_t* messages,
+                                   size_t count, void* user_data);
+
+/**
+ * Callback når en socket-callback blokkerte loopen for lenge
+ * 
+ * @param sock Socket hvis callback var treg
+ * @param elapsed_ns Hvor lenge callbacken kjørte (nanosekunder)
+ * @param user_data User data fra p2p_event_loop_set_slow_callback()
+ */
+typedef void (*p2p_slow_callback)(p2p_socket_t* sock, uint64_t elapsed_ns, void* user_data);
+
 /**
  * Oppretter en ny event loop
  * 
@@ -55,6 +79,84 @@ int p2p_event_loop_add_socket(p2p_event_loop_t* loop,
                                p2p_error_callback on_error,
                                void* user_data);
 
+/**
+ * Default maks antall meldinger per batch-callback
+ */
+#define P2P_EVENT_LOOP_BATCH_DEFAULT 64
+
+/**
+ * Legger til en socket i batch-modus
+ * 
+ * Loopen leser selv fra socketen (ett recv per lesbar-event, inn i en
+ * buffer per socket), deler dataene i meldinger (samme framing som
+ * p2p_message_send) og leverer alle komplette meldinger i ett kall til
+ * on_batch, i stedet for ett on_read per event og én
+ * p2p_message_recv() per melding. Kun klartekst-framing.
+ * 
+ * Maks max_batch meldinger per kall; resten leveres i neste runde etter
+ * at de andre socketene har fått sin tur (poll venter da ikke).
+ * 
+ * on_error kalles med error 0 når peer lukker og -1 ved lesefeil eller
+ * ugyldig frame-lengde.
+ * 
+ * @param loop Event loop
+ * @param sock Socket å overvåke (appen skal ikke lese fra den selv)
+ * @param on_batch Callback med meldinger
+ * @param on_error Callback ved feil/disconnect (kan være NULL)
+ * @param max_batch Maks meldinger per callback (0 = P2P_EVENT_LOOP_BATCH_DEFAULT)
+ * @param user_data User data sendt til callbacks
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_event_loop_add_socket_batch(p2p_event_loop_t* loop,
+                                    p2p_socket_t* sock,
+                                    p2p_batch_callback on_batch,
+                                    p2p_error_callback on_error,
+                                    size_t max_batch,
+                                    void* user_data);
+
+/**
+ * Setter lesebudsjett per socket per runde
+ * 
+ * Begrenser hvor mye én socket i batch-modus får lese og levere i én
+ * runde, så en peer som flommer loopen ikke øker ventetiden for de
+ * andre. Det som er igjen (i bufferen eller i kjernen) tas i neste runde.
+ * Sockets med events behandles round-robin: hver runde starter etter
+ * socketen som startet forrige runde.
+ * 
+ * Sockets med on_read leser selv; for samme rettferdighet bør de lese én
+ * melding (eller et begrenset antall) per kall og la resten ligge til
+ * neste runde.
+ * 
+ * @param loop Event loop
+ * @param max_bytes Maks bytes lest og levert per socket per runde
+ *                  (0 = ubegrenset; minst én melding leveres alltid)
+ * @param max_frames Maks meldinger per socket per runde (0 = kun max_batch)
+ */
+void p2p_event_loop_set_read_budget(p2p_event_loop_t* loop,
+                                    size_t max_bytes,
+                                    size_t max_frames);
+
+/**
+ * Busy-poll: bytt CPU mot lavere og jevnere latency
+ * 
+ * Før loopen blokkerer i poll() spinner den på ikke-blokkerende
+ * readiness-sjekker i opptil spin_ns, så events som kommer like etter
+ * plukkes opp uten at tråden sover og må vekkes av kjernen. Loop-tråden
+ * bruker da opptil en hel kjerne når trafikken går i pauser kortere enn
+ * spin_ns. Passer relay-noder med egen kjerne til loopen.
+ * 
+ * socket_busy_poll_us > 0 slår i tillegg på SO_BUSY_POLL for alle sockets
+ * i loopen (også de som legges til senere), se p2p_socket_set_busy_poll().
+ * Ignoreres der det ikke støttes.
+ * 
+ * @param loop Event loop
+ * @param spin_ns Nanosekunder å spinne før blokkerende vent (0 = av)
+ * @param socket_busy_poll_us SO_BUSY_POLL per socket i mikrosekunder (0 = av)
+ */
+void p2p_event_loop_set_busy_poll(p2p_event_loop_t* loop,
+                                  uint64_t spin_ns,
+                                  int socket_busy_poll_us);
+
 /**
  * Fjerner en socket fra event loop
  * 
@@ -68,17 +170,47 @@ int p2p_event_loop_remove_socket(p2p_event_loop_t* loop, p2p_socket_t* sock);
  * Kjører event loop (blokkerer her til p2p_event_loop_stop() kalles)
  * Overvåker alle registrerte sockets og kaller callbacks når events skjer
  * 
+ * Returnerer også når loopen ikke har sockets igjen og ingen postede
+ * oppgaver venter. En stop() som kom før run() gjør at run() returnerer
+ * med en gang.
+ * 
  * @param loop Event loop å kjøre
  */
 void p2p_event_loop_run(p2p_event_loop_t* loop);
 
 /**
- * Stopper event loop (kan kalles fra en callback)
+ * Stopper event loop (kan kalles fra en callback eller en annen tråd)
+ * 
+ * Vekker loopen, så den stopper med en gang i stedet for etter neste
+ * poll-timeout. Runden som pågår fullføres.
  * 
  * @param loop Event loop å stoppe
  */
 void p2p_event_loop_stop(p2p_event_loop_t* loop);
 
+/**
+ * Oppgave som kjøres på loop-tråden (p2p_event_loop_post)
+ */
+typedef void (*p2p_task_fn)(void* arg);
+
+/**
+ * Kjører fn(arg) på loop-tråden (kan kalles fra alle tråder)
+ * 
+ * For arbeid som må skje på loopen, f.eks. sende på en socket loopen
+ * eier eller legge til en ny socket. Køen er låsfri (én atomisk
+ * exchange per post) og loopen vekkes via eventfd/pipe (loopback-socket
+ * på Windows), så oppgaven kjøres innen mikrosekunder, uten polling og
+ * uten låser på loop-tråden. Oppgaver fra samme tråd kjøres i rekkefølge.
+ * 
+ * Oppgaver som ikke har kjørt når loopen frigjøres, kastes (fn kalles ikke).
+ * 
+ * @param loop Event loop
+ * @param fn Funksjon å kjøre
+ * @param arg Argument til fn
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_event_loop_post(p2p_event_loop_t* loop, p2p_task_fn fn, void* arg);
+
 /**
  * Henter antall sockets i event loop
  * 
@@ -87,4 +219,21 @@ void p2p_event_loop_stop(p2p_event_loop_t* loop);
  */
 int p2p_event_loop_socket_count(p2p_event_loop_t* loop);
 
+/**
+ * Slår på deteksjon av trege callbacks
+ * 
+ * Etter hver on_read/on_error som varte lenger enn threshold_ns kalles
+ * on_slow med socketen som blokkerte loopen. Uten on_slow logges en
+ * WARN-melding i stedet.
+ * 
+ * @param loop Event loop
+ * @param threshold_ns Terskel i nanosekunder (0 = av)
+ * @param on_slow Callback (kan være NULL)
+ * @param user_data User data sendt til on_slow
+ */
+void p2p_event_loop_set_slow_callback(p2p_event_loop_t* loop,
+                                      uint64_t threshold_ns,
+                                      p2p_slow_callback on_slow,
+                                      void* user_data);
+
 #endif /* P2PNET_EVENT_LOOP_H */
\ No newline at end of file
@@ -0,0 +1,78 @@
+#ifndef P2PNET_FILE_H
+#define P2PNET_FILE_H
+
+#include <p2pnet/socket.h>
+#include <p2pnet/session.h>
+#include <p2pnet/message.h>
+#include <stdint.h>
+
+/**
+ * File Transfer
+ *
+ * Streams a byte range of a file as a sequence of ordinary frames:
+ *
+ *   [file header frame]  "P2PF" + total length (u64) + chunk size (u32)
+ *   [chunk frame] ...    file data, chunk size each (last one shorter)
+ *
+ * so memory use is bounded by one chunk regardless of file size, and
+ * every frame is still a valid message for p2p_message_recv() /
+ * p2p_session_recv().
+ *
+ * Plaintext over TCP/Unix sockets the data never enters user space:
+ * sendfile() on the sender, splice() socket -> pipe -> file on the
+ * receiver (Linux). Other transports and platforms fall back to
+ * pread()/pwrite() through a chunk buffer. Encrypted transfers always
+ * go through a buffer (the data has to be sealed), using the largest
+ * chunk a record can carry.
+ *
+ * All functions block until the whole range is transferred.
+ *
+ * The file position is left as it was. On Windows (no pread/pwrite) it
+ * is moved during each read/write and restored, so the fd must not be
+ * used by another thread during a transfer.
+ */
+
+/**
+ * Chunk size on the wire (one frame / one encrypted record)
+ */
+#define P2P_FILE_CHUNK_SIZE P2P_MAX_MESSAGE_SIZE
+
+/**
+ * Send `length` bytes of `fd` starting at `offset` (plaintext)
+ *
+ * @param sock Connected socket
+ * @param fd Open file descriptor (read access; position is not used or changed)
+ * @param offset First byte to send
+ * @param length Number of bytes to send (0 sends an empty transfer)
+ * @return 0 on success, -1 on error (including a file shorter than the range)
+ */
+int p2p_send_file(p2p_socket_t* sock, int fd, uint64_t offset, uint64_t length);
+
+/**
+ * Receive a transfer sent with p2p_send_file() into `fd` at `offset`
+ *
+ * @param sock Connected socket
+ * @param fd Open file descriptor (write access; position is not used or changed)
+ * @param offset Where to write the first byte
+ * @param max_length Reject transfers larger than this
+ * @return Number of bytes received, or -1 on error
+ */
+int64_t p2p_recv_file(p2p_socket_t* sock, int fd, uint64_t offset, uint64_t max_length);
+
+/**
+ * Send a file range encrypted (one record per chunk)
+ *
+ * @return 0 on success, -1 on error
+ */
+int p2p_session_send_file(p2p_session_t* session, p2p_socket_t* sock,
+                          int fd, uint64_t offset, uint64_t length);
+
+/**
+ * Receive an encrypted transfer sent with p2p_session_send_file()
+ *
+ * @return Number of bytes received, or -1 on error (MAC failure, replay, disconnect)
+ */
+int64_t p2p_session_recv_file(p2p_session_t* session, p2p_socket_t* sock,
+                              int fd, uint64_t offset, uint64_t max_length);
+
+#endif /* P2PNET_FILE_H */
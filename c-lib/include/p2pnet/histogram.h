@@ -0,0 +1,135 @@
+#ifndef P2PNET_HISTOGRAM_H
+#define P2PNET_HISTOGRAM_H
+
+#include <stdint.h>
+
+/**
+ * Latency Histograms
+ *
+ * HDR-style log-bucketed histograms: every power of two is split into 16
+ * linear sub-buckets, so any recorded value is reported within ~6% while
+ * a histogram covering 1ns to ~39 hours is under 6 KB. Recording is one
+ * relaxed atomic add (plus min/max updates when they change) and is safe
+ * from any thread.
+ *
+ * The library can record its own latencies (nanoseconds) into a fixed set
+ * of global histograms, see p2p_latency_t. This is off by default, so the
+ * encrypt/decrypt and event loop paths skip the clock reads and shared
+ * histogram updates; turn it on with p2p_latency_set_enabled().
+ * Applications can also create their own histograms.
+ */
+
+/**
+ * Opaque histogram
+ */
+typedef struct p2p_histogram p2p_histogram_t;
+
+/**
+ * Built-in latency histograms (all in nanoseconds)
+ */
+typedef enum {
+    // p2p_handshake_server(), per phase
+    P2P_LATENCY_HS_SERVER_KEYGEN = 0,       // Ephemeral keypair + challenge
+    P2P_LATENCY_HS_SERVER_RECV_HELLO,       // Waiting for ClientHello
+    P2P_LATENCY_HS_SERVER_SEND_HELLO,       // Allow-list check + ServerHello
+    P2P_LATENCY_HS_SERVER_RECV_KEY_EXCHANGE,// Waiting for KeyExchange
+    P2P_LATENCY_HS_SERVER_VERIFY,           // Client signature verification
+    P2P_LATENCY_HS_SERVER_SIGN,             // Signing challenge + keys
+    P2P_LATENCY_HS_SERVER_SEND_ACCEPT,      // Sending Accept
+    P2P_LATENCY_HS_SERVER_DERIVE,           // ECDH + session key + session
+    P2P_LATENCY_HS_SERVER_TOTAL,
+    P2P_LATENCY_HS_CLIENT_TOTAL,
+
+    // p2p_event_loop_run()
+    P2P_LATENCY_LOOP_ITERATION,             // Dispatch work per wakeup (excl. poll wait)
+    P2P_LATENCY_LOOP_DISPATCH_DELAY,        // Poll returned -> callback started
+    P2P_LATENCY_LOOP_CALLBACK,              // on_read/on_error execution
+
+    // AEAD by plaintext size class
+    P2P_LATENCY_ENCRYPT_64,                 // <= 64 B
+    P2P_LATENCY_ENCRYPT_1K,                 // <= 1 KB
+    P2P_LATENCY_ENCRYPT_16K,                // <= 16 KB
+    P2P_LATENCY_ENCRYPT_LARGE,              // >  16 KB
+    P2P_LATENCY_DECRYPT_64,
+    P2P_LATENCY_DECRYPT_1K,
+    P2P_LATENCY_DECRYPT_16K,
+    P2P_LATENCY_DECRYPT_LARGE,
+
+    P2P_LATENCY_COUNT
+} p2p_latency_t;
+
+/**
+ * Create empty histogram
+ *
+ * @return New histogram, or NULL on error
+ */
+p2p_histogram_t* p2p_histogram_create(void);
+
+/**
+ * Free histogram (can be NULL)
+ */
+void p2p_histogram_free(p2p_histogram_t* hist);
+
+/**
+ * Record one value
+ */
+void p2p_histogram_record(p2p_histogram_t* hist, uint64_t value);
+
+/**
+ * Clear all recorded values
+ */
+void p2p_histogram_reset(p2p_histogram_t* hist);
+
+/**
+ * Add all values recorded in src to dst
+ */
+void p2p_histogram_merge(p2p_histogram_t* dst, const p2p_histogram_t* src);
+
+/**
+ * Number of recorded values
+ */
+uint64_t p2p_histogram_count(const p2p_histogram_t* hist);
+
+/**
+ * Smallest / largest recorded value (0 if empty)
+ */
+uint64_t p2p_histogram_min(const p2p_histogram_t* hist);
+uint64_t p2p_histogram_max(const p2p_histogram_t* hist);
+
+/**
+ * Mean of recorded values (0 if empty)
+ */
+double p2p_histogram_mean(const p2p_histogram_t* hist);
+
+/**
+ * Value at percentile
+ *
+ * @param percentile 0.0 - 100.0 (e.g. 99.9)
+ * @return Upper bound of the bucket holding that percentile, 0 if empty
+ */
+uint64_t p2p_histogram_percentile(const p2p_histogram_t* hist, double percentile);
+
+/**
+ * Built-in latency histogram (owned by the library, never NULL for valid id)
+ */
+p2p_histogram_t* p2p_latency_histogram(p2p_latency_t id);
+
+/**
+ * Name of built-in histogram, e.g. "hs_server_verify" (NULL for invalid id)
+ */
+const char* p2p_latency_name(p2p_latency_t id);
+
+/**
+ * Reset all built-in latency histograms
+ */
+void p2p_latency_reset(void);
+
+/**
+ * Turn recording into the built-in histograms on or off (default off)
+ *
+ * Takes effect for operations that start after the call; safe from any
+ * thread.
+ */
+void p2p_latency_set_enabled(int enabled);
+
+#endif /* P2PNET_HISTOGRAM_H */
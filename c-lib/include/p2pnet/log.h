@@ -0,0 +1,159 @@
+#ifndef P2PNET_LOG_H
+#define P2PNET_LOG_H
+
+#include <stddef.h>
+
+/**
+ * Logging
+ *
+ * The library is silent by default. Applications opt in by setting a
+ * level and a sink:
+ *
+ *   p2p_log_set_level(P2P_LOG_LEVEL_INFO);
+ *   p2p_log_set_sink(p2p_log_stderr_sink, NULL);   // synchronous
+ *   p2p_log_async_start(4096, p2p_log_stderr_sink, NULL);  // or: background thread
+ *
+ * Log statements below P2P_LOG_COMPILE_LEVEL are removed at compile time.
+ * Statements above it cost one integer compare when the runtime level
+ * filters them out - arguments are not evaluated or formatted.
+ */
+
+// Levels
+#define P2P_LOG_LEVEL_TRACE 0   // Per-step protocol detail (handshake steps)
+#define P2P_LOG_LEVEL_DEBUG 1   // Per-connection events
+#define P2P_LOG_LEVEL_INFO  2   // Lifecycle (loop start/stop)
+#define P2P_LOG_LEVEL_WARN  3   // Peer misbehaviour, auth failures, disconnects
+#define P2P_LOG_LEVEL_ERROR 4   // Local failures (allocation, invalid arguments)
+#define P2P_LOG_LEVEL_OFF   5   // Nothing
+
+/**
+ * Lowest level compiled into the library (override with -DP2P_LOG_COMPILE_LEVEL=...)
+ */
+#ifndef P2P_LOG_COMPILE_LEVEL
+    #define P2P_LOG_COMPILE_LEVEL P2P_LOG_LEVEL_DEBUG
+#endif
+
+// Max formatted length of one log line (longer lines are truncated)
+#define P2P_LOG_LINE_MAX 256
+
+/**
+ * Log sink
+ *
+ * @param level Message level
+ * @param tag Subsystem tag (e.g. "HANDSHAKE"), static string
+ * @param message Formatted message (no trailing newline)
+ * @param ctx Context pointer from p2p_log_set_sink()
+ */
+typedef void (*p2p_log_sink)(int level, const char* tag, const char* message, void* ctx);
+
+/**
+ * Runtime threshold - read by the log macros (use p2p_log_set_level())
+ */
+extern volatile int p2p_log_threshold;
+
+/**
+ * Set runtime log level
+ *
+ * @param level P2P_LOG_LEVEL_* (default P2P_LOG_LEVEL_OFF)
+ */
+void p2p_log_set_level(int level);
+
+/**
+ * Install synchronous sink (NULL = discard)
+ *
+ * May be called while other threads log: each message goes to a sink
+ * together with its own ctx. A call already in progress can still
+ * finish in the previous sink.
+ *
+ * @note Replaces any async sink (call p2p_log_async_stop() first)
+ */
+void p2p_log_set_sink(p2p_log_sink sink, void* ctx);
+
+/**
+ * Built-in sink: "[TAG] message" to stderr
+ */
+void p2p_log_stderr_sink(int level, const char* tag, const char* message, void* ctx);
+
+/**
+ * Start asynchronous logging
+ *
+ * Log calls format into a lock-free ring buffer and return immediately;
+ * a background thread drains the ring into the downstream sink. When the
+ * ring is full, messages are dropped (and counted) instead of blocking.
+ *
+ * @param capacity Ring size in messages (rounded up to power of two)
+ * @param downstream Sink called from the background thread
+ * @param ctx Context for downstream sink
+ * @return 0 on success, -1 on error
+ */
+int p2p_log_async_start(size_t capacity, p2p_log_sink downstream, void* ctx);
+
+/**
+ * Drain ring, stop background thread and discard further messages
+ *
+ * @note Call only when no other thread is logging
+ */
+void p2p_log_async_stop(void);
+
+/**
+ * Number of messages dropped because the async ring was full
+ */
+size_t p2p_log_dropped(void);
+
+/**
+ * Format and emit a log message (use the macros below instead)
+ */
+void p2p_log_write(int level, const char* tag, const char* fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+// ============================================================================
+// Log macros
+// ============================================================================
+
+#define P2P_LOG_AT_(level, tag, ...) do { \
+    if ((level) >= p2p_log_threshold) { \
+        p2p_log_write((level), (tag), __VA_ARGS__); \
+    } \
+} while (0)
+
+// Compiled out, but arguments still type-checked (and no unused-variable warnings)
+#define P2P_LOG_ELIDED_(level, tag, ...) do { \
+    if (0) { \
+        p2p_log_write((level), (tag), __VA_ARGS__); \
+    } \
+} while (0)
+
+#if P2P_LOG_COMPILE_LEVEL <= P2P_LOG_LEVEL_TRACE
+    #define P2P_LOG_TRACE(tag, ...) P2P_LOG_AT_(P2P_LOG_LEVEL_TRACE, tag, __VA_ARGS__)
+#else
+    #define P2P_LOG_TRACE(tag, ...) P2P_LOG_ELIDED_(P2P_LOG_LEVEL_TRACE, tag, __VA_ARGS__)
+#endif
+
+#if P2P_LOG_COMPILE_LEVEL <= P2P_LOG_LEVEL_DEBUG
+    #define P2P_LOG_DEBUG(tag, ...) P2P_LOG_AT_(P2P_LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+    #define P2P_LOG_DEBUG(tag, ...) P2P_LOG_ELIDED_(P2P_LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#endif
+
+#if P2P_LOG_COMPILE_LEVEL <= P2P_LOG_LEVEL_INFO
+    #define P2P_LOG_INFO(tag, ...) P2P_LOG_AT_(P2P_LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+    #define P2P_LOG_INFO(tag, ...) P2P_LOG_ELIDED_(P2P_LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#endif
+
+#if P2P_LOG_COMPILE_LEVEL <= P2P_LOG_LEVEL_WARN
+    #define P2P_LOG_WARN(tag, ...) P2P_LOG_AT_(P2P_LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+    #define P2P_LOG_WARN(tag, ...) P2P_LOG_ELIDED_(P2P_LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#endif
+
+#if P2P_LOG_COMPILE_LEVEL <= P2P_LOG_LEVEL_ERROR
+    #define P2P_LOG_ERROR(tag, ...) P2P_LOG_AT_(P2P_LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+    #define P2P_LOG_ERROR(tag, ...) P2P_LOG_ELIDED_(P2P_LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#endif
+
+#endif /* P2PNET_LOG_H */
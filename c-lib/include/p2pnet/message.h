@@ -18,6 +18,8 @@
 typedef struct {
     uint32_t length;   // Lengde på data
     uint8_t* data;     // Pointer til data buffer
+    p2p_release_fn release;    // Frigjør data (NULL = free(data)), se p2p_message_wrap
+    void* release_ctx;         // Argument til release
 } p2p_message_t;
 
 /**
@@ -39,6 +41,26 @@ p2p_message_t* p2p_message_create(const char* text);
  */
 p2p_message_t* p2p_message_create_binary(const void* data, size_t length);
 
+/**
+ * Oppretter en melding rundt en eksisterende buffer (ingen kopi)
+ * 
+ * Meldingen tar over bufferen: p2p_message_free() kaller
+ * free_fn(ctx) i stedet for free(data). Nyttig når data allerede ligger
+ * i en buffer appen eier (mmap-et fil, arena, serializer-output), og
+ * sammen med p2p_message_send_owned() går data helt til socketen uten
+ * kopi.
+ * 
+ * @param data Buffer (må leve til free_fn er kalt)
+ * @param length Lengde på data (1..P2P_MAX_MESSAGE_SIZE)
+ * @param free_fn Kalles én gang når meldingen frigjøres (NULL = bufferen
+ *                eies fortsatt av kalleren og frigjøres ikke)
+ * @param ctx Argument til free_fn
+ * @return Ny melding, eller NULL ved feil (da er free_fn ikke kalt,
+ *         kalleren eier fortsatt bufferen)
+ */
+p2p_message_t* p2p_message_wrap(void* data, size_t length,
+                                p2p_release_fn free_fn, void* ctx);
+
 /**
  * Sender en framed melding over socket
  * Sender først length-header (4 bytes), deretter data
@@ -51,6 +73,20 @@ p2p_message_t* p2p_message_create_binary(const void* data, size_t length);
  */
 int p2p_message_send(p2p_socket_t* sock, p2p_message_t* msg);
 
+/**
+ * Sender en framed melding og tar eierskap til den
+ * 
+ * Som p2p_message_send(), men meldingen frigjøres av biblioteket
+ * (p2p_message_free). Er zero-copy på for socketen og meldingen over
+ * terskelen (p2p_socket_set_zerocopy), sendes data uten kopi og
+ * meldingen holdes til kjernen er ferdig med den.
+ * 
+ * @param sock Socket å sende over
+ * @param msg Melding å sende (ikke bruk etter kallet, heller ikke ved feil)
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_message_send_owned(p2p_socket_t* sock, p2p_message_t* msg);
+
 /**
  * Mottar en komplett framed melding fra socket (blokkerende)
  * Leser først 4-byte header, deretter eksakt så mye data
@@ -62,6 +98,33 @@ int p2p_message_send(p2p_socket_t* sock, p2p_message_t* msg);
  */
 p2p_message_t* p2p_message_recv(p2p_socket_t* sock);
 
+/**
+ * Mottar header for neste melding (blokkerende)
+ * 
+ * Første halvdel av p2p_message_recv(): gir lengden slik at appen kan
+ * velge eller allokere mottaksbuffer selv, og så lese data med
+ * p2p_message_recv_into().
+ * 
+ * @param sock Socket å motta fra
+ * @param length Output: lengde på data (1..P2P_MAX_MESSAGE_SIZE)
+ * @return 0 ved suksess, -1 ved feil/disconnect/ugyldig lengde
+ */
+int p2p_message_recv_header(p2p_socket_t* sock, uint32_t* length);
+
+/**
+ * Mottar data for en melding rett i appens buffer (ingen allokering)
+ * 
+ * Kalles etter p2p_message_recv_header() med lengden den ga. Må leses
+ * helt før neste melding; ved feil er strømmen ute av synk og socketen
+ * bør lukkes.
+ * 
+ * @param sock Socket å motta fra
+ * @param buffer Mottaksbuffer (minst length bytes)
+ * @param length Lengde fra p2p_message_recv_header()
+ * @return 0 ved suksess, -1 ved feil/disconnect
+ */
+int p2p_message_recv_into(p2p_socket_t* sock, void* buffer, uint32_t length);
+
 /**
  * Frigjør minne allokert for melding
  * 
@@ -69,6 +132,68 @@ p2p_message_t* p2p_message_recv(p2p_socket_t* sock);
  */
 void p2p_message_free(p2p_message_t* msg);
 
+/**
+ * Delt, uforanderlig melding for kringkasting (broadcast)
+ * 
+ * Innholdet kopieres én gang, ferdig framet (header + data i én buffer),
+ * og kan sendes til vilkårlig mange sockets uten ny kopi. Referansetelt:
+ * hver sending holder en referanse til skrivingen er ferdig (med
+ * zero-copy til kjernen har meldt ferdig), og bufferen frigjøres når
+ * siste referanse slippes. Minne og kopiering for en broadcast blir
+ * O(payload) i stedet for O(payload × mottakere).
+ * 
+ * Kun klartekst-framing: krypterte sesjoner må kryptere per mottaker.
+ */
+typedef struct p2p_shared_message p2p_shared_message_t;
+
+/**
+ * Oppretter en delt melding (én kopi av data, referanse = 1)
+ * 
+ * @param data Binær data
+ * @param length Lengde på data (1..P2P_MAX_MESSAGE_SIZE)
+ * @return Ny delt melding, eller NULL ved feil
+ */
+p2p_shared_message_t* p2p_shared_message_create(const void* data, size_t length);
+
+/**
+ * Tar en ekstra referanse (trådsikkert)
+ * 
+ * @return Samme melding
+ */
+p2p_shared_message_t* p2p_shared_message_ref(p2p_shared_message_t* msg);
+
+/**
+ * Slipper en referanse; siste slipp frigjør meldingen (kan være NULL)
+ */
+void p2p_shared_message_unref(p2p_shared_message_t* msg);
+
+/**
+ * Henter innholdet (kun lesing)
+ * 
+ * @param length Output: lengde på data (kan være NULL)
+ * @return Pointer til data
+ */
+const uint8_t* p2p_shared_message_data(const p2p_shared_message_t* msg, size_t* length);
+
+/**
+ * Sender en delt melding over socket (samme wire-format som p2p_message_send)
+ * 
+ * Header og data går i én sending. Kalleren beholder sin referanse.
+ * 
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_message_send_shared(p2p_socket_t* sock, p2p_shared_message_t* msg);
+
+/**
+ * Sender samme delte melding til mange sockets
+ * 
+ * @param socks Mottakere
+ * @param count Antall mottakere
+ * @param msg Melding (kalleren beholder sin referanse)
+ * @return Antall sockets meldingen ble sendt til, -1 ved ugyldige argumenter
+ */
+int p2p_message_broadcast(p2p_socket_t** socks, size_t count, p2p_shared_message_t* msg);
+
 /**
  * Hjelpefunksjon: Skriv ut melding som string (for debugging)
  * 
@@ -0,0 +1,94 @@
+#ifndef P2PNET_METRICS_H
+#define P2PNET_METRICS_H
+
+#include <p2pnet/socket.h>
+#include <p2pnet/session.h>
+#include <p2pnet/event_loop.h>
+#include <stdint.h>
+
+/**
+ * Metrics
+ *
+ * Monotonic counters kept at four levels:
+ *
+ *   socket:     I/O on that socket (bytes, syscalls, partials, handshakes)
+ *   session:    encrypted messages and security events for that peer
+ *   event loop: iterations, poll calls and callbacks dispatched
+ *   global:     everything, summed over per-thread shards
+ *
+ * Counting costs one relaxed atomic add per level on the hot path;
+ * session message counts are read off the nonces and cost nothing.
+ * Reading never takes a lock; a snapshot taken while other threads are
+ * counting is per-counter consistent (not across counters).
+ */
+
+/**
+ * Counter ids
+ */
+typedef enum {
+    P2P_METRIC_BYTES_IN = 0,        // Bytes returned by recv()
+    P2P_METRIC_BYTES_OUT,           // Bytes accepted by send()
+    P2P_METRIC_MESSAGES_IN,         // Framed/encrypted messages received
+    P2P_METRIC_MESSAGES_OUT,        // Framed/encrypted messages sent
+    P2P_METRIC_SYSCALLS,            // send/recv/poll calls
+    P2P_METRIC_PARTIAL_READS,       // recv() returned less than requested
+    P2P_METRIC_PARTIAL_WRITES,      // send() accepted less than requested
+    P2P_METRIC_AEAD_FAILURES,       // Decryption/authentication failed
+    P2P_METRIC_REPLAY_REJECTS,      // Nonce rewind (replay) rejected
+    P2P_METRIC_HANDSHAKES_STARTED,
+    P2P_METRIC_HANDSHAKES_COMPLETED,
+    P2P_METRIC_HANDSHAKES_FAILED,
+    P2P_METRIC_ALLOCATIONS,         // Message/session/socket allocations
+    P2P_METRIC_LOOP_ITERATIONS,     // Event loop poll rounds
+    P2P_METRIC_CALLBACKS,           // on_read/on_error callbacks dispatched
+    P2P_METRIC_ZEROCOPY_SENDS,      // send() calls with MSG_ZEROCOPY
+    P2P_METRIC_ZEROCOPY_COPIED,     // Zero-copy sends the kernel copied anyway
+    P2P_METRIC_ACCEPT_REJECTS,      // Connections closed by admission control
+    P2P_METRIC_COUNT
+} p2p_metric_t;
+
+/**
+ * Snapshot of all counters (index with p2p_metric_t)
+ */
+typedef struct {
+    uint64_t values[P2P_METRIC_COUNT];
+} p2p_metrics_t;
+
+/**
+ * Counter name, e.g. "bytes_in" (NULL for invalid id)
+ */
+const char* p2p_metric_name(p2p_metric_t metric);
+
+/**
+ * Process-wide totals (sum of all per-thread shards)
+ *
+ * @param out Snapshot to fill
+ */
+void p2p_metrics_global(p2p_metrics_t* out);
+
+/**
+ * Counters for one socket
+ *
+ * @return 0 on success, -1 on error
+ */
+int p2p_socket_metrics(p2p_socket_t* sock, p2p_metrics_t* out);
+
+/**
+ * Counters for one session (messages, AEAD failures, replays)
+ *
+ * Only MESSAGES_IN/OUT, AEAD_FAILURES and REPLAY_REJECTS are set.
+ * MESSAGES_IN is the peer's counter on the last accepted record, so
+ * records rejected before it (see AEAD_FAILURES) are included.
+ *
+ * @return 0 on success, -1 on error
+ */
+int p2p_session_metrics(const p2p_session_t* session, p2p_metrics_t* out);
+
+/**
+ * Counters for one event loop
+ *
+ * @return 0 on success, -1 on error
+ */
+int p2p_event_loop_metrics(p2p_event_loop_t* loop, p2p_metrics_t* out);
+
+#endif /* P2PNET_METRICS_H */
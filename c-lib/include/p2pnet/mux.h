@@ -0,0 +1,204 @@
+#ifndef P2PNET_MUX_H
+#define P2PNET_MUX_H
+
+#include <p2pnet/socket.h>
+#include <p2pnet/session.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Stream Multiplexing
+ *
+ * Carries many logical streams over one connection so a bulk transfer
+ * no longer holds up chat messages queued behind it. Every frame is an
+ * ordinary frame (or encrypted record) whose payload starts with a mux
+ * header:
+ *
+ * ┌────────────────────┬──────────┬──────────────────────────┐
+ * │ Stream id (4)      │ Flags(1) │ Data (0..CHUNK_SIZE)     │
+ * │ uint32_t big-endian│ FIN, WU  │                          │
+ * └────────────────────┴──────────┴──────────────────────────┘
+ *
+ * Writes are queued per stream; p2p_mux_send_pending() then sends
+ * bounded chunks, choosing the next stream before every chunk:
+ *
+ *   - strict priority between levels (0 = most urgent), so an
+ *     interactive stream waits for at most one chunk of bulk data
+ *   - weighted fair sharing between streams on the same level
+ *     (a weight 3 stream gets three times the bytes of a weight 1)
+ *
+ * Flow control is credit based, per stream and per connection (like
+ * HTTP/2 WINDOW_UPDATE): a sender may have at most the receiver's window
+ * of unacknowledged data in flight. The receiver returns credit with a
+ * window update (flag WU, 4-byte increment, stream id 0 = connection)
+ * once the application has consumed about half a window. Streams without
+ * credit are skipped by the scheduler, and a peer that overruns a window
+ * is a protocol error, so receiver memory per peer is bounded by
+ * P2P_MUX_CONN_WINDOW. Producers should only feed a stream what
+ * p2p_mux_write_space() allows.
+ *
+ * The sending side has to keep calling p2p_mux_recv() too, since that is
+ * where credit comes back.
+ *
+ * Stream ids are odd for the initiating side and even for the other, so
+ * both ends can open streams without coordination. A stream is gone
+ * once both directions have sent FIN (p2p_mux_close()).
+ *
+ * Each side may have at most P2P_MUX_MAX_STREAMS streams it opened live
+ * at once (like HTTP/2 SETTINGS_MAX_CONCURRENT_STREAMS, but fixed rather
+ * than negotiated). p2p_mux_open() refuses beyond it, and a peer that
+ * opens more is a protocol error, so the per-stream state a peer can
+ * make us allocate is bounded too. A data frame with neither data nor
+ * FIN is also a protocol error.
+ *
+ * Thread-safety: writes, opens and closes may come from any thread while
+ * one thread sends and one thread receives.
+ */
+
+#define P2P_MUX_HEADER_SIZE 5
+#define P2P_MUX_CHUNK_SIZE (16 * 1024)      // Max data bytes per frame
+
+#define P2P_MUX_PRIORITIES 8
+#define P2P_MUX_PRIORITY_INTERACTIVE 0
+#define P2P_MUX_PRIORITY_DEFAULT 4
+#define P2P_MUX_PRIORITY_BULK 7
+
+#define P2P_MUX_WEIGHT_DEFAULT 16
+#define P2P_MUX_WEIGHT_MAX 256
+
+#define P2P_MUX_STREAM_WINDOW (256 * 1024)  // Initial credit per stream
+#define P2P_MUX_CONN_WINDOW (1024 * 1024)   // Initial credit per connection
+
+#define P2P_MUX_MAX_STREAMS 100             // Live streams opened by each side
+
+typedef struct p2p_mux p2p_mux_t;
+
+/**
+ * Called for every received frame
+ *
+ * @param mux Multiplexer
+ * @param stream_id Stream the data belongs to (new ids are streams the peer opened)
+ * @param data Frame data (only valid during the call)
+ * @param length Data length (0 for a bare FIN)
+ * @param fin Non-zero if the peer is done sending on this stream
+ * @param user_data User context from p2p_mux_create()
+ */
+typedef void (*p2p_mux_data_fn)(p2p_mux_t* mux, uint32_t stream_id,
+                                const uint8_t* data, size_t length,
+                                int fin, void* user_data);
+
+/**
+ * Create a multiplexer over a connected socket
+ *
+ * @param sock Connected socket (not owned)
+ * @param session Encrypted session, or NULL for plaintext (not owned)
+ * @param initiator 1 on the connecting side, 0 on the accepting side
+ * @param on_data Receive callback
+ * @param user_data Passed to on_data
+ * @return Multiplexer, or NULL on error
+ */
+p2p_mux_t* p2p_mux_create(p2p_socket_t* sock, p2p_session_t* session, int initiator,
+                          p2p_mux_data_fn on_data, void* user_data);
+
+/**
+ * Free the multiplexer and any unsent data (socket and session are left open)
+ */
+void p2p_mux_free(p2p_mux_t* mux);
+
+/**
+ * Open a new outgoing stream
+ *
+ * @param priority 0 (most urgent) .. P2P_MUX_PRIORITIES-1
+ * @param weight Share within the priority level, 1..P2P_MUX_WEIGHT_MAX
+ * @return Stream id, or 0 on error (including P2P_MUX_MAX_STREAMS of our
+ *         streams still open)
+ */
+uint32_t p2p_mux_open(p2p_mux_t* mux, int priority, int weight);
+
+/**
+ * Change a stream's scheduling (also for streams the peer opened)
+ *
+ * @return 0 on success, -1 if the stream doesn't exist or the values are invalid
+ */
+int p2p_mux_set_priority(p2p_mux_t* mux, uint32_t stream_id, int priority, int weight);
+
+/**
+ * Queue data on a stream (copied; sent by p2p_mux_send_pending())
+ *
+ * @return 0 on success, -1 if the stream doesn't exist or is closed for writing
+ */
+int p2p_mux_write(p2p_mux_t* mux, uint32_t stream_id, const void* data, size_t length);
+
+/**
+ * Finish the stream for writing: FIN goes out after the queued data
+ *
+ * @return 0 on success, -1 if the stream doesn't exist or was already closed
+ */
+int p2p_mux_close(p2p_mux_t* mux, uint32_t stream_id);
+
+/**
+ * Bytes a producer may queue on the stream right now
+ *
+ * The stream's (and connection's) remaining credit minus what is already
+ * queued. Read from the source only this much to keep the send queue
+ * bounded.
+ *
+ * @return Bytes, 0 if the stream is out of credit or doesn't exist
+ */
+size_t p2p_mux_write_space(p2p_mux_t* mux, uint32_t stream_id);
+
+/**
+ * Send window updates and queued chunks in scheduling order
+ *
+ * @param max_bytes Stop after about this many data bytes (0 = until nothing is sendable)
+ * @return Data bytes sent, or -1 on error
+ */
+intptr_t p2p_mux_send_pending(p2p_mux_t* mux, size_t max_bytes);
+
+/**
+ * Block until there is something to send (data with credit, a FIN or a
+ * window update), for a dedicated sender thread
+ *
+ * @return 0 when there is work, -1 once p2p_mux_recv() has failed (disconnect)
+ */
+int p2p_mux_wait_sendable(p2p_mux_t* mux);
+
+/**
+ * Bytes queued but not yet sent, over all streams
+ */
+size_t p2p_mux_pending(p2p_mux_t* mux);
+
+/**
+ * Receive one frame and hand it to on_data
+ *
+ * Also applies window updates from the peer and, if credit is due,
+ * sends ours (unless the sender thread is busy; then it sends them).
+ *
+ * @return 0 on success, -1 on disconnect or protocol error (including
+ *         data beyond the advertised window and streams beyond
+ *         P2P_MUX_MAX_STREAMS)
+ */
+int p2p_mux_recv(p2p_mux_t* mux);
+
+/**
+ * Choose when received data counts as consumed
+ *
+ * Enabled (default): as soon as on_data returns. Disabled: only when the
+ * application calls p2p_mux_consume(), for apps that queue data for
+ * later processing; the peer then stops once the window is full.
+ */
+void p2p_mux_set_auto_consume(p2p_mux_t* mux, int enabled);
+
+/**
+ * Return credit for `bytes` received on a stream (manual consume mode)
+ *
+ * @return 0 on success, -1 on error
+ */
+int p2p_mux_consume(p2p_mux_t* mux, uint32_t stream_id, size_t bytes);
+
+/**
+ * Number of open streams (either direction still open)
+ */
+int p2p_mux_stream_count(p2p_mux_t* mux);
+
+#endif /* P2PNET_MUX_H */
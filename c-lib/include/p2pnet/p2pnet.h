@@ -11,12 +11,20 @@
 #include "p2pnet/socket.h"
 #include "p2pnet/message.h"
 #include "p2pnet/event_loop.h"
+#include "p2pnet/log.h"
+#include "p2pnet/metrics.h"
+#include "p2pnet/histogram.h"
 
 // Cryptography (Phase 2)
 #include "p2pnet/crypto.h" 
 #include "p2pnet/session.h"
+#include "p2pnet/session_table.h"
 #include "p2pnet/handshake.h"
 #include "p2pnet/encryption.h"
+#include "p2pnet/decrypt_pool.h"
+#include "p2pnet/file.h"
+#include "p2pnet/stream.h"
+#include "p2pnet/mux.h"
 // Flere headers kommer senere...
 
 /**
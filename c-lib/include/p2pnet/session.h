@@ -7,12 +7,25 @@
 /**
  * Opaque session structure
  * Contains session key and peer information
+ *
+ * Represents an authenticated session between two peers after successful handshake.
+ * Sessions either live on the heap (from handshake) or in a p2p_session_table_t.
  */
 typedef struct p2p_session p2p_session_t;
 
+/**
+ * Create a new session (internal use by handshake)
+ *
+ * @param session_key 32-byte derived session key (copied into secure key arena)
+ * @param peer_pubkey 32-byte verified peer public key
+ * @return New session, or NULL on error
+ */
+p2p_session_t* p2p_session_create(const uint8_t* session_key,
+                                   const uint8_t* peer_pubkey);
+
 /**
  * Get peer's public key from session
- * 
+ *
  * @param session Session
  * @return Pointer to 32-byte public key, or NULL if session is NULL
  */
@@ -20,24 +33,26 @@ const uint8_t* p2p_session_peer_pubkey(const p2p_session_t* session);
 
 /**
  * Get session key (for encryption)
- * 
+ *
  * @param session Session
  * @return Pointer to 32-byte session key, or NULL if session is NULL
- * 
+ *
  * @note Do NOT expose this key - use encryption API instead
  */
 const uint8_t* p2p_session_key(const p2p_session_t* session);
 
 /**
  * Free session and securely wipe memory
- * 
+ *
  * @param session Session to free (can be NULL)
+ *
+ * @note Sessions stored in a session table are removed from it
  */
 void p2p_session_free(p2p_session_t* session);
 
 /**
  * Get peer's fingerprint (Base64 encoded public key)
- * 
+ *
  * @param session Session
  * @param buffer Output buffer (at least 45 bytes)
  * @param buffer_size Size of buffer
@@ -48,38 +63,19 @@ const char* p2p_session_peer_fingerprint(const p2p_session_t* session,
                                           size_t buffer_size);
 
 /**
- * P2P Session
- * 
- * Represents an authenticated session between two peers after successful handshake.
- * Contains the shared session key and peer identity.
- */
-typedef struct p2p_session {
-    uint8_t session_key[32];    // Shared encryption key (derived from ECDH)
-    uint8_t peer_pubkey[32];    // Verified peer's Ed25519 public key
-    uint64_t send_nonce;        // Counter for outgoing messages (prevents nonce reuse)
-    uint64_t recv_nonce;        // Last received nonce (prevents replay attacks)
-} p2p_session_t;
-
-/**
- * Create a new session (internal use by handshake)
- */
-p2p_session_t* p2p_session_create(void);
-
-/**
- * Free session and securely wipe memory
+ * Attach application data to session
+ *
+ * @param session Session
+ * @param user_data Pointer stored with the session (not freed by library)
  */
-void p2p_session_free(p2p_session_t* session);
+void p2p_session_set_user_data(p2p_session_t* session, void* user_data);
 
 /**
- * Get peer's fingerprint (Base64 encoded public key)
- * 
+ * Get application data attached to session
+ *
  * @param session Session
- * @param buffer Output buffer (at least 45 bytes)
- * @param buffer_size Size of buffer
- * @return Pointer to buffer, or NULL on error
+ * @return User data, or NULL if none / session is NULL
  */
-const char* p2p_session_peer_fingerprint(const p2p_session_t* session,
-                                          char* buffer,
-                                          size_t buffer_size);
+void* p2p_session_get_user_data(const p2p_session_t* session);
 
-#endif /* P2PNET_SESSION_H */
\ No newline at end of file
+#endif /* P2PNET_SESSION_H */
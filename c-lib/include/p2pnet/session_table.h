@@ -0,0 +1,111 @@
+#ifndef P2PNET_SESSION_TABLE_H
+#define P2PNET_SESSION_TABLE_H
+
+#include <p2pnet/session.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Session Table
+ *
+ * Central registry for many concurrent sessions (sized for ~1M peers).
+ * Sessions are stored in contiguous, fixed-capacity slot arrays with a
+ * hot/cold split:
+ *
+ *   hot array:  nonces + key handle     (touched on every message)
+ *   cold array: peer identity, metadata, failure counts (lookup-by-peer/teardown)
+ *
+ * Lookups by connection id and by peer public key are O(1) (open
+ * addressing). Session pointers stay valid until the session is removed,
+ * since the table never reallocates.
+ *
+ * @note Not thread-safe - use one table per event loop thread, or lock
+ */
+
+/**
+ * Opaque session table
+ */
+typedef struct p2p_session_table p2p_session_table_t;
+
+/**
+ * Create session table
+ *
+ * @param capacity Maximum number of sessions (fixed, max 2^31)
+ * @return New table, or NULL on error
+ */
+p2p_session_table_t* p2p_session_table_create(size_t capacity);
+
+/**
+ * Free table and securely wipe all sessions still in it
+ *
+ * @param table Table to free (can be NULL)
+ *
+ * @note Session pointers from the table are invalid afterwards
+ */
+void p2p_session_table_free(p2p_session_table_t* table);
+
+/**
+ * Move a session into the table
+ *
+ * Takes ownership of a heap session (e.g. from p2p_handshake_server()),
+ * moves it into a table slot and frees the heap object.
+ *
+ * @param table Session table
+ * @param session Heap session (freed on success, untouched on failure)
+ * @param conn_id Application connection id (must be unique in table)
+ * @return Session pointer inside table, or NULL if full / conn_id in use
+ *
+ * @example
+ *   p2p_session_t* s = p2p_handshake_server(sock, kp, NULL, 0);
+ *   s = p2p_session_table_adopt(table, s, conn_id);
+ */
+p2p_session_t* p2p_session_table_adopt(p2p_session_table_t* table,
+                                       p2p_session_t* session,
+                                       uint64_t conn_id);
+
+/**
+ * Find session by connection id
+ *
+ * @return Session, or NULL if not found
+ */
+p2p_session_t* p2p_session_table_find_conn(const p2p_session_table_t* table,
+                                           uint64_t conn_id);
+
+/**
+ * Find session by peer public key
+ *
+ * @param table Session table
+ * @param peer_pubkey 32-byte Ed25519 public key
+ * @return Most recently adopted session for this peer that is still in
+ *         the table, or NULL
+ */
+p2p_session_t* p2p_session_table_find_peer(const p2p_session_table_t* table,
+                                           const uint8_t* peer_pubkey);
+
+/**
+ * Remove session from table and wipe it
+ *
+ * Same as p2p_session_free() on a table session.
+ *
+ * @return 0 on success, -1 if session is not in this table
+ */
+int p2p_session_table_remove(p2p_session_table_t* table, p2p_session_t* session);
+
+/**
+ * Get connection id of a table session
+ *
+ * @return Connection id, or 0 if session is not in a table
+ */
+uint64_t p2p_session_conn_id(const p2p_session_t* session);
+
+/**
+ * Number of sessions in table
+ */
+size_t p2p_session_table_count(const p2p_session_table_t* table);
+
+/**
+ * Bytes allocated by table (slots + indexes, excluding key arena)
+ */
+size_t p2p_session_table_memory_usage(const p2p_session_table_t* table);
+
+#endif /* P2PNET_SESSION_TABLE_H */
@@ -78,6 +78,92 @@ int p2p_socket_listen(p2p_socket_t* sock, int backlog);
  */
 p2p_socket_t* p2p_socket_accept(p2p_socket_t* sock);
 
+/**
+ * Opptaksregler for innkommende tilkoblinger (admission control)
+ *
+ * Sjekkes i p2p_socket_accept_batch() rett etter accept, før appen får
+ * socketen og før noe krypto er brukt. Tilkoblinger over en grense
+ * lukkes med en gang (RST, ingen TIME_WAIT på serveren). Trådsikker:
+ * sockets kan lukkes fra andre tråder enn den som aksepterer.
+ *
+ *   max_pending  Maks aksepterte tilkoblinger som ikke er ferdige med
+ *                handshake (p2p_socket_admitted() ikke kalt, ikke lukket)
+ *   max_per_ip   Maks åpne tilkoblinger per peer-IP (IPv4/IPv6; gjelder
+ *                ikke Unix sockets)
+ */
+typedef struct p2p_admission p2p_admission_t;
+
+/**
+ * Oppretter opptaksregler
+ *
+ * @param max_pending Maks ventende handshakes (0 = ubegrenset)
+ * @param max_per_ip Maks tilkoblinger per IP (0 = ubegrenset)
+ * @return Nye regler, eller NULL ved feil
+ */
+p2p_admission_t* p2p_admission_create(int max_pending, int max_per_ip);
+
+/**
+ * Frigjør opptaksreglene (kan være NULL)
+ *
+ * Sockets som fortsatt er åpne holder reglene i live til de lukkes.
+ */
+void p2p_admission_free(p2p_admission_t* admission);
+
+/**
+ * Henter tellere for opptaket
+ *
+ * @param pending Output: ventende handshakes nå (kan være NULL)
+ * @param rejected Output: avviste tilkoblinger totalt (kan være NULL)
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_admission_stats(p2p_admission_t* admission, int* pending, uint64_t* rejected);
+
+/**
+ * Markerer at en akseptert socket er ferdig med handshake
+ *
+ * Frigjør plassen socketen tok av max_pending (per-IP-plassen holdes til
+ * socketen lukkes). Gjør ingenting for sockets uten opptaksregler, og
+ * kan trygt kalles flere ganger.
+ *
+ * @param sock Socket fra p2p_socket_accept_batch()
+ */
+void p2p_socket_admitted(p2p_socket_t* sock);
+
+/**
+ * Accept-flagg
+ */
+#define P2P_ACCEPT_NONBLOCK 0x1     // Aksepterte sockets er non-blocking
+
+/**
+ * Aksepterer alle ventende tilkoblinger (ikke-blokkerende)
+ *
+ * For lyttere i event loop: ett lesbar-event kan bety mange ventende
+ * tilkoblinger (reconnect-storm), og én accept per event gjør accept til
+ * flaskehalsen. Aksepterer til køen er tom eller max er nådd, med
+ * accept4(SOCK_CLOEXEC) på Linux så ingen ekstra fcntl-kall trengs.
+ * Socket-strukturene gjenbrukes fra en pool i stedet for malloc per
+ * tilkobling. Tilkoblinger som bryter opptaksreglene lukkes og telles,
+ * men returneres ikke.
+ *
+ * Gjør høyst max accept-forsøk per kall, også for tilkoblinger som avvises
+ * eller var avbrutt av peer, så en flom av dem ikke holder tråden fast.
+ * Venter flere, er listeneren fortsatt lesbar og event loop kaller igjen.
+ *
+ * Er prosessen tom for fd-er (EMFILE/ENFILE), brukes en reservert fd til å
+ * ta tilkoblingen ut av køen og lukke den (telles som avvist), så en
+ * lesbar listener ikke spinner. Windows: gir -1, stopp accept en stund.
+ *
+ * @param sock Server socket (listen mode, må være satt non-blocking med
+ *             p2p_socket_set_nonblocking(), ellers -1)
+ * @param out Output: aksepterte sockets
+ * @param max Plass i out, og maks antall forsøk
+ * @param admission Opptaksregler (NULL = ingen)
+ * @param flags 0 eller P2P_ACCEPT_NONBLOCK
+ * @return Antall sockets i out (0 = ingen akseptert), -1 ved feil
+ */
+int p2p_socket_accept_batch(p2p_socket_t* sock, p2p_socket_t** out, int max,
+                            p2p_admission_t* admission, int flags);
+
 /**
  * Kobler til en server (for klienter)
  * 
@@ -134,12 +220,213 @@ SOCKET p2p_socket_get_handle(p2p_socket_t* sock);
 int p2p_socket_get_handle(p2p_socket_t* sock);
 #endif
 
-#endif /* P2PNET_SOCKET_H */
-
 /**
  * Setter socket i non-blocking mode
  * 
  * @param sock Socket å sette non-blocking
  * @return 0 ved suksess, -1 ved feil
  */
-int p2p_socket_set_nonblocking(p2p_socket_t* sock, int enabled);
\ No newline at end of file
+int p2p_socket_set_nonblocking(p2p_socket_t* sock, int enabled);
+
+/**
+ * Slår av/på Nagle (TCP_NODELAY)
+ * 
+ * Framed meldinger sendes som header + data i to send()-kall; med Nagle
+ * på kan svaret vente på delayed ACK. Slå på for request/response-trafikk.
+ * 
+ * @param sock TCP socket
+ * @param enabled 1 = send umiddelbart, 0 = Nagle (default)
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_socket_set_nodelay(p2p_socket_t* sock, int enabled);
+
+/**
+ * Slår på busy polling i kjernen (SO_BUSY_POLL, Linux)
+ * 
+ * Et blokkerende recv() uten data spinner på nettverkskortets kø i opptil
+ * usec mikrosekunder før tråden legges til å sove, så pakker som kommer
+ * like etter plukkes opp uten interrupt- og wakeup-forsinkelse. Koster
+ * CPU. Verdier over sysctl net.core.busy_read krever CAP_NET_ADMIN.
+ * 
+ * @param sock Socket (tcp eller unix)
+ * @param usec Mikrosekunder å spinne (0 = av)
+ * @return 0 ved suksess, -1 ved feil eller hvis plattformen ikke støtter det
+ */
+int p2p_socket_set_busy_poll(p2p_socket_t* sock, int usec);
+
+/**
+ * Lager en Unix domain stream socket (AF_UNIX)
+ * 
+ * For lokal IPC (f.eks. daemon <-> UI) uten TCP-stacken. Bruk
+ * p2p_socket_bind_unix/connect_unix i stedet for bind/connect;
+ * listen, accept, send/recv, meldinger, handshake og event loop
+ * fungerer som for TCP. Kun POSIX.
+ * 
+ * @return Ny socket, eller NULL ved feil
+ */
+p2p_socket_t* p2p_socket_create_unix(void);
+
+/**
+ * Binder Unix socket til en fil-path
+ * 
+ * En gammel socket-fil som ingen lytter på (server som døde) fjernes
+ * automatisk. Filen fjernes ikke ved close - det er kallerens ansvar.
+ * 
+ * @param sock Socket fra p2p_socket_create_unix()
+ * @param path Path, maks 107 tegn
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_socket_bind_unix(p2p_socket_t* sock, const char* path);
+
+/**
+ * Kobler Unix socket til en server på path
+ * 
+ * @param sock Socket fra p2p_socket_create_unix()
+ * @param path Serverens path
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_socket_connect_unix(p2p_socket_t* sock, const char* path);
+
+/**
+ * Sender en socket til en annen prosess (SCM_RIGHTS)
+ * 
+ * Lar en front-prosess akseptere tilkoblinger og gi dem videre til
+ * worker-prosesser uten å proxye bytes. Mottakeren får sin egen kopi
+ * av fd-en; avsender kan lukke sin socket etterpå. Sender én byte på
+ * kanalen, så kanalen bør ikke samtidig brukes til meldinger uten at
+ * begge sider vet hvor socketen kommer. Kun POSIX.
+ * 
+ * @param channel Unix socket (p2p_socket_create_unix eller p2p_socket_pair)
+ * @param sock Socket som skal sendes (tilkoblet eller listener)
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_socket_send_socket(p2p_socket_t* channel, p2p_socket_t* sock);
+
+/**
+ * Mottar en socket sendt med p2p_socket_send_socket()
+ * 
+ * Transport (tcp/unix) og listen-modus leses fra den mottatte fd-en.
+ * Blokkerer til en socket kommer.
+ * 
+ * @param channel Unix socket
+ * @return Ny socket, eller NULL ved feil
+ */
+p2p_socket_t* p2p_socket_recv_socket(p2p_socket_t* channel);
+
+/**
+ * Kalles når en buffer gitt til p2p_socket_send_zerocopy() er ledig igjen
+ */
+typedef void (*p2p_release_fn)(void* ctx);
+
+/**
+ * Skrur på zero-copy sending (MSG_ZEROCOPY) for store buffere
+ * 
+ * Buffere på minst `threshold` bytes sendt med p2p_socket_send_zerocopy()
+ * (og krypterte meldinger via p2p_session_send) kopieres ikke inn i
+ * kjernen; sidene låses til kjernen melder at de er sendt. Under
+ * terskelen er vanlig kopi raskere (låsing + notifikasjon koster mer
+ * enn memcpy), så ~64 KB er et fornuftig utgangspunkt. Kun TCP på
+ * Linux 4.14+; over loopback kopierer kjernen likevel.
+ * 
+ * @param sock TCP socket
+ * @param threshold Minste størrelse for zero-copy, 0 = av
+ * @return 0 ved suksess, -1 hvis ikke støttet
+ */
+int p2p_socket_set_zerocopy(p2p_socket_t* sock, size_t threshold);
+
+/**
+ * Sender alle bytes, uten kopi hvis zero-copy er på og len >= terskel
+ * 
+ * Bufferen må ikke endres før release(ctx) er kalt. release kalles
+ * nøyaktig én gang, også ved feil: med en gang for kopi-sending, ellers
+ * når kjernen har meldt ferdig (ved en senere send, reap eller close).
+ * Er kjernen ikke ferdig innen ~1 s etter close, holdes bufferen til
+ * den er det (kalles fra en senere p2p_socket_zerocopy_reap() på en
+ * hvilken som helst socket); release kalles aldri før det.
+ * 
+ * @param sock Socket
+ * @param data Buffer som sendes
+ * @param len Antall bytes
+ * @param release Kalles når bufferen er ledig (f.eks. free)
+ * @param ctx Argument til release
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_socket_send_zerocopy(p2p_socket_t* sock, const void* data, size_t len,
+                             p2p_release_fn release, void* ctx);
+
+/**
+ * Henter ferdigmeldinger fra kjernen og frigjør ferdige buffere
+ * 
+ * Skjer automatisk ved hver zero-copy sending, i event loop (POLLERR)
+ * og ved close; kall den selv hvis socketen ellers er stille. Henter
+ * også ferdigmeldinger for lukkede sockets som fortsatt hadde buffere
+ * i kjernen.
+ * 
+ * @param sock Socket (kan være NULL: kun lukkede sockets)
+ * @return Antall buffere kjernen fortsatt holder
+ */
+int p2p_socket_zerocopy_reap(p2p_socket_t* sock);
+
+/**
+ * Lager to sammenkoblede stream-sockets (uten listener/nettverk)
+ * 
+ * Unix: socketpair(AF_UNIX). Windows: TCP over 127.0.0.1 (ingen
+ * socketpair i Winsock). Nyttig for tester og benchmarks som vil kjøre
+ * framing, handshake og kryptering uten en server.
+ * 
+ * @param a Output: første ende
+ * @param b Output: andre ende
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_socket_pair(p2p_socket_t** a, p2p_socket_t** b);
+
+/**
+ * Lager to sammenkoblede sockets i minnet (ingen syscalls)
+ * 
+ * Hver retning er en ringbuffer i prosessen. send/recv oppfører seg som
+ * en blokkerende stream-socket, så framing, handshake og kryptering kan
+ * kjøres, benchmarkes og fuzzes i minnehastighet, og mange simulerte
+ * peers kan kjøre i én prosess. Har ingen handle og kan ikke brukes i
+ * event loop, bind/listen/connect eller set_nonblocking.
+ * 
+ * @param a Output: første ende
+ * @param b Output: andre ende
+ * @param capacity Bytes per retning (0 = 256 KB, rundes opp til 2^n)
+ * @return 0 ved suksess, -1 ved feil
+ */
+int p2p_socket_pair_memory(p2p_socket_t** a, p2p_socket_t** b, size_t capacity);
+
+/**
+ * Henter navnet på socketens transport
+ * 
+ * @param sock Socket
+ * @return "tcp", "unix", "shm" eller "memory" (NULL hvis sock er NULL)
+ */
+const char* p2p_socket_transport(p2p_socket_t* sock);
+
+/**
+ * Flytter en tilkobling til delt minne hvis peer er på samme maskin
+ * 
+ * Hvis peer-adressen er lokal (127.0.0.0/8, egen IP eller AF_UNIX),
+ * forhandler endene frem et shared-memory segment med to ringbuffere,
+ * og socketen bytter til transport "shm". Meldinger, handshake og
+ * kryptering fungerer som før, men uten TCP-stacken: kjernen brukes
+ * bare for å vekke en peer som sover (futex).
+ * 
+ * Endene utveksler alltid et tilbud (64 bytes) og et svar (1 byte), også
+ * når peer ikke er lokal: da sendes et tomt tilbud eller et avslag, og
+ * socketen er uendret. Hver ende vurderer lokalitet selv (de kan være
+ * uenige bak port-forward/NAT), men formatet på linja er det samme.
+ * 
+ * Begge ender MÅ derfor kalle denne på samme sted i protokollen (typisk
+ * rett etter connect/accept, før handshake), én som initiator. Shm finnes
+ * kun på Linux; andre plattformer avslår etter samme utveksling og
+ * returnerer 0. Shm-sockets er blokkerende og kan ikke brukes i event loop.
+ * 
+ * @param sock Tilkoblet stream socket
+ * @param initiator 1 på siden som lager segmentet (typisk klienten), 0 på den andre
+ * @return 1 hvis byttet til shm, 0 hvis uendret, -1 ved feil (tilkoblingen er da ubrukelig)
+ */
+int p2p_socket_upgrade_local(p2p_socket_t* sock, int initiator);
+
+#endif /* P2PNET_SOCKET_H */
@@ -0,0 +1,102 @@
+#ifndef P2PNET_STREAM_H
+#define P2PNET_STREAM_H
+
+#include <p2pnet/socket.h>
+#include <p2pnet/session.h>
+#include <p2pnet/message.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Streaming Messages
+ *
+ * A streamed message is a payload of any size (beyond P2P_MAX_MESSAGE_SIZE,
+ * or of unknown length when sending starts) carried as a sequence of
+ * ordinary frames:
+ *
+ *   [begin frame]  "P2PS" + total length (u64, or unknown) + window (u32)
+ *   [chunk frame]  type (u8) + up to `window` bytes of data
+ *   ...
+ *   [end frame]    type END (or ABORT if the sender gave up)
+ *
+ * The sender buffers at most one window and the receiver hands every
+ * chunk to a callback as it arrives, so memory on both sides is bounded
+ * by the window instead of the message size. With a session every frame
+ * is an encrypted record; without one they are plaintext frames.
+ *
+ * Streams are blocking and occupy the connection until they end; don't
+ * interleave other messages on the socket while one is open.
+ */
+
+#define P2P_STREAM_DEFAULT_WINDOW (64 * 1024)
+#define P2P_STREAM_MAX_WINDOW (P2P_MAX_MESSAGE_SIZE - 1)    // One type byte per frame
+
+/**
+ * Total length for streams whose size isn't known up front
+ */
+#define P2P_STREAM_UNKNOWN_LENGTH UINT64_MAX
+
+typedef struct p2p_stream_writer p2p_stream_writer_t;
+
+/**
+ * Called for every chunk received
+ *
+ * @param data Chunk data (only valid during the call)
+ * @param length Chunk length (1..window)
+ * @param offset Position of the chunk within the message
+ * @param user_data User context
+ * @return 0 to continue, non-zero to stop receiving (p2p_stream_recv() fails)
+ */
+typedef int (*p2p_stream_chunk_fn)(const uint8_t* data, size_t length,
+                                   uint64_t offset, void* user_data);
+
+/**
+ * Start a streamed message (sends the begin frame)
+ *
+ * @param sock Connected socket
+ * @param session Encrypted session, or NULL for plaintext
+ * @param total_length Message size, or P2P_STREAM_UNKNOWN_LENGTH
+ * @param window Bytes per chunk (0 = P2P_STREAM_DEFAULT_WINDOW, max P2P_STREAM_MAX_WINDOW)
+ * @return Writer, or NULL on error
+ */
+p2p_stream_writer_t* p2p_stream_begin(p2p_socket_t* sock, p2p_session_t* session,
+                                      uint64_t total_length, size_t window);
+
+/**
+ * Append data to the message
+ *
+ * Buffers up to one window; full windows are sent as they fill.
+ *
+ * @return 0 on success, -1 on error (network, or more data than total_length).
+ *         After an error the writer only accepts p2p_stream_end()/p2p_stream_abort().
+ */
+int p2p_stream_write(p2p_stream_writer_t* writer, const void* data, size_t length);
+
+/**
+ * Flush and finish the message, then free the writer
+ *
+ * @return 0 on success, -1 on error (including fewer bytes written than
+ *         a declared total_length; the receiver sees an aborted stream)
+ */
+int p2p_stream_end(p2p_stream_writer_t* writer);
+
+/**
+ * Abandon the message (best effort ABORT to the receiver), then free the writer
+ */
+void p2p_stream_abort(p2p_stream_writer_t* writer);
+
+/**
+ * Receive one streamed message, delivering it chunk by chunk
+ *
+ * @param sock Connected socket
+ * @param session Encrypted session, or NULL for plaintext
+ * @param on_chunk Chunk callback
+ * @param user_data Passed to on_chunk
+ * @param max_length Reject (declared or actual) messages larger than this
+ * @return Message length, or -1 on error, abort, or callback stop
+ */
+int64_t p2p_stream_recv(p2p_socket_t* sock, p2p_session_t* session,
+                        p2p_stream_chunk_fn on_chunk, void* user_data,
+                        uint64_t max_length);
+
+#endif /* P2PNET_STREAM_H */
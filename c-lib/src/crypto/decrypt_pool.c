@@ -0,0 +1,277 @@
+#include <p2pnet/decrypt_pool.h>
+#include <p2pnet/log.h>
+#include "session_internal.h"
+#include "../platform/thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_MAX_IN_FLIGHT 64
+
+/**
+ * Slot states in reorder buffer
+ */
+#define SLOT_EMPTY    0   // Free
+#define SLOT_QUEUED   1   // Submitted, waiting for a worker
+#define SLOT_RUNNING  2   // Worker is decrypting
+#define SLOT_DONE     3   // Decrypted (or failed), waiting for in-order delivery
+
+/**
+ * One record in flight
+ */
+typedef struct {
+    int state;
+    p2p_session_t* session;
+    p2p_decrypt_callback on_message;
+    void* user_data;
+    uint8_t nonce[12];
+    uint8_t* ciphertext;
+    size_t ciphertext_len;
+    p2p_message_t* result;
+} record_slot_t;
+
+/**
+ * Decrypt pool internal structure
+ *
+ * The reorder buffer doubles as the work queue. Sequence numbers only grow:
+ *   deliver_seq <= dispatch_seq <= submit_seq
+ * Slot for sequence N lives at slots[N % capacity].
+ */
+struct p2p_decrypt_pool {
+    record_slot_t* slots;
+    size_t capacity;
+
+    uint64_t submit_seq;        // Next sequence to submit (I/O thread)
+    uint64_t dispatch_seq;      // Next sequence to hand to a worker
+    uint64_t deliver_seq;       // Next sequence to deliver to callback
+    int delivering;             // 1 while a worker runs callbacks
+    int shutdown;               // 1 when workers should exit
+
+    p2p_mutex_t lock;
+    p2p_cond_t work_ready;      // Signalled when submit_seq advances
+    p2p_cond_t space_ready;     // Signalled when deliver_seq advances
+
+    p2p_thread_t* workers;
+    int num_workers;
+};
+
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+/**
+ * Deliver all consecutive finished records (lock must be held)
+ *
+ * Only one thread delivers at a time, so callbacks and recv_nonce updates
+ * are serialized and happen in submission order.
+ */
+static void deliver_ready(p2p_decrypt_pool_t* pool) {
+    if (pool->delivering) {
+        return;  // Another worker is delivering and will pick ours up
+    }
+
+    pool->delivering = 1;
+
+    while (pool->deliver_seq < pool->dispatch_seq) {
+        record_slot_t* slot = &pool->slots[pool->deliver_seq % pool->capacity];
+        if (slot->state != SLOT_DONE) {
+            break;  // Next-in-order record is still being decrypted
+        }
+
+        p2p_session_t* session = slot->session;
+        p2p_decrypt_callback on_message = slot->on_message;
+        void* user_data = slot->user_data;
+        p2p_message_t* msg = slot->result;
+        uint8_t nonce[12];
+        memcpy(nonce, slot->nonce, sizeof(nonce));
+
+        p2p_mutex_unlock(&pool->lock);
+
+        // Replay check must happen in order, after decryption succeeded
+        if (msg) {
+            if (p2p_session_check_replay(session, nonce) == 0) {
+                p2p_session_accept_nonce(session, nonce);
+            } else {
+                p2p_message_free(msg);
+                msg = NULL;
+            }
+        }
+
+        if (on_message) {
+            on_message(session, msg, user_data);
+        } else {
+            p2p_message_free(msg);
+        }
+
+        p2p_mutex_lock(&pool->lock);
+
+        slot->state = SLOT_EMPTY;
+        slot->result = NULL;
+        pool->deliver_seq++;
+        p2p_cond_broadcast(&pool->space_ready);
+    }
+
+    pool->delivering = 0;
+}
+
+/**
+ * Worker thread: take next record, decrypt outside the lock, deliver
+ */
+static P2P_THREAD_FUNC(worker_main) {
+    p2p_decrypt_pool_t* pool = (p2p_decrypt_pool_t*)arg;
+
+    p2p_mutex_lock(&pool->lock);
+
+    for (;;) {
+        while (pool->dispatch_seq == pool->submit_seq && !pool->shutdown) {
+            p2p_cond_wait(&pool->work_ready, &pool->lock);
+        }
+
+        if (pool->dispatch_seq == pool->submit_seq) {
+            break;  // Shutdown and nothing left to do
+        }
+
+        record_slot_t* slot = &pool->slots[pool->dispatch_seq % pool->capacity];
+        pool->dispatch_seq++;
+        slot->state = SLOT_RUNNING;
+
+        p2p_mutex_unlock(&pool->lock);
+
+        p2p_message_t* msg = p2p_session_open_record(slot->session, slot->nonce,
+                                                     slot->ciphertext,
+                                                     slot->ciphertext_len);
+        free(slot->ciphertext);
+        slot->ciphertext = NULL;
+
+        p2p_mutex_lock(&pool->lock);
+
+        slot->result = msg;
+        slot->state = SLOT_DONE;
+        deliver_ready(pool);
+    }
+
+    p2p_mutex_unlock(&pool->lock);
+
+    P2P_THREAD_EXIT;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+p2p_decrypt_pool_t* p2p_decrypt_pool_create(int num_workers, size_t max_in_flight) {
+    if (num_workers < 1) {
+        return NULL;
+    }
+
+    if (max_in_flight == 0) {
+        max_in_flight = DEFAULT_MAX_IN_FLIGHT;
+    }
+
+    p2p_decrypt_pool_t* pool = (p2p_decrypt_pool_t*)calloc(1, sizeof(p2p_decrypt_pool_t));
+    if (!pool) return NULL;
+
+    pool->slots = (record_slot_t*)calloc(max_in_flight, sizeof(record_slot_t));
+    pool->workers = (p2p_thread_t*)calloc((size_t)num_workers, sizeof(p2p_thread_t));
+    if (!pool->slots || !pool->workers) {
+        free(pool->slots);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+
+    pool->capacity = max_in_flight;
+
+    p2p_mutex_init(&pool->lock);
+    p2p_cond_init(&pool->work_ready);
+    p2p_cond_init(&pool->space_ready);
+
+    for (int i = 0; i < num_workers; i++) {
+        if (p2p_thread_start(&pool->workers[i], worker_main, pool) != 0) {
+            P2P_LOG_ERROR("DECRYPT_POOL", "Failed to start worker %d", i);
+            pool->num_workers = i;
+            p2p_decrypt_pool_free(pool);
+            return NULL;
+        }
+    }
+
+    pool->num_workers = num_workers;
+
+    return pool;
+}
+
+void p2p_decrypt_pool_free(p2p_decrypt_pool_t* pool) {
+    if (!pool) return;
+
+    // Workers drain the queue before they exit
+    p2p_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    p2p_cond_broadcast(&pool->work_ready);
+    p2p_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        p2p_thread_join(pool->workers[i]);
+    }
+
+    p2p_cond_destroy(&pool->work_ready);
+    p2p_cond_destroy(&pool->space_ready);
+    p2p_mutex_destroy(&pool->lock);
+
+    free(pool->workers);
+    free(pool->slots);
+    free(pool);
+}
+
+int p2p_session_recv_async(p2p_decrypt_pool_t* pool,
+                           p2p_session_t* session,
+                           p2p_socket_t* sock,
+                           p2p_decrypt_callback on_message,
+                           void* user_data) {
+    if (!pool || !session || !sock) {
+        P2P_LOG_ERROR("DECRYPT_POOL", "Invalid parameters");
+        return -1;
+    }
+
+    // Framing only - no crypto on the I/O thread
+    uint8_t nonce[12];
+    uint8_t* ciphertext;
+    size_t ciphertext_len;
+
+    if (p2p_session_read_record(sock, nonce, &ciphertext, &ciphertext_len) != 0) {
+        return -1;
+    }
+
+    p2p_mutex_lock(&pool->lock);
+
+    // Backpressure: wait for a free slot in the reorder buffer
+    while (pool->submit_seq - pool->deliver_seq >= pool->capacity) {
+        p2p_cond_wait(&pool->space_ready, &pool->lock);
+    }
+
+    record_slot_t* slot = &pool->slots[pool->submit_seq % pool->capacity];
+    slot->state = SLOT_QUEUED;
+    slot->session = session;
+    slot->on_message = on_message;
+    slot->user_data = user_data;
+    memcpy(slot->nonce, nonce, sizeof(nonce));
+    slot->ciphertext = ciphertext;
+    slot->ciphertext_len = ciphertext_len;
+    slot->result = NULL;
+
+    pool->submit_seq++;
+    p2p_cond_signal(&pool->work_ready);
+
+    p2p_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
+void p2p_decrypt_pool_flush(p2p_decrypt_pool_t* pool) {
+    if (!pool) return;
+
+    p2p_mutex_lock(&pool->lock);
+    while (pool->deliver_seq != pool->submit_seq) {
+        p2p_cond_wait(&pool->space_ready, &pool->lock);
+    }
+    p2p_mutex_unlock(&pool->lock);
+}
@@ -1,87 +1,56 @@
 #include <p2pnet/encryption.h>
 #include <p2pnet/socket.h>
 #include <p2pnet/message.h>
+#include <p2pnet/log.h>
+#include "session_internal.h"
+#include "../protocol/frame.h"
+#include "../util/histogram.h"
+#include "../util/metrics.h"
 #include <sodium.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // ChaCha20-Poly1305 constants
-#define NONCE_SIZE 12
-#define MAC_SIZE 16
+#define NONCE_SIZE P2P_NONCE_SIZE
+#define MAC_SIZE   P2P_MAC_SIZE
 
 /**
- * Helper: Construct nonce from counter
- * 
- * Nonce format (12 bytes):
- * ┌──────────────────────┬──────────────────┐
- * │ Counter (8 bytes)    │ Padding (4 bytes) │
- * │ uint64_t (big-endian)│ 0x00000000        │
- * └──────────────────────┴──────────────────┘
- */
-static void construct_nonce(uint64_t counter, uint8_t nonce[NONCE_SIZE]) {
-    // Zero-initialize nonce
-    memset(nonce, 0, NONCE_SIZE);
-    
-    // Write counter in big-endian (network byte order)
-    nonce[0] = (counter >> 56) & 0xFF;
-    nonce[1] = (counter >> 48) & 0xFF;
-    nonce[2] = (counter >> 40) & 0xFF;
-    nonce[3] = (counter >> 32) & 0xFF;
-    nonce[4] = (counter >> 24) & 0xFF;
-    nonce[5] = (counter >> 16) & 0xFF;
-    nonce[6] = (counter >> 8) & 0xFF;
-    nonce[7] = counter & 0xFF;
-    
-    // Remaining 4 bytes already zero (padding)
-}
-
-/**
- * Helper: Extract counter from nonce
+ * Helper: Latency histogram for AEAD operation on len bytes of plaintext
  */
-static uint64_t extract_counter(const uint8_t nonce[NONCE_SIZE]) {
-    uint64_t counter = 0;
-    counter |= ((uint64_t)nonce[0] << 56);
-    counter |= ((uint64_t)nonce[1] << 48);
-    counter |= ((uint64_t)nonce[2] << 40);
-    counter |= ((uint64_t)nonce[3] << 32);
-    counter |= ((uint64_t)nonce[4] << 24);
-    counter |= ((uint64_t)nonce[5] << 16);
-    counter |= ((uint64_t)nonce[6] << 8);
-    counter |= ((uint64_t)nonce[7]);
-    return counter;
+static p2p_latency_t size_class(p2p_latency_t base, size_t len) {
+    if (len <= 64)    return base;
+    if (len <= 1024)  return (p2p_latency_t)(base + 1);
+    if (len <= 16384) return (p2p_latency_t)(base + 2);
+    return (p2p_latency_t)(base + 3);
 }
 
 /**
- * Helper: Send exact amount of data (handles partial sends)
+ * Encrypt one record with ChaCha20-Poly1305 (internal, no I/O)
+ * 
+ * Mirror of p2p_session_open_record(): pure function of (key, nonce,
+ * plaintext), the caller owns the nonce counter.
  */
-static int send_exact(p2p_socket_t* sock, const void* data, size_t length) {
-    size_t total_sent = 0;
-    const uint8_t* ptr = (const uint8_t*)data;
-    
-    while (total_sent < length) {
-        ssize_t sent = p2p_socket_send(sock, ptr + total_sent, length - total_sent);
-        if (sent <= 0) {
-            return -1;  // Error or connection closed
-        }
-        total_sent += sent;
-    }
+int p2p_session_seal_record(const p2p_session_t* session,
+                            const uint8_t nonce[NONCE_SIZE],
+                            const uint8_t* data,
+                            size_t length,
+                            uint8_t* ciphertext) {
+    unsigned long long ciphertext_len;
+    uint64_t t = p2p_latency_start();
+    int result = crypto_aead_chacha20poly1305_ietf_encrypt(
+        ciphertext, &ciphertext_len,
+        data, length,
+        NULL, 0,  // No additional authenticated data
+        NULL,     // nsec (unused)
+        nonce,
+        session->session_key
+    );
+    p2p_latency_lap(size_class(P2P_LATENCY_ENCRYPT_64, length), t);
     
-    return 0;
-}
-
-/**
- * Helper: Receive exact amount of data (handles partial reads)
- */
-static int recv_exact(p2p_socket_t* sock, void* buffer, size_t length) {
-    size_t total_received = 0;
-    uint8_t* ptr = (uint8_t*)buffer;
-    
-    while (total_received < length) {
-        ssize_t received = p2p_socket_recv(sock, ptr + total_received, length - total_received);
-        if (received <= 0) {
-            return -1;  // Error or connection closed
-        }
-        total_received += received;
+    if (result != 0) {
+        P2P_LOG_ERROR("ENCRYPTION", "Encryption failed");
+        return -1;
     }
     
     return 0;
@@ -92,174 +61,255 @@ int p2p_session_send(p2p_session_t* session,
                      const uint8_t* data,
                      size_t length) {
     if (!session || !sock || !data || length == 0) {
-        fprintf(stderr, "[ENCRYPTION] Invalid parameters\n");
+        P2P_LOG_ERROR("ENCRYPTION", "Invalid parameters");
         return -1;
     }
     
     // Check for counter overflow (extremely unlikely - 2^64 messages)
     if (session->send_nonce == UINT64_MAX) {
-        fprintf(stderr, "[ENCRYPTION] CRITICAL: Send nonce overflow! Re-handshake required.\n");
+        P2P_LOG_ERROR("ENCRYPTION", "CRITICAL: Send nonce overflow! Re-handshake required.");
         return -1;
     }
     
     // Construct nonce from current counter
     uint8_t nonce[NONCE_SIZE];
-    construct_nonce(session->send_nonce, nonce);
+    p2p_construct_nonce(session->send_nonce, nonce);
     
     // Allocate buffer for ciphertext + MAC
     // ChaCha20-Poly1305 adds 16-byte MAC tag
-    unsigned long long ciphertext_len;
-    uint8_t* ciphertext = (uint8_t*)malloc(length + MAC_SIZE);
+    size_t ciphertext_len = length + MAC_SIZE;
+    uint8_t* ciphertext = (uint8_t*)malloc(ciphertext_len);
     if (!ciphertext) {
-        fprintf(stderr, "[ENCRYPTION] Memory allocation failed\n");
+        P2P_LOG_ERROR("ENCRYPTION", "Memory allocation failed");
         return -1;
     }
     
-    // Encrypt with ChaCha20-Poly1305
-    int result = crypto_aead_chacha20poly1305_ietf_encrypt(
-        ciphertext, &ciphertext_len,
-        data, length,
-        NULL, 0,  // No additional authenticated data
-        NULL,     // nsec (unused)
-        nonce,
-        session->session_key
-    );
-    
-    if (result != 0) {
-        fprintf(stderr, "[ENCRYPTION] Encryption failed\n");
+    if (p2p_session_seal_record(session, nonce, data, length, ciphertext) != 0) {
         free(ciphertext);
         return -1;
     }
     
     // Wire format: [4B length][12B nonce][ciphertext + MAC]
-    uint32_t total_length = NONCE_SIZE + ciphertext_len;
+    uint32_t total_length = (uint32_t)(NONCE_SIZE + ciphertext_len);
     uint32_t network_length = htonl(total_length);
     
     // Send length header
-    if (send_exact(sock, &network_length, sizeof(network_length)) != 0) {
-        fprintf(stderr, "[ENCRYPTION] Failed to send length header\n");
+    if (p2p_send_exact(sock, &network_length, sizeof(network_length)) != 0) {
+        P2P_LOG_WARN("ENCRYPTION", "Failed to send length header");
         free(ciphertext);
         return -1;
     }
     
     // Send nonce
-    if (send_exact(sock, nonce, NONCE_SIZE) != 0) {
-        fprintf(stderr, "[ENCRYPTION] Failed to send nonce\n");
+    if (p2p_send_exact(sock, nonce, NONCE_SIZE) != 0) {
+        P2P_LOG_WARN("ENCRYPTION", "Failed to send nonce");
         free(ciphertext);
         return -1;
     }
     
-    // Send ciphertext + MAC
-    if (send_exact(sock, ciphertext, ciphertext_len) != 0) {
-        fprintf(stderr, "[ENCRYPTION] Failed to send ciphertext\n");
-        free(ciphertext);
+    // Send ciphertext + MAC. Zero-copy if enabled on the socket, so the
+    // buffer is owned (and freed) by the socket layer from here on
+    if (p2p_socket_send_zerocopy(sock, ciphertext, ciphertext_len, free, ciphertext) != 0) {
+        P2P_LOG_WARN("ENCRYPTION", "Failed to send ciphertext");
         return -1;
     }
     
     // Increment send nonce (CRITICAL: must happen after successful send)
     session->send_nonce++;
     
-    free(ciphertext);
+    p2p_metric_add(NULL, P2P_METRIC_MESSAGES_OUT, 1);
+    
     return 0;
 }
 
-p2p_message_t* p2p_session_recv(p2p_session_t* session,
-                                 p2p_socket_t* sock) {
-    if (!session || !sock) {
-        fprintf(stderr, "[ENCRYPTION] Invalid parameters\n");
-        return NULL;
-    }
-    
+/**
+ * Read one encrypted record from socket (framing only, no crypto)
+ * 
+ * Internal: shared by p2p_session_recv() and the decrypt pool, so the
+ * I/O thread can frame records without touching ChaCha20-Poly1305.
+ * 
+ * @param sock Connected socket
+ * @param nonce Output: 12-byte nonce from record
+ * @param ciphertext Output: malloc'd ciphertext + MAC (caller frees)
+ * @param ciphertext_len Output: length of ciphertext + MAC
+ * @return 0 on success, -1 on error/disconnect
+ */
+int p2p_session_read_record(p2p_socket_t* sock,
+                            uint8_t nonce[NONCE_SIZE],
+                            uint8_t** ciphertext,
+                            size_t* ciphertext_len) {
     // Receive length header
     uint32_t network_length;
-    if (recv_exact(sock, &network_length, sizeof(network_length)) != 0) {
-        fprintf(stderr, "[ENCRYPTION] Failed to receive length header\n");
-        return NULL;
+    if (p2p_recv_exact(sock, &network_length, sizeof(network_length)) != 0) {
+        P2P_LOG_DEBUG("ENCRYPTION", "Failed to receive length header");
+        return -1;
     }
     
     uint32_t total_length = ntohl(network_length);
     
     // Sanity check: minimum length is NONCE_SIZE + MAC_SIZE
     if (total_length < NONCE_SIZE + MAC_SIZE) {
-        fprintf(stderr, "[ENCRYPTION] Invalid message length: %u\n", total_length);
-        return NULL;
+        P2P_LOG_WARN("ENCRYPTION", "Invalid message length: %u", total_length);
+        return -1;
     }
     
     // Sanity check: reasonable maximum (1MB + overhead)
     if (total_length > P2P_MAX_MESSAGE_SIZE + NONCE_SIZE + MAC_SIZE) {
-        fprintf(stderr, "[ENCRYPTION] Message too large: %u\n", total_length);
-        return NULL;
+        P2P_LOG_WARN("ENCRYPTION", "Message too large: %u", total_length);
+        return -1;
     }
     
     // Receive nonce
-    uint8_t nonce[NONCE_SIZE];
-    if (recv_exact(sock, nonce, NONCE_SIZE) != 0) {
-        fprintf(stderr, "[ENCRYPTION] Failed to receive nonce\n");
-        return NULL;
+    if (p2p_recv_exact(sock, nonce, NONCE_SIZE) != 0) {
+        P2P_LOG_WARN("ENCRYPTION", "Failed to receive nonce");
+        return -1;
     }
     
-    // Extract and verify nonce counter
-    uint64_t received_counter = extract_counter(nonce);
+    // Receive ciphertext + MAC
+    size_t length = total_length - NONCE_SIZE;
+    uint8_t* buffer = (uint8_t*)malloc(length);
+    if (!buffer) {
+        P2P_LOG_ERROR("ENCRYPTION", "Memory allocation failed");
+        return -1;
+    }
     
-    // Replay protection: nonce must be strictly increasing
-    if (received_counter <= session->recv_nonce) {
-        fprintf(stderr, "[ENCRYPTION] SECURITY: Nonce rewind detected! "
-                        "Expected >%llu, got %llu (replay attack?)\n",
-                        session->recv_nonce, received_counter);
-        return NULL;
+    if (p2p_recv_exact(sock, buffer, length) != 0) {
+        P2P_LOG_WARN("ENCRYPTION", "Failed to receive ciphertext");
+        free(buffer);
+        return -1;
     }
     
-    // Receive ciphertext + MAC
-    size_t ciphertext_len = total_length - NONCE_SIZE;
-    uint8_t* ciphertext = (uint8_t*)malloc(ciphertext_len);
-    if (!ciphertext) {
-        fprintf(stderr, "[ENCRYPTION] Memory allocation failed\n");
+    *ciphertext = buffer;
+    *ciphertext_len = length;
+    return 0;
+}
+
+/**
+ * Verify MAC and decrypt one record into a new message
+ * 
+ * Internal: pure function of (key, nonce, ciphertext) - does NOT check or
+ * update recv_nonce, so it is safe to call from decrypt worker threads.
+ * Plaintext is written straight into the message buffer (no extra copy).
+ * 
+ * @return Decrypted message, or NULL if MAC verification failed
+ */
+p2p_message_t* p2p_session_open_record(const p2p_session_t* session,
+                                       const uint8_t nonce[NONCE_SIZE],
+                                       const uint8_t* ciphertext,
+                                       size_t ciphertext_len) {
+    // Empty plaintext is not a valid message (matches p2p_message_create_binary)
+    if (ciphertext_len <= MAC_SIZE) {
+        P2P_LOG_WARN("ENCRYPTION", "Empty encrypted message");
         return NULL;
     }
     
-    if (recv_exact(sock, ciphertext, ciphertext_len) != 0) {
-        fprintf(stderr, "[ENCRYPTION] Failed to receive ciphertext\n");
-        free(ciphertext);
+    p2p_message_t* msg = (p2p_message_t*)malloc(sizeof(p2p_message_t));
+    if (!msg) {
+        P2P_LOG_ERROR("ENCRYPTION", "Memory allocation failed");
         return NULL;
     }
     
-    // Allocate buffer for plaintext (same size as ciphertext minus MAC)
-    size_t plaintext_max_len = ciphertext_len;  // Includes MAC, but decrypt will adjust
-    uint8_t* plaintext = (uint8_t*)malloc(plaintext_max_len);
-    if (!plaintext) {
-        fprintf(stderr, "[ENCRYPTION] Memory allocation failed\n");
-        free(ciphertext);
+    msg->release = NULL;
+    msg->release_ctx = NULL;
+    msg->data = (uint8_t*)malloc(ciphertext_len - MAC_SIZE);
+    if (!msg->data) {
+        P2P_LOG_ERROR("ENCRYPTION", "Memory allocation failed");
+        free(msg);
         return NULL;
     }
+    p2p_metric_add(NULL, P2P_METRIC_ALLOCATIONS, 1);
     
     // Decrypt and verify MAC
     unsigned long long plaintext_len;
+    uint64_t t = p2p_latency_start();
     int result = crypto_aead_chacha20poly1305_ietf_decrypt(
-        plaintext, &plaintext_len,
+        msg->data, &plaintext_len,
         NULL,     // nsec (unused)
         ciphertext, ciphertext_len,
         NULL, 0,  // No additional authenticated data
         nonce,
         session->session_key
     );
+    p2p_latency_lap(size_class(P2P_LATENCY_DECRYPT_64, ciphertext_len - MAC_SIZE), t);
     
     if (result != 0) {
-        fprintf(stderr, "[ENCRYPTION] SECURITY: Decryption failed! "
-                        "Message tampered or incorrect key.\n");
-        free(ciphertext);
-        free(plaintext);
+        P2P_LOG_WARN("ENCRYPTION", "SECURITY: Decryption failed! "
+                                   "Message tampered or incorrect key.");
+        atomic_fetch_add_explicit(&session->cold->aead_failures, 1, memory_order_relaxed);
+        p2p_metric_add(NULL, P2P_METRIC_AEAD_FAILURES, 1);
+        p2p_message_free(msg);
         return NULL;
     }
     
-    // Update recv_nonce (only after successful decryption)
-    session->recv_nonce = received_counter;
+    msg->length = (uint32_t)plaintext_len;
+    return msg;
+}
+
+/**
+ * Replay protection: nonce must be strictly increasing
+ * 
+ * Internal: also used by the decrypt pool when delivering in order.
+ * 
+ * @return 0 if counter is acceptable, -1 on rewind/replay
+ */
+int p2p_session_check_replay(const p2p_session_t* session,
+                             const uint8_t nonce[NONCE_SIZE]) {
+    uint64_t received_counter = p2p_extract_counter(nonce);
+    
+    if (received_counter <= session->recv_nonce) {
+        P2P_LOG_WARN("ENCRYPTION", "SECURITY: Nonce rewind detected! "
+                                   "Expected >%llu, got %llu (replay attack?)",
+                     (unsigned long long)session->recv_nonce,
+                     (unsigned long long)received_counter);
+        session->cold->replay_rejects++;
+        p2p_metric_add(NULL, P2P_METRIC_REPLAY_REJECTS, 1);
+        return -1;
+    }
     
-    // Create message from plaintext
-    p2p_message_t* msg = p2p_message_create_binary(plaintext, plaintext_len);
+    return 0;
+}
+
+/**
+ * Accept nonce after successful decryption and count the message (internal)
+ */
+void p2p_session_accept_nonce(p2p_session_t* session,
+                              const uint8_t nonce[NONCE_SIZE]) {
+    session->recv_nonce = p2p_extract_counter(nonce);
     
-    // Cleanup
+    p2p_metric_add(NULL, P2P_METRIC_MESSAGES_IN, 1);
+}
+
+p2p_message_t* p2p_session_recv(p2p_session_t* session,
+                                 p2p_socket_t* sock) {
+    if (!session || !sock) {
+        P2P_LOG_ERROR("ENCRYPTION", "Invalid parameters");
+        return NULL;
+    }
+    
+    uint8_t nonce[NONCE_SIZE];
+    uint8_t* ciphertext;
+    size_t ciphertext_len;
+    
+    if (p2p_session_read_record(sock, nonce, &ciphertext, &ciphertext_len) != 0) {
+        return NULL;
+    }
+    
+    // Reject replays before spending any crypto on them
+    if (p2p_session_check_replay(session, nonce) != 0) {
+        free(ciphertext);
+        return NULL;
+    }
+    
+    p2p_message_t* msg = p2p_session_open_record(session, nonce,
+                                                 ciphertext, ciphertext_len);
     free(ciphertext);
-    free(plaintext);
+    
+    if (!msg) {
+        return NULL;
+    }
+    
+    // Update recv_nonce (only after successful decryption)
+    p2p_session_accept_nonce(session, nonce);
     
     return msg;
-}
\ No newline at end of file
+}
@@ -1,5 +1,10 @@
 #include "p2pnet/handshake.h"
 #include "p2pnet/message.h"
+#include "p2pnet/log.h"
+#include "session_internal.h"
+#include "../protocol/frame.h"
+#include "../util/metrics.h"
+#include "../util/histogram.h"
 #include <sodium.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,51 +27,15 @@ p2p_session_t* p2p_session_create(const uint8_t* session_key,
 #define SIZE_KEY_EXCHANGE  97   // 1 + 32 + 64
 #define SIZE_ACCEPT        97   // 1 + 32 + 64
 
-/**
- * Send raw bytes over socket
- */
-static int send_bytes(p2p_socket_t* sock, const uint8_t* data, size_t len) {
-    size_t total_sent = 0;
-    
-    while (total_sent < len) {
-        int sent = p2p_socket_send(sock, (const char*)(data + total_sent), 
-                                   len - total_sent);
-        if (sent <= 0) {
-            return -1;  // Error or connection closed
-        }
-        total_sent += sent;
-    }
-    
-    return 0;
-}
-
-/**
- * Receive exact number of bytes from socket
- */
-static int recv_bytes(p2p_socket_t* sock, uint8_t* buffer, size_t len) {
-    size_t total_received = 0;
-    
-    while (total_received < len) {
-        int received = p2p_socket_recv(sock, (char*)(buffer + total_received),
-                                       len - total_received);
-        if (received <= 0) {
-            return -1;  // Error or connection closed
-        }
-        total_received += received;
-    }
-    
-    return 0;
-}
-
 /**
  * Derive session key from shared secret + identities
  * 
  * session_key = BLAKE2b(shared_secret || alice_id || bob_id || "P2PNetSessionKey")
  */
-static void derive_session_key(uint8_t* session_key,
-                                const uint8_t* shared_secret,
-                                const uint8_t* alice_pubkey,
-                                const uint8_t* bob_pubkey) {
+void p2p_derive_session_key(uint8_t* session_key,
+                            const uint8_t* shared_secret,
+                            const uint8_t* alice_pubkey,
+                            const uint8_t* bob_pubkey) {
     // Prepare input for BLAKE2b
     uint8_t input[32 + 32 + 32 + 17];  // shared + alice + bob + domain separator
     
@@ -103,14 +72,13 @@ static int is_peer_allowed(const uint8_t* peer_pubkey,
     return 0;  // Not allowed
 }
 
-p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
-                                     p2p_keypair_t* my_keypair,
-                                     const uint8_t* expected_peer_pubkey) {
-    if (!sock || !my_keypair) {
-        return NULL;
-    }
-    
-    printf("[HANDSHAKE] Starting client handshake...\n");
+/**
+ * Client side of the handshake (see p2p_handshake_client)
+ */
+static p2p_session_t* run_client_handshake(p2p_socket_t* sock,
+                                           p2p_keypair_t* my_keypair,
+                                           const uint8_t* expected_peer_pubkey) {
+    P2P_LOG_TRACE("HANDSHAKE", "Starting client handshake...");
     
     // ========================================================================
     // Step 1: Generate ephemeral X25519 keypair
@@ -129,27 +97,27 @@ p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
     client_hello[0] = MSG_CLIENT_HELLO;
     memcpy(client_hello + 1, my_keypair->public_key, 32);
     
-    if (send_bytes(sock, client_hello, SIZE_CLIENT_HELLO) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Failed to send ClientHello\n");
+    if (p2p_send_exact(sock, client_hello, SIZE_CLIENT_HELLO) != 0) {
+        P2P_LOG_WARN("HANDSHAKE", "Failed to send ClientHello");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
-    printf("[HANDSHAKE] Sent ClientHello\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Sent ClientHello");
     
     // ========================================================================
     // Step 3: Receive ServerHello (peer identity + challenge)
     // ========================================================================
     
     uint8_t server_hello[SIZE_SERVER_HELLO];
-    if (recv_bytes(sock, server_hello, SIZE_SERVER_HELLO) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Failed to receive ServerHello\n");
+    if (p2p_recv_exact(sock, server_hello, SIZE_SERVER_HELLO) != 0) {
+        P2P_LOG_WARN("HANDSHAKE", "Failed to receive ServerHello");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
     if (server_hello[0] != MSG_SERVER_HELLO) {
-        fprintf(stderr, "[HANDSHAKE] Invalid message type (expected ServerHello)\n");
+        P2P_LOG_WARN("HANDSHAKE", "Invalid message type (expected ServerHello)");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
@@ -160,7 +128,7 @@ p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
     memcpy(server_pubkey, server_hello + 1, 32);
     memcpy(challenge, server_hello + 33, 32);
     
-    printf("[HANDSHAKE] Received ServerHello\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Received ServerHello");
     
     // ========================================================================
     // Step 4: Verify peer identity (if expected)
@@ -168,11 +136,11 @@ p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
     
     if (expected_peer_pubkey) {
         if (sodium_memcmp(server_pubkey, expected_peer_pubkey, 32) != 0) {
-            fprintf(stderr, "[HANDSHAKE] Peer identity mismatch!\n");
+            P2P_LOG_WARN("HANDSHAKE", "Peer identity mismatch!");
             sodium_memzero(ephemeral_secret, 32);
             return NULL;
         }
-        printf("[HANDSHAKE] Peer identity verified\n");
+        P2P_LOG_TRACE("HANDSHAKE", "Peer identity verified");
     }
     
     // ========================================================================
@@ -196,27 +164,27 @@ p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
     memcpy(key_exchange + 1, ephemeral_public, 32);
     memcpy(key_exchange + 33, signature, 64);
     
-    if (send_bytes(sock, key_exchange, SIZE_KEY_EXCHANGE) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Failed to send KeyExchange\n");
+    if (p2p_send_exact(sock, key_exchange, SIZE_KEY_EXCHANGE) != 0) {
+        P2P_LOG_WARN("HANDSHAKE", "Failed to send KeyExchange");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
-    printf("[HANDSHAKE] Sent KeyExchange\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Sent KeyExchange");
     
     // ========================================================================
     // Step 7: Receive Accept
     // ========================================================================
     
     uint8_t accept[SIZE_ACCEPT];
-    if (recv_bytes(sock, accept, SIZE_ACCEPT) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Failed to receive Accept\n");
+    if (p2p_recv_exact(sock, accept, SIZE_ACCEPT) != 0) {
+        P2P_LOG_WARN("HANDSHAKE", "Failed to receive Accept");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
     if (accept[0] != MSG_ACCEPT) {
-        fprintf(stderr, "[HANDSHAKE] Invalid message type (expected Accept)\n");
+        P2P_LOG_WARN("HANDSHAKE", "Invalid message type (expected Accept)");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
@@ -227,7 +195,7 @@ p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
     memcpy(server_ephemeral, accept + 1, 32);
     memcpy(server_signature, accept + 33, 64);
     
-    printf("[HANDSHAKE] Received Accept\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Received Accept");
     
     // ========================================================================
     // Step 8: Verify server signature
@@ -241,12 +209,12 @@ p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
     
     if (crypto_sign_verify_detached(server_signature, server_signed, 96, 
                                      server_pubkey) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Server signature verification failed!\n");
+        P2P_LOG_WARN("HANDSHAKE", "Server signature verification failed!");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
-    printf("[HANDSHAKE] Server signature verified\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Server signature verified");
     
     // ========================================================================
     // Step 9: Derive shared secret (X25519 ECDH)
@@ -254,7 +222,7 @@ p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
     
     uint8_t shared_secret[32];
     if (crypto_scalarmult(shared_secret, ephemeral_secret, server_ephemeral) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Key exchange failed\n");
+        P2P_LOG_WARN("HANDSHAKE", "Key exchange failed");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
@@ -264,10 +232,10 @@ p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
     // ========================================================================
     
     uint8_t session_key[32];
-    derive_session_key(session_key, shared_secret, 
-                       my_keypair->public_key, server_pubkey);
+    p2p_derive_session_key(session_key, shared_secret,
+                           my_keypair->public_key, server_pubkey);
     
-    printf("[HANDSHAKE] Session key derived\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Session key derived");
     
     // ========================================================================
     // Step 11: Create session object
@@ -285,20 +253,21 @@ p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
     sodium_memzero(to_sign, 64);
     sodium_memzero(server_signed, 96);
     
-    printf("[HANDSHAKE] ✅ Client handshake complete!\n");
+    P2P_LOG_DEBUG("HANDSHAKE", "Client handshake complete!");
     
     return session;
 }
 
-p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
-                                     p2p_keypair_t* my_keypair,
-                                     const uint8_t** allowed_peers,
-                                     size_t num_allowed) {
-    if (!sock || !my_keypair) {
-        return NULL;
-    }
+/**
+ * Server side of the handshake (see p2p_handshake_server)
+ */
+static p2p_session_t* run_server_handshake(p2p_socket_t* sock,
+                                           p2p_keypair_t* my_keypair,
+                                           const uint8_t** allowed_peers,
+                                           size_t num_allowed) {
+    P2P_LOG_TRACE("HANDSHAKE", "Starting server handshake...");
     
-    printf("[HANDSHAKE] Starting server handshake...\n");
+    uint64_t t = p2p_latency_start();  // Phase timer
     
     // ========================================================================
     // Step 1: Generate ephemeral X25519 keypair
@@ -316,19 +285,21 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     uint8_t challenge[32];
     randombytes_buf(challenge, 32);
     
+    t = p2p_latency_lap(P2P_LATENCY_HS_SERVER_KEYGEN, t);
+    
     // ========================================================================
     // Step 3: Receive ClientHello
     // ========================================================================
     
     uint8_t client_hello[SIZE_CLIENT_HELLO];
-    if (recv_bytes(sock, client_hello, SIZE_CLIENT_HELLO) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Failed to receive ClientHello\n");
+    if (p2p_recv_exact(sock, client_hello, SIZE_CLIENT_HELLO) != 0) {
+        P2P_LOG_WARN("HANDSHAKE", "Failed to receive ClientHello");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
     if (client_hello[0] != MSG_CLIENT_HELLO) {
-        fprintf(stderr, "[HANDSHAKE] Invalid message type (expected ClientHello)\n");
+        P2P_LOG_WARN("HANDSHAKE", "Invalid message type (expected ClientHello)");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
@@ -336,19 +307,20 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     uint8_t client_pubkey[32];
     memcpy(client_pubkey, client_hello + 1, 32);
     
-    printf("[HANDSHAKE] Received ClientHello\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Received ClientHello");
+    t = p2p_latency_lap(P2P_LATENCY_HS_SERVER_RECV_HELLO, t);
     
     // ========================================================================
     // Step 4: Check if client is allowed
     // ========================================================================
     
     if (!is_peer_allowed(client_pubkey, allowed_peers, num_allowed)) {
-        fprintf(stderr, "[HANDSHAKE] Client not in allowed list!\n");
+        P2P_LOG_WARN("HANDSHAKE", "Client not in allowed list!");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
-    printf("[HANDSHAKE] Client is allowed\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Client is allowed");
     
     // ========================================================================
     // Step 5: Send ServerHello
@@ -359,27 +331,28 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     memcpy(server_hello + 1, my_keypair->public_key, 32);
     memcpy(server_hello + 33, challenge, 32);
     
-    if (send_bytes(sock, server_hello, SIZE_SERVER_HELLO) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Failed to send ServerHello\n");
+    if (p2p_send_exact(sock, server_hello, SIZE_SERVER_HELLO) != 0) {
+        P2P_LOG_WARN("HANDSHAKE", "Failed to send ServerHello");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
-    printf("[HANDSHAKE] Sent ServerHello\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Sent ServerHello");
+    t = p2p_latency_lap(P2P_LATENCY_HS_SERVER_SEND_HELLO, t);
     
     // ========================================================================
     // Step 6: Receive KeyExchange
     // ========================================================================
     
     uint8_t key_exchange[SIZE_KEY_EXCHANGE];
-    if (recv_bytes(sock, key_exchange, SIZE_KEY_EXCHANGE) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Failed to receive KeyExchange\n");
+    if (p2p_recv_exact(sock, key_exchange, SIZE_KEY_EXCHANGE) != 0) {
+        P2P_LOG_WARN("HANDSHAKE", "Failed to receive KeyExchange");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
     if (key_exchange[0] != MSG_KEY_EXCHANGE) {
-        fprintf(stderr, "[HANDSHAKE] Invalid message type (expected KeyExchange)\n");
+        P2P_LOG_WARN("HANDSHAKE", "Invalid message type (expected KeyExchange)");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
@@ -390,7 +363,8 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     memcpy(client_ephemeral, key_exchange + 1, 32);
     memcpy(client_signature, key_exchange + 33, 64);
     
-    printf("[HANDSHAKE] Received KeyExchange\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Received KeyExchange");
+    t = p2p_latency_lap(P2P_LATENCY_HS_SERVER_RECV_KEY_EXCHANGE, t);
     
     // ========================================================================
     // Step 7: Verify client signature
@@ -403,12 +377,13 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     
     if (crypto_sign_verify_detached(client_signature, client_signed, 64,
                                      client_pubkey) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Client signature verification failed!\n");
+        P2P_LOG_WARN("HANDSHAKE", "Client signature verification failed!");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
-    printf("[HANDSHAKE] Client signature verified\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Client signature verified");
+    t = p2p_latency_lap(P2P_LATENCY_HS_SERVER_VERIFY, t);
     
     // ========================================================================
     // Step 8: Sign challenge + ephemeral keys
@@ -423,6 +398,8 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     uint8_t signature[64];
     crypto_sign_detached(signature, NULL, to_sign, 96, my_keypair->secret_key);
     
+    t = p2p_latency_lap(P2P_LATENCY_HS_SERVER_SIGN, t);
+    
     // ========================================================================
     // Step 9: Send Accept
     // ========================================================================
@@ -432,13 +409,14 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     memcpy(accept + 1, ephemeral_public, 32);
     memcpy(accept + 33, signature, 64);
     
-    if (send_bytes(sock, accept, SIZE_ACCEPT) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Failed to send Accept\n");
+    if (p2p_send_exact(sock, accept, SIZE_ACCEPT) != 0) {
+        P2P_LOG_WARN("HANDSHAKE", "Failed to send Accept");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
     
-    printf("[HANDSHAKE] Sent Accept\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Sent Accept");
+    t = p2p_latency_lap(P2P_LATENCY_HS_SERVER_SEND_ACCEPT, t);
     
     // ========================================================================
     // Step 10: Derive shared secret (X25519 ECDH)
@@ -446,7 +424,7 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     
     uint8_t shared_secret[32];
     if (crypto_scalarmult(shared_secret, ephemeral_secret, client_ephemeral) != 0) {
-        fprintf(stderr, "[HANDSHAKE] Key exchange failed\n");
+        P2P_LOG_WARN("HANDSHAKE", "Key exchange failed");
         sodium_memzero(ephemeral_secret, 32);
         return NULL;
     }
@@ -456,10 +434,10 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     // ========================================================================
     
     uint8_t session_key[32];
-    derive_session_key(session_key, shared_secret,
-                       client_pubkey, my_keypair->public_key);
+    p2p_derive_session_key(session_key, shared_secret,
+                           client_pubkey, my_keypair->public_key);
     
-    printf("[HANDSHAKE] Session key derived\n");
+    P2P_LOG_TRACE("HANDSHAKE", "Session key derived");
     
     // ========================================================================
     // Step 12: Create session object
@@ -467,6 +445,8 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     
     p2p_session_t* session = p2p_session_create(session_key, client_pubkey);
     
+    p2p_latency_lap(P2P_LATENCY_HS_SERVER_DERIVE, t);
+    
     // ========================================================================
     // Step 13: Cleanup ephemeral secrets
     // ========================================================================
@@ -477,7 +457,56 @@ p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
     sodium_memzero(client_signed, 64);
     sodium_memzero(to_sign, 96);
     
-    printf("[HANDSHAKE] ✅ Server handshake complete!\n");
+    P2P_LOG_DEBUG("HANDSHAKE", "Server handshake complete!");
     
     return session;
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+/**
+ * Count handshake outcome on socket and globally, record total duration
+ */
+static p2p_session_t* count_outcome(p2p_socket_t* sock, p2p_session_t* session,
+                                    p2p_latency_t total, uint64_t start_ns) {
+    p2p_metric_add(p2p_socket_counters(sock),
+                   session ? P2P_METRIC_HANDSHAKES_COMPLETED : P2P_METRIC_HANDSHAKES_FAILED,
+                   1);
+    if (session) {
+        p2p_latency_lap(total, start_ns);
+    }
+    return session;
+}
+
+p2p_session_t* p2p_handshake_client(p2p_socket_t* sock,
+                                     p2p_keypair_t* my_keypair,
+                                     const uint8_t* expected_peer_pubkey) {
+    if (!sock || !my_keypair) {
+        return NULL;
+    }
+    
+    p2p_metric_add(p2p_socket_counters(sock), P2P_METRIC_HANDSHAKES_STARTED, 1);
+    uint64_t start = p2p_latency_start();
+    
+    return count_outcome(sock, run_client_handshake(sock, my_keypair,
+                                                    expected_peer_pubkey),
+                         P2P_LATENCY_HS_CLIENT_TOTAL, start);
+}
+
+p2p_session_t* p2p_handshake_server(p2p_socket_t* sock,
+                                     p2p_keypair_t* my_keypair,
+                                     const uint8_t** allowed_peers,
+                                     size_t num_allowed) {
+    if (!sock || !my_keypair) {
+        return NULL;
+    }
+    
+    p2p_metric_add(p2p_socket_counters(sock), P2P_METRIC_HANDSHAKES_STARTED, 1);
+    uint64_t start = p2p_latency_start();
+    
+    return count_outcome(sock, run_server_handshake(sock, my_keypair,
+                                                    allowed_peers, num_allowed),
+                         P2P_LATENCY_HS_SERVER_TOTAL, start);
+}
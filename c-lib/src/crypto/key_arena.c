@@ -0,0 +1,199 @@
+#include "key_arena.h"
+#include "p2pnet/log.h"
+#include "../platform/thread.h"
+#include <sodium.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+// Usable pages per slab: starts at 4 pages (512 keys with 4KB pages) and
+// doubles per slab up to 256 pages (32768 keys), so 1M sessions need ~35 maps
+#define SLAB_MIN_PAGES 4
+#define SLAB_MAX_PAGES 256
+
+/**
+ * Slab bookkeeping (kept in normal heap - holds no secrets)
+ */
+typedef struct key_slab {
+    uint8_t* mapping;           // Start of mapping (first guard page)
+    size_t mapping_size;        // Total size incl. both guard pages
+    struct key_slab* next;
+} key_slab_t;
+
+/**
+ * Free slot link, stored in the first bytes of a free (wiped) slot
+ */
+typedef struct free_slot {
+    struct free_slot* next;
+} free_slot_t;
+
+/**
+ * Global arena (sessions are created from many threads)
+ */
+static p2p_mutex_t g_arena_lock = P2P_MUTEX_INITIALIZER;
+static key_slab_t* g_slabs = NULL;
+static free_slot_t* g_free_list = NULL;
+static size_t g_num_slabs = 0;
+static size_t g_slots_in_use = 0;
+static int g_all_locked = 1;
+
+// ============================================================================
+// Platform helpers
+// ============================================================================
+
+static size_t page_size(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+/**
+ * Map slab with guard pages on both sides and lock the usable part
+ *
+ * @return 0 on success, -1 if mapping failed
+ */
+static int map_slab(key_slab_t* slab, size_t ps, size_t usable, int* locked) {
+    size_t total = usable + 2 * ps;
+
+#ifdef _WIN32
+    uint8_t* mapping = (uint8_t*)VirtualAlloc(NULL, total,
+                                              MEM_RESERVE | MEM_COMMIT,
+                                              PAGE_READWRITE);
+    if (!mapping) {
+        return -1;
+    }
+
+    DWORD old_protect;
+    VirtualProtect(mapping, ps, PAGE_NOACCESS, &old_protect);
+    VirtualProtect(mapping + ps + usable, ps, PAGE_NOACCESS, &old_protect);
+
+    *locked = VirtualLock(mapping + ps, usable) ? 1 : 0;
+#else
+    uint8_t* mapping = (uint8_t*)mmap(NULL, total, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return -1;
+    }
+
+    mprotect(mapping, ps, PROT_NONE);
+    mprotect(mapping + ps + usable, ps, PROT_NONE);
+
+    #ifdef MADV_DONTDUMP
+        madvise(mapping + ps, usable, MADV_DONTDUMP);
+    #endif
+
+    // mlock can fail under a low RLIMIT_MEMLOCK - keys still work, just swappable
+    *locked = (mlock(mapping + ps, usable) == 0) ? 1 : 0;
+#endif
+
+    slab->mapping = mapping;
+    slab->mapping_size = total;
+    return 0;
+}
+
+/**
+ * Add a new slab and push all its slots on the free list (lock held)
+ */
+static int grow_arena(void) {
+    size_t ps = page_size();
+    size_t pages = SLAB_MAX_PAGES;
+    if (g_num_slabs < 6) {
+        pages = (size_t)SLAB_MIN_PAGES << g_num_slabs;
+    }
+    size_t usable = pages * ps;
+
+    key_slab_t* slab = (key_slab_t*)malloc(sizeof(key_slab_t));
+    if (!slab) {
+        return -1;
+    }
+
+    int locked = 0;
+    if (map_slab(slab, ps, usable, &locked) != 0) {
+        P2P_LOG_ERROR("KEY_ARENA", "Failed to map key slab");
+        free(slab);
+        return -1;
+    }
+
+    if (!locked && g_all_locked) {
+        P2P_LOG_WARN("KEY_ARENA", "Could not lock key slab in memory "
+                     "(keys may be swapped)");
+        g_all_locked = 0;
+    }
+
+    // Carve usable pages into slots (push in reverse so alloc walks forward)
+    uint8_t* first = slab->mapping + ps;
+    size_t num_slots = usable / P2P_KEY_SLOT_SIZE;
+
+    for (size_t i = num_slots; i > 0; i--) {
+        free_slot_t* slot = (free_slot_t*)(first + (i - 1) * P2P_KEY_SLOT_SIZE);
+        slot->next = g_free_list;
+        g_free_list = slot;
+    }
+
+    slab->next = g_slabs;
+    g_slabs = slab;
+    g_num_slabs++;
+
+    return 0;
+}
+
+// ============================================================================
+// Arena API
+// ============================================================================
+
+uint8_t* p2p_key_arena_alloc(void) {
+    p2p_mutex_lock(&g_arena_lock);
+
+    if (!g_free_list && grow_arena() != 0) {
+        p2p_mutex_unlock(&g_arena_lock);
+        return NULL;
+    }
+
+    free_slot_t* slot = g_free_list;
+    g_free_list = slot->next;
+    g_slots_in_use++;
+
+    p2p_mutex_unlock(&g_arena_lock);
+
+    // Clear free-list link so caller always gets a zeroed slot
+    sodium_memzero(slot, P2P_KEY_SLOT_SIZE);
+
+    return (uint8_t*)slot;
+}
+
+void p2p_key_arena_free(uint8_t* slot) {
+    if (!slot) return;
+
+    // Zero-on-free: key material never lingers in a free slot
+    sodium_memzero(slot, P2P_KEY_SLOT_SIZE);
+
+    p2p_mutex_lock(&g_arena_lock);
+
+    free_slot_t* link = (free_slot_t*)slot;
+    link->next = g_free_list;
+    g_free_list = link;
+    g_slots_in_use--;
+
+    p2p_mutex_unlock(&g_arena_lock);
+}
+
+void p2p_key_arena_stats(size_t* slabs_out, size_t* slots_in_use_out, int* locked_out) {
+    p2p_mutex_lock(&g_arena_lock);
+
+    if (slabs_out) *slabs_out = g_num_slabs;
+    if (slots_in_use_out) *slots_in_use_out = g_slots_in_use;
+    if (locked_out) *locked_out = g_all_locked;
+
+    p2p_mutex_unlock(&g_arena_lock);
+}
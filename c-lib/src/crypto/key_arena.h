@@ -0,0 +1,46 @@
+#ifndef P2PNET_KEY_ARENA_H
+#define P2PNET_KEY_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Secure key arena (internal, not part of public API)
+ *
+ * Session keys live in fixed-size slots carved out of a few large slabs:
+ *
+ * ┌────────────┬──────────────────────────────────────┬────────────┐
+ * │ Guard page │ Key slots (mlocked, no core dump)    │ Guard page │
+ * │ PROT_NONE  │ 32B │ 32B │ 32B │ ...                │ PROT_NONE  │
+ * └────────────┴──────────────────────────────────────┴────────────┘
+ *
+ * One mmap + mlock per slab instead of per session, O(1) alloc/free via
+ * an intrusive free list, and every slot is wiped on free.
+ */
+
+#define P2P_KEY_SLOT_SIZE 32
+
+/**
+ * Allocate one zeroed key slot
+ *
+ * @return Pointer to P2P_KEY_SLOT_SIZE bytes, or NULL on error
+ */
+uint8_t* p2p_key_arena_alloc(void);
+
+/**
+ * Wipe and release key slot
+ *
+ * @param slot Slot from p2p_key_arena_alloc() (can be NULL)
+ */
+void p2p_key_arena_free(uint8_t* slot);
+
+/**
+ * Arena statistics (for tests and benchmarks)
+ *
+ * @param slabs_out Number of slabs mapped (can be NULL)
+ * @param slots_in_use_out Number of allocated slots (can be NULL)
+ * @param locked_out 1 if all slabs are locked in RAM (can be NULL)
+ */
+void p2p_key_arena_stats(size_t* slabs_out, size_t* slots_in_use_out, int* locked_out);
+
+#endif /* P2PNET_KEY_ARENA_H */
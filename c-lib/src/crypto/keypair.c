@@ -1,4 +1,5 @@
 #include "p2pnet/crypto.h"
+#include "p2pnet/log.h"
 #include <sodium.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,7 +19,7 @@ int p2p_crypto_init(void) {
     }
     
     if (sodium_init() < 0) {
-        fprintf(stderr, "[CRYPTO] Failed to initialize libsodium\n");
+        P2P_LOG_ERROR("CRYPTO", "Failed to initialize libsodium");
         return -1;
     }
     
@@ -65,7 +66,7 @@ int p2p_keypair_save(const p2p_keypair_t* keypair, const char* filepath) {
     
     FILE* f = fopen(filepath, "wb");
     if (!f) {
-        fprintf(stderr, "[CRYPTO] Failed to open %s for writing\n", filepath);
+        P2P_LOG_ERROR("CRYPTO", "Failed to open %s for writing", filepath);
         return -1;
     }
     
@@ -110,7 +111,7 @@ p2p_keypair_t* p2p_keypair_load(const char* filepath) {
     
     FILE* f = fopen(filepath, "rb");
     if (!f) {
-        fprintf(stderr, "[CRYPTO] Failed to open %s for reading\n", filepath);
+        P2P_LOG_ERROR("CRYPTO", "Failed to open %s for reading", filepath);
         return NULL;
     }
     
@@ -149,7 +150,7 @@ p2p_keypair_t* p2p_keypair_load(const char* filepath) {
     fclose(f);
     
     if (!found_secret || !found_public) {
-        fprintf(stderr, "[CRYPTO] Invalid key file format\n");
+        P2P_LOG_ERROR("CRYPTO", "Invalid key file format");
         free(keypair);
         return NULL;
     }
@@ -161,7 +162,7 @@ p2p_keypair_t* p2p_keypair_load(const char* filepath) {
                           b64_secret, strlen(b64_secret),
                           NULL, &secret_len, NULL,
                           sodium_base64_VARIANT_ORIGINAL) != 0) {
-        fprintf(stderr, "[CRYPTO] Failed to decode secret key\n");
+        P2P_LOG_ERROR("CRYPTO", "Failed to decode secret key");
         free(keypair);
         return NULL;
     }
@@ -170,14 +171,14 @@ p2p_keypair_t* p2p_keypair_load(const char* filepath) {
                           b64_public, strlen(b64_public),
                           NULL, &public_len, NULL,
                           sodium_base64_VARIANT_ORIGINAL) != 0) {
-        fprintf(stderr, "[CRYPTO] Failed to decode public key\n");
+        P2P_LOG_ERROR("CRYPTO", "Failed to decode public key");
         free(keypair);
         return NULL;
     }
     
     // Verify keypair
     if (p2p_keypair_verify(keypair) != 0) {
-        fprintf(stderr, "[CRYPTO] Loaded keypair is invalid\n");
+        P2P_LOG_ERROR("CRYPTO", "Loaded keypair is invalid");
         p2p_keypair_free(keypair);
         return NULL;
     }
@@ -220,11 +221,12 @@ int p2p_pubkey_from_fingerprint(uint8_t* pubkey, const char* fingerprint) {
         return -1;
     }
     
+    // Same variant as p2p_keypair_fingerprint(); tolerate trailing padding
     size_t decoded_len;
     if (sodium_base642bin(pubkey, 32,
                           fingerprint, strlen(fingerprint),
-                          NULL, &decoded_len, NULL,
-                          sodium_base64_VARIANT_ORIGINAL) != 0) {
+                          "=", &decoded_len, NULL,
+                          sodium_base64_VARIANT_URLSAFE_NO_PADDING) != 0) {
         return -1;
     }
     
@@ -1,48 +1,68 @@
 #include "p2pnet/session.h"
-#include "p2pnet/crypto.h" 
+#include "p2pnet/crypto.h"
+#include "session_internal.h"
+#include "key_arena.h"
+#include "../util/metrics.h"
 #include <sodium.h>
 #include <stdlib.h>
 #include <string.h>
 
 /**
- * Session structure (internal)
+ * Heap session: hot and cold part in one allocation
  */
-struct p2p_session {
-    uint8_t session_key[32];    // Derived encryption key
-    uint8_t peer_pubkey[32];    // Verified peer identity
-    uint64_t nonce_counter;     // For message nonce generation (Milestone 2.3)
-};
+typedef struct {
+    struct p2p_session hot;
+    p2p_session_cold_t cold;
+} heap_session_t;
 
 /**
- * Create new session (internal use only)
+ * Create new session (internal use by handshake)
+ *
+ * Session key is stored in a slot from the secure key arena (locked,
+ * guard-paged), not in the heap-allocated session struct.
  */
 p2p_session_t* p2p_session_create(const uint8_t* session_key,
                                    const uint8_t* peer_pubkey) {
     if (!session_key || !peer_pubkey) {
         return NULL;
     }
-    
-    p2p_session_t* session = (p2p_session_t*)malloc(sizeof(p2p_session_t));
-    if (!session) {
+
+    heap_session_t* block = (heap_session_t*)calloc(1, sizeof(heap_session_t));
+    if (!block) {
+        return NULL;
+    }
+
+    p2p_session_t* session = &block->hot;
+    session->cold = &block->cold;
+
+    session->session_key = p2p_key_arena_alloc();
+    if (!session->session_key) {
+        free(block);
         return NULL;
     }
-    
-    // Copy session key
+
+    // Copy session key into locked slot
     memcpy(session->session_key, session_key, 32);
-    
+
     // Copy peer public key
-    memcpy(session->peer_pubkey, peer_pubkey, 32);
-    
-    // Initialize nonce counter
-    session->nonce_counter = 0;
-    
+    memcpy(session->cold->peer_pubkey, peer_pubkey, 32);
+
+    // Initialize nonces
+    // recv_nonce = 0 means "nothing received yet", so first counter sent is 1
+    session->send_nonce = 1;
+    session->recv_nonce = 0;
+
+    atomic_init(&session->cold->aead_failures, 0);
+    session->cold->replay_rejects = 0;
+    p2p_metric_add(NULL, P2P_METRIC_ALLOCATIONS, 1);
+
     return session;
 }
 
 // Get peer's public key from session
 const uint8_t* p2p_session_peer_pubkey(const p2p_session_t* session) {
     if (!session) return NULL;
-    return session->peer_pubkey;
+    return session->cold->peer_pubkey;
 }
 
 // Get session key (for encryption)
@@ -51,44 +71,11 @@ const uint8_t* p2p_session_key(const p2p_session_t* session) {
     return session->session_key;
 }
 
-// Free session and securely wipe memory
-void p2p_session_free(p2p_session_t* session) {
-    if (!session) return;
-    
-    // Securely wipe session key and all data
-    sodium_memzero(session, sizeof(p2p_session_t));
-    
-    free(session);
-}
-
-// Get peer's fingerprint (Base64 encoded public key)
-const char* p2p_session_peer_fingerprint(const p2p_session_t* session,
-                                          char* buffer,
-                                          size_t buffer_size) {
-    if (!session || !buffer || buffer_size < 45) {
-        return NULL;
-    }
-    
-    // Create temporary keypair for fingerprint function
-    p2p_keypair_t temp;
-    memcpy(temp.public_key, session->peer_pubkey, 32);
-    memset(temp.secret_key, 0, 64);  // Not used
-    
-    return p2p_keypair_fingerprint(&temp, buffer, buffer_size);
-}
-
-// Create a new session (internal use by handshake)
-p2p_session_t* p2p_session_create(void) {
-    p2p_session_t* session = (p2p_session_t*)malloc(sizeof(p2p_session_t));
-    if (!session) {
-        return NULL;
-    }
-    
-    // Initialize nonces to 0
-    session->send_nonce = 0;
-    session->recv_nonce = 0;
-    
-    return session;
+// Free heap shell after its contents moved into a session table (internal)
+void p2p_session_free_shell(p2p_session_t* session) {
+    heap_session_t* block = (heap_session_t*)session;
+    sodium_memzero(block, sizeof(heap_session_t));
+    free(block);
 }
 
 // Free session and securely wipe memory
@@ -96,10 +83,18 @@ void p2p_session_free(p2p_session_t* session) {
     if (!session) {
         return;
     }
-    
-    // Securely wipe session key and nonces
-    sodium_memzero(session, sizeof(p2p_session_t));
-    free(session);
+
+    // Table sessions live in the table's slot arrays
+    if (session->cold->table) {
+        p2p_session_table_release(session->cold->table, session);
+        return;
+    }
+
+    // Key slot is wiped by the arena
+    p2p_key_arena_free(session->session_key);
+
+    // Securely wipe peer identity and nonces
+    p2p_session_free_shell(session);
 }
 
 // Get peer's fingerprint (Base64 encoded public key)
@@ -109,11 +104,36 @@ const char* p2p_session_peer_fingerprint(const p2p_session_t* session,
     if (!session || !buffer || buffer_size < 45) {
         return NULL;
     }
-    
+
     // Base64 encode public key (URL-safe, no padding)
     sodium_bin2base64(buffer, buffer_size,
-                      session->peer_pubkey, 32,
+                      session->cold->peer_pubkey, 32,
                       sodium_base64_VARIANT_URLSAFE_NO_PADDING);
-    
+
     return buffer;
-}
\ No newline at end of file
+}
+
+// Attach application data to session
+void p2p_session_set_user_data(p2p_session_t* session, void* user_data) {
+    if (!session) return;
+    session->cold->user_data = user_data;
+}
+
+// Get application data attached to session
+void* p2p_session_get_user_data(const p2p_session_t* session) {
+    if (!session) return NULL;
+    return session->cold->user_data;
+}
+
+// Per-session counters, derived from the nonces plus the failure counts
+int p2p_session_metrics(const p2p_session_t* session, p2p_metrics_t* out) {
+    if (!session || !out) return -1;
+
+    memset(out, 0, sizeof(*out));
+    out->values[P2P_METRIC_MESSAGES_OUT] = session->send_nonce - 1;
+    out->values[P2P_METRIC_MESSAGES_IN] = session->recv_nonce;
+    out->values[P2P_METRIC_AEAD_FAILURES] = atomic_load_explicit(&session->cold->aead_failures,
+                                                                 memory_order_relaxed);
+    out->values[P2P_METRIC_REPLAY_REJECTS] = session->cold->replay_rejects;
+    return 0;
+}
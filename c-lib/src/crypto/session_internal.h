@@ -0,0 +1,126 @@
+#ifndef P2PNET_SESSION_INTERNAL_H
+#define P2PNET_SESSION_INTERNAL_H
+
+#include "p2pnet/session.h"
+#include "p2pnet/socket.h"
+#include "p2pnet/message.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Session layout (internal, not part of public API)
+ *
+ * Split in a hot part touched on every send/recv and a cold part only
+ * touched on handshake, lookup-by-peer and teardown:
+ *
+ *   hot  (32B, 2 per cache line): send_nonce, recv_nonce, key, cold ptr
+ *   cold (64B, 1 per cache line): peer identity, metadata, failure counts
+ *
+ * Message counts come from the nonces (both count from 1 with no gaps on
+ * the sender), so the send/recv path never touches the cold part. Only
+ * rejected records bump a cold counter.
+ *
+ * Heap sessions keep hot and cold in one allocation; a session table keeps
+ * them in two separate contiguous arrays.
+ */
+
+struct p2p_session_table;
+
+/**
+ * Cold part: peer identity and metadata
+ */
+typedef struct p2p_session_cold {
+    uint8_t peer_pubkey[32];            // Verified peer's Ed25519 public key
+    uint64_t conn_id;                   // Connection id (session table only)
+    struct p2p_session_table* table;    // Owning table, NULL for heap sessions
+    void* user_data;                    // Application data
+    atomic_uint_least32_t aead_failures;// Decrypt workers may fail in parallel
+    uint32_t replay_rejects;            // Checked in delivery order only
+} p2p_session_cold_t;
+
+/**
+ * Hot part: everything the encrypt/decrypt path touches
+ */
+struct p2p_session {
+    uint64_t send_nonce;        // Counter for outgoing messages (prevents nonce reuse)
+    uint64_t recv_nonce;        // Last received nonce (prevents replay attacks)
+    uint8_t* session_key;       // 32-byte key slot in secure key arena
+    p2p_session_cold_t* cold;   // Peer identity and metadata
+};
+
+/**
+ * Remove session from its table (session_table.c)
+ */
+void p2p_session_table_release(struct p2p_session_table* table, p2p_session_t* session);
+
+// ============================================================================
+// Record helpers (encryption.c)
+// ============================================================================
+
+// ChaCha20-Poly1305 IETF
+#define P2P_NONCE_SIZE 12
+#define P2P_MAC_SIZE   16
+
+/**
+ * Construct nonce from counter
+ *
+ * Nonce format (12 bytes):
+ * ┌──────────────────────┬──────────────────┐
+ * │ Counter (8 bytes)    │ Padding (4 bytes) │
+ * │ uint64_t (big-endian)│ 0x00000000        │
+ * └──────────────────────┴──────────────────┘
+ */
+static inline void p2p_construct_nonce(uint64_t counter, uint8_t nonce[P2P_NONCE_SIZE]) {
+    for (int i = 0; i < 8; i++) {
+        nonce[i] = (uint8_t)(counter >> (56 - 8 * i));
+    }
+    nonce[8] = nonce[9] = nonce[10] = nonce[11] = 0;
+}
+
+/**
+ * Extract counter from nonce
+ */
+static inline uint64_t p2p_extract_counter(const uint8_t nonce[P2P_NONCE_SIZE]) {
+    uint64_t counter = 0;
+    for (int i = 0; i < 8; i++) {
+        counter = (counter << 8) | nonce[i];
+    }
+    return counter;
+}
+
+/**
+ * Encrypt one record (no I/O, does not touch send_nonce)
+ *
+ * @param ciphertext Output: length + P2P_MAC_SIZE bytes
+ * @return 0 on success, -1 on error
+ */
+int p2p_session_seal_record(const p2p_session_t* session,
+                            const uint8_t nonce[P2P_NONCE_SIZE],
+                            const uint8_t* data,
+                            size_t length,
+                            uint8_t* ciphertext);
+
+int p2p_session_read_record(p2p_socket_t* sock,
+                            uint8_t nonce[P2P_NONCE_SIZE],
+                            uint8_t** ciphertext,
+                            size_t* ciphertext_len);
+p2p_message_t* p2p_session_open_record(const p2p_session_t* session,
+                                       const uint8_t nonce[P2P_NONCE_SIZE],
+                                       const uint8_t* ciphertext,
+                                       size_t ciphertext_len);
+int p2p_session_check_replay(const p2p_session_t* session,
+                             const uint8_t nonce[P2P_NONCE_SIZE]);
+void p2p_session_accept_nonce(p2p_session_t* session,
+                              const uint8_t nonce[P2P_NONCE_SIZE]);
+
+/**
+ * session_key = BLAKE2b(shared_secret || alice_id || bob_id || "P2PNetSessionKey")
+ * (handshake.c)
+ */
+void p2p_derive_session_key(uint8_t* session_key,
+                            const uint8_t* shared_secret,
+                            const uint8_t* alice_pubkey,
+                            const uint8_t* bob_pubkey);
+
+#endif /* P2PNET_SESSION_INTERNAL_H */
@@ -0,0 +1,437 @@
+#include "p2pnet/session_table.h"
+#include "p2pnet/crypto.h"
+#include "p2pnet/log.h"
+#include "session_internal.h"
+#include "key_arena.h"
+#include <sodium.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Max capacity (slot index + 1 must fit in uint32_t, index size in 2^32)
+#define MAX_CAPACITY ((size_t)1 << 31)
+
+/**
+ * Connection index entry (16 bytes, 4 per cache line)
+ * conn_id is stored inline so a lookup never touches the cold array
+ */
+typedef struct {
+    uint64_t conn_id;
+    uint32_t slot;      // Slot index + 1 (0 = empty)
+    uint32_t reserved;
+} conn_entry_t;
+
+/**
+ * Peer index entry (8 bytes)
+ * hash doubles as home position and tag - pubkey is only compared on tag match
+ */
+typedef struct {
+    uint32_t slot;      // Slot index + 1 (0 = empty)
+    uint32_t hash;      // Keyed SipHash of peer public key (low 32 bits)
+} peer_entry_t;
+
+/**
+ * Sessions of one peer, newest first (slot index + 1, 0 = none)
+ * The peer index points at the newest; removing it falls back to the next
+ */
+typedef struct {
+    uint32_t older;
+    uint32_t newer;
+} peer_link_t;
+
+/**
+ * Session table internal structure
+ */
+struct p2p_session_table {
+    struct p2p_session* hot;        // [capacity] nonces + key handle
+    p2p_session_cold_t* cold;       // [capacity] peer identity + metadata
+    uint32_t* free_slots;           // Stack of free slot indexes
+    size_t num_free;
+    peer_link_t* peer_links;        // [capacity] same-peer chains
+
+    conn_entry_t* conn_index;       // Open addressing, linear probing
+    peer_entry_t* peer_index;
+    size_t index_mask;              // Index size - 1 (power of two)
+
+    uint8_t hash_key[crypto_shorthash_KEYBYTES];  // Random per table (anti-flooding)
+
+    size_t capacity;
+    size_t count;
+};
+
+// Free heap shell of a session after its contents moved (session.c)
+void p2p_session_free_shell(p2p_session_t* session);
+
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+/**
+ * Mix connection id (splitmix64 finalizer) - ids are often sequential
+ */
+static uint64_t hash_conn_id(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * Keyed hash of peer public key
+ *
+ * Peers choose their own keys, so an unkeyed hash would let an attacker
+ * grind keys that collide and turn O(1) lookups into O(n).
+ */
+static uint32_t hash_peer(const p2p_session_table_t* table, const uint8_t* pubkey) {
+    uint8_t out[crypto_shorthash_BYTES];
+    crypto_shorthash(out, pubkey, 32, table->hash_key);
+
+    uint32_t hash;
+    memcpy(&hash, out, sizeof(hash));
+    return hash;
+}
+
+static size_t conn_find_pos(const p2p_session_table_t* table, uint64_t conn_id) {
+    size_t pos = hash_conn_id(conn_id) & table->index_mask;
+
+    while (table->conn_index[pos].slot != 0) {
+        if (table->conn_index[pos].conn_id == conn_id) {
+            return pos;
+        }
+        pos = (pos + 1) & table->index_mask;
+    }
+
+    return (size_t)-1;
+}
+
+static void conn_insert(p2p_session_table_t* table, uint64_t conn_id, uint32_t slot) {
+    size_t pos = hash_conn_id(conn_id) & table->index_mask;
+
+    while (table->conn_index[pos].slot != 0) {
+        pos = (pos + 1) & table->index_mask;
+    }
+
+    table->conn_index[pos].conn_id = conn_id;
+    table->conn_index[pos].slot = slot + 1;
+}
+
+/**
+ * Remove entry at pos (backward-shift deletion, no tombstones)
+ */
+static void conn_delete_at(p2p_session_table_t* table, size_t pos) {
+    size_t mask = table->index_mask;
+    size_t hole = pos;
+    size_t next = (pos + 1) & mask;
+
+    while (table->conn_index[next].slot != 0) {
+        size_t home = hash_conn_id(table->conn_index[next].conn_id) & mask;
+
+        // Move entry back unless its home lies cyclically in (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            table->conn_index[hole] = table->conn_index[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    table->conn_index[hole].slot = 0;
+    table->conn_index[hole].conn_id = 0;
+}
+
+static size_t peer_find_pos(const p2p_session_table_t* table,
+                            const uint8_t* pubkey, uint32_t hash) {
+    size_t pos = hash & table->index_mask;
+
+    while (table->peer_index[pos].slot != 0) {
+        const peer_entry_t* entry = &table->peer_index[pos];
+        if (entry->hash == hash &&
+            memcmp(table->cold[entry->slot - 1].peer_pubkey, pubkey, 32) == 0) {
+            return pos;
+        }
+        pos = (pos + 1) & table->index_mask;
+    }
+
+    return (size_t)-1;
+}
+
+static void peer_delete_at(p2p_session_table_t* table, size_t pos) {
+    size_t mask = table->index_mask;
+    size_t hole = pos;
+    size_t next = (pos + 1) & mask;
+
+    while (table->peer_index[next].slot != 0) {
+        size_t home = table->peer_index[next].hash & mask;
+
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            table->peer_index[hole] = table->peer_index[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    table->peer_index[hole].slot = 0;
+    table->peer_index[hole].hash = 0;
+}
+
+/**
+ * Point peer index at slot (older sessions of the peer stay chained behind it)
+ */
+static void peer_insert(p2p_session_table_t* table, uint32_t slot) {
+    const uint8_t* pubkey = table->cold[slot].peer_pubkey;
+    uint32_t hash = hash_peer(table, pubkey);
+    peer_link_t* link = &table->peer_links[slot];
+
+    size_t pos = peer_find_pos(table, pubkey, hash);
+    if (pos == (size_t)-1) {
+        pos = hash & table->index_mask;
+        while (table->peer_index[pos].slot != 0) {
+            pos = (pos + 1) & table->index_mask;
+        }
+        link->older = 0;
+    } else {
+        link->older = table->peer_index[pos].slot;
+        table->peer_links[link->older - 1].newer = slot + 1;
+    }
+    link->newer = 0;
+
+    table->peer_index[pos].slot = slot + 1;
+    table->peer_index[pos].hash = hash;
+}
+
+/**
+ * Unlink slot from its peer chain; re-point the index if it was the newest
+ */
+static void peer_remove(p2p_session_table_t* table, uint32_t slot) {
+    peer_link_t* link = &table->peer_links[slot];
+
+    if (link->older) {
+        table->peer_links[link->older - 1].newer = link->newer;
+    }
+    if (link->newer) {
+        table->peer_links[link->newer - 1].older = link->older;
+    } else {
+        const uint8_t* pubkey = table->cold[slot].peer_pubkey;
+        size_t pos = peer_find_pos(table, pubkey, hash_peer(table, pubkey));
+        if (pos != (size_t)-1) {
+            if (link->older) {
+                table->peer_index[pos].slot = link->older;
+            } else {
+                peer_delete_at(table, pos);
+            }
+        }
+    }
+
+    link->older = 0;
+    link->newer = 0;
+}
+
+/**
+ * Get slot index of session, or -1 if it does not belong to table
+ */
+static int64_t slot_of(const p2p_session_table_t* table, const p2p_session_t* session) {
+    if (session < table->hot || session >= table->hot + table->capacity) {
+        return -1;
+    }
+
+    size_t slot = (size_t)(session - table->hot);
+    if (table->cold[slot].table != table) {
+        return -1;  // Free slot
+    }
+
+    return (int64_t)slot;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+p2p_session_table_t* p2p_session_table_create(size_t capacity) {
+    if (capacity == 0 || capacity > MAX_CAPACITY) {
+        return NULL;
+    }
+
+    if (p2p_crypto_init() < 0) {
+        return NULL;
+    }
+
+    p2p_session_table_t* table = (p2p_session_table_t*)calloc(1, sizeof(p2p_session_table_t));
+    if (!table) return NULL;
+
+    // Index at most half full keeps linear probe chains short
+    size_t index_size = 1;
+    while (index_size < capacity * 2) {
+        index_size <<= 1;
+    }
+
+    table->hot = (struct p2p_session*)calloc(capacity, sizeof(struct p2p_session));
+    table->cold = (p2p_session_cold_t*)calloc(capacity, sizeof(p2p_session_cold_t));
+    table->free_slots = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    table->peer_links = (peer_link_t*)calloc(capacity, sizeof(peer_link_t));
+    table->conn_index = (conn_entry_t*)calloc(index_size, sizeof(conn_entry_t));
+    table->peer_index = (peer_entry_t*)calloc(index_size, sizeof(peer_entry_t));
+
+    if (!table->hot || !table->cold || !table->free_slots || !table->peer_links ||
+        !table->conn_index || !table->peer_index) {
+        P2P_LOG_ERROR("SESSION_TABLE", "Memory allocation failed");
+        p2p_session_table_free(table);
+        return NULL;
+    }
+
+    // Hand out low slots first (keeps the hot array dense)
+    for (size_t i = 0; i < capacity; i++) {
+        table->free_slots[i] = (uint32_t)(capacity - 1 - i);
+    }
+
+    table->num_free = capacity;
+    table->capacity = capacity;
+    table->index_mask = index_size - 1;
+    randombytes_buf(table->hash_key, sizeof(table->hash_key));
+
+    return table;
+}
+
+void p2p_session_table_free(p2p_session_table_t* table) {
+    if (!table) return;
+
+    if (table->hot && table->cold) {
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (table->cold[i].table == table) {
+                p2p_key_arena_free(table->hot[i].session_key);
+            }
+        }
+
+        sodium_memzero(table->hot, table->capacity * sizeof(struct p2p_session));
+        sodium_memzero(table->cold, table->capacity * sizeof(p2p_session_cold_t));
+    }
+
+    free(table->hot);
+    free(table->cold);
+    free(table->free_slots);
+    free(table->peer_links);
+    free(table->conn_index);
+    free(table->peer_index);
+    free(table);
+}
+
+p2p_session_t* p2p_session_table_adopt(p2p_session_table_t* table,
+                                       p2p_session_t* session,
+                                       uint64_t conn_id) {
+    if (!table || !session || session->cold->table) {
+        return NULL;
+    }
+
+    if (table->num_free == 0) {
+        P2P_LOG_WARN("SESSION_TABLE", "Table full (%zu sessions)", table->capacity);
+        return NULL;
+    }
+
+    if (conn_find_pos(table, conn_id) != (size_t)-1) {
+        P2P_LOG_WARN("SESSION_TABLE", "Connection id %llu already in use",
+                (unsigned long long)conn_id);
+        return NULL;
+    }
+
+    uint32_t slot = table->free_slots[--table->num_free];
+
+    // Move contents (key slot ownership moves with the pointer)
+    struct p2p_session* hot = &table->hot[slot];
+    p2p_session_cold_t* cold = &table->cold[slot];
+
+    *cold = *session->cold;
+    cold->conn_id = conn_id;
+    cold->table = table;
+
+    hot->send_nonce = session->send_nonce;
+    hot->recv_nonce = session->recv_nonce;
+    hot->session_key = session->session_key;
+    hot->cold = cold;
+
+    p2p_session_free_shell(session);
+
+    conn_insert(table, conn_id, slot);
+    peer_insert(table, slot);
+    table->count++;
+
+    return hot;
+}
+
+p2p_session_t* p2p_session_table_find_conn(const p2p_session_table_t* table,
+                                           uint64_t conn_id) {
+    if (!table) return NULL;
+
+    size_t pos = conn_find_pos(table, conn_id);
+    if (pos == (size_t)-1) {
+        return NULL;
+    }
+
+    return &table->hot[table->conn_index[pos].slot - 1];
+}
+
+p2p_session_t* p2p_session_table_find_peer(const p2p_session_table_t* table,
+                                           const uint8_t* peer_pubkey) {
+    if (!table || !peer_pubkey) return NULL;
+
+    size_t pos = peer_find_pos(table, peer_pubkey, hash_peer(table, peer_pubkey));
+    if (pos == (size_t)-1) {
+        return NULL;
+    }
+
+    return &table->hot[table->peer_index[pos].slot - 1];
+}
+
+int p2p_session_table_remove(p2p_session_table_t* table, p2p_session_t* session) {
+    if (!table || !session) return -1;
+
+    int64_t found = slot_of(table, session);
+    if (found < 0) {
+        return -1;
+    }
+
+    uint32_t slot = (uint32_t)found;
+    p2p_session_cold_t* cold = &table->cold[slot];
+
+    size_t pos = conn_find_pos(table, cold->conn_id);
+    if (pos != (size_t)-1) {
+        conn_delete_at(table, pos);
+    }
+
+    peer_remove(table, slot);
+
+    // Key slot is wiped by the arena
+    p2p_key_arena_free(table->hot[slot].session_key);
+
+    sodium_memzero(&table->hot[slot], sizeof(struct p2p_session));
+    sodium_memzero(cold, sizeof(p2p_session_cold_t));
+
+    table->free_slots[table->num_free++] = slot;
+    table->count--;
+
+    return 0;
+}
+
+void p2p_session_table_release(struct p2p_session_table* table, p2p_session_t* session) {
+    p2p_session_table_remove(table, session);
+}
+
+uint64_t p2p_session_conn_id(const p2p_session_t* session) {
+    if (!session || !session->cold->table) return 0;
+    return session->cold->conn_id;
+}
+
+size_t p2p_session_table_count(const p2p_session_table_t* table) {
+    if (!table) return 0;
+    return table->count;
+}
+
+size_t p2p_session_table_memory_usage(const p2p_session_table_t* table) {
+    if (!table) return 0;
+
+    size_t index_size = table->index_mask + 1;
+
+    return sizeof(p2p_session_table_t)
+         + table->capacity * (sizeof(struct p2p_session) + sizeof(p2p_session_cold_t)
+                              + sizeof(uint32_t) + sizeof(peer_link_t))
+         + index_size * (sizeof(conn_entry_t) + sizeof(peer_entry_t));
+}
@@ -0,0 +1,296 @@
+#include "socket_internal.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Accept path helpers shared by the platform ports
+ *
+ * Socket pool: closed p2p_socket_t structs go on a free list and are
+ * handed out again by p2p_socket_pool_get(), so a reconnect storm does
+ * not pay malloc/free per connection. Bounded, so a burst that is over
+ * does not pin memory.
+ *
+ * Admission: pending-handshake and per-IP counters checked right after
+ * accept. Per-IP counts live in an open-addressing table keyed by the
+ * 16-byte IPv6 address (IPv4 as v4-mapped), with backward-shift
+ * deletion so it never fills with tombstones.
+ */
+
+#define SOCKET_POOL_MAX 256
+#define ADMISSION_MIN_CAPACITY 64       // Power of two
+
+// ============================================================================
+// Socket pool
+// ============================================================================
+
+static p2p_mutex_t g_pool_lock = P2P_MUTEX_INITIALIZER;
+static p2p_socket_t* g_pool = NULL;     // Linked through transport_data
+static int g_pool_size = 0;
+
+p2p_socket_t* p2p_socket_pool_get(void) {
+    p2p_mutex_lock(&g_pool_lock);
+    p2p_socket_t* sock = g_pool;
+    if (sock) {
+        g_pool = (p2p_socket_t*)sock->transport_data;
+        g_pool_size--;
+    }
+    p2p_mutex_unlock(&g_pool_lock);
+
+    if (!sock) {
+        sock = (p2p_socket_t*)malloc(sizeof(p2p_socket_t));
+        if (sock) {
+            p2p_metric_add(NULL, P2P_METRIC_ALLOCATIONS, 1);
+        }
+    }
+    return sock;
+}
+
+void p2p_socket_pool_put(p2p_socket_t* sock) {
+    p2p_mutex_lock(&g_pool_lock);
+    if (g_pool_size < SOCKET_POOL_MAX) {
+        sock->transport_data = g_pool;
+        g_pool = sock;
+        g_pool_size++;
+        sock = NULL;
+    }
+    p2p_mutex_unlock(&g_pool_lock);
+
+    free(sock);
+}
+
+void p2p_socket_pool_drain(void) {
+    p2p_mutex_lock(&g_pool_lock);
+    p2p_socket_t* sock = g_pool;
+    g_pool = NULL;
+    g_pool_size = 0;
+    p2p_mutex_unlock(&g_pool_lock);
+
+    while (sock) {
+        p2p_socket_t* next = (p2p_socket_t*)sock->transport_data;
+        free(sock);
+        sock = next;
+    }
+}
+
+// ============================================================================
+// Admission
+// ============================================================================
+
+typedef struct {
+    uint8_t addr[16];
+    uint32_t count;             // 0 = empty slot
+} ip_entry_t;
+
+struct p2p_admission {
+    p2p_mutex_t lock;
+    int refs;                   // Creator + every admitted socket still open
+    int max_pending;
+    int max_per_ip;
+    int pending;
+    uint64_t rejected;
+    ip_entry_t* table;          // NULL until the first per-IP admit
+    size_t capacity;            // Power of two
+    size_t used;
+};
+
+static size_t ip_hash(const uint8_t addr[16]) {
+    // FNV-1a; the low bytes (host part) vary most, all bytes are mixed
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < 16; i++) {
+        hash = (hash ^ addr[i]) * 0x100000001b3ULL;
+    }
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+static ip_entry_t* ip_find(p2p_admission_t* admission, const uint8_t addr[16]) {
+    size_t mask = admission->capacity - 1;
+    size_t i = ip_hash(addr) & mask;
+    while (admission->table[i].count != 0) {
+        if (memcmp(admission->table[i].addr, addr, 16) == 0) {
+            return &admission->table[i];
+        }
+        i = (i + 1) & mask;
+    }
+    return &admission->table[i];            // Empty slot where addr belongs
+}
+
+static int ip_grow(p2p_admission_t* admission) {
+    size_t old_capacity = admission->capacity;
+    ip_entry_t* old_table = admission->table;
+    size_t capacity = old_capacity ? old_capacity * 2 : ADMISSION_MIN_CAPACITY;
+
+    ip_entry_t* table = (ip_entry_t*)calloc(capacity, sizeof(ip_entry_t));
+    if (!table) return -1;
+
+    admission->table = table;
+    admission->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_table[i].count != 0) {
+            *ip_find(admission, old_table[i].addr) = old_table[i];
+        }
+    }
+    free(old_table);
+    return 0;
+}
+
+static void ip_remove(p2p_admission_t* admission, ip_entry_t* entry) {
+    size_t mask = admission->capacity - 1;
+    size_t hole = (size_t)(entry - admission->table);
+    size_t i = hole;
+
+    // Backward shift: move later entries of the same probe run into the hole
+    for (;;) {
+        i = (i + 1) & mask;
+        if (admission->table[i].count == 0) break;
+
+        size_t home = ip_hash(admission->table[i].addr) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            admission->table[hole] = admission->table[i];
+            hole = i;
+        }
+    }
+
+    admission->table[hole].count = 0;
+    admission->used--;
+}
+
+/**
+ * Peer address as 16-byte key, 0 if it has no IP (AF_UNIX)
+ */
+static int ip_key(const struct sockaddr* addr, uint8_t key[16]) {
+    if (addr->sa_family == AF_INET) {
+        const struct sockaddr_in* in = (const struct sockaddr_in*)addr;
+        memset(key, 0, 10);
+        key[10] = 0xff;
+        key[11] = 0xff;
+        memcpy(key + 12, &in->sin_addr, 4);
+        return 1;
+    }
+    if (addr->sa_family == AF_INET6) {
+        const struct sockaddr_in6* in6 = (const struct sockaddr_in6*)addr;
+        memcpy(key, &in6->sin6_addr, 16);
+        return 1;
+    }
+    return 0;
+}
+
+static void admission_unref_locked(p2p_admission_t* admission) {
+    if (--admission->refs == 0) {
+        p2p_mutex_unlock(&admission->lock);
+        p2p_mutex_destroy(&admission->lock);
+        free(admission->table);
+        free(admission);
+        return;
+    }
+    p2p_mutex_unlock(&admission->lock);
+}
+
+p2p_admission_t* p2p_admission_create(int max_pending, int max_per_ip) {
+    if (max_pending < 0 || max_per_ip < 0) return NULL;
+
+    p2p_admission_t* admission = (p2p_admission_t*)calloc(1, sizeof(p2p_admission_t));
+    if (!admission) return NULL;
+
+    p2p_mutex_init(&admission->lock);
+    admission->refs = 1;
+    admission->max_pending = max_pending;
+    admission->max_per_ip = max_per_ip;
+    return admission;
+}
+
+void p2p_admission_free(p2p_admission_t* admission) {
+    if (!admission) return;
+
+    p2p_mutex_lock(&admission->lock);
+    admission_unref_locked(admission);
+}
+
+int p2p_admission_stats(p2p_admission_t* admission, int* pending, uint64_t* rejected) {
+    if (!admission) return -1;
+
+    p2p_mutex_lock(&admission->lock);
+    if (pending) *pending = admission->pending;
+    if (rejected) *rejected = admission->rejected;
+    p2p_mutex_unlock(&admission->lock);
+    return 0;
+}
+
+int p2p_admission_admit(p2p_admission_t* admission, const struct sockaddr* peer,
+                        p2p_admission_ticket_t* ticket) {
+    ticket->admission = NULL;
+    ticket->has_peer = (uint8_t)ip_key(peer, ticket->peer);
+    ticket->pending = 0;
+
+    p2p_mutex_lock(&admission->lock);
+
+    if (admission->max_pending > 0 && admission->pending >= admission->max_pending) {
+        goto reject;
+    }
+
+    if (admission->max_per_ip > 0 && ticket->has_peer) {
+        // Keep load <= 1/2 so probe runs stay short
+        if ((admission->used + 1) * 2 > admission->capacity && ip_grow(admission) != 0) {
+            goto reject;
+        }
+
+        ip_entry_t* entry = ip_find(admission, ticket->peer);
+        if (entry->count >= (uint32_t)admission->max_per_ip) {
+            goto reject;
+        }
+        if (entry->count == 0) {
+            memcpy(entry->addr, ticket->peer, 16);
+            admission->used++;
+        }
+        entry->count++;
+    } else {
+        ticket->has_peer = 0;                   // Not counted, nothing to release
+    }
+
+    admission->pending++;
+    admission->refs++;
+    p2p_mutex_unlock(&admission->lock);
+
+    ticket->admission = admission;
+    ticket->pending = 1;
+    return 0;
+
+reject:
+    admission->rejected++;
+    p2p_mutex_unlock(&admission->lock);
+    return -1;
+}
+
+void p2p_admission_established(p2p_admission_ticket_t* ticket) {
+    p2p_admission_t* admission = ticket->admission;
+    if (!admission || !ticket->pending) return;
+
+    p2p_mutex_lock(&admission->lock);
+    admission->pending--;
+    p2p_mutex_unlock(&admission->lock);
+    ticket->pending = 0;
+}
+
+void p2p_admission_release(p2p_admission_ticket_t* ticket) {
+    p2p_admission_t* admission = ticket->admission;
+    if (!admission) return;
+
+    p2p_mutex_lock(&admission->lock);
+    if (ticket->pending) {
+        admission->pending--;
+    }
+    if (ticket->has_peer) {
+        ip_entry_t* entry = ip_find(admission, ticket->peer);
+        if (entry->count > 0 && --entry->count == 0) {
+            ip_remove(admission, entry);
+        }
+    }
+    ticket->admission = NULL;
+    admission_unref_locked(admission);
+}
+
+void p2p_socket_admitted(p2p_socket_t* sock) {
+    if (sock) {
+        p2p_admission_established(&sock->ticket);
+    }
+}
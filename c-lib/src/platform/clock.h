@@ -0,0 +1,36 @@
+#ifndef P2PNET_PLATFORM_CLOCK_H
+#define P2PNET_PLATFORM_CLOCK_H
+
+/**
+ * Intern monoton klokke (ikke del av public API)
+ *
+ * Nanosekunder fra et vilkårlig startpunkt - kun for å måle varighet.
+ */
+
+#include <stdint.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+static inline uint64_t p2p_clock_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;  // Konstant etter boot, race er ufarlig
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+    // Del opp for å unngå overflow i now * 1e9
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000000ULL +
+           (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000000ULL / (uint64_t)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#endif /* P2PNET_PLATFORM_CLOCK_H */
@@ -0,0 +1,746 @@
+#include "p2pnet/event_loop.h"
+#include "p2pnet/log.h"
+#include "socket_internal.h"
+#include "../util/metrics.h"
+#include "../util/histogram.h"
+#include "../util/mpsc.h"
+#include "../protocol/frame_reader.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+    #include <sys/eventfd.h>
+#endif
+
+#define INITIAL_CAPACITY 16
+#define TASKS_PER_ROUND 256     // Maks postede oppgaver per runde (resten neste runde)
+
+/**
+ * Postet oppgave (p2p_event_loop_post)
+ */
+typedef struct {
+    p2p_mpsc_node_t node;       // Må være først
+    p2p_task_fn fn;
+    void* arg;
+} task_t;
+
+/**
+ * Lesebuffer for en socket i batch-modus
+ */
+typedef struct {
+    p2p_frame_reader_t reader;
+    size_t max_batch;
+    int pending;                // Komplette meldinger igjen i bufferen
+} batch_state_t;
+
+/**
+ * Socket registration info
+ */
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_read_callback on_read;
+    p2p_batch_callback on_batch;
+    p2p_error_callback on_error;
+    void* user_data;
+    batch_state_t* batch;       // NULL hvis ikke batch-modus
+} socket_entry_t;
+
+/**
+ * Event loop internal structure
+ */
+struct p2p_event_loop {
+    socket_entry_t* entries;    // Array av socket registrations
+    struct pollfd* poll_fds;    // Array for poll()
+    int num_sockets;            // Antall aktive sockets
+    int capacity;               // Allocated capacity
+    atomic_int stop_requested;  // 1 = stop() kalt, ikke forbrukt av run() ennå
+    p2p_counters_t counters;    // Per-loop metrics
+    p2p_mpsc_queue_t tasks;     // Postet fra andre tråder
+    int tasks_pending;          // Oppgaver igjen etter TASKS_PER_ROUND
+    atomic_int wake_pending;    // 1 = wakeup allerede sendt, ikke lest
+    int wake_read;              // eventfd (Linux) eller pipe, i poll-settet
+    int wake_write;
+    uint64_t slow_threshold_ns; // 0 = slow-callback detector off
+    p2p_slow_callback on_slow;
+    void* slow_user_data;
+    p2p_message_t* views;       // Scratch for batch-callbacks
+    size_t views_capacity;
+    int batch_pending;          // Sockets med meldinger igjen i bufferen
+    size_t budget_bytes;        // Lesebudsjett per socket per runde (0 = av)
+    size_t budget_frames;
+    uint64_t busy_poll_ns;      // Spinn før blokkerende vent (0 = av)
+    int busy_poll_us;           // SO_BUSY_POLL på sockets (0 = av)
+    int* ready;                 // Klarliste for runden (indekser i entries)
+    int rr_next;                // Round-robin: første index neste runde
+    int in_dispatch;            // 1 mens klarlisten behandles
+    int num_removed;            // Fjernet under runden, ryddes etter
+};
+
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+/**
+ * Finn index for socket i entries array
+ */
+static int find_socket_index(p2p_event_loop_t* loop, p2p_socket_t* sock) {
+    for (int i = 0; i < loop->num_sockets; i++) {
+        if (loop->entries[i].sock == sock) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Mål callback-tid og rapporter trege callbacks
+ */
+static void callback_done(p2p_event_loop_t* loop, p2p_socket_t* sock, uint64_t start_ns) {
+    uint64_t now = p2p_latency_lap(P2P_LATENCY_LOOP_CALLBACK, start_ns);
+    uint64_t elapsed = now - start_ns;
+    
+    if (loop->slow_threshold_ns == 0 || start_ns == 0 || elapsed < loop->slow_threshold_ns) {
+        return;
+    }
+    
+    if (loop->on_slow) {
+        loop->on_slow(sock, elapsed, loop->slow_user_data);
+    } else {
+        P2P_LOG_WARN("EVENT_LOOP", "Callback for socket %p blocked loop for %llu us",
+                     (void*)sock, (unsigned long long)(elapsed / 1000));
+    }
+}
+
+/**
+ * Oppdater pending-flagg og telleren poll-timeouten baseres på
+ */
+static void set_batch_pending(p2p_event_loop_t* loop, batch_state_t* batch, int pending) {
+    if (batch->pending == pending) return;
+    batch->pending = pending;
+    loop->batch_pending += pending ? 1 : -1;
+}
+
+static void free_batch(batch_state_t* batch) {
+    p2p_frame_reader_free(&batch->reader);
+    free(batch);
+}
+
+/**
+ * Les fra en batch-socket og lever komplette meldinger
+ * 
+ * @param readable 1 hvis poll meldte lesbar (ellers kun bufrede meldinger)
+ */
+static void dispatch_batch(p2p_event_loop_t* loop, int index,
+                           int readable, uint64_t ready) {
+    socket_entry_t* entry = &loop->entries[index];
+    batch_state_t* batch = entry->batch;
+    p2p_socket_t* sock = entry->sock;
+    p2p_error_callback on_error = entry->on_error;
+    void* user_data = entry->user_data;
+    int error = 0;
+    
+    // Bufrede meldinger leveres før vi leser mer (også før disconnect)
+    if (readable && !batch->pending) {
+        intptr_t n = p2p_frame_reader_fill(&batch->reader, sock, loop->budget_bytes);
+        if (n <= 0) {
+            error = (n == 0) ? 0 : -1;
+            goto report_error;
+        }
+    }
+    
+    // Budsjett: maks meldinger og bytes levert per runde (minst én melding)
+    size_t max_count = batch->max_batch;
+    if (loop->budget_frames && loop->budget_frames < max_count) {
+        max_count = loop->budget_frames;
+    }
+    
+    size_t count = 0;
+    size_t bytes = 0;
+    int rc = 0;
+    while (count < max_count &&
+           (loop->budget_bytes == 0 || bytes < loop->budget_bytes) &&
+           (rc = p2p_frame_reader_next(&batch->reader, &loop->views[count])) == 1) {
+        bytes += loop->views[count].length;
+        count++;
+    }
+    
+    if (count > 0) {
+        p2p_metric_add(p2p_socket_counters(sock), P2P_METRIC_MESSAGES_IN, count);
+        p2p_metric_add(&loop->counters, P2P_METRIC_CALLBACKS, 1);
+        
+        uint64_t start = p2p_latency_lap(P2P_LATENCY_LOOP_DISPATCH_DELAY, ready);
+        entry->on_batch(sock, loop->views, count, user_data);
+        callback_done(loop, sock, start);
+        
+        if (loop->entries[index].sock != sock) {
+            return;                 // Fjernet i callbacken (ryddes etter runden)
+        }
+    }
+    
+    if (rc < 0) {
+        P2P_LOG_WARN("EVENT_LOOP", "Invalid frame length from socket %p", (void*)sock);
+        error = -1;
+        goto report_error;
+    }
+    
+    set_batch_pending(loop, batch, p2p_frame_reader_ready(&batch->reader));
+    return;
+    
+report_error:
+    set_batch_pending(loop, batch, 0);
+    if (on_error) {
+        p2p_metric_add(&loop->counters, P2P_METRIC_CALLBACKS, 1);
+        uint64_t start = p2p_latency_lap(P2P_LATENCY_LOOP_DISPATCH_DELAY, ready);
+        on_error(sock, error, user_data);
+        callback_done(loop, sock, start);
+    }
+}
+
+/**
+ * Fjern entry (swap & pop) og frigjør batch-state
+ */
+static void remove_index(p2p_event_loop_t* loop, int index) {
+    if (loop->entries[index].batch) {
+        free_batch(loop->entries[index].batch);
+    }
+    
+    // Flytt siste element til denne plassen (swap & pop)
+    int last_index = loop->num_sockets - 1;
+    if (index != last_index) {
+        loop->entries[index] = loop->entries[last_index];
+        loop->poll_fds[index] = loop->poll_fds[last_index];
+    }
+    
+    loop->num_sockets--;
+}
+
+/**
+ * Rydd sockets som ble fjernet mens klarlisten ble behandlet
+ */
+static void remove_pending(p2p_event_loop_t* loop) {
+    for (int i = loop->num_sockets - 1; i >= 0 && loop->num_removed > 0; i--) {
+        if (!loop->entries[i].sock) {
+            remove_index(loop, i);
+            loop->num_removed--;
+        }
+    }
+}
+
+/**
+ * Behandle events for én socket i klarlisten
+ */
+static void dispatch_entry(p2p_event_loop_t* loop, int index, uint64_t ready) {
+    struct pollfd* pfd = &loop->poll_fds[index];
+    socket_entry_t* entry = &loop->entries[index];
+    short revents = pfd->revents;
+    pfd->revents = 0;
+    
+    // Zero-copy ferdigmeldinger gir POLLERR uten at socketen har feil
+    if ((revents & POLLERR) && !(revents & (POLLHUP | POLLNVAL)) &&
+        entry->sock->zerocopy) {
+        int so_error = 0;
+        socklen_t len = sizeof(so_error);
+        p2p_socket_zerocopy_reap(entry->sock);
+        if (getsockopt(pfd->fd, SOL_SOCKET, SO_ERROR, &so_error, &len) == 0 && so_error == 0) {
+            revents &= ~POLLERR;
+            if (revents == 0) return;
+        }
+    }
+    
+    // Batch-modus: les/lever først, disconnect meldes når recv() gir 0.
+    // POLLHUP uten POLLIN (peer lukket, ingen data igjen) leses også, så
+    // en ordnet lukking alltid meldes som error 0
+    int readable = (revents & POLLIN) ||
+                   (revents & (POLLERR | POLLHUP | POLLNVAL)) == POLLHUP;
+    if (entry->batch && (readable || entry->batch->pending)) {
+        dispatch_batch(loop, index, readable, ready);
+        return;
+    }
+    
+    // Sjekk for error/disconnect
+    if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        if (entry->on_error) {
+            p2p_socket_t* sock = entry->sock;
+            p2p_metric_add(&loop->counters, P2P_METRIC_CALLBACKS, 1);
+            uint64_t start = p2p_latency_lap(P2P_LATENCY_LOOP_DISPATCH_DELAY, ready);
+            entry->on_error(sock, revents, entry->user_data);
+            callback_done(loop, sock, start);
+        }
+        return;
+    }
+    
+    // Sjekk for lesbar data
+    if ((revents & POLLIN) && entry->on_read) {
+        p2p_socket_t* sock = entry->sock;
+        p2p_metric_add(&loop->counters, P2P_METRIC_CALLBACKS, 1);
+        uint64_t start = p2p_latency_lap(P2P_LATENCY_LOOP_DISPATCH_DELAY, ready);
+        entry->on_read(sock, entry->user_data);
+        callback_done(loop, sock, start);
+    }
+}
+
+/**
+ * Åpne wakeup-fd (ikke-blokkerende i begge ender)
+ */
+static int wake_open(p2p_event_loop_t* loop) {
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) return -1;
+    loop->wake_read = fd;
+    loop->wake_write = fd;
+#else
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    loop->wake_read = fds[0];
+    loop->wake_write = fds[1];
+#endif
+    return 0;
+}
+
+static void wake_close(p2p_event_loop_t* loop) {
+    if (loop->wake_write != loop->wake_read) close(loop->wake_write);
+    close(loop->wake_read);
+}
+
+/**
+ * Vekk loopen fra poll() (alle tråder); bare første wakeup før loopen
+ * har lest den koster et write()
+ */
+static void wake_signal(p2p_event_loop_t* loop) {
+    if (atomic_exchange(&loop->wake_pending, 1)) {
+        return;
+    }
+    
+    uint64_t one = 1;       // eventfd krever 8 bytes, pipe tar hva som helst
+    ssize_t n = write(loop->wake_write, &one, sizeof(one));
+    (void)n;                // Full pipe: loopen er allerede vekket
+}
+
+/**
+ * Tøm wakeup-fd (loop-tråden)
+ */
+static void wake_drain(p2p_event_loop_t* loop) {
+    atomic_store(&loop->wake_pending, 0);
+    
+    uint8_t buffer[64];
+    while (read(loop->wake_read, buffer, sizeof(buffer)) > 0) {
+        p2p_metric_add(&loop->counters, P2P_METRIC_SYSCALLS, 1);
+    }
+}
+
+/**
+ * Kjør postede oppgaver (maks TASKS_PER_ROUND, så en oppgave som poster
+ * seg selv ikke stenger ute I/O)
+ */
+static void run_tasks(p2p_event_loop_t* loop) {
+    int count = 0;
+    p2p_mpsc_node_t* node = NULL;
+    
+    while (count < TASKS_PER_ROUND && (node = p2p_mpsc_pop(&loop->tasks)) != NULL) {
+        task_t* task = (task_t*)node;
+        task->fn(task->arg);
+        free(task);
+        count++;
+    }
+    
+    loop->tasks_pending = (count == TASKS_PER_ROUND);
+}
+
+/**
+ * Ekspander kapasitet hvis nødvendig
+ */
+static int ensure_capacity(p2p_event_loop_t* loop) {
+    if (loop->num_sockets < loop->capacity) {
+        return 0;  // Har plass
+    }
+    
+    int new_capacity = loop->capacity * 2;
+    
+    socket_entry_t* new_entries = (socket_entry_t*)realloc(
+        loop->entries, 
+        new_capacity * sizeof(socket_entry_t)
+    );
+    
+    if (!new_entries) {
+        P2P_LOG_ERROR("EVENT_LOOP", "Failed to expand entries array");
+        return -1;
+    }
+    loop->entries = new_entries;
+    
+    struct pollfd* new_poll_fds = (struct pollfd*)realloc(
+        loop->poll_fds,
+        (new_capacity + 1) * sizeof(struct pollfd)   // + wakeup
+    );
+    
+    if (!new_poll_fds) {
+        P2P_LOG_ERROR("EVENT_LOOP", "Failed to expand poll_fds array");
+        return -1;
+    }
+    loop->poll_fds = new_poll_fds;
+    
+    int* new_ready = (int*)realloc(loop->ready, new_capacity * sizeof(int));
+    if (!new_ready) {
+        P2P_LOG_ERROR("EVENT_LOOP", "Failed to expand ready list");
+        return -1;
+    }
+    
+    loop->ready = new_ready;
+    loop->capacity = new_capacity;
+    
+    return 0;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+p2p_event_loop_t* p2p_event_loop_create(void) {
+    p2p_event_loop_t* loop = (p2p_event_loop_t*)malloc(sizeof(p2p_event_loop_t));
+    if (!loop) return NULL;
+    
+    loop->entries = (socket_entry_t*)malloc(INITIAL_CAPACITY * sizeof(socket_entry_t));
+    if (!loop->entries) {
+        free(loop);
+        return NULL;
+    }
+    
+    loop->poll_fds = (struct pollfd*)malloc((INITIAL_CAPACITY + 1) * sizeof(struct pollfd));
+    if (!loop->poll_fds) {
+        free(loop->entries);
+        free(loop);
+        return NULL;
+    }
+    
+    loop->ready = (int*)malloc(INITIAL_CAPACITY * sizeof(int));
+    if (!loop->ready || wake_open(loop) != 0) {
+        free(loop->ready);
+        free(loop->poll_fds);
+        free(loop->entries);
+        free(loop);
+        return NULL;
+    }
+    
+    loop->num_sockets = 0;
+    loop->capacity = INITIAL_CAPACITY;
+    atomic_init(&loop->stop_requested, 0);
+    p2p_counters_init(&loop->counters);
+    loop->slow_threshold_ns = 0;
+    loop->on_slow = NULL;
+    loop->slow_user_data = NULL;
+    loop->views = NULL;
+    loop->views_capacity = 0;
+    loop->batch_pending = 0;
+    loop->budget_bytes = 0;
+    loop->budget_frames = 0;
+    loop->busy_poll_ns = 0;
+    loop->busy_poll_us = 0;
+    loop->rr_next = 0;
+    loop->in_dispatch = 0;
+    loop->num_removed = 0;
+    p2p_mpsc_init(&loop->tasks);
+    loop->tasks_pending = 0;
+    atomic_init(&loop->wake_pending, 0);
+    
+    return loop;
+}
+
+void p2p_event_loop_free(p2p_event_loop_t* loop) {
+    if (!loop) return;
+    
+    for (int i = 0; i < loop->num_sockets; i++) {
+        if (loop->entries[i].batch) free_batch(loop->entries[i].batch);
+    }
+    free(loop->views);
+    free(loop->ready);
+    
+    // Oppgaver som aldri kjørte kastes
+    p2p_mpsc_node_t* node;
+    while ((node = p2p_mpsc_pop(&loop->tasks)) != NULL) {
+        free(node);
+    }
+    wake_close(loop);
+    if (loop->entries) free(loop->entries);
+    if (loop->poll_fds) free(loop->poll_fds);
+    free(loop);
+}
+
+int p2p_event_loop_add_socket(p2p_event_loop_t* loop,
+                               p2p_socket_t* sock,
+                               p2p_read_callback on_read,
+                               p2p_error_callback on_error,
+                               void* user_data) {
+    if (!loop || !sock) return -1;
+    
+    // Sjekk om socket allerede er registrert
+    if (find_socket_index(loop, sock) >= 0) {
+        P2P_LOG_WARN("EVENT_LOOP", "Socket already registered");
+        return -1;
+    }
+    
+    // Ekspander hvis nødvendig
+    if (ensure_capacity(loop) < 0) {
+        return -1;
+    }
+    
+    // Legg til i entries
+    int index = loop->num_sockets;
+    loop->entries[index].sock = sock;
+    loop->entries[index].on_read = on_read;
+    loop->entries[index].on_batch = NULL;
+    loop->entries[index].on_error = on_error;
+    loop->entries[index].user_data = user_data;
+    loop->entries[index].batch = NULL;
+    
+    // Sett opp for poll()
+    loop->poll_fds[index].fd = p2p_socket_get_handle(sock);
+    loop->poll_fds[index].events = POLLIN;  // Lytt på lesbare events
+    loop->poll_fds[index].revents = 0;
+    
+    if (loop->busy_poll_us > 0) {
+        p2p_socket_set_busy_poll(sock, loop->busy_poll_us);    // Best effort
+    }
+    
+    loop->num_sockets++;
+    
+    return 0;
+}
+
+int p2p_event_loop_add_socket_batch(p2p_event_loop_t* loop,
+                                    p2p_socket_t* sock,
+                                    p2p_batch_callback on_batch,
+                                    p2p_error_callback on_error,
+                                    size_t max_batch,
+                                    void* user_data) {
+    if (!loop || !sock || !on_batch) return -1;
+    
+    if (max_batch == 0) max_batch = P2P_EVENT_LOOP_BATCH_DEFAULT;
+    
+    if (max_batch > loop->views_capacity) {
+        p2p_message_t* views = (p2p_message_t*)realloc(loop->views,
+                                                       max_batch * sizeof(p2p_message_t));
+        if (!views) return -1;
+        loop->views = views;
+        loop->views_capacity = max_batch;
+    }
+    
+    batch_state_t* batch = (batch_state_t*)calloc(1, sizeof(batch_state_t));
+    if (!batch) return -1;
+    if (p2p_frame_reader_init(&batch->reader) != 0) {
+        free(batch);
+        return -1;
+    }
+    batch->max_batch = max_batch;
+    
+    if (p2p_event_loop_add_socket(loop, sock, NULL, on_error, user_data) != 0) {
+        free_batch(batch);
+        return -1;
+    }
+    
+    socket_entry_t* entry = &loop->entries[loop->num_sockets - 1];
+    entry->on_batch = on_batch;
+    entry->batch = batch;
+    
+    return 0;
+}
+
+void p2p_event_loop_set_read_budget(p2p_event_loop_t* loop,
+                                    size_t max_bytes,
+                                    size_t max_frames) {
+    if (!loop) return;
+    loop->budget_bytes = max_bytes;
+    loop->budget_frames = max_frames;
+}
+
+void p2p_event_loop_set_busy_poll(p2p_event_loop_t* loop,
+                                  uint64_t spin_ns,
+                                  int socket_busy_poll_us) {
+    if (!loop) return;
+    loop->busy_poll_ns = spin_ns;
+    
+    if (socket_busy_poll_us != loop->busy_poll_us) {
+        loop->busy_poll_us = socket_busy_poll_us;
+        for (int i = 0; i < loop->num_sockets; i++) {
+            if (loop->entries[i].sock) {
+                p2p_socket_set_busy_poll(loop->entries[i].sock, socket_busy_poll_us);
+            }
+        }
+    }
+}
+
+int p2p_event_loop_remove_socket(p2p_event_loop_t* loop, p2p_socket_t* sock) {
+    if (!loop || !sock) return -1;
+    
+    int index = find_socket_index(loop, sock);
+    if (index < 0) {
+        return -1;  // Ikke funnet
+    }
+    
+    if (loop->entries[index].batch) {
+        set_batch_pending(loop, loop->entries[index].batch, 0);
+    }
+    
+    // Under en runde peker klarlisten på indekser: bare merk, rydd etterpå
+    if (loop->in_dispatch) {
+        loop->entries[index].sock = NULL;
+        loop->num_removed++;
+        return 0;
+    }
+    
+    remove_index(loop, index);
+    
+    return 0;
+}
+
+void p2p_event_loop_run(p2p_event_loop_t* loop) {
+    if (!loop) return;
+    
+    P2P_LOG_INFO("EVENT_LOOP", "Started (monitoring %d sockets)", loop->num_sockets);
+    
+    while (!atomic_load_explicit(&loop->stop_requested, memory_order_acquire)) {
+        if (loop->num_sockets == 0 && !loop->tasks_pending &&
+            !atomic_load(&loop->wake_pending)) {
+            // Ingen sockets å overvåke og ingen postede oppgaver på vei
+            // (en post() setter wake_pending før loopen vekkes)
+            P2P_LOG_INFO("EVENT_LOOP", "No sockets to monitor, stopping");
+            break;
+        }
+        
+        // Vent på events (timeout 1000ms, ikke vent hvis batch-meldinger
+        // eller oppgaver venter). Wakeup-fd ligger sist i poll-settet.
+        int timeout = (loop->batch_pending > 0 || loop->tasks_pending) ? 0 : 1000;
+        struct pollfd* wake = &loop->poll_fds[loop->num_sockets];
+        wake->fd = loop->wake_read;
+        wake->events = POLLIN;
+        wake->revents = 0;
+        
+        nfds_t nfds = (nfds_t)loop->num_sockets + 1;
+        int result = 0;
+        p2p_metric_add(&loop->counters, P2P_METRIC_LOOP_ITERATIONS, 1);
+        
+        // Busy-poll: spinn på ikke-blokkerende poll før vi sover
+        if (loop->busy_poll_ns > 0 && timeout != 0) {
+            uint64_t spin_end = p2p_clock_ns() + loop->busy_poll_ns;
+            do {
+                result = poll(loop->poll_fds, nfds, 0);
+                p2p_metric_add(&loop->counters, P2P_METRIC_SYSCALLS, 1);
+            } while (result == 0 && p2p_clock_ns() < spin_end);
+        }
+        
+        if (result == 0) {
+            result = poll(loop->poll_fds, nfds, timeout);
+            p2p_metric_add(&loop->counters, P2P_METRIC_SYSCALLS, 1);
+        }
+        
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;  // Avbrutt av signal
+            }
+            P2P_LOG_ERROR("EVENT_LOOP", "poll error: %d", errno);
+            break;
+        }
+        
+        if (result == 0 && loop->batch_pending == 0 && !loop->tasks_pending) {
+            // Timeout (ingen events)
+            continue;
+        }
+        
+        // Les wakeup før dispatch: add_socket i en callback tar denne plassen
+        int woken = (wake->revents != 0);
+        if (woken) {
+            wake_drain(loop);
+        }
+        
+        // Tidspunkt poll() returnerte; klokka leses bare når noe skal måles
+        uint64_t ready = loop->slow_threshold_ns ? p2p_clock_ns() : p2p_latency_start();
+        
+        // Klarliste: sockets med events eller meldinger igjen fra forrige runde
+        int num_ready = 0;
+        int first = 0;
+        for (int i = 0; i < loop->num_sockets; i++) {
+            if (loop->poll_fds[i].revents != 0 ||
+                (loop->entries[i].batch && loop->entries[i].batch->pending)) {
+                if (i < loop->rr_next) first = num_ready + 1;
+                loop->ready[num_ready++] = i;
+            }
+        }
+        
+        // Round-robin: start der forrige runde slapp, så samme socket
+        // ikke alltid går først
+        if (first >= num_ready) first = 0;
+        loop->in_dispatch = 1;
+        for (int k = 0; k < num_ready; k++) {
+            int index = loop->ready[(first + k) % num_ready];
+            if (!loop->entries[index].sock) {
+                continue;  // Fjernet tidligere i runden
+            }
+            dispatch_entry(loop, index, ready);
+        }
+        loop->in_dispatch = 0;
+        if (num_ready > 0) {
+            loop->rr_next = loop->ready[first] + 1;
+        }
+        remove_pending(loop);
+        
+        if (woken || loop->tasks_pending) {
+            run_tasks(loop);
+        }
+        
+        p2p_latency_lap(P2P_LATENCY_LOOP_ITERATION, ready);
+    }
+    
+    // Forbruk stop(), så neste run() kjører igjen
+    atomic_store(&loop->stop_requested, 0);
+    
+    P2P_LOG_INFO("EVENT_LOOP", "Stopped");
+}
+
+void p2p_event_loop_stop(p2p_event_loop_t* loop) {
+    if (!loop) return;
+    atomic_store_explicit(&loop->stop_requested, 1, memory_order_release);
+    wake_signal(loop);
+}
+
+int p2p_event_loop_post(p2p_event_loop_t* loop, p2p_task_fn fn, void* arg) {
+    if (!loop || !fn) return -1;
+    
+    task_t* task = (task_t*)malloc(sizeof(task_t));
+    if (!task) return -1;
+    task->fn = fn;
+    task->arg = arg;
+    
+    p2p_mpsc_push(&loop->tasks, &task->node);
+    wake_signal(loop);
+    
+    return 0;
+}
+
+int p2p_event_loop_socket_count(p2p_event_loop_t* loop) {
+    if (!loop) return -1;
+    return loop->num_sockets - loop->num_removed;
+}
+
+void p2p_event_loop_set_slow_callback(p2p_event_loop_t* loop,
+                                      uint64_t threshold_ns,
+                                      p2p_slow_callback on_slow,
+                                      void* user_data) {
+    if (!loop) return;
+    loop->slow_threshold_ns = threshold_ns;
+    loop->on_slow = on_slow;
+    loop->slow_user_data = user_data;
+}
+
+int p2p_event_loop_metrics(p2p_event_loop_t* loop, p2p_metrics_t* out) {
+    if (!loop || !out) return -1;
+    p2p_counters_read(&loop->counters, out);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#ifndef P2PNET_SOCKET_INTERNAL_H
+#define P2PNET_SOCKET_INTERNAL_H
+
+#include "p2pnet/socket.h"
+#include "../util/metrics.h"
+
+/**
+ * Transport (internal, not part of public API)
+ *
+ * p2p_socket_send/recv/close dispatch through the socket's transport, so
+ * message framing, handshake and encryption run unchanged over:
+ *
+ *   tcp     AF_INET stream socket         (socket_win.c / socket_unix.c)
+ *   unix    AF_UNIX stream socket         (socket_unix.c)
+ *   shm     Shared-memory rings, same host (transport_shm.c, Linux)
+ *   memory  In-process ring buffer pair   (transport_memory.c)
+ *
+ * send/recv follow the socket semantics: partial transfers allowed, recv
+ * returns 0 on orderly close, -1 on error (with p2p_socket_set_error()).
+ * Byte and partial-transfer metrics are counted by the dispatcher; a
+ * transport only counts its own syscalls.
+ */
+typedef struct p2p_transport {
+    const char* name;
+    intptr_t (*send)(p2p_socket_t* sock, const void* data, size_t len);
+    intptr_t (*recv)(p2p_socket_t* sock, void* buffer, size_t len);
+    void (*close)(p2p_socket_t* sock);     // Release transport state, not the struct
+} p2p_transport_t;
+
+typedef struct p2p_zerocopy p2p_zerocopy_t;     // socket_unix.c (Linux)
+
+/**
+ * What an accepted socket holds against its admission rules (accept.c)
+ */
+typedef struct {
+    p2p_admission_t* admission; // NULL = not admitted through rules
+    uint8_t peer[16];           // Peer IP (v4-mapped for IPv4)
+    uint8_t has_peer;           // Counted against max_per_ip
+    uint8_t pending;            // Counted against max_pending
+} p2p_admission_ticket_t;
+
+/**
+ * Socket structure (shared by the platform ports and transports)
+ */
+struct p2p_socket {
+#ifdef _WIN32
+    SOCKET handle;      // Windows socket handle, INVALID_SOCKET for memory
+#else
+    int handle;         // File descriptor, -1 for memory
+#endif
+    int type;           // SOCK_STREAM eller SOCK_DGRAM
+    int is_listening;   // 1 hvis socket er i listen mode
+    int is_nonblocking; // 1 etter p2p_socket_set_nonblocking(sock, 1)
+    const p2p_transport_t* transport;
+    void* transport_data;       // Transport private state (memory/shm: ring end)
+    p2p_zerocopy_t* zerocopy;   // MSG_ZEROCOPY state, NULL = copy path only
+    p2p_counters_t counters;    // Per-socket metrics
+    p2p_admission_ticket_t ticket;
+};
+
+/**
+ * Allocate a socket without OS handle for a non-fd transport (platform port)
+ */
+p2p_socket_t* p2p_socket_wrap_transport(const p2p_transport_t* transport, void* data);
+
+/**
+ * Set the message returned by p2p_get_error() (platform port)
+ */
+void p2p_socket_set_error(const char* message);
+
+/**
+ * Socket struct from the pool, or malloc if it is empty (accept.c)
+ *
+ * Fields are not initialized. Returns NULL when out of memory.
+ */
+p2p_socket_t* p2p_socket_pool_get(void);
+
+/**
+ * Return a closed socket struct to the pool (freed if the pool is full)
+ */
+void p2p_socket_pool_put(p2p_socket_t* sock);
+
+/**
+ * Free all pooled structs (p2p_cleanup)
+ */
+void p2p_socket_pool_drain(void);
+
+/**
+ * Check a new connection against the rules and take its slots
+ *
+ * @return 0 if admitted (ticket holds a reference to admission), -1 if
+ *         rejected (counted in admission, ticket is empty)
+ */
+int p2p_admission_admit(p2p_admission_t* admission, const struct sockaddr* peer,
+                        p2p_admission_ticket_t* ticket);
+
+/**
+ * Handshake done: give back the pending slot
+ */
+void p2p_admission_established(p2p_admission_ticket_t* ticket);
+
+/**
+ * Socket closed: give back all slots and the reference
+ */
+void p2p_admission_release(p2p_admission_ticket_t* ticket);
+
+#endif /* P2PNET_SOCKET_INTERNAL_H */
@@ -0,0 +1,1120 @@
+#include "socket_internal.h"
+#include "thread.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/un.h>
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    #include "p2pnet/log.h"
+    #include <linux/errqueue.h>
+    #include <poll.h>
+    #define P2P_HAVE_ZEROCOPY 1
+#endif
+
+/**
+ * Global error buffer (thread-unsafe, men OK for enkle programmer)
+ */
+static char error_buffer[256];
+
+// ============================================================================
+// Initialisering og cleanup
+// ============================================================================
+
+/**
+ * Reserve-fd for accept når prosessen er tom for fd-er (EMFILE/ENFILE):
+ * en listener med tilkoblinger i køen forblir lesbar, så uten en fd å
+ * akseptere med ville event loop spinne på den. Reserven tas når en socket
+ * begynner å lytte.
+ */
+static p2p_mutex_t g_spare_lock = P2P_MUTEX_INITIALIZER;
+static int g_spare_fd = -1;
+
+static void accept_spare_reserve(void) {
+    p2p_mutex_lock(&g_spare_lock);
+    if (g_spare_fd < 0) {
+        g_spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    p2p_mutex_unlock(&g_spare_lock);
+}
+
+static void accept_spare_release(void) {
+    p2p_mutex_lock(&g_spare_lock);
+    if (g_spare_fd >= 0) {
+        close(g_spare_fd);
+        g_spare_fd = -1;
+    }
+    p2p_mutex_unlock(&g_spare_lock);
+}
+
+int p2p_init(void) {
+    // Skriving til lukket socket skal gi EPIPE, ikke drepe prosessen
+    signal(SIGPIPE, SIG_IGN);
+    return 0;
+}
+
+void p2p_cleanup(void) {
+    // Siste sjanse for parkerte zero-copy buffere; resten lekkes heller enn å frigjøres
+    p2p_socket_zerocopy_reap(NULL);
+    p2p_socket_pool_drain();
+    accept_spare_release();
+}
+
+// ============================================================================
+// Stream transport (AF_INET og AF_UNIX - samme send/recv på fd)
+// ============================================================================
+
+static intptr_t stream_send(p2p_socket_t* sock, const void* data, size_t len) {
+    ssize_t result;
+    do {
+        result = send(sock->handle, data, len, MSG_NOSIGNAL);
+        p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "send() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return result;
+}
+
+static intptr_t stream_recv(p2p_socket_t* sock, void* buffer, size_t len) {
+    ssize_t result;
+    do {
+        result = recv(sock->handle, buffer, len, 0);
+        p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "recv() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return result;
+}
+
+static void stream_close(p2p_socket_t* sock) {
+    if (sock->handle >= 0) {
+        close(sock->handle);
+    }
+}
+
+static const p2p_transport_t tcp_transport = {"tcp", stream_send, stream_recv, stream_close};
+static const p2p_transport_t unix_transport = {"unix", stream_send, stream_recv, stream_close};
+
+// ============================================================================
+// Socket operasjoner
+// ============================================================================
+
+/**
+ * Ny socket struktur for transport (handle = -1 hvis ingen fd)
+ */
+static p2p_socket_t* wrap(const p2p_transport_t* transport, int handle, int type) {
+    p2p_socket_t* sock = p2p_socket_pool_get();
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Out of memory");
+        return NULL;
+    }
+
+    sock->handle = handle;
+    sock->type = type;
+    sock->is_listening = 0;
+    sock->is_nonblocking = 0;
+    sock->transport = transport;
+    sock->transport_data = NULL;
+    sock->zerocopy = NULL;
+    p2p_counters_init(&sock->counters);
+    sock->ticket.admission = NULL;
+
+    return sock;
+}
+
+p2p_socket_t* p2p_socket_wrap_transport(const p2p_transport_t* transport, void* data) {
+    p2p_socket_t* sock = wrap(transport, -1, SOCK_STREAM);
+    if (sock) {
+        sock->transport_data = data;
+    }
+    return sock;
+}
+
+void p2p_socket_set_error(const char* message) {
+    snprintf(error_buffer, sizeof(error_buffer), "%s", message);
+}
+
+p2p_socket_t* p2p_socket_create(int type) {
+    int handle = socket(AF_INET, type, 0);
+    if (handle < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "socket() failed: %s", strerror(errno));
+        return NULL;
+    }
+
+    // Tillat rask restart av servere (TIME_WAIT)
+    int one = 1;
+    setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    p2p_socket_t* sock = wrap(&tcp_transport, handle, type);
+    if (!sock) {
+        close(handle);
+        return NULL;
+    }
+
+    return sock;
+}
+
+int p2p_socket_bind(p2p_socket_t* sock, const char* ip, uint16_t port) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    // Sett opp adresse struktur
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);  // Konverter til network byte order
+
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) != 1) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "Invalid IP address: %s", ip);
+        return -1;
+    }
+
+    if (bind(sock->handle, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "bind() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int p2p_socket_listen(p2p_socket_t* sock, int backlog) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    if (listen(sock->handle, backlog) < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "listen() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    sock->is_listening = 1;
+    accept_spare_reserve();
+    return 0;
+}
+
+p2p_socket_t* p2p_socket_accept(p2p_socket_t* sock) {
+    if (!sock || !sock->is_listening) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "Socket is not in listening mode");
+        return NULL;
+    }
+
+    struct sockaddr_storage client_addr;    // AF_INET eller AF_UNIX
+    socklen_t addr_len = sizeof(client_addr);
+
+    int client_handle;
+    do {
+        client_handle = accept(sock->handle, (struct sockaddr*)&client_addr, &addr_len);
+    } while (client_handle < 0 && errno == EINTR);
+
+    if (client_handle < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "accept() failed: %s", strerror(errno));
+        return NULL;
+    }
+
+    // Samme transport som listener (tcp eller unix)
+    p2p_socket_t* client_sock = wrap(sock->transport, client_handle, sock->type);
+    if (!client_sock) {
+        close(client_handle);
+        return NULL;
+    }
+
+    return client_sock;
+}
+
+/**
+ * Lukker en avvist tilkobling med RST (ingen TIME_WAIT på serveren)
+ */
+static void reject_connection(int handle) {
+    struct linger abort_close = {1, 0};
+    setsockopt(handle, SOL_SOCKET, SO_LINGER, &abort_close, sizeof(abort_close));
+    close(handle);
+}
+
+/**
+ * Tom for fd-er: bruk reserven til å ta én tilkobling ut av køen og avvis den
+ *
+ * @return 0 hvis køen ble kortere (eller er tom), -1 uten reserve
+ */
+static int shed_connection(p2p_socket_t* listener) {
+    int rc = -1;
+    p2p_mutex_lock(&g_spare_lock);
+    if (g_spare_fd >= 0) {
+        close(g_spare_fd);
+        int handle = accept(listener->handle, NULL, NULL);
+        p2p_metric_add(&listener->counters, P2P_METRIC_SYSCALLS, 1);
+        if (handle >= 0) {
+            reject_connection(handle);
+            p2p_metric_add(&listener->counters, P2P_METRIC_ACCEPT_REJECTS, 1);
+        }
+        rc = 0;
+        g_spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    p2p_mutex_unlock(&g_spare_lock);
+    return rc;
+}
+
+int p2p_socket_accept_batch(p2p_socket_t* sock, p2p_socket_t** out, int max,
+                            p2p_admission_t* admission, int flags) {
+    if (!sock || !sock->is_listening || !out || max <= 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "Socket is not in listening mode");
+        return -1;
+    }
+    if (!sock->is_nonblocking) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "Listener must be non-blocking");
+        return -1;
+    }
+
+    // Høyst max forsøk: avviste og avbrutte tilkoblinger teller også, så en
+    // flom av dem ikke holder tråden her
+    int count = 0;
+    for (int attempt = 0; attempt < max; attempt++) {
+        struct sockaddr_storage client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+
+        int client_handle;
+        do {
+#ifdef __linux__
+            // Flaggene settes i samme syscall
+            client_handle = accept4(sock->handle, (struct sockaddr*)&client_addr, &addr_len,
+                                    SOCK_CLOEXEC |
+                                    ((flags & P2P_ACCEPT_NONBLOCK) ? SOCK_NONBLOCK : 0));
+#else
+            client_handle = accept(sock->handle, (struct sockaddr*)&client_addr, &addr_len);
+#endif
+            p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+        } while (client_handle < 0 && errno == EINTR);
+
+        if (client_handle < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;                              // Køen er tom
+            }
+            // Peer ga opp før vi rakk den: hopp over, ta neste
+            if (errno == ECONNABORTED || errno == EPROTO) {
+                continue;
+            }
+            int err = errno;
+            if ((err == EMFILE || err == ENFILE) && shed_connection(sock) == 0) {
+                continue;
+            }
+            snprintf(error_buffer, sizeof(error_buffer),
+                     "accept() failed: %s", strerror(err));
+            return count > 0 ? count : -1;
+        }
+
+#ifndef __linux__
+        // BSD: arver O_NONBLOCK fra listeneren, sett modus fra flags
+        fcntl(client_handle, F_SETFD, FD_CLOEXEC);
+        int fl = fcntl(client_handle, F_GETFL, 0);
+        fcntl(client_handle, F_SETFL, (flags & P2P_ACCEPT_NONBLOCK) ? (fl | O_NONBLOCK)
+                                                                    : (fl & ~O_NONBLOCK));
+#endif
+
+        p2p_admission_ticket_t ticket;
+        if (admission &&
+            p2p_admission_admit(admission, (struct sockaddr*)&client_addr, &ticket) != 0) {
+            reject_connection(client_handle);
+            p2p_metric_add(&sock->counters, P2P_METRIC_ACCEPT_REJECTS, 1);
+            continue;
+        }
+
+        p2p_socket_t* client_sock = wrap(sock->transport, client_handle, sock->type);
+        if (!client_sock) {
+            if (admission) p2p_admission_release(&ticket);
+            close(client_handle);
+            return count > 0 ? count : -1;
+        }
+        if (admission) {
+            client_sock->ticket = ticket;
+        }
+        client_sock->is_nonblocking = (flags & P2P_ACCEPT_NONBLOCK) ? 1 : 0;
+
+        out[count++] = client_sock;
+    }
+
+    return count;
+}
+
+int p2p_socket_connect(p2p_socket_t* sock, const char* ip, uint16_t port) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, ip, &server_addr.sin_addr) != 1) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "Invalid IP address: %s", ip);
+        return -1;
+    }
+
+    if (connect(sock->handle, (struct sockaddr*)&server_addr,
+                sizeof(server_addr)) < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "connect() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+// ============================================================================
+// Unix domain sockets
+// ============================================================================
+
+/**
+ * Fyller sockaddr_un, feiler hvis path ikke får plass
+ */
+static int unix_address(const char* path, struct sockaddr_un* addr) {
+    if (!path || strlen(path) >= sizeof(addr->sun_path)) {
+        snprintf(error_buffer, sizeof(error_buffer), "Invalid socket path");
+        return -1;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path, strlen(path) + 1);
+    return 0;
+}
+
+p2p_socket_t* p2p_socket_create_unix(void) {
+    int handle = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (handle < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "socket() failed: %s", strerror(errno));
+        return NULL;
+    }
+
+    p2p_socket_t* sock = wrap(&unix_transport, handle, SOCK_STREAM);
+    if (!sock) {
+        close(handle);
+        return NULL;
+    }
+
+    return sock;
+}
+
+int p2p_socket_bind_unix(p2p_socket_t* sock, const char* path) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    if (unix_address(path, &addr) != 0) {
+        return -1;
+    }
+
+    if (bind(sock->handle, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        return 0;
+    }
+
+    // Fil igjen etter en server som døde? Fjern den bare hvis ingen lytter
+    if (errno == EADDRINUSE) {
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        int stale = probe >= 0 &&
+                    connect(probe, (struct sockaddr*)&addr, sizeof(addr)) < 0 &&
+                    errno == ECONNREFUSED;
+        if (probe >= 0) close(probe);
+
+        if (stale && unlink(path) == 0 &&
+            bind(sock->handle, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            return 0;
+        }
+        errno = EADDRINUSE;
+    }
+
+    snprintf(error_buffer, sizeof(error_buffer),
+             "bind() failed: %s", strerror(errno));
+    return -1;
+}
+
+int p2p_socket_connect_unix(p2p_socket_t* sock, const char* path) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    if (unix_address(path, &addr) != 0) {
+        return -1;
+    }
+
+    int result;
+    do {
+        result = connect(sock->handle, (struct sockaddr*)&addr, sizeof(addr));
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "connect() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int p2p_socket_send_socket(p2p_socket_t* channel, p2p_socket_t* sock) {
+    if (!channel || !sock || sock->handle < 0) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    // Én markør-byte bærer fd-en (SCM_RIGHTS krever minst én byte data)
+    uint8_t marker = 'F';
+    struct iovec iov = {&marker, 1};
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &sock->handle, sizeof(int));
+
+    ssize_t result;
+    do {
+        result = sendmsg(channel->handle, &msg, MSG_NOSIGNAL);
+        p2p_metric_add(&channel->counters, P2P_METRIC_SYSCALLS, 1);
+    } while (result < 0 && errno == EINTR);
+
+    if (result != 1) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "sendmsg() failed: %s", result < 0 ? strerror(errno) : "short write");
+        return -1;
+    }
+
+    return 0;
+}
+
+p2p_socket_t* p2p_socket_recv_socket(p2p_socket_t* channel) {
+    if (!channel) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return NULL;
+    }
+
+    uint8_t marker = 0;
+    struct iovec iov = {&marker, 1};
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t result;
+    do {
+        result = recvmsg(channel->handle, &msg, MSG_CMSG_CLOEXEC);
+        p2p_metric_add(&channel->counters, P2P_METRIC_SYSCALLS, 1);
+    } while (result < 0 && errno == EINTR);
+
+    if (result <= 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "recvmsg() failed: %s", result < 0 ? strerror(errno) : "connection closed");
+        return NULL;
+    }
+
+    int handle = -1;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+        memcpy(&handle, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    if (handle < 0 || marker != 'F' || (msg.msg_flags & MSG_CTRUNC)) {
+        if (handle >= 0) close(handle);
+        snprintf(error_buffer, sizeof(error_buffer), "No socket in message");
+        return NULL;
+    }
+
+    // Finn transport og type fra den mottatte fd-en
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    int type = SOCK_STREAM;
+    socklen_t type_len = sizeof(type);
+    if (getsockname(handle, (struct sockaddr*)&addr, &addr_len) < 0 ||
+        getsockopt(handle, SOL_SOCKET, SO_TYPE, &type, &type_len) < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "Received fd is not a socket: %s", strerror(errno));
+        close(handle);
+        return NULL;
+    }
+
+    p2p_socket_t* sock = wrap(addr.ss_family == AF_UNIX ? &unix_transport : &tcp_transport,
+                              handle, type);
+    if (!sock) {
+        close(handle);
+        return NULL;
+    }
+
+    // Listener- og non-blocking-tilstand følger ikke med fd-en, spør kjernen
+    int listening = 0;
+    socklen_t listening_len = sizeof(listening);
+    if (getsockopt(handle, SOL_SOCKET, SO_ACCEPTCONN, &listening, &listening_len) == 0) {
+        sock->is_listening = listening;
+    }
+    int fl = fcntl(handle, F_GETFL, 0);
+    sock->is_nonblocking = fl >= 0 && (fl & O_NONBLOCK) ? 1 : 0;
+
+    return sock;
+}
+
+int p2p_socket_set_nonblocking(p2p_socket_t* sock, int enabled) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    int flags = fcntl(sock->handle, F_GETFL, 0);
+    if (flags < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "fcntl() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    flags = enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    if (fcntl(sock->handle, F_SETFL, flags) < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "fcntl() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    sock->is_nonblocking = enabled ? 1 : 0;
+    return 0;
+}
+
+int p2p_socket_set_nodelay(p2p_socket_t* sock, int enabled) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    // Ingen Nagle på AF_UNIX: ingenting å skru av
+    if (sock->transport == &unix_transport) {
+        return 0;
+    }
+
+    int value = enabled ? 1 : 0;
+    if (setsockopt(sock->handle, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)) < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "setsockopt(TCP_NODELAY) failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int p2p_socket_set_busy_poll(p2p_socket_t* sock, int usec) {
+    if (!sock || usec < 0) {
+        snprintf(error_buffer, sizeof(error_buffer), "Invalid arguments");
+        return -1;
+    }
+
+#ifdef SO_BUSY_POLL
+    if (sock->handle < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "Busy poll not supported on %s transport", sock->transport->name);
+        return -1;
+    }
+
+    if (setsockopt(sock->handle, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "setsockopt(SO_BUSY_POLL) failed: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+#else
+    snprintf(error_buffer, sizeof(error_buffer), "SO_BUSY_POLL not supported");
+    return -1;
+#endif
+}
+
+int p2p_socket_pair(p2p_socket_t** a, p2p_socket_t** b) {
+    if (!a || !b) {
+        snprintf(error_buffer, sizeof(error_buffer), "Output is NULL");
+        return -1;
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "socketpair() failed: %s", strerror(errno));
+        return -1;
+    }
+
+    *a = wrap(&unix_transport, fds[0], SOCK_STREAM);
+    *b = wrap(&unix_transport, fds[1], SOCK_STREAM);
+    if (!*a || !*b) {
+        if (*a) p2p_socket_close(*a); else close(fds[0]);
+        if (*b) p2p_socket_close(*b); else close(fds[1]);
+        *a = *b = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+intptr_t p2p_socket_send(p2p_socket_t* sock, const void* data, size_t len) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    intptr_t result = sock->transport->send(sock, data, len);
+    if (result < 0) {
+        return -1;
+    }
+
+    p2p_metric_add(&sock->counters, P2P_METRIC_BYTES_OUT, (uint64_t)result);
+    if ((size_t)result < len) {
+        p2p_metric_add(&sock->counters, P2P_METRIC_PARTIAL_WRITES, 1);
+    }
+
+    return result;
+}
+
+intptr_t p2p_socket_recv(p2p_socket_t* sock, void* buffer, size_t len) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    intptr_t result = sock->transport->recv(sock, buffer, len);
+    if (result < 0) {
+        return -1;
+    }
+
+    p2p_metric_add(&sock->counters, P2P_METRIC_BYTES_IN, (uint64_t)result);
+    if (result > 0 && (size_t)result < len) {
+        p2p_metric_add(&sock->counters, P2P_METRIC_PARTIAL_READS, 1);
+    }
+
+    return result;
+}
+
+// ============================================================================
+// Zero-copy send (MSG_ZEROCOPY)
+// ============================================================================
+
+#ifdef P2P_HAVE_ZEROCOPY
+
+#define ZEROCOPY_CLOSE_WAIT_MS 1000
+
+/**
+ * Buffer som kjernen fortsatt leser fra
+ *
+ * Hvert vellykket send(MSG_ZEROCOPY) får et løpenummer; kjernen melder
+ * ferdige områder [lo, hi] på error-køen. Bufferen frigjøres når alle
+ * kallene den ble sendt med er ferdige.
+ */
+typedef struct {
+    uint32_t first_seq;
+    uint32_t calls;         // Antall send-kall (fra first_seq)
+    uint32_t outstanding;   // Kall som ikke er bekreftet ennå
+    p2p_release_fn release;
+    void* ctx;
+} zerocopy_pending_t;
+
+struct p2p_zerocopy {
+    size_t threshold;
+    uint32_t next_seq;
+    zerocopy_pending_t* pending;
+    int num_pending;
+    int capacity;
+    int parked_fd;              // dup av socketen etter close (parkert), ellers -1
+    p2p_zerocopy_t* next;       // Parkert-listen
+};
+
+/**
+ * Lukkede sockets der kjernen fortsatt holder buffere
+ *
+ * Bufferne kan ikke frigjøres før kjernen har meldt ferdig (sidene kan
+ * fortsatt være i sendekøen), og meldingen kommer bare på socketens
+ * error-kø. Close beholder derfor en dup av fd-en her til alt er meldt.
+ */
+static p2p_mutex_t g_parked_lock = P2P_MUTEX_INITIALIZER;
+static p2p_zerocopy_t* g_parked = NULL;
+
+/**
+ * Trekk fullførte kall [lo, lo + count) fra alle ventende buffere
+ */
+static void zerocopy_complete(p2p_zerocopy_t* zc, uint32_t lo, uint32_t count) {
+    int kept = 0;
+    for (int i = 0; i < zc->num_pending; i++) {
+        zerocopy_pending_t* p = &zc->pending[i];
+
+        // Overlapp mellom [first, first + calls) og [lo, lo + count), mod 2^32
+        int32_t d = (int32_t)(lo - p->first_seq);
+        int64_t overlap = d >= 0 ? (int64_t)p->calls - d : (int64_t)count + d;
+        if (overlap > (int64_t)count) overlap = count;
+        if (overlap > (int64_t)p->calls) overlap = p->calls;
+        if (overlap > 0) p->outstanding -= (uint32_t)overlap;
+
+        if (p->outstanding == 0) {
+            p->release(p->ctx);
+        } else {
+            zc->pending[kept++] = *p;
+        }
+    }
+    zc->num_pending = kept;
+}
+
+static int zerocopy_reap_fd(int fd, p2p_zerocopy_t* zc, p2p_counters_t* counters) {
+    for (;;) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t result = recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+        p2p_metric_add(counters, P2P_METRIC_SYSCALLS, 1);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            break;      // EAGAIN: køen er tom
+        }
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) {
+                continue;
+            }
+
+            uint32_t count = err.ee_data - err.ee_info + 1;
+            if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                p2p_metric_add(counters, P2P_METRIC_ZEROCOPY_COPIED, count);
+            }
+            zerocopy_complete(zc, err.ee_info, count);
+        }
+    }
+
+    return zc->num_pending;
+}
+
+static int zerocopy_reap(p2p_socket_t* sock) {
+    return zerocopy_reap_fd(sock->handle, sock->zerocopy, &sock->counters);
+}
+
+/**
+ * Reap parkerte sockets, lukk de som er ferdige
+ *
+ * @return Antall sockets som fortsatt er parkert
+ */
+static int zerocopy_reap_parked(void) {
+    p2p_mutex_lock(&g_parked_lock);
+
+    int remaining = 0;
+    p2p_zerocopy_t** link = &g_parked;
+    while (*link) {
+        p2p_zerocopy_t* zc = *link;
+        if (zerocopy_reap_fd(zc->parked_fd, zc, NULL) > 0) {
+            link = &zc->next;
+            remaining++;
+            continue;
+        }
+
+        *link = zc->next;
+        close(zc->parked_fd);
+        free(zc->pending);
+        free(zc);
+    }
+
+    p2p_mutex_unlock(&g_parked_lock);
+    return remaining;
+}
+
+/**
+ * Vent (begrenset) på at kjernen slipper alle buffere
+ *
+ * Buffere uten ferdigmelding frigjøres aldri her: kjernen kan fortsatt
+ * sende fra dem. Etter tidsavbruddet parkeres de sammen med en dup av
+ * fd-en, og frigjøres av en senere reap når kjernen har meldt ferdig.
+ */
+static void zerocopy_shutdown(p2p_socket_t* sock) {
+    p2p_zerocopy_t* zc = sock->zerocopy;
+    sock->zerocopy = NULL;
+
+    zerocopy_reap_parked();
+
+    for (int waited = 0;
+         zerocopy_reap_fd(sock->handle, zc, &sock->counters) > 0 && waited < ZEROCOPY_CLOSE_WAIT_MS;
+         waited += 10) {
+        struct pollfd pfd = {sock->handle, 0, 0};     // POLLERR meldes alltid
+        poll(&pfd, 1, 10);
+    }
+
+    if (zc->num_pending > 0) {
+        zc->parked_fd = fcntl(sock->handle, F_DUPFD_CLOEXEC, 0);
+        if (zc->parked_fd >= 0) {
+            // Peer får FIN etter det som står i køen, som ved vanlig close
+            shutdown(sock->handle, SHUT_WR);
+            p2p_mutex_lock(&g_parked_lock);
+            zc->next = g_parked;
+            g_parked = zc;
+            p2p_mutex_unlock(&g_parked_lock);
+        } else {
+            // Uten fd får vi aldri vite når kjernen er ferdig: lekk heller enn å frigjøre
+            P2P_LOG_WARN("SOCKET", "Zero-copy close: leaking %d buffer(s) still in flight",
+                         zc->num_pending);
+        }
+        return;
+    }
+
+    free(zc->pending);
+    free(zc);
+}
+
+int p2p_socket_set_zerocopy(p2p_socket_t* sock, size_t threshold) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+
+    if (sock->zerocopy) {
+        // Eksisterende ventende buffere beholdes til de er ferdige
+        sock->zerocopy->threshold = threshold ? threshold : SIZE_MAX;
+        return 0;
+    }
+    if (threshold == 0) {
+        return 0;
+    }
+
+    if (sock->transport != &tcp_transport) {
+        snprintf(error_buffer, sizeof(error_buffer), "Zero-copy requires a TCP socket");
+        return -1;
+    }
+
+    int one = 1;
+    if (setsockopt(sock->handle, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "setsockopt(SO_ZEROCOPY) failed: %s", strerror(errno));
+        return -1;
+    }
+
+    p2p_zerocopy_t* zc = (p2p_zerocopy_t*)calloc(1, sizeof(p2p_zerocopy_t));
+    if (!zc) {
+        snprintf(error_buffer, sizeof(error_buffer), "Out of memory");
+        return -1;
+    }
+
+    zc->threshold = threshold;
+    sock->zerocopy = zc;
+    return 0;
+}
+
+int p2p_socket_send_zerocopy(p2p_socket_t* sock, const void* data, size_t len,
+                             p2p_release_fn release, void* ctx) {
+    if (!sock || !data || !release) {
+        snprintf(error_buffer, sizeof(error_buffer), "Invalid parameters");
+        if (release) release(ctx);
+        return -1;
+    }
+
+    p2p_zerocopy_t* zc = sock->zerocopy;
+    if (!zc || len < zc->threshold) {
+        goto copy;
+    }
+
+    // Plass til ny oppføring før vi sender noe (release må alltid kunne registreres)
+    if (zc->num_pending == zc->capacity) {
+        int capacity = zc->capacity ? zc->capacity * 2 : 16;
+        zerocopy_pending_t* grown = (zerocopy_pending_t*)realloc(zc->pending,
+                                                                 capacity * sizeof(zerocopy_pending_t));
+        if (!grown) goto copy;
+        zc->pending = grown;
+        zc->capacity = capacity;
+    }
+
+    zerocopy_pending_t entry = {zc->next_seq, 0, 0, release, ctx};
+    const uint8_t* ptr = (const uint8_t*)data;
+    size_t total = 0;
+    int failed = 0;
+
+    while (total < len) {
+        ssize_t result = send(sock->handle, ptr + total, len - total, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+
+        if (result < 0 && errno == EINTR) continue;
+
+        if (result < 0 && errno == ENOBUFS) {
+            // For mange ventende notifikasjoner (optmem): hent dem og kopier denne biten
+            zerocopy_reap(sock);
+            result = stream_send(sock, ptr + total, len - total);
+            if (result <= 0) {
+                failed = 1;
+                break;
+            }
+        } else if (result <= 0) {
+            snprintf(error_buffer, sizeof(error_buffer),
+                     "send() failed: %s", result < 0 ? strerror(errno) : "no progress");
+            failed = 1;
+            break;
+        } else {
+            zc->next_seq++;
+            entry.calls++;
+            p2p_metric_add(&sock->counters, P2P_METRIC_ZEROCOPY_SENDS, 1);
+        }
+
+        p2p_metric_add(&sock->counters, P2P_METRIC_BYTES_OUT, (uint64_t)result);
+        if ((size_t)result < len - total) {
+            p2p_metric_add(&sock->counters, P2P_METRIC_PARTIAL_WRITES, 1);
+        }
+        total += (size_t)result;
+    }
+
+    if (entry.calls == 0) {
+        release(ctx);
+    } else {
+        entry.outstanding = entry.calls;
+        zc->pending[zc->num_pending++] = entry;
+    }
+
+    // Rydd opp notifikasjoner for tidligere sendinger mens vi er her
+    zerocopy_reap(sock);
+    return failed ? -1 : 0;
+
+copy:
+    {
+        const uint8_t* p = (const uint8_t*)data;
+        size_t sent = 0;
+        while (sent < len) {
+            intptr_t result = p2p_socket_send(sock, p + sent, len - sent);
+            if (result <= 0) break;
+            sent += (size_t)result;
+        }
+        release(ctx);
+        return sent == len ? 0 : -1;
+    }
+}
+
+int p2p_socket_zerocopy_reap(p2p_socket_t* sock) {
+    zerocopy_reap_parked();
+    if (!sock || !sock->zerocopy) return 0;
+    return zerocopy_reap(sock);
+}
+
+#else
+
+int p2p_socket_set_zerocopy(p2p_socket_t* sock, size_t threshold) {
+    (void)sock;
+    if (threshold == 0) return 0;
+    snprintf(error_buffer, sizeof(error_buffer), "MSG_ZEROCOPY not supported on this platform");
+    return -1;
+}
+
+int p2p_socket_send_zerocopy(p2p_socket_t* sock, const void* data, size_t len,
+                             p2p_release_fn release, void* ctx) {
+    const uint8_t* p = (const uint8_t*)data;
+    size_t sent = 0;
+    while (sock && p && sent < len) {
+        intptr_t result = p2p_socket_send(sock, p + sent, len - sent);
+        if (result <= 0) break;
+        sent += (size_t)result;
+    }
+    if (release) release(ctx);
+    return (sock && p && sent == len) ? 0 : -1;
+}
+
+int p2p_socket_zerocopy_reap(p2p_socket_t* sock) {
+    (void)sock;
+    return 0;
+}
+
+#endif
+
+void p2p_socket_close(p2p_socket_t* sock) {
+    if (!sock) return;
+
+#ifdef P2P_HAVE_ZEROCOPY
+    if (sock->zerocopy) {
+        zerocopy_shutdown(sock);
+    }
+#endif
+
+    sock->transport->close(sock);
+    p2p_admission_release(&sock->ticket);
+    p2p_socket_pool_put(sock);
+}
+
+const char* p2p_socket_transport(p2p_socket_t* sock) {
+    return sock ? sock->transport->name : NULL;
+}
+
+// ============================================================================
+// Error handling
+// ============================================================================
+
+const char* p2p_get_error(void) {
+    return error_buffer;
+}
+
+int p2p_socket_get_handle(p2p_socket_t* sock) {
+    if (!sock) return -1;
+    return sock->handle;
+}
+
+// ============================================================================
+// Metrics
+// ============================================================================
+
+p2p_counters_t* p2p_socket_counters(p2p_socket_t* sock) {
+    return sock ? &sock->counters : NULL;
+}
+
+int p2p_socket_metrics(p2p_socket_t* sock, p2p_metrics_t* out) {
+    if (!sock || !out) return -1;
+    p2p_counters_read(&sock->counters, out);
+    return 0;
+}
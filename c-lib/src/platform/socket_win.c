@@ -1,17 +1,8 @@
-#include "p2pnet/socket.h"
+#include "socket_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/**
- * Intern socket struktur (kun synlig i denne filen)
- */
-struct p2p_socket {
-    SOCKET handle;      // Windows socket handle
-    int type;           // SOCK_STREAM eller SOCK_DGRAM
-    int is_listening;   // 1 hvis socket er i listen mode
-};
-
 /**
  * Global error buffer (thread-unsafe, men OK for enkle programmer)
  */
@@ -35,33 +26,104 @@ int p2p_init(void) {
 }
 
 void p2p_cleanup(void) {
+    p2p_socket_pool_drain();
     WSACleanup();
 }
 
+// ============================================================================
+// TCP transport
+// ============================================================================
+
+static intptr_t tcp_send(p2p_socket_t* sock, const void* data, size_t len) {
+    int result = send(sock->handle, (const char*)data, (int)len, 0);
+    p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+    
+    if (result == SOCKET_ERROR) {
+        int err = WSAGetLastError();
+        snprintf(error_buffer, sizeof(error_buffer), 
+                 "send() failed with error: %d", err);
+        return -1;
+    }
+    
+    return result;
+}
+
+static intptr_t tcp_recv(p2p_socket_t* sock, void* buffer, size_t len) {
+    int result = recv(sock->handle, (char*)buffer, (int)len, 0);
+    p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+    
+    if (result == SOCKET_ERROR) {
+        int err = WSAGetLastError();
+        snprintf(error_buffer, sizeof(error_buffer), 
+                 "recv() failed with error: %d", err);
+        return -1;
+    }
+    
+    return result;
+}
+
+static void tcp_close(p2p_socket_t* sock) {
+    if (sock->handle != INVALID_SOCKET) {
+        closesocket(sock->handle);
+    }
+}
+
+static const p2p_transport_t tcp_transport = {"tcp", tcp_send, tcp_recv, tcp_close};
+
 // ============================================================================
 // Socket operasjoner
 // ============================================================================
 
-p2p_socket_t* p2p_socket_create(int type) {
-    // Allokér minne for socket struktur
-    p2p_socket_t* sock = (p2p_socket_t*)malloc(sizeof(p2p_socket_t));
+/**
+ * Ny socket struktur for transport (INVALID_SOCKET hvis ingen handle)
+ */
+static p2p_socket_t* wrap(const p2p_transport_t* transport, SOCKET handle, int type) {
+    p2p_socket_t* sock = p2p_socket_pool_get();
     if (!sock) {
         snprintf(error_buffer, sizeof(error_buffer), "Out of memory");
         return NULL;
     }
     
+    sock->handle = handle;
+    sock->type = type;
+    sock->is_listening = 0;
+    sock->is_nonblocking = 0;
+    sock->transport = transport;
+    sock->transport_data = NULL;
+    sock->zerocopy = NULL;
+    p2p_counters_init(&sock->counters);
+    sock->ticket.admission = NULL;
+    
+    return sock;
+}
+
+p2p_socket_t* p2p_socket_wrap_transport(const p2p_transport_t* transport, void* data) {
+    p2p_socket_t* sock = wrap(transport, INVALID_SOCKET, SOCK_STREAM);
+    if (sock) {
+        sock->transport_data = data;
+    }
+    return sock;
+}
+
+void p2p_socket_set_error(const char* message) {
+    snprintf(error_buffer, sizeof(error_buffer), "%s", message);
+}
+
+p2p_socket_t* p2p_socket_create(int type) {
     // Opprett Windows socket
-    sock->handle = socket(AF_INET, type, 0);
-    if (sock->handle == INVALID_SOCKET) {
+    SOCKET handle = socket(AF_INET, type, 0);
+    if (handle == INVALID_SOCKET) {
         int err = WSAGetLastError();
         snprintf(error_buffer, sizeof(error_buffer), 
                  "socket() failed with error: %d", err);
-        free(sock);
         return NULL;
     }
     
-    sock->type = type;
-    sock->is_listening = 0;
+    p2p_socket_t* sock = wrap(&tcp_transport, handle, type);
+    if (!sock) {
+        closesocket(handle);
+        return NULL;
+    }
     
     return sock;
 }
@@ -136,20 +198,90 @@ p2p_socket_t* p2p_socket_accept(p2p_socket_t* sock) {
     }
     
     // Opprett ny socket struktur for klienten
-    p2p_socket_t* client_sock = (p2p_socket_t*)malloc(sizeof(p2p_socket_t));
+    p2p_socket_t* client_sock = wrap(sock->transport, client_handle, sock->type);
     if (!client_sock) {
         closesocket(client_handle);
-        snprintf(error_buffer, sizeof(error_buffer), "Out of memory");
         return NULL;
     }
     
-    client_sock->handle = client_handle;
-    client_sock->type = sock->type;
-    client_sock->is_listening = 0;
-    
     return client_sock;
 }
 
+/**
+ * Lukker en avvist tilkobling med RST (ingen TIME_WAIT på serveren)
+ */
+static void reject_connection(SOCKET handle) {
+    struct linger abort_close = {1, 0};
+    setsockopt(handle, SOL_SOCKET, SO_LINGER, (const char*)&abort_close, sizeof(abort_close));
+    closesocket(handle);
+}
+
+int p2p_socket_accept_batch(p2p_socket_t* sock, p2p_socket_t** out, int max,
+                            p2p_admission_t* admission, int flags) {
+    if (!sock || !sock->is_listening || !out || max <= 0) {
+        snprintf(error_buffer, sizeof(error_buffer), 
+                 "Socket is not in listening mode");
+        return -1;
+    }
+    if (!sock->is_nonblocking) {
+        snprintf(error_buffer, sizeof(error_buffer), 
+                 "Listener must be non-blocking");
+        return -1;
+    }
+    
+    // Høyst max forsøk: avviste og avbrutte tilkoblinger teller også, så en
+    // flom av dem ikke holder tråden her
+    int count = 0;
+    for (int attempt = 0; attempt < max; attempt++) {
+        struct sockaddr_storage client_addr;
+        int addr_len = sizeof(client_addr);
+        
+        // Winsock har ingen accept4: handles arves ikke av barneprosesser uansett
+        SOCKET client_handle = accept(sock->handle, (struct sockaddr*)&client_addr, &addr_len);
+        p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+        
+        if (client_handle == INVALID_SOCKET) {
+            int err = WSAGetLastError();
+            if (err == WSAEWOULDBLOCK) {
+                break;                              // Køen er tom
+            }
+            if (err == WSAECONNRESET) {
+                continue;                           // Peer ga opp før vi rakk den
+            }
+            snprintf(error_buffer, sizeof(error_buffer), 
+                     "accept() failed with error: %d", err);
+            return count > 0 ? count : -1;
+        }
+        
+        // Aksepterte sockets arver non-blocking fra listeneren, sett modus fra flags
+        u_long mode = (flags & P2P_ACCEPT_NONBLOCK) ? 1 : 0;
+        ioctlsocket(client_handle, FIONBIO, &mode);
+        
+        p2p_admission_ticket_t ticket;
+        if (admission &&
+            p2p_admission_admit(admission, (struct sockaddr*)&client_addr, &ticket) != 0) {
+            reject_connection(client_handle);
+            p2p_metric_add(&sock->counters, P2P_METRIC_ACCEPT_REJECTS, 1);
+            continue;
+        }
+        
+        p2p_socket_t* client_sock = wrap(sock->transport, client_handle, sock->type);
+        if (!client_sock) {
+            if (admission) p2p_admission_release(&ticket);
+            closesocket(client_handle);
+            return count > 0 ? count : -1;
+        }
+        if (admission) {
+            client_sock->ticket = ticket;
+        }
+        client_sock->is_nonblocking = (int)mode;
+        
+        out[count++] = client_sock;
+    }
+    
+    return count;
+}
+
 int p2p_socket_connect(p2p_socket_t* sock, const char* ip, uint16_t port) {
     if (!sock) {
         snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
@@ -180,6 +312,42 @@ int p2p_socket_connect(p2p_socket_t* sock, const char* ip, uint16_t port) {
     return 0;
 }
 
+// ============================================================================
+// Unix domain sockets (ikke støttet i denne porten)
+// ============================================================================
+
+p2p_socket_t* p2p_socket_create_unix(void) {
+    snprintf(error_buffer, sizeof(error_buffer), "AF_UNIX not supported on Windows");
+    return NULL;
+}
+
+int p2p_socket_bind_unix(p2p_socket_t* sock, const char* path) {
+    (void)sock;
+    (void)path;
+    snprintf(error_buffer, sizeof(error_buffer), "AF_UNIX not supported on Windows");
+    return -1;
+}
+
+int p2p_socket_connect_unix(p2p_socket_t* sock, const char* path) {
+    (void)sock;
+    (void)path;
+    snprintf(error_buffer, sizeof(error_buffer), "AF_UNIX not supported on Windows");
+    return -1;
+}
+
+int p2p_socket_send_socket(p2p_socket_t* channel, p2p_socket_t* sock) {
+    (void)channel;
+    (void)sock;
+    snprintf(error_buffer, sizeof(error_buffer), "Socket passing not supported on Windows");
+    return -1;
+}
+
+p2p_socket_t* p2p_socket_recv_socket(p2p_socket_t* channel) {
+    (void)channel;
+    snprintf(error_buffer, sizeof(error_buffer), "Socket passing not supported on Windows");
+    return NULL;
+}
+
 int p2p_socket_set_nonblocking(p2p_socket_t* sock, int enabled) {
     if (!sock) {
         snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
@@ -194,24 +362,100 @@ int p2p_socket_set_nonblocking(p2p_socket_t* sock, int enabled) {
         return -1;
     }
     
+    sock->is_nonblocking = enabled ? 1 : 0;
     return 0;
 }
 
-ssize_t p2p_socket_send(p2p_socket_t* sock, const void* data, size_t len) {
+int p2p_socket_set_nodelay(p2p_socket_t* sock, int enabled) {
     if (!sock) {
         snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
         return -1;
     }
     
-    int result = send(sock->handle, (const char*)data, (int)len, 0);
-    
-    if (result == SOCKET_ERROR) {
+    BOOL value = enabled ? TRUE : FALSE;
+    if (setsockopt(sock->handle, IPPROTO_TCP, TCP_NODELAY,
+                   (const char*)&value, sizeof(value)) == SOCKET_ERROR) {
         int err = WSAGetLastError();
         snprintf(error_buffer, sizeof(error_buffer), 
-                 "send() failed with error: %d", err);
+                 "setsockopt(TCP_NODELAY) failed with error: %d", err);
+        return -1;
+    }
+    
+    return 0;
+}
+
+int p2p_socket_set_busy_poll(p2p_socket_t* sock, int usec) {
+    (void)usec;
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+    
+    // Winsock har ingen tilsvarende socket-opsjon
+    snprintf(error_buffer, sizeof(error_buffer), "SO_BUSY_POLL not supported on Windows");
+    return -1;
+}
+
+int p2p_socket_pair(p2p_socket_t** a, p2p_socket_t** b) {
+    if (!a || !b) {
+        snprintf(error_buffer, sizeof(error_buffer), "Output is NULL");
+        return -1;
+    }
+    *a = *b = NULL;
+    
+    // Ingen socketpair() i Winsock: koble til en midlertidig listener
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    if (!listener ||
+        p2p_socket_bind(listener, "127.0.0.1", 0) != 0 ||
+        p2p_socket_listen(listener, 1) != 0) {
+        p2p_socket_close(listener);
         return -1;
     }
     
+    struct sockaddr_in addr;
+    int addr_len = sizeof(addr);
+    if (getsockname(listener->handle, (struct sockaddr*)&addr, &addr_len) == SOCKET_ERROR) {
+        snprintf(error_buffer, sizeof(error_buffer),
+                 "getsockname() failed with error: %d", WSAGetLastError());
+        p2p_socket_close(listener);
+        return -1;
+    }
+    
+    *a = p2p_socket_create(P2P_TCP);
+    if (!*a || p2p_socket_connect(*a, "127.0.0.1", ntohs(addr.sin_port)) != 0) {
+        p2p_socket_close(*a);
+        p2p_socket_close(listener);
+        *a = NULL;
+        return -1;
+    }
+    
+    *b = p2p_socket_accept(listener);
+    p2p_socket_close(listener);
+    if (!*b) {
+        p2p_socket_close(*a);
+        *a = NULL;
+        return -1;
+    }
+    
+    return 0;
+}
+
+ssize_t p2p_socket_send(p2p_socket_t* sock, const void* data, size_t len) {
+    if (!sock) {
+        snprintf(error_buffer, sizeof(error_buffer), "Socket is NULL");
+        return -1;
+    }
+    
+    intptr_t result = sock->transport->send(sock, data, len);
+    if (result < 0) {
+        return -1;
+    }
+    
+    p2p_metric_add(&sock->counters, P2P_METRIC_BYTES_OUT, (uint64_t)result);
+    if ((size_t)result < len) {
+        p2p_metric_add(&sock->counters, P2P_METRIC_PARTIAL_WRITES, 1);
+    }
+    
     return result;
 }
 
@@ -221,26 +465,58 @@ ssize_t p2p_socket_recv(p2p_socket_t* sock, void* buffer, size_t len) {
         return -1;
     }
     
-    int result = recv(sock->handle, (char*)buffer, (int)len, 0);
-    
-    if (result == SOCKET_ERROR) {
-        int err = WSAGetLastError();
-        snprintf(error_buffer, sizeof(error_buffer), 
-                 "recv() failed with error: %d", err);
+    intptr_t result = sock->transport->recv(sock, buffer, len);
+    if (result < 0) {
         return -1;
     }
     
+    p2p_metric_add(&sock->counters, P2P_METRIC_BYTES_IN, (uint64_t)result);
+    if (result > 0 && (size_t)result < len) {
+        p2p_metric_add(&sock->counters, P2P_METRIC_PARTIAL_READS, 1);
+    }
+    
     return result;
 }
 
+// ============================================================================
+// Zero-copy send (ikke støttet i Winsock - alltid kopi)
+// ============================================================================
+
+int p2p_socket_set_zerocopy(p2p_socket_t* sock, size_t threshold) {
+    (void)sock;
+    if (threshold == 0) return 0;
+    snprintf(error_buffer, sizeof(error_buffer), "MSG_ZEROCOPY not supported on Windows");
+    return -1;
+}
+
+int p2p_socket_send_zerocopy(p2p_socket_t* sock, const void* data, size_t len,
+                             p2p_release_fn release, void* ctx) {
+    const uint8_t* p = (const uint8_t*)data;
+    size_t sent = 0;
+    while (sock && p && sent < len) {
+        ssize_t result = p2p_socket_send(sock, p + sent, len - sent);
+        if (result <= 0) break;
+        sent += (size_t)result;
+    }
+    if (release) release(ctx);
+    return (sock && p && sent == len) ? 0 : -1;
+}
+
+int p2p_socket_zerocopy_reap(p2p_socket_t* sock) {
+    (void)sock;
+    return 0;
+}
+
 void p2p_socket_close(p2p_socket_t* sock) {
     if (!sock) return;
     
-    if (sock->handle != INVALID_SOCKET) {
-        closesocket(sock->handle);
-    }
-    
-    free(sock);
+    sock->transport->close(sock);
+    p2p_admission_release(&sock->ticket);
+    p2p_socket_pool_put(sock);
+}
+
+const char* p2p_socket_transport(p2p_socket_t* sock) {
+    return sock ? sock->transport->name : NULL;
 }
 
 // ============================================================================
@@ -254,4 +530,18 @@ const char* p2p_get_error(void) {
 SOCKET p2p_socket_get_handle(p2p_socket_t* sock) {
     if (!sock) return INVALID_SOCKET;
     return sock->handle;
+}
+
+// ============================================================================
+// Metrics
+// ============================================================================
+
+p2p_counters_t* p2p_socket_counters(p2p_socket_t* sock) {
+    return sock ? &sock->counters : NULL;
+}
+
+int p2p_socket_metrics(p2p_socket_t* sock, p2p_metrics_t* out) {
+    if (!sock || !out) return -1;
+    p2p_counters_read(&sock->counters, out);
+    return 0;
 }
\ No newline at end of file
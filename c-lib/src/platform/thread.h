@@ -0,0 +1,206 @@
+#ifndef P2PNET_PLATFORM_THREAD_H
+#define P2PNET_PLATFORM_THREAD_H
+
+/**
+ * Intern tråd-abstraksjon (ikke del av public API)
+ *
+ * Tynne wrappers rundt Win32 threads / SRWLOCK / CONDITION_VARIABLE
+ * og pthreads, slik at biblioteket kan bruke bakgrunnstråder uten
+ * #ifdef i hver fil.
+ */
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>
+
+    typedef HANDLE p2p_thread_t;
+    typedef SRWLOCK p2p_mutex_t;
+    typedef CONDITION_VARIABLE p2p_cond_t;
+
+    #define P2P_THREAD_FUNC(name) unsigned __stdcall name(void* arg)
+    #define P2P_THREAD_EXIT return 0
+    #define P2P_MUTEX_INITIALIZER SRWLOCK_INIT
+#else
+    #include <pthread.h>
+    #include <time.h>
+
+    typedef pthread_t p2p_thread_t;
+    typedef pthread_mutex_t p2p_mutex_t;
+    typedef pthread_cond_t p2p_cond_t;
+
+    #define P2P_THREAD_FUNC(name) void* name(void* arg)
+    #define P2P_THREAD_EXIT return NULL
+    #define P2P_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+#ifdef _WIN32
+    typedef unsigned (__stdcall *p2p_thread_func)(void*);
+#else
+    typedef void* (*p2p_thread_func)(void*);
+#endif
+
+// Tråd-lokal lagring
+#if defined(_MSC_VER)
+    #define P2P_THREAD_LOCAL __declspec(thread)
+#else
+    #define P2P_THREAD_LOCAL _Thread_local
+#endif
+
+// ============================================================================
+// Threads
+// ============================================================================
+
+static inline int p2p_thread_start(p2p_thread_t* thread, p2p_thread_func fn, void* arg) {
+#ifdef _WIN32
+    *thread = (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    return *thread ? 0 : -1;
+#else
+    return pthread_create(thread, NULL, fn, arg) == 0 ? 0 : -1;
+#endif
+}
+
+static inline void p2p_thread_join(p2p_thread_t thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+static inline void p2p_thread_sleep_ms(unsigned int ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// ============================================================================
+// Mutex
+// ============================================================================
+
+static inline void p2p_mutex_init(p2p_mutex_t* mutex) {
+#ifdef _WIN32
+    InitializeSRWLock(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+static inline void p2p_mutex_destroy(p2p_mutex_t* mutex) {
+#ifdef _WIN32
+    (void)mutex;  // SRWLOCK trenger ingen cleanup
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+static inline void p2p_mutex_lock(p2p_mutex_t* mutex) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+static inline int p2p_mutex_trylock(p2p_mutex_t* mutex) {
+#ifdef _WIN32
+    return TryAcquireSRWLockExclusive(mutex) ? 0 : -1;
+#else
+    return pthread_mutex_trylock(mutex) == 0 ? 0 : -1;
+#endif
+}
+
+static inline void p2p_mutex_unlock(p2p_mutex_t* mutex) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+// ============================================================================
+// Condition variables
+// ============================================================================
+
+static inline void p2p_cond_init(p2p_cond_t* cond) {
+#ifdef _WIN32
+    InitializeConditionVariable(cond);
+#else
+    pthread_cond_init(cond, NULL);
+#endif
+}
+
+static inline void p2p_cond_destroy(p2p_cond_t* cond) {
+#ifdef _WIN32
+    (void)cond;
+#else
+    pthread_cond_destroy(cond);
+#endif
+}
+
+static inline void p2p_cond_wait(p2p_cond_t* cond, p2p_mutex_t* mutex) {
+#ifdef _WIN32
+    SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif
+}
+
+static inline void p2p_cond_signal(p2p_cond_t* cond) {
+#ifdef _WIN32
+    WakeConditionVariable(cond);
+#else
+    pthread_cond_signal(cond);
+#endif
+}
+
+static inline void p2p_cond_broadcast(p2p_cond_t* cond) {
+#ifdef _WIN32
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
+
+// ============================================================================
+// Thread exit callbacks
+// ============================================================================
+
+/**
+ * Nøkkel med destruktor: p2p_tls_set() gir en verdi per tråd, og
+ * destruktoren kalles med den verdien på tråden selv når den avslutter
+ * (ikke for NULL-verdier). Destruktoren deklareres med P2P_TLS_DESTRUCTOR.
+ */
+#ifdef _WIN32
+    typedef DWORD p2p_tls_key_t;
+    #define P2P_TLS_DESTRUCTOR(name) void NTAPI name(void* value)
+    typedef void (NTAPI *p2p_tls_destructor)(void*);
+#else
+    typedef pthread_key_t p2p_tls_key_t;
+    #define P2P_TLS_DESTRUCTOR(name) void name(void* value)
+    typedef void (*p2p_tls_destructor)(void*);
+#endif
+
+static inline int p2p_tls_key_create(p2p_tls_key_t* key, p2p_tls_destructor destructor) {
+#ifdef _WIN32
+    *key = FlsAlloc(destructor);
+    return *key == FLS_OUT_OF_INDEXES ? -1 : 0;
+#else
+    return pthread_key_create(key, destructor) == 0 ? 0 : -1;
+#endif
+}
+
+static inline int p2p_tls_set(p2p_tls_key_t key, void* value) {
+#ifdef _WIN32
+    return FlsSetValue(key, value) ? 0 : -1;
+#else
+    return pthread_setspecific(key, value) == 0 ? 0 : -1;
+#endif
+}
+
+#endif /* P2PNET_PLATFORM_THREAD_H */
@@ -0,0 +1,223 @@
+#include "socket_internal.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * In-memory transport
+ *
+ * Two sockets share a link with one byte ring per direction. Semantics
+ * match a blocking stream socket: send blocks while the ring is full and
+ * may write less than asked, recv blocks while it is empty and returns 0
+ * once the peer has closed and the ring is drained. No syscalls, no fds,
+ * so it does not work with the event loop.
+ */
+
+#define DEFAULT_CAPACITY (256 * 1024)
+
+typedef struct {
+    uint8_t* data;
+    size_t capacity;        // Power of two
+    size_t read_pos;        // Monotonic, masked on access
+    size_t write_pos;
+} ring_t;
+
+typedef struct {
+    p2p_mutex_t lock;
+    p2p_cond_t changed;     // Data written, space freed or an end closed
+    ring_t rings[2];        // rings[side] is written by side, read by 1 - side
+    int closed[2];
+    int refs;
+} memory_link_t;
+
+typedef struct {
+    memory_link_t* link;
+    int side;
+} memory_end_t;
+
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 64;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+/**
+ * Copy up to len bytes into ring, return bytes copied
+ */
+static size_t ring_write(ring_t* ring, const uint8_t* data, size_t len) {
+    size_t space = ring->capacity - (ring->write_pos - ring->read_pos);
+    if (len > space) len = space;
+
+    size_t offset = ring->write_pos & (ring->capacity - 1);
+    size_t first = ring->capacity - offset;
+    if (first > len) first = len;
+
+    memcpy(ring->data + offset, data, first);
+    memcpy(ring->data, data + first, len - first);
+    ring->write_pos += len;
+    return len;
+}
+
+/**
+ * Copy up to len bytes out of ring, return bytes copied
+ */
+static size_t ring_read(ring_t* ring, uint8_t* buffer, size_t len) {
+    size_t used = ring->write_pos - ring->read_pos;
+    if (len > used) len = used;
+
+    size_t offset = ring->read_pos & (ring->capacity - 1);
+    size_t first = ring->capacity - offset;
+    if (first > len) first = len;
+
+    memcpy(buffer, ring->data + offset, first);
+    memcpy(buffer + first, ring->data, len - first);
+    ring->read_pos += len;
+    return len;
+}
+
+static void link_release(memory_link_t* link) {
+    p2p_mutex_lock(&link->lock);
+    int last = --link->refs == 0;
+    p2p_mutex_unlock(&link->lock);
+
+    if (!last) return;
+
+    p2p_cond_destroy(&link->changed);
+    p2p_mutex_destroy(&link->lock);
+    free(link->rings[0].data);
+    free(link->rings[1].data);
+    free(link);
+}
+
+// ============================================================================
+// Transport
+// ============================================================================
+
+static intptr_t memory_send(p2p_socket_t* sock, const void* data, size_t len) {
+    memory_end_t* end = (memory_end_t*)sock->transport_data;
+    memory_link_t* link = end->link;
+    ring_t* ring = &link->rings[end->side];
+
+    p2p_mutex_lock(&link->lock);
+
+    size_t written = 0;
+    while (!link->closed[1 - end->side] &&
+           (written = ring_write(ring, (const uint8_t*)data, len)) == 0 && len > 0) {
+        p2p_cond_wait(&link->changed, &link->lock);
+    }
+    int peer_closed = link->closed[1 - end->side];
+
+    p2p_mutex_unlock(&link->lock);
+
+    if (peer_closed) {
+        p2p_socket_set_error("send() failed: peer closed");
+        return -1;
+    }
+
+    p2p_cond_broadcast(&link->changed);
+    return (intptr_t)written;
+}
+
+static intptr_t memory_recv(p2p_socket_t* sock, void* buffer, size_t len) {
+    memory_end_t* end = (memory_end_t*)sock->transport_data;
+    memory_link_t* link = end->link;
+    ring_t* ring = &link->rings[1 - end->side];
+
+    p2p_mutex_lock(&link->lock);
+
+    size_t received = 0;
+    while ((received = ring_read(ring, (uint8_t*)buffer, len)) == 0 && len > 0 &&
+           !link->closed[1 - end->side]) {
+        p2p_cond_wait(&link->changed, &link->lock);
+    }
+
+    p2p_mutex_unlock(&link->lock);
+
+    // 0 = peer closed and ring drained (orderly shutdown)
+    if (received > 0) {
+        p2p_cond_broadcast(&link->changed);
+    }
+    return (intptr_t)received;
+}
+
+/**
+ * Mark side closed (wakes the peer) and drop its link reference
+ */
+static void end_close(memory_end_t* end) {
+    p2p_mutex_lock(&end->link->lock);
+    end->link->closed[end->side] = 1;
+    p2p_mutex_unlock(&end->link->lock);
+    p2p_cond_broadcast(&end->link->changed);
+
+    link_release(end->link);
+    free(end);
+}
+
+static void memory_close(p2p_socket_t* sock) {
+    end_close((memory_end_t*)sock->transport_data);
+}
+
+static const p2p_transport_t memory_transport = {"memory", memory_send, memory_recv, memory_close};
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int p2p_socket_pair_memory(p2p_socket_t** a, p2p_socket_t** b, size_t capacity) {
+    if (!a || !b) {
+        p2p_socket_set_error("Output is NULL");
+        return -1;
+    }
+    *a = *b = NULL;
+
+    capacity = round_up_pow2(capacity ? capacity : DEFAULT_CAPACITY);
+
+    memory_link_t* link = (memory_link_t*)calloc(1, sizeof(memory_link_t));
+    memory_end_t* ends[2] = {
+        (memory_end_t*)malloc(sizeof(memory_end_t)),
+        (memory_end_t*)malloc(sizeof(memory_end_t)),
+    };
+    if (link) {
+        link->rings[0].data = (uint8_t*)malloc(capacity);
+        link->rings[1].data = (uint8_t*)malloc(capacity);
+    }
+
+    if (!link || !ends[0] || !ends[1] || !link->rings[0].data || !link->rings[1].data) {
+        if (link) {
+            free(link->rings[0].data);
+            free(link->rings[1].data);
+        }
+        free(link);
+        free(ends[0]);
+        free(ends[1]);
+        p2p_socket_set_error("Out of memory");
+        return -1;
+    }
+
+    p2p_mutex_init(&link->lock);
+    p2p_cond_init(&link->changed);
+    link->rings[0].capacity = capacity;
+    link->rings[1].capacity = capacity;
+    link->refs = 2;
+
+    for (int side = 0; side < 2; side++) {
+        ends[side]->link = link;
+        ends[side]->side = side;
+    }
+
+    *a = p2p_socket_wrap_transport(&memory_transport, ends[0]);
+    *b = p2p_socket_wrap_transport(&memory_transport, ends[1]);
+    if (!*a || !*b) {
+        // Closing a wrapped end releases its share of the link
+        if (*a) p2p_socket_close(*a); else end_close(ends[0]);
+        if (*b) p2p_socket_close(*b); else end_close(ends[1]);
+        *a = *b = NULL;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,549 @@
+#include "socket_internal.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Shared-memory transport (Linux)
+ *
+ * Same-host peers can move a connected TCP socket onto two single-producer
+ * single-consumer byte rings in a shared mapping. The data path is then
+ * memcpy + atomic index updates; the kernel is entered only to wake a peer
+ * that went to sleep:
+ *
+ *   - the consumer spins briefly on an empty ring (only with more than one
+ *     online CPU, otherwise spinning just delays the peer), then raises `waiting`
+ *     and sleeps on a futex; the producer only calls FUTEX_WAKE when it
+ *     sees `waiting` set after publishing data
+ *   - a producer facing a full ring does the same on the space futex
+ *
+ * The original fd stays open and carries no data after the upgrade. A
+ * sleeper wakes up periodically and polls it, so a peer that died without
+ * closing the ring is detected as EOF.
+ *
+ * The upgrade runs before the handshake, so the peer is not authenticated
+ * and everything in the mapping is peer-writable. Each end keeps its own
+ * copy of the capacity (validated once) and of the index it owns, and
+ * only reads the peer's index from shared memory. A peer index that puts
+ * more than `capacity` bytes in flight breaks the link (-1 from then on).
+ *
+ * Negotiation (both ends call p2p_socket_upgrade_local() at the same point,
+ * typically right after connect/accept and before the handshake):
+ *
+ *   initiator -> acceptor   64 bytes: "P2PSHM1\0" + shm name (empty = no offer)
+ *   acceptor  -> initiator  1 byte:   1 = mapped, 0 = declined
+ *
+ * The exchange always happens on a connected stream socket. Each end only
+ * sees its own side of a port-forward, proxy or NAT hairpin, so the
+ * locality check decides what is in the offer and the reply (empty name,
+ * decline), never whether they are sent.
+ */
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHM_MAGIC 0x31534850u          // "PHS1"
+#define SHM_RING_CAPACITY (256 * 1024)
+#define SHM_SPIN_LIMIT 2048            // Empty/full polls before sleeping (multi-core only)
+#define SHM_LIVENESS_MS 50
+#define OFFER_SIZE 64
+#define OFFER_PREFIX "P2PSHM1"
+
+// Test hook: treat every peer as remote (this thread only)
+_Thread_local int p2p_shm_assume_remote = 0;
+
+#define CACHE_LINE 64
+
+/**
+ * One direction. Indexes are monotonic and masked on access; the producer
+ * owns write_pos, the consumer owns read_pos. Each lives on its own cache
+ * line so the two processes do not false-share.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic uint64_t write_pos;
+    _Atomic uint32_t data_seq;          // Futex: bumped when waking the consumer
+    _Atomic uint32_t consumer_waiting;
+    _Atomic uint32_t closed;            // Producer side closed
+
+    _Alignas(CACHE_LINE) _Atomic uint64_t read_pos;
+    _Atomic uint32_t space_seq;         // Futex: bumped when waking the producer
+    _Atomic uint32_t producer_waiting;
+    _Atomic uint32_t reader_closed;     // Consumer side closed
+} shm_ring_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t capacity;
+    shm_ring_t rings[2];                // rings[0]: initiator -> acceptor
+} shm_header_t;
+
+typedef struct {
+    shm_header_t* header;
+    size_t map_size;
+    uint8_t* data[2];
+    uint64_t capacity;                  // Validated copy, never re-read from the mapping
+    uint64_t write_pos;                 // Own copy of rings[side].write_pos
+    uint64_t read_pos;                  // Own copy of rings[1 - side].read_pos
+    int side;                           // 0 = initiator, 1 = acceptor
+    int spin_limit;
+    int broken;                         // Peer corrupted the rings
+} shm_end_t;
+
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+static long futex_wait(_Atomic uint32_t* word, uint32_t expected, int timeout_ms) {
+    struct timespec ts = {timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L};
+    return syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, &ts, NULL, 0);
+}
+
+static void futex_wake(_Atomic uint32_t* word) {
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/**
+ * Peer process still has the original connection open?
+ */
+static int peer_alive(p2p_socket_t* sock) {
+    struct pollfd pfd = {sock->handle, POLLIN | POLLRDHUP, 0};
+    p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+    return poll(&pfd, 1, 0) == 0;
+}
+
+static size_t shm_map_size(uint32_t capacity) {
+    return sizeof(shm_header_t) + 2 * (size_t)capacity;
+}
+
+static void shm_end_attach(shm_end_t* end, shm_header_t* header, size_t map_size,
+                           uint32_t capacity, int side) {
+    end->header = header;
+    end->map_size = map_size;
+    end->capacity = capacity;
+    end->data[0] = (uint8_t*)(header + 1);
+    end->data[1] = end->data[0] + capacity;
+    end->side = side;
+    end->spin_limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHM_SPIN_LIMIT : 1;
+    end->broken = 0;
+
+    // Both rings start at 0 (segment_create zero-fills)
+    end->write_pos = 0;
+    end->read_pos = 0;
+}
+
+/**
+ * Peer index out of range: stop using the rings for good
+ */
+static intptr_t shm_broken(shm_end_t* end) {
+    end->broken = 1;
+    p2p_socket_set_error("Shared-memory ring corrupted by peer");
+    return -1;
+}
+
+static int write_full(int fd, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void* buffer, size_t len) {
+    uint8_t* p = (uint8_t*)buffer;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Peer on the same host, as seen from this end (the other end may disagree)
+ */
+static int peer_is_local(int fd) {
+    struct sockaddr_storage local, peer;
+    socklen_t local_len = sizeof(local), peer_len = sizeof(peer);
+    if (getsockname(fd, (struct sockaddr*)&local, &local_len) != 0 ||
+        getpeername(fd, (struct sockaddr*)&peer, &peer_len) != 0) {
+        return 0;
+    }
+
+    if (peer.ss_family == AF_UNIX) return 1;
+    if (peer.ss_family != AF_INET || local.ss_family != AF_INET) return 0;
+
+    uint32_t peer_ip = ntohl(((struct sockaddr_in*)&peer)->sin_addr.s_addr);
+    uint32_t local_ip = ntohl(((struct sockaddr_in*)&local)->sin_addr.s_addr);
+    return (peer_ip >> 24) == 127 || peer_ip == local_ip;
+}
+
+/**
+ * Create and map a fresh segment, name written to `name`
+ */
+static shm_header_t* segment_create(char* name, size_t name_size) {
+    static _Atomic uint32_t counter;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    snprintf(name, name_size, "/p2pnet-%d-%lx-%u", (int)getpid(),
+             (unsigned long)now.tv_nsec, atomic_fetch_add(&counter, 1));
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return NULL;
+
+    size_t size = shm_map_size(SHM_RING_CAPACITY);
+    void* map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0) {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    // ftruncate zero-fills, so the rings start empty and open
+    shm_header_t* header = (shm_header_t*)map;
+    header->magic = SHM_MAGIC;
+    header->capacity = SHM_RING_CAPACITY;
+    return header;
+}
+
+/**
+ * Map a segment created by the peer, validate its layout
+ */
+static shm_header_t* segment_open(const char* name, size_t* map_size, uint32_t* capacity_out) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(shm_header_t)) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    shm_header_t* header = (shm_header_t*)map;
+    // One read: the peer can change the header at any time after this
+    uint32_t capacity = *(volatile uint32_t*)&header->capacity;
+    if (header->magic != SHM_MAGIC || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+        shm_map_size(capacity) != (size_t)st.st_size) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    *map_size = (size_t)st.st_size;
+    *capacity_out = capacity;
+    return header;
+}
+
+// ============================================================================
+// Transport
+// ============================================================================
+
+static intptr_t shm_send(p2p_socket_t* sock, const void* data, size_t len) {
+    shm_end_t* end = (shm_end_t*)sock->transport_data;
+    shm_ring_t* ring = &end->header->rings[end->side];
+    uint8_t* buf = end->data[end->side];
+    uint64_t capacity = end->capacity;
+
+    if (end->broken) return shm_broken(end);
+    if (len == 0) return 0;
+
+    uint64_t write_pos = end->write_pos;
+    uint64_t space;
+    int spins = 0;
+
+    for (;;) {
+        if (atomic_load_explicit(&ring->reader_closed, memory_order_acquire)) {
+            p2p_socket_set_error("send() failed: peer closed");
+            return -1;
+        }
+
+        uint64_t in_flight = write_pos - atomic_load_explicit(&ring->read_pos, memory_order_acquire);
+        if (in_flight > capacity) return shm_broken(end);
+
+        space = capacity - in_flight;
+        if (space > 0) break;
+
+        if (++spins < end->spin_limit) continue;
+
+        // Ring full: sleep until the consumer frees space
+        uint32_t seq = atomic_load(&ring->space_seq);
+        atomic_store(&ring->producer_waiting, 1);
+        if (write_pos - atomic_load(&ring->read_pos) == capacity &&
+            !atomic_load(&ring->reader_closed)) {
+            p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+            if (futex_wait(&ring->space_seq, seq, SHM_LIVENESS_MS) < 0 && errno == ETIMEDOUT &&
+                !peer_alive(sock)) {
+                atomic_store(&ring->producer_waiting, 0);
+                p2p_socket_set_error("send() failed: peer gone");
+                return -1;
+            }
+        }
+        atomic_store(&ring->producer_waiting, 0);
+        spins = 0;
+    }
+
+    if (len > space) len = (size_t)space;
+
+    size_t offset = (size_t)(write_pos & (capacity - 1));
+    size_t first = (size_t)capacity - offset;
+    if (first > len) first = len;
+    memcpy(buf + offset, data, first);
+    memcpy(buf, (const uint8_t*)data + first, len - first);
+
+    end->write_pos = write_pos + len;
+    atomic_store_explicit(&ring->write_pos, end->write_pos, memory_order_release);
+
+    // Pairs with the consumer's store to consumer_waiting before it re-checks
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->consumer_waiting, memory_order_relaxed)) {
+        atomic_fetch_add(&ring->data_seq, 1);
+        futex_wake(&ring->data_seq);
+        p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+    }
+
+    return (intptr_t)len;
+}
+
+static intptr_t shm_recv(p2p_socket_t* sock, void* buffer, size_t len) {
+    shm_end_t* end = (shm_end_t*)sock->transport_data;
+    int from = 1 - end->side;
+    shm_ring_t* ring = &end->header->rings[from];
+    const uint8_t* buf = end->data[from];
+    uint64_t capacity = end->capacity;
+
+    if (end->broken) return shm_broken(end);
+    if (len == 0) return 0;
+
+    uint64_t read_pos = end->read_pos;
+    uint64_t used;
+    int spins = 0;
+
+    for (;;) {
+        used = atomic_load_explicit(&ring->write_pos, memory_order_acquire) - read_pos;
+        if (used > capacity) return shm_broken(end);
+        if (used > 0) break;
+
+        // Drained and the producer is gone: orderly shutdown
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire)) return 0;
+
+        if (++spins < end->spin_limit) continue;
+
+        // Ring empty: sleep until the producer publishes data
+        uint32_t seq = atomic_load(&ring->data_seq);
+        atomic_store(&ring->consumer_waiting, 1);
+        if (atomic_load(&ring->write_pos) == read_pos && !atomic_load(&ring->closed)) {
+            p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+            if (futex_wait(&ring->data_seq, seq, SHM_LIVENESS_MS) < 0 && errno == ETIMEDOUT &&
+                !peer_alive(sock)) {
+                atomic_store(&ring->consumer_waiting, 0);
+                return 0;
+            }
+        }
+        atomic_store(&ring->consumer_waiting, 0);
+        spins = 0;
+    }
+
+    if (len > used) len = (size_t)used;
+
+    size_t offset = (size_t)(read_pos & (capacity - 1));
+    size_t first = (size_t)capacity - offset;
+    if (first > len) first = len;
+    memcpy(buffer, buf + offset, first);
+    memcpy((uint8_t*)buffer + first, buf, len - first);
+
+    end->read_pos = read_pos + len;
+    atomic_store_explicit(&ring->read_pos, end->read_pos, memory_order_release);
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->producer_waiting, memory_order_relaxed)) {
+        atomic_fetch_add(&ring->space_seq, 1);
+        futex_wake(&ring->space_seq);
+        p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 1);
+    }
+
+    return (intptr_t)len;
+}
+
+static void shm_close(p2p_socket_t* sock) {
+    shm_end_t* end = (shm_end_t*)sock->transport_data;
+    shm_ring_t* out = &end->header->rings[end->side];
+    shm_ring_t* in = &end->header->rings[1 - end->side];
+
+    // Wake a peer blocked in either direction so it sees the close
+    atomic_store(&out->closed, 1);
+    atomic_store(&in->reader_closed, 1);
+    atomic_fetch_add(&out->data_seq, 1);
+    atomic_fetch_add(&in->space_seq, 1);
+    futex_wake(&out->data_seq);
+    futex_wake(&in->space_seq);
+
+    munmap(end->header, end->map_size);
+    free(end);
+
+    if (sock->handle >= 0) {
+        close(sock->handle);
+    }
+}
+
+static const p2p_transport_t shm_transport = {"shm", shm_send, shm_recv, shm_close};
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int p2p_socket_upgrade_local(p2p_socket_t* sock, int initiator) {
+    if (!sock) {
+        p2p_socket_set_error("Socket is NULL");
+        return -1;
+    }
+
+    if (sock->transport == &shm_transport) return 1;
+
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    if (sock->handle < 0 || sock->type != SOCK_STREAM || sock->is_listening ||
+        getpeername(sock->handle, (struct sockaddr*)&peer, &peer_len) != 0) {
+        return 0;                   // Not connected: neither end negotiates
+    }
+    int local = !p2p_shm_assume_remote && peer_is_local(sock->handle);
+
+    shm_end_t* end = (shm_end_t*)malloc(sizeof(shm_end_t));
+    if (!end) {
+        p2p_socket_set_error("Out of memory");
+        return -1;
+    }
+
+    char offer[OFFER_SIZE];
+    memset(offer, 0, sizeof(offer));
+    memcpy(offer, OFFER_PREFIX, sizeof(OFFER_PREFIX));
+    char* name = offer + sizeof(OFFER_PREFIX);
+    size_t name_size = sizeof(offer) - sizeof(OFFER_PREFIX);
+
+    shm_header_t* header = NULL;
+    size_t map_size = 0;
+    uint32_t capacity = SHM_RING_CAPACITY;
+    uint8_t accepted = 0;
+    int io_ok;
+
+    if (initiator) {
+        // An empty name: peer not local, or no segment could be created
+        header = local ? segment_create(name, name_size) : NULL;
+        if (!header) name[0] = '\0';
+        map_size = shm_map_size(SHM_RING_CAPACITY);
+
+        io_ok = write_full(sock->handle, offer, sizeof(offer)) == 0 &&
+                read_full(sock->handle, &accepted, 1) == 0;
+
+        // Acceptor has mapped it (or given up), the name is no longer needed
+        if (header) shm_unlink(name);
+    } else {
+        char received[OFFER_SIZE];
+        io_ok = read_full(sock->handle, received, sizeof(received)) == 0;
+
+        if (io_ok && memcmp(received, OFFER_PREFIX, sizeof(OFFER_PREFIX)) == 0) {
+            received[OFFER_SIZE - 1] = '\0';
+            const char* offered = received + sizeof(OFFER_PREFIX);
+            if (offered[0] == '/' && local) {
+                header = segment_open(offered, &map_size, &capacity);
+            }
+        } else if (io_ok) {
+            // Peer is not running the same negotiation: stream is out of sync
+            p2p_socket_set_error("Local upgrade failed: unexpected offer");
+            free(end);
+            return -1;
+        }
+
+        accepted = header != NULL;
+        io_ok = io_ok && write_full(sock->handle, &accepted, 1) == 0;
+    }
+    accepted = accepted && header;  // A reply of 1 to an empty offer is ignored
+    p2p_metric_add(&sock->counters, P2P_METRIC_SYSCALLS, 2);
+
+    if (!io_ok || !accepted) {
+        if (header) munmap(header, map_size);
+        free(end);
+        if (!io_ok) {
+            p2p_socket_set_error("Local upgrade failed: connection lost");
+            return -1;
+        }
+        return 0;
+    }
+
+    shm_end_attach(end, header, map_size, capacity, initiator ? 0 : 1);
+    sock->transport = &shm_transport;
+    sock->transport_data = end;
+    return 1;
+}
+
+#else
+
+#include "../protocol/frame.h"
+
+#define OFFER_SIZE 64
+#define OFFER_PREFIX "P2PSHM1"
+
+/**
+ * No shared memory here, but the same exchange as on Linux (empty offer,
+ * decline) so a Linux peer stays in sync
+ */
+int p2p_socket_upgrade_local(p2p_socket_t* sock, int initiator) {
+    if (!sock) {
+        p2p_socket_set_error("Socket is NULL");
+        return -1;
+    }
+
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    if (sock->transport_data || sock->type != SOCK_STREAM || sock->is_listening ||
+        getpeername(sock->handle, (struct sockaddr*)&peer, &peer_len) != 0) {
+        return 0;
+    }
+
+    char offer[OFFER_SIZE];
+    memset(offer, 0, sizeof(offer));
+    uint8_t accepted = 0;
+    int io_ok;
+
+    if (initiator) {
+        memcpy(offer, OFFER_PREFIX, sizeof(OFFER_PREFIX));
+        io_ok = p2p_send_exact(sock, offer, sizeof(offer)) == 0 &&
+                p2p_recv_exact(sock, &accepted, 1) == 0;
+    } else {
+        io_ok = p2p_recv_exact(sock, offer, sizeof(offer)) == 0;
+        if (io_ok && memcmp(offer, OFFER_PREFIX, sizeof(OFFER_PREFIX)) != 0) {
+            p2p_socket_set_error("Local upgrade failed: unexpected offer");
+            return -1;
+        }
+        io_ok = io_ok && p2p_send_exact(sock, &accepted, 1) == 0;
+    }
+
+    if (!io_ok) {
+        p2p_socket_set_error("Local upgrade failed: connection lost");
+        return -1;
+    }
+    return 0;
+}
+
+#endif
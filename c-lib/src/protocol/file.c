@@ -0,0 +1,506 @@
+#include "p2pnet/file.h"
+#include "p2pnet/message.h"
+#include "p2pnet/encryption.h"
+#include "p2pnet/log.h"
+#include "frame.h"
+#include "../util/metrics.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <sys/sendfile.h>
+    #define P2P_HAVE_SPLICE 1
+#endif
+
+#define FILE_MAGIC "P2PF"
+#define FILE_HEADER_SIZE 16             // magic + u64 length + u32 chunk size
+#define COPY_BUFFER_SIZE (256 * 1024)   // Fallback path read/write window
+
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+#ifdef _WIN32
+/**
+ * No pread/pwrite on Windows (ReadFile with an OVERLAPPED offset still
+ * moves the pointer of a synchronous handle): seek, transfer, seek back
+ */
+static intptr_t file_io_at(int fd, void* buffer, size_t length, uint64_t offset, int is_write) {
+    __int64 saved = _lseeki64(fd, 0, SEEK_CUR);
+    if (saved < 0 || _lseeki64(fd, (__int64)offset, SEEK_SET) < 0) return -1;
+    int n = is_write ? _write(fd, buffer, (unsigned)length) : _read(fd, buffer, (unsigned)length);
+    if (_lseeki64(fd, saved, SEEK_SET) < 0) return -1;
+    return n;
+}
+#endif
+
+/**
+ * Positioned read/write that leave the file position as it was
+ */
+static intptr_t file_read_at(int fd, void* buffer, size_t length, uint64_t offset) {
+#ifdef _WIN32
+    return file_io_at(fd, buffer, length, offset, 0);
+#else
+    ssize_t n;
+    do {
+        n = pread(fd, buffer, length, (off_t)offset);
+    } while (n < 0 && errno == EINTR);
+    return n;
+#endif
+}
+
+static int file_write_all_at(int fd, const void* data, size_t length, uint64_t offset) {
+    const uint8_t* ptr = (const uint8_t*)data;
+    while (length > 0) {
+#ifdef _WIN32
+        intptr_t n = file_io_at(fd, (void*)ptr, length, offset, 1);
+#else
+        ssize_t n = pwrite(fd, ptr, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n <= 0) return -1;
+        ptr += n;
+        offset += (uint64_t)n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+static void encode_file_header(uint64_t length, uint32_t chunk, uint8_t out[FILE_HEADER_SIZE]) {
+    memcpy(out, FILE_MAGIC, 4);
+    for (int i = 0; i < 8; i++) {
+        out[4 + i] = (uint8_t)(length >> (56 - 8 * i));
+    }
+    p2p_frame_encode_header(chunk, out + 12);
+}
+
+/**
+ * Validate a received file header, return total length (or -1)
+ */
+static int64_t decode_file_header(const p2p_message_t* msg, uint64_t max_length, uint32_t* chunk) {
+    if (!msg || msg->length != FILE_HEADER_SIZE || memcmp(msg->data, FILE_MAGIC, 4) != 0) {
+        P2P_LOG_WARN("FILE", "Not a file transfer header");
+        return -1;
+    }
+
+    uint64_t length = 0;
+    for (int i = 0; i < 8; i++) {
+        length = (length << 8) | msg->data[4 + i];
+    }
+    *chunk = p2p_frame_decode_header(msg->data + 12);
+
+    if (*chunk == 0 || *chunk > P2P_MAX_MESSAGE_SIZE || length > (uint64_t)INT64_MAX) {
+        P2P_LOG_WARN("FILE", "Invalid file header (chunk %u)", *chunk);
+        return -1;
+    }
+    if (length > max_length) {
+        P2P_LOG_WARN("FILE", "File too large: %llu bytes (max: %llu)",
+                     (unsigned long long)length, (unsigned long long)max_length);
+        return -1;
+    }
+
+    return (int64_t)length;
+}
+
+static uint32_t next_chunk(uint64_t remaining, uint32_t chunk) {
+    return remaining < chunk ? (uint32_t)remaining : chunk;
+}
+
+// ============================================================================
+// Range I/O (one chunk)
+// ============================================================================
+
+/**
+ * Copy path: pread + send through a bounded buffer
+ */
+static int send_range_buffered(p2p_socket_t* sock, int fd, uint64_t offset,
+                               size_t length, uint8_t** buffer) {
+    if (!*buffer && !(*buffer = (uint8_t*)malloc(COPY_BUFFER_SIZE))) return -1;
+
+    while (length > 0) {
+        size_t want = length < COPY_BUFFER_SIZE ? length : COPY_BUFFER_SIZE;
+        intptr_t n = file_read_at(fd, *buffer, want, offset);
+        if (n <= 0) {
+            P2P_LOG_WARN("FILE", "File read failed or ended early");
+            return -1;
+        }
+        if (p2p_send_exact(sock, *buffer, (size_t)n) != 0) return -1;
+        offset += (uint64_t)n;
+        length -= (size_t)n;
+    }
+
+    return 0;
+}
+
+/**
+ * Copy path: recv + pwrite through a bounded buffer
+ */
+static int recv_range_buffered(p2p_socket_t* sock, int fd, uint64_t offset,
+                               size_t length, uint8_t** buffer) {
+    if (!*buffer && !(*buffer = (uint8_t*)malloc(COPY_BUFFER_SIZE))) return -1;
+
+    while (length > 0) {
+        size_t want = length < COPY_BUFFER_SIZE ? length : COPY_BUFFER_SIZE;
+        intptr_t n = p2p_socket_recv(sock, *buffer, want);
+        if (n <= 0) return -1;
+        if (file_write_all_at(fd, *buffer, (size_t)n, offset) != 0) {
+            P2P_LOG_WARN("FILE", "File write failed");
+            return -1;
+        }
+        offset += (uint64_t)n;
+        length -= (size_t)n;
+    }
+
+    return 0;
+}
+
+#ifdef P2P_HAVE_SPLICE
+
+/**
+ * Transport carries its data on the fd (so sendfile/splice apply)?
+ */
+static int fd_transport(p2p_socket_t* sock) {
+    const char* name = p2p_socket_transport(sock);
+    return name && (strcmp(name, "tcp") == 0 || strcmp(name, "unix") == 0);
+}
+
+/**
+ * Wait until the socket is ready again after EAGAIN
+ *
+ * Honours SO_SNDTIMEO/SO_RCVTIMEO like a plain send/recv would: on a
+ * blocking socket EAGAIN already means the timeout expired, a
+ * non-blocking one is polled for at most that long (no timeout = wait).
+ *
+ * @return 0 when ready, -1 on timeout or error
+ */
+static int wait_ready(int handle, short events) {
+    struct timeval tv = {0, 0};
+    socklen_t len = sizeof(tv);
+    int option = (events & POLLOUT) ? SO_SNDTIMEO : SO_RCVTIMEO;
+    if (getsockopt(handle, SOL_SOCKET, option, &tv, &len) != 0) return -1;
+
+    int timeout_ms = -1;
+    if (tv.tv_sec != 0 || tv.tv_usec != 0) {
+        if (!(fcntl(handle, F_GETFL, 0) & O_NONBLOCK)) return -1;
+        timeout_ms = (int)(tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000);
+    }
+
+    struct pollfd pfd = {handle, events, 0};
+    int rc;
+    do {
+        rc = poll(&pfd, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    return rc > 0 ? 0 : -1;
+}
+
+/**
+ * sendfile() the range. Stops early (with *done < length) if the file
+ * cannot be sendfile'd, so the caller can finish through the copy path.
+ */
+static int send_range_sendfile(p2p_socket_t* sock, int fd, uint64_t offset,
+                               size_t length, size_t* done) {
+    int handle = p2p_socket_get_handle(sock);
+    p2p_counters_t* counters = p2p_socket_counters(sock);
+    off_t pos = (off_t)offset;
+
+    *done = 0;
+    while (*done < length) {
+        ssize_t n = sendfile(handle, fd, &pos, length - *done);
+        p2p_metric_add(counters, P2P_METRIC_SYSCALLS, 1);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) {
+                if (wait_ready(handle, POLLOUT) == 0) continue;
+                P2P_LOG_WARN("FILE", "Send timed out");
+                return -1;
+            }
+            if (errno == EINVAL || errno == ENOSYS) {
+                return 0;           // Rest of the range via the copy path
+            }
+            P2P_LOG_WARN("FILE", "sendfile() failed: %s", strerror(errno));
+            return -1;
+        }
+        if (n == 0) {
+            P2P_LOG_WARN("FILE", "File ended early");
+            return -1;
+        }
+
+        p2p_metric_add(counters, P2P_METRIC_BYTES_OUT, (uint64_t)n);
+        *done += (size_t)n;
+    }
+
+    return 0;
+}
+
+typedef struct {
+    int pipe[2];            // socket -> pipe -> file
+    int ready;
+    int fallback;           // splice into this file is not supported
+    uint8_t* buffer;
+} splice_state_t;
+
+/**
+ * Move `length` bytes already in the pipe into the file
+ */
+static int drain_pipe(splice_state_t* st, int fd, uint64_t offset, size_t length) {
+    while (length > 0) {
+        if (!st->fallback) {
+            loff_t pos = (loff_t)offset;
+            ssize_t n = splice(st->pipe[0], NULL, fd, &pos, length, SPLICE_F_MOVE);
+            if (n > 0) {
+                offset += (uint64_t)n;
+                length -= (size_t)n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno != EINVAL) {
+                P2P_LOG_WARN("FILE", "splice() to file failed: %s", strerror(errno));
+                return -1;
+            }
+            st->fallback = 1;
+        }
+
+        // File does not take splice (e.g. O_APPEND): read the pipe ourselves
+        if (!st->buffer && !(st->buffer = (uint8_t*)malloc(COPY_BUFFER_SIZE))) return -1;
+        size_t want = length < COPY_BUFFER_SIZE ? length : COPY_BUFFER_SIZE;
+        ssize_t n = read(st->pipe[0], st->buffer, want);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0 || file_write_all_at(fd, st->buffer, (size_t)n, offset) != 0) {
+            P2P_LOG_WARN("FILE", "File write failed");
+            return -1;
+        }
+        offset += (uint64_t)n;
+        length -= (size_t)n;
+    }
+
+    return 0;
+}
+
+static int recv_range_splice(p2p_socket_t* sock, splice_state_t* st, int fd,
+                             uint64_t offset, size_t length) {
+    int handle = p2p_socket_get_handle(sock);
+    p2p_counters_t* counters = p2p_socket_counters(sock);
+
+    if (!st->ready) {
+        if (pipe2(st->pipe, O_CLOEXEC) != 0) {
+            return recv_range_buffered(sock, fd, offset, length, &st->buffer);
+        }
+        fcntl(st->pipe[1], F_SETPIPE_SZ, COPY_BUFFER_SIZE);     // Best effort
+        st->ready = 1;
+    }
+
+    while (length > 0) {
+        ssize_t n = splice(handle, NULL, st->pipe[1], NULL, length, SPLICE_F_MOVE | SPLICE_F_MORE);
+        p2p_metric_add(counters, P2P_METRIC_SYSCALLS, 1);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) {
+                if (wait_ready(handle, POLLIN) == 0) continue;
+                P2P_LOG_WARN("FILE", "Receive timed out");
+                return -1;
+            }
+            P2P_LOG_WARN("FILE", "splice() from socket failed: %s", strerror(errno));
+            return -1;
+        }
+        if (n == 0) {
+            P2P_LOG_WARN("FILE", "Connection closed mid-transfer");
+            return -1;
+        }
+
+        p2p_metric_add(counters, P2P_METRIC_BYTES_IN, (uint64_t)n);
+        if (drain_pipe(st, fd, offset, (size_t)n) != 0) return -1;
+        offset += (uint64_t)n;
+        length -= (size_t)n;
+    }
+
+    return 0;
+}
+
+#endif
+
+// ============================================================================
+// Plaintext API
+// ============================================================================
+
+int p2p_send_file(p2p_socket_t* sock, int fd, uint64_t offset, uint64_t length) {
+    if (!sock || fd < 0) return -1;
+
+    uint8_t header[FILE_HEADER_SIZE];
+    encode_file_header(length, P2P_FILE_CHUNK_SIZE, header);
+    p2p_message_t msg = {.length = FILE_HEADER_SIZE, .data = header};
+    if (p2p_message_send(sock, &msg) != 0) return -1;
+
+#ifdef P2P_HAVE_SPLICE
+    int direct = fd_transport(sock);
+#endif
+    uint8_t* buffer = NULL;
+    int rc = 0;
+
+    for (uint64_t sent = 0; sent < length && rc == 0; ) {
+        uint32_t chunk = next_chunk(length - sent, P2P_FILE_CHUNK_SIZE);
+        uint8_t frame[P2P_FRAME_HEADER_SIZE];
+        p2p_frame_encode_header(chunk, frame);
+        if (p2p_send_exact(sock, frame, sizeof(frame)) != 0) {
+            rc = -1;
+            break;
+        }
+
+        size_t done = 0;
+#ifdef P2P_HAVE_SPLICE
+        if (direct) {
+            if (send_range_sendfile(sock, fd, offset + sent, chunk, &done) != 0) {
+                rc = -1;
+                break;
+            }
+            if (done < chunk) direct = 0;   // File type without sendfile support
+        }
+#endif
+        if (done < chunk &&
+            send_range_buffered(sock, fd, offset + sent + done, chunk - done, &buffer) != 0) {
+            rc = -1;
+            break;
+        }
+
+        p2p_metric_add(p2p_socket_counters(sock), P2P_METRIC_MESSAGES_OUT, 1);
+        sent += chunk;
+    }
+
+    free(buffer);
+    return rc;
+}
+
+int64_t p2p_recv_file(p2p_socket_t* sock, int fd, uint64_t offset, uint64_t max_length) {
+    if (!sock || fd < 0) return -1;
+
+    p2p_message_t* msg = p2p_message_recv(sock);
+    uint32_t chunk = 0;
+    int64_t length = decode_file_header(msg, max_length, &chunk);
+    p2p_message_free(msg);
+    if (length < 0) return -1;
+
+#ifdef P2P_HAVE_SPLICE
+    splice_state_t st = {{-1, -1}, 0, 0, NULL};
+    int direct = fd_transport(sock);
+#endif
+    uint8_t* buffer = NULL;
+    int rc = 0;
+
+    for (uint64_t received = 0; received < (uint64_t)length; ) {
+        uint32_t expected = next_chunk((uint64_t)length - received, chunk);
+
+        uint8_t frame[P2P_FRAME_HEADER_SIZE];
+        if (p2p_recv_exact(sock, frame, sizeof(frame)) != 0 ||
+            p2p_frame_decode_header(frame) != expected) {
+            P2P_LOG_WARN("FILE", "Bad chunk frame");
+            rc = -1;
+            break;
+        }
+
+#ifdef P2P_HAVE_SPLICE
+        rc = direct ? recv_range_splice(sock, &st, fd, offset + received, expected)
+                    : recv_range_buffered(sock, fd, offset + received, expected, &buffer);
+#else
+        rc = recv_range_buffered(sock, fd, offset + received, expected, &buffer);
+#endif
+        if (rc != 0) break;
+
+        p2p_metric_add(p2p_socket_counters(sock), P2P_METRIC_MESSAGES_IN, 1);
+        received += expected;
+    }
+
+#ifdef P2P_HAVE_SPLICE
+    if (st.ready) {
+        close(st.pipe[0]);
+        close(st.pipe[1]);
+    }
+    free(st.buffer);
+#endif
+    free(buffer);
+    return rc == 0 ? length : -1;
+}
+
+// ============================================================================
+// Encrypted API
+// ============================================================================
+
+int p2p_session_send_file(p2p_session_t* session, p2p_socket_t* sock,
+                          int fd, uint64_t offset, uint64_t length) {
+    if (!session || !sock || fd < 0) return -1;
+
+    uint8_t header[FILE_HEADER_SIZE];
+    encode_file_header(length, P2P_FILE_CHUNK_SIZE, header);
+    if (p2p_session_send(session, sock, header, sizeof(header)) != 0) return -1;
+    if (length == 0) return 0;
+
+    uint8_t* buffer = (uint8_t*)malloc(P2P_FILE_CHUNK_SIZE);
+    if (!buffer) return -1;
+
+    int rc = 0;
+    for (uint64_t sent = 0; sent < length; ) {
+        uint32_t chunk = next_chunk(length - sent, P2P_FILE_CHUNK_SIZE);
+
+        size_t filled = 0;
+        while (filled < chunk) {
+            intptr_t n = file_read_at(fd, buffer + filled, chunk - filled, offset + sent + filled);
+            if (n <= 0) break;
+            filled += (size_t)n;
+        }
+        if (filled < chunk) {
+            P2P_LOG_WARN("FILE", "File read failed or ended early");
+            rc = -1;
+            break;
+        }
+
+        if (p2p_session_send(session, sock, buffer, chunk) != 0) {
+            rc = -1;
+            break;
+        }
+        sent += chunk;
+    }
+
+    free(buffer);
+    return rc;
+}
+
+int64_t p2p_session_recv_file(p2p_session_t* session, p2p_socket_t* sock,
+                              int fd, uint64_t offset, uint64_t max_length) {
+    if (!session || !sock || fd < 0) return -1;
+
+    p2p_message_t* msg = p2p_session_recv(session, sock);
+    uint32_t chunk = 0;
+    int64_t length = decode_file_header(msg, max_length, &chunk);
+    p2p_message_free(msg);
+    if (length < 0) return -1;
+
+    for (uint64_t received = 0; received < (uint64_t)length; ) {
+        uint32_t expected = next_chunk((uint64_t)length - received, chunk);
+
+        msg = p2p_session_recv(session, sock);
+        if (!msg || msg->length != expected) {
+            P2P_LOG_WARN("FILE", "Bad encrypted chunk");
+            p2p_message_free(msg);
+            return -1;
+        }
+
+        int rc = file_write_all_at(fd, msg->data, msg->length, offset + received);
+        p2p_message_free(msg);
+        if (rc != 0) {
+            P2P_LOG_WARN("FILE", "File write failed");
+            return -1;
+        }
+        received += expected;
+    }
+
+    return length;
+}
@@ -0,0 +1,73 @@
+#ifndef P2PNET_FRAME_H
+#define P2PNET_FRAME_H
+
+#include "p2pnet/socket.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Frame header (internal)
+ *
+ * Wire format of a framed message:
+ * ┌──────────────────────┬──────────────────┐
+ * │ Length (4 bytes)     │ Payload          │
+ * │ uint32_t (big-endian)│ Length bytes     │
+ * └──────────────────────┴──────────────────┘
+ *
+ * Byte-wise so it works on any alignment and needs no winsock/arpa
+ * headers.
+ */
+
+#define P2P_FRAME_HEADER_SIZE 4
+
+static inline void p2p_frame_encode_header(uint32_t length, uint8_t header[P2P_FRAME_HEADER_SIZE]) {
+    header[0] = (uint8_t)(length >> 24);
+    header[1] = (uint8_t)(length >> 16);
+    header[2] = (uint8_t)(length >> 8);
+    header[3] = (uint8_t)length;
+}
+
+static inline uint32_t p2p_frame_decode_header(const uint8_t header[P2P_FRAME_HEADER_SIZE]) {
+    return ((uint32_t)header[0] << 24) |
+           ((uint32_t)header[1] << 16) |
+           ((uint32_t)header[2] << 8) |
+           (uint32_t)header[3];
+}
+
+/**
+ * Send exactly length bytes (loops over partial sends)
+ *
+ * @return 0 on success, -1 on error or disconnect
+ */
+static inline int p2p_send_exact(p2p_socket_t* sock, const void* data, size_t length) {
+    const uint8_t* ptr = (const uint8_t*)data;
+    size_t total = 0;
+
+    while (total < length) {
+        intptr_t sent = p2p_socket_send(sock, ptr + total, length - total);
+        if (sent <= 0) return -1;
+        total += (size_t)sent;
+    }
+
+    return 0;
+}
+
+/**
+ * Receive exactly length bytes (loops over partial reads)
+ *
+ * @return 0 on success, -1 on error or disconnect
+ */
+static inline int p2p_recv_exact(p2p_socket_t* sock, void* buffer, size_t length) {
+    uint8_t* ptr = (uint8_t*)buffer;
+    size_t total = 0;
+
+    while (total < length) {
+        intptr_t received = p2p_socket_recv(sock, ptr + total, length - total);
+        if (received <= 0) return -1;
+        total += (size_t)received;
+    }
+
+    return 0;
+}
+
+#endif /* P2PNET_FRAME_H */
@@ -0,0 +1,92 @@
+#include "frame_reader.h"
+#include "frame.h"
+#include <stdlib.h>
+#include <string.h>
+
+int p2p_frame_reader_init(p2p_frame_reader_t* reader) {
+    reader->buffer = (uint8_t*)malloc(P2P_FRAME_READER_INITIAL);
+    if (!reader->buffer) return -1;
+    
+    reader->capacity = P2P_FRAME_READER_INITIAL;
+    reader->start = 0;
+    reader->end = 0;
+    return 0;
+}
+
+void p2p_frame_reader_free(p2p_frame_reader_t* reader) {
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->capacity = 0;
+}
+
+/**
+ * Make room: drop consumed bytes, grow if the pending frame is larger
+ * than the buffer
+ */
+static int make_room(p2p_frame_reader_t* reader) {
+    size_t pending = reader->end - reader->start;
+    
+    if (reader->start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, pending);
+        reader->start = 0;
+        reader->end = pending;
+    }
+    
+    if (pending < P2P_FRAME_HEADER_SIZE || pending < reader->capacity) {
+        return 0;
+    }
+    
+    // Buffer full with one incomplete frame (length already validated by next())
+    size_t needed = P2P_FRAME_HEADER_SIZE + p2p_frame_decode_header(reader->buffer);
+    if (needed <= reader->capacity) return 0;
+    
+    uint8_t* grown = (uint8_t*)realloc(reader->buffer, needed);
+    if (!grown) return -1;
+    
+    reader->buffer = grown;
+    reader->capacity = needed;
+    return 0;
+}
+
+intptr_t p2p_frame_reader_fill(p2p_frame_reader_t* reader, p2p_socket_t* sock,
+                               size_t max_bytes) {
+    if (make_room(reader) != 0) return -1;
+    
+    size_t space = reader->capacity - reader->end;
+    if (max_bytes && max_bytes < space) space = max_bytes;
+    
+    intptr_t n = p2p_socket_recv(sock, reader->buffer + reader->end, space);
+    if (n > 0) {
+        reader->end += (size_t)n;
+    }
+    return n;
+}
+
+int p2p_frame_reader_next(p2p_frame_reader_t* reader, p2p_message_t* view) {
+    size_t available = reader->end - reader->start;
+    if (available < P2P_FRAME_HEADER_SIZE) return 0;
+    
+    const uint8_t* frame = reader->buffer + reader->start;
+    uint32_t length = p2p_frame_decode_header(frame);
+    if (length == 0 || length > P2P_MAX_MESSAGE_SIZE) return -1;
+    
+    if (available - P2P_FRAME_HEADER_SIZE < length) return 0;
+    
+    view->length = length;
+    view->data = (uint8_t*)frame + P2P_FRAME_HEADER_SIZE;
+    view->release = NULL;
+    view->release_ctx = NULL;
+    
+    reader->start += P2P_FRAME_HEADER_SIZE + length;
+    return 1;
+}
+
+int p2p_frame_reader_ready(const p2p_frame_reader_t* reader) {
+    size_t available = reader->end - reader->start;
+    if (available < P2P_FRAME_HEADER_SIZE) return 0;
+    
+    uint32_t length = p2p_frame_decode_header(reader->buffer + reader->start);
+    if (length == 0 || length > P2P_MAX_MESSAGE_SIZE) return 1;
+    
+    return available - P2P_FRAME_HEADER_SIZE >= length;
+}
@@ -0,0 +1,66 @@
+#ifndef P2PNET_FRAME_READER_H
+#define P2PNET_FRAME_READER_H
+
+#include "p2pnet/socket.h"
+#include "p2pnet/message.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Frame reader (internal, not part of public API)
+ *
+ * Buffers raw bytes from a socket and splits them into frames in place,
+ * for the event loop's batch delivery:
+ *
+ * ┌──────────────┬─────────────────────────────┬─────────────┐
+ * │ consumed     │ [hdr][frame][hdr][frame][hd │ free        │
+ * └──────────────┴─────────────────────────────┴─────────────┘
+ *                ^ start                       ^ end
+ *
+ * One recv() pulls in as many queued frames as fit, and
+ * p2p_frame_reader_next() returns views into the buffer without copying.
+ * Views stay valid until the next p2p_frame_reader_fill(), which moves a
+ * trailing partial frame to the front (and grows the buffer up to one
+ * maximum-size frame when a frame doesn't fit).
+ */
+
+#define P2P_FRAME_READER_INITIAL (64 * 1024)
+
+typedef struct {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t start;           // First unparsed byte
+    size_t end;             // End of received data
+} p2p_frame_reader_t;
+
+/**
+ * @return 0 on success, -1 on allocation failure
+ */
+int p2p_frame_reader_init(p2p_frame_reader_t* reader);
+
+void p2p_frame_reader_free(p2p_frame_reader_t* reader);
+
+/**
+ * One recv() into the free space (invalidates earlier views)
+ *
+ * @param max_bytes Read at most this much (0 = as much as fits)
+ * @return Bytes read, 0 on orderly close, -1 on error
+ */
+intptr_t p2p_frame_reader_fill(p2p_frame_reader_t* reader, p2p_socket_t* sock,
+                               size_t max_bytes);
+
+/**
+ * Next complete frame as a view into the buffer
+ *
+ * @param view Output: length and data (release = NULL, don't free)
+ * @return 1 for a frame, 0 if no complete frame is buffered, -1 for an
+ *         invalid length header (zero or above P2P_MAX_MESSAGE_SIZE)
+ */
+int p2p_frame_reader_next(p2p_frame_reader_t* reader, p2p_message_t* view);
+
+/**
+ * Whether next() would return a frame (or an error) without another fill
+ */
+int p2p_frame_reader_ready(const p2p_frame_reader_t* reader);
+
+#endif /* P2PNET_FRAME_READER_H */
@@ -1,64 +1,20 @@
 #include "p2pnet/message.h"
+#include "p2pnet/log.h"
+#include "frame.h"
+#include "../util/metrics.h"
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-// Windows-spesifikk: hton1/ntoh1 for byte order onversion
-#ifdef _WIN32
-    #include <winsock2.h>
-#else
-    #include <arpa/inet.h>
-#endif
-
-// ============================================================================
-// Helper Functions
-// ============================================================================
-
-/**
- * Leser eksakt N bytes fra socket (håndterer partial reads)
- * Blokkerer til alle bytes er lest, eller connection lukkes
- */
-
- static int recv_exact(p2p_socket_t* sock, void* buffer, size_t length) {
-    size_t total_received = 0;
-    uint8_t* buf_ptr = (uint8_t*)buffer;
-
-    while( total_received < length ) {
-        ssize_t   received = p2p_socket_recv(sock, buf_ptr + total_received, length - total_received);
-        if (received <= 0) {
-            return -1;  // Error or disconnect
-        } else if (received == 0) {
-            return (total_received == 0) ? 0 : -1; // Connection closed
-        }
-
-        total_received += received;
-    }
-    
-    return total_received;
-}
-
 /**
- * Sender eksakt N bytes til socket (håndterer partial sends)
+ * Delt melding: ferdig framet i én allokering
  */
-static int send_exact(p2p_socket_t* sock, const void* data, size_t length) {
-    size_t total_sent = 0;
-    const uint8_t* ptr = (const uint8_t*)data;
-    
-    while (total_sent < length) {
-        ssize_t sent = p2p_socket_send(sock, ptr + total_sent, length - total_sent);
-        
-        if (sent < 0) {
-            return -1;
-        } else if (sent == 0) {
-            // Should not happen with blocking sockets
-            return -1;
-        }
-        
-        total_sent += sent;
-    }
-    
-    return total_sent;
-}
+struct p2p_shared_message {
+    atomic_int refs;
+    uint32_t length;                            // Lengde på data (uten header)
+    uint8_t frame[];                            // [header][data]
+};
 
 // ============================================================================
 // Message API
@@ -76,7 +32,7 @@ p2p_message_t* p2p_message_create_binary(const void* data, size_t length) {
     
     // Sjekk maks størrelse
     if (length > P2P_MAX_MESSAGE_SIZE) {
-        fprintf(stderr, "Message too large: %zu bytes (max: %d)\n", 
+        P2P_LOG_WARN("MESSAGE", "Message too large: %zu bytes (max: %d)",
                 length, P2P_MAX_MESSAGE_SIZE);
         return NULL;
     }
@@ -95,6 +51,36 @@ p2p_message_t* p2p_message_create_binary(const void* data, size_t length) {
     // Kopier data
     memcpy(msg->data, data, length);
     msg->length = (uint32_t)length;
+    msg->release = NULL;
+    msg->release_ctx = NULL;
+    
+    p2p_metric_add(NULL, P2P_METRIC_ALLOCATIONS, 1);
+    
+    return msg;
+}
+
+// Wrap uten free_fn: bufferen tilhører fortsatt kalleren
+static void release_borrowed(void* ctx) {
+    (void)ctx;
+}
+
+p2p_message_t* p2p_message_wrap(void* data, size_t length,
+                                p2p_release_fn free_fn, void* ctx) {
+    if (!data || length == 0) return NULL;
+    
+    if (length > P2P_MAX_MESSAGE_SIZE) {
+        P2P_LOG_WARN("MESSAGE", "Message too large: %zu bytes (max: %d)",
+                length, P2P_MAX_MESSAGE_SIZE);
+        return NULL;
+    }
+    
+    p2p_message_t* msg = (p2p_message_t*)malloc(sizeof(p2p_message_t));
+    if (!msg) return NULL;
+    
+    msg->length = (uint32_t)length;
+    msg->data = (uint8_t*)data;
+    msg->release = free_fn ? free_fn : release_borrowed;
+    msg->release_ctx = ctx;
     
     return msg;
 }
@@ -102,46 +88,98 @@ p2p_message_t* p2p_message_create_binary(const void* data, size_t length) {
 int p2p_message_send(p2p_socket_t* sock, p2p_message_t* msg) {
     if (!sock || !msg || !msg->data) return -1;
     
-    // Konverter length til network byte order (big-endian)
-    uint32_t network_length = htonl(msg->length);
+    // Length header i network byte order (big-endian)
+    uint8_t header[P2P_FRAME_HEADER_SIZE];
+    p2p_frame_encode_header(msg->length, header);
     
     // Send length header (4 bytes)
-    if (send_exact(sock, &network_length, sizeof(network_length)) < 0) {
+    if (p2p_send_exact(sock, header, sizeof(header)) != 0) {
         return -1;
     }
     
     // Send data
-    if (send_exact(sock, msg->data, msg->length) < 0) {
+    if (p2p_send_exact(sock, msg->data, msg->length) != 0) {
         return -1;
     }
     
+    p2p_metric_add(p2p_socket_counters(sock), P2P_METRIC_MESSAGES_OUT, 1);
+    
     return 0;
 }
 
-p2p_message_t* p2p_message_recv(p2p_socket_t* sock) {
-    if (!sock) return NULL;
+static void release_message(void* ctx) {
+    p2p_message_free((p2p_message_t*)ctx);
+}
+
+int p2p_message_send_owned(p2p_socket_t* sock, p2p_message_t* msg) {
+    if (!msg) return -1;
+    if (!sock || !msg->data) {
+        p2p_message_free(msg);
+        return -1;
+    }
     
-    // Motta length header (4 bytes)
-    uint32_t network_length;
-    int result = recv_exact(sock, &network_length, sizeof(network_length));
+    uint8_t header[P2P_FRAME_HEADER_SIZE];
+    p2p_frame_encode_header(msg->length, header);
+    
+    if (p2p_send_exact(sock, header, sizeof(header)) != 0) {
+        p2p_message_free(msg);
+        return -1;
+    }
     
-    if (result <= 0) {
+    // Data holdes til kjernen er ferdig (zero-copy), ellers frigjøres den med en gang
+    if (p2p_socket_send_zerocopy(sock, msg->data, msg->length, release_message, msg) != 0) {
+        return -1;
+    }
+    
+    p2p_metric_add(p2p_socket_counters(sock), P2P_METRIC_MESSAGES_OUT, 1);
+    
+    return 0;
+}
+
+int p2p_message_recv_header(p2p_socket_t* sock, uint32_t* length) {
+    if (!sock || !length) return -1;
+    
+    // Motta length header (4 bytes)
+    uint8_t header[P2P_FRAME_HEADER_SIZE];
+    if (p2p_recv_exact(sock, header, sizeof(header)) != 0) {
         // Connection closed or error
-        return NULL;
+        return -1;
     }
     
     // Konverter fra network byte order til host byte order
-    uint32_t length = ntohl(network_length);
+    uint32_t value = p2p_frame_decode_header(header);
     
     // Valider størrelse
-    if (length == 0) {
-        fprintf(stderr, "Received zero-length message\n");
-        return NULL;
+    if (value == 0) {
+        P2P_LOG_WARN("MESSAGE", "Received zero-length message");
+        return -1;
     }
     
-    if (length > P2P_MAX_MESSAGE_SIZE) {
-        fprintf(stderr, "Message too large: %u bytes (max: %d)\n", 
-                length, P2P_MAX_MESSAGE_SIZE);
+    if (value > P2P_MAX_MESSAGE_SIZE) {
+        P2P_LOG_WARN("MESSAGE", "Message too large: %u bytes (max: %d)",
+                value, P2P_MAX_MESSAGE_SIZE);
+        return -1;
+    }
+    
+    *length = value;
+    return 0;
+}
+
+int p2p_message_recv_into(p2p_socket_t* sock, void* buffer, uint32_t length) {
+    if (!sock || !buffer || length == 0) return -1;
+    
+    if (p2p_recv_exact(sock, buffer, length) != 0) {
+        return -1;
+    }
+    
+    p2p_metric_add(p2p_socket_counters(sock), P2P_METRIC_MESSAGES_IN, 1);
+    
+    return 0;
+}
+
+p2p_message_t* p2p_message_recv(p2p_socket_t* sock) {
+    uint32_t length;
+    if (p2p_message_recv_header(sock, &length) != 0) {
         return NULL;
     }
     
@@ -150,14 +188,17 @@ p2p_message_t* p2p_message_recv(p2p_socket_t* sock) {
     if (!msg) return NULL;
     
     msg->length = length;
+    msg->release = NULL;
+    msg->release_ctx = NULL;
     msg->data = (uint8_t*)malloc(length);
     if (!msg->data) {
         free(msg);
         return NULL;
     }
+    p2p_metric_add(NULL, P2P_METRIC_ALLOCATIONS, 1);
     
     // Motta data
-    if (recv_exact(sock, msg->data, length) <= 0) {
+    if (p2p_message_recv_into(sock, msg->data, length) != 0) {
         p2p_message_free(msg);
         return NULL;
     }
@@ -165,10 +206,94 @@ p2p_message_t* p2p_message_recv(p2p_socket_t* sock) {
     return msg;
 }
 
+// ============================================================================
+// Shared messages (broadcast)
+// ============================================================================
+
+p2p_shared_message_t* p2p_shared_message_create(const void* data, size_t length) {
+    if (!data || length == 0) return NULL;
+    
+    if (length > P2P_MAX_MESSAGE_SIZE) {
+        P2P_LOG_WARN("MESSAGE", "Message too large: %zu bytes (max: %d)",
+                length, P2P_MAX_MESSAGE_SIZE);
+        return NULL;
+    }
+    
+    p2p_shared_message_t* msg = (p2p_shared_message_t*)malloc(
+        sizeof(p2p_shared_message_t) + P2P_FRAME_HEADER_SIZE + length);
+    if (!msg) return NULL;
+    
+    atomic_init(&msg->refs, 1);
+    msg->length = (uint32_t)length;
+    p2p_frame_encode_header(msg->length, msg->frame);
+    memcpy(msg->frame + P2P_FRAME_HEADER_SIZE, data, length);
+    
+    p2p_metric_add(NULL, P2P_METRIC_ALLOCATIONS, 1);
+    
+    return msg;
+}
+
+p2p_shared_message_t* p2p_shared_message_ref(p2p_shared_message_t* msg) {
+    if (msg) {
+        atomic_fetch_add_explicit(&msg->refs, 1, memory_order_relaxed);
+    }
+    return msg;
+}
+
+void p2p_shared_message_unref(p2p_shared_message_t* msg) {
+    if (!msg) return;
+    
+    // acq_rel: alle skrivinger fra andre tråder er ferdige før free
+    if (atomic_fetch_sub_explicit(&msg->refs, 1, memory_order_acq_rel) == 1) {
+        free(msg);
+    }
+}
+
+const uint8_t* p2p_shared_message_data(const p2p_shared_message_t* msg, size_t* length) {
+    if (!msg) return NULL;
+    if (length) *length = msg->length;
+    return msg->frame + P2P_FRAME_HEADER_SIZE;
+}
+
+static void release_shared(void* ctx) {
+    p2p_shared_message_unref((p2p_shared_message_t*)ctx);
+}
+
+int p2p_message_send_shared(p2p_socket_t* sock, p2p_shared_message_t* msg) {
+    if (!sock || !msg) return -1;
+    
+    // Sendingen holder sin egen referanse til kjernen er ferdig (zero-copy),
+    // ellers slippes den med en gang
+    p2p_shared_message_ref(msg);
+    if (p2p_socket_send_zerocopy(sock, msg->frame, P2P_FRAME_HEADER_SIZE + msg->length,
+                                 release_shared, msg) != 0) {
+        return -1;
+    }
+    
+    p2p_metric_add(p2p_socket_counters(sock), P2P_METRIC_MESSAGES_OUT, 1);
+    
+    return 0;
+}
+
+int p2p_message_broadcast(p2p_socket_t** socks, size_t count, p2p_shared_message_t* msg) {
+    if (!socks || !msg) return -1;
+    
+    int sent = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (socks[i] && p2p_message_send_shared(socks[i], msg) == 0) {
+            sent++;
+        }
+    }
+    
+    return sent;
+}
+
 void p2p_message_free(p2p_message_t* msg) {
     if (!msg) return;
     
-    if (msg->data) {
+    if (msg->release) {
+        msg->release(msg->release_ctx);
+    } else if (msg->data) {
         free(msg->data);
     }
     
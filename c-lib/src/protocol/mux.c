@@ -0,0 +1,754 @@
+#include "p2pnet/mux.h"
+#include "p2pnet/message.h"
+#include "p2pnet/encryption.h"
+#include "p2pnet/log.h"
+#include "frame.h"
+#include "../platform/thread.h"
+#include "../util/metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MUX_FLAG_FIN 0x01
+#define MUX_FLAG_WINDOW_UPDATE 0x02
+
+#define CONN_STREAM_ID 0                // Window updates for the whole connection
+#define WINDOW_UPDATE_SIZE 4
+#define MAX_CREDIT INT32_MAX            // Larger windows are a protocol error
+#define UPDATE_BATCH 16
+
+// Id -> stream hash, sized for both sides' stream caps at load <= 1/2
+#define STREAM_INDEX_SIZE 512           // Power of two
+#if STREAM_INDEX_SIZE < 4 * P2P_MUX_MAX_STREAMS
+#error "STREAM_INDEX_SIZE too small for P2P_MUX_MAX_STREAMS"
+#endif
+
+// Virtual time per byte at weight 1; a stream advances by cost / weight
+#define VTIME_SCALE P2P_MUX_WEIGHT_MAX
+
+typedef struct mux_segment {
+    struct mux_segment* next;
+    size_t length;
+    size_t offset;                      // Bytes of this segment already sent
+    uint8_t data[];
+} mux_segment_t;
+
+typedef struct {
+    uint32_t id;
+    int slot;                           // Position in mux->streams
+    int priority;
+    int weight;
+    uint64_t vtime;                     // Weighted bytes sent (fair share)
+
+    mux_segment_t* head;
+    mux_segment_t* tail;
+    size_t queued;
+
+    int fin_queued;                     // p2p_mux_close() called
+    int fin_sent;
+    int fin_received;
+
+    int64_t send_credit;                // Bytes we may still send
+    int64_t recv_window;                // Bytes the peer may still send
+    size_t unconsumed;                  // Received, not yet consumed
+    size_t grant;                       // Consumed, credit not yet returned
+} mux_stream_t;
+
+struct p2p_mux {
+    p2p_socket_t* sock;
+    p2p_session_t* session;
+    p2p_mux_data_fn on_data;
+    void* user_data;
+
+    p2p_mutex_t lock;                   // Streams and queues
+    p2p_mutex_t send_lock;              // Held by the sender; owns `frame`
+
+    mux_stream_t** streams;             // Dense, for scheduling scans
+    int num_streams;
+    int capacity;
+    mux_stream_t* index[STREAM_INDEX_SIZE]; // Open addressing by id
+
+    uint32_t next_id;                   // Next id we open
+    uint32_t peer_max_id;               // Highest id the peer has opened
+    int own_streams;                    // Live streams we opened
+    int peer_streams;                   // Live streams the peer opened
+    uint64_t vclock[P2P_MUX_PRIORITIES];// Virtual time per level (last pick)
+    size_t pending;
+
+    // Connection-level flow control
+    int64_t conn_credit;
+    int64_t conn_recv_window;
+    size_t conn_unconsumed;
+    size_t conn_grant;
+    int updates_due;                    // Window updates waiting to be sent
+    int auto_consume;
+    int broken;                         // Receive side failed
+
+    p2p_cond_t sendable;                // Work for p2p_mux_wait_sendable()
+
+    uint8_t* frame;                     // Header + one chunk
+};
+
+// ============================================================================
+// Stream table (call with lock held)
+// ============================================================================
+
+static size_t index_home(uint32_t id) {
+    // Fibonacci hashing; ids are sequential per side
+    return (size_t)((id * 2654435769u) >> 16) & (STREAM_INDEX_SIZE - 1);
+}
+
+/**
+ * Index slot holding id, or the empty slot where it belongs
+ */
+static size_t index_slot(p2p_mux_t* mux, uint32_t id) {
+    size_t i = index_home(id);
+    while (mux->index[i] && mux->index[i]->id != id) {
+        i = (i + 1) & (STREAM_INDEX_SIZE - 1);
+    }
+    return i;
+}
+
+static void index_remove(p2p_mux_t* mux, uint32_t id) {
+    size_t mask = STREAM_INDEX_SIZE - 1;
+    size_t hole = index_slot(mux, id);
+    size_t i = hole;
+
+    // Backward shift: move later entries of the same probe run into the hole
+    for (;;) {
+        i = (i + 1) & mask;
+        if (!mux->index[i]) break;
+
+        size_t home = index_home(mux->index[i]->id);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            mux->index[hole] = mux->index[i];
+            hole = i;
+        }
+    }
+    mux->index[hole] = NULL;
+}
+
+static mux_stream_t* find_stream(p2p_mux_t* mux, uint32_t id) {
+    return mux->index[index_slot(mux, id)];
+}
+
+/**
+ * Stream opened by this side (same id parity as the ones we hand out)
+ */
+static int is_own(const p2p_mux_t* mux, uint32_t id) {
+    return (id & 1) == (mux->next_id & 1);
+}
+
+static mux_stream_t* add_stream(p2p_mux_t* mux, uint32_t id, int priority, int weight) {
+    if (mux->num_streams == mux->capacity) {
+        int capacity = mux->capacity ? mux->capacity * 2 : 8;
+        mux_stream_t** streams = (mux_stream_t**)realloc(mux->streams, capacity * sizeof(*streams));
+        if (!streams) return NULL;
+        mux->streams = streams;
+        mux->capacity = capacity;
+    }
+
+    mux_stream_t* stream = (mux_stream_t*)calloc(1, sizeof(*stream));
+    if (!stream) return NULL;
+
+    if (is_own(mux, id)) mux->own_streams++;
+    else mux->peer_streams++;
+
+    stream->id = id;
+    stream->priority = priority;
+    stream->weight = weight;
+    stream->vtime = mux->vclock[priority];
+    stream->send_credit = P2P_MUX_STREAM_WINDOW;
+    stream->recv_window = P2P_MUX_STREAM_WINDOW;
+    stream->slot = mux->num_streams;
+    mux->streams[mux->num_streams++] = stream;
+    mux->index[index_slot(mux, id)] = stream;
+    return stream;
+}
+
+static void free_queue(mux_stream_t* stream) {
+    mux_segment_t* seg = stream->head;
+    while (seg) {
+        mux_segment_t* next = seg->next;
+        free(seg);
+        seg = next;
+    }
+    stream->head = stream->tail = NULL;
+    stream->queued = 0;
+}
+
+/**
+ * Drop the stream once both directions are finished
+ */
+static void maybe_remove(p2p_mux_t* mux, mux_stream_t* stream) {
+    if (!stream->fin_sent || !stream->fin_received) return;
+
+    mux_stream_t* last = mux->streams[--mux->num_streams];
+    mux->streams[stream->slot] = last;
+    last->slot = stream->slot;
+    index_remove(mux, stream->id);
+    if (is_own(mux, stream->id)) mux->own_streams--;
+    else mux->peer_streams--;
+    free_queue(stream);
+    free(stream);
+}
+
+/**
+ * Queued data (with credit to send it) or a FIN is waiting
+ */
+static int is_ready(const p2p_mux_t* mux, const mux_stream_t* stream) {
+    if (stream->queued > 0) {
+        return stream->send_credit > 0 && mux->conn_credit > 0;
+    }
+    return stream->fin_queued && !stream->fin_sent;
+}
+
+/**
+ * Idle stream becomes ready: don't let it bank credit from the idle time
+ */
+static void wake_stream(p2p_mux_t* mux, mux_stream_t* stream) {
+    if (!is_ready(mux, stream) && stream->vtime < mux->vclock[stream->priority]) {
+        stream->vtime = mux->vclock[stream->priority];
+    }
+}
+
+/**
+ * Next stream to send from: most urgent level, then least virtual time
+ */
+static mux_stream_t* pick_stream(p2p_mux_t* mux) {
+    mux_stream_t* best = NULL;
+
+    for (int i = 0; i < mux->num_streams; i++) {
+        mux_stream_t* s = mux->streams[i];
+        if (!is_ready(mux, s)) continue;
+
+        if (!best || s->priority < best->priority ||
+            (s->priority == best->priority && s->vtime < best->vtime)) {
+            best = s;
+        }
+    }
+
+    return best;
+}
+
+static int valid_priority(int priority, int weight) {
+    return priority >= 0 && priority < P2P_MUX_PRIORITIES &&
+           weight >= 1 && weight <= P2P_MUX_WEIGHT_MAX;
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+p2p_mux_t* p2p_mux_create(p2p_socket_t* sock, p2p_session_t* session, int initiator,
+                          p2p_mux_data_fn on_data, void* user_data) {
+    if (!sock || !on_data) return NULL;
+
+    p2p_mux_t* mux = (p2p_mux_t*)calloc(1, sizeof(*mux));
+    if (!mux) return NULL;
+
+    mux->frame = (uint8_t*)malloc(P2P_MUX_HEADER_SIZE + P2P_MUX_CHUNK_SIZE);
+    if (!mux->frame) {
+        free(mux);
+        return NULL;
+    }
+    p2p_metric_add(NULL, P2P_METRIC_ALLOCATIONS, 1);
+
+    mux->sock = sock;
+    mux->session = session;
+    mux->on_data = on_data;
+    mux->user_data = user_data;
+    mux->next_id = initiator ? 1 : 2;
+    mux->conn_credit = P2P_MUX_CONN_WINDOW;
+    mux->conn_recv_window = P2P_MUX_CONN_WINDOW;
+    mux->auto_consume = 1;
+    p2p_mutex_init(&mux->lock);
+    p2p_mutex_init(&mux->send_lock);
+    p2p_cond_init(&mux->sendable);
+
+    return mux;
+}
+
+void p2p_mux_free(p2p_mux_t* mux) {
+    if (!mux) return;
+
+    for (int i = 0; i < mux->num_streams; i++) {
+        free_queue(mux->streams[i]);
+        free(mux->streams[i]);
+    }
+    free(mux->streams);
+    free(mux->frame);
+    p2p_mutex_destroy(&mux->lock);
+    p2p_mutex_destroy(&mux->send_lock);
+    p2p_cond_destroy(&mux->sendable);
+    free(mux);
+}
+
+// ============================================================================
+// Streams
+// ============================================================================
+
+uint32_t p2p_mux_open(p2p_mux_t* mux, int priority, int weight) {
+    if (!mux || !valid_priority(priority, weight)) return 0;
+
+    p2p_mutex_lock(&mux->lock);
+    uint32_t id = mux->next_id;
+    mux_stream_t* stream = NULL;
+    if (id <= UINT32_MAX - 2 && mux->own_streams < P2P_MUX_MAX_STREAMS) {
+        stream = add_stream(mux, id, priority, weight);
+    }
+    if (stream) mux->next_id += 2;
+    p2p_mutex_unlock(&mux->lock);
+
+    return stream ? id : 0;
+}
+
+int p2p_mux_set_priority(p2p_mux_t* mux, uint32_t stream_id, int priority, int weight) {
+    if (!mux || !valid_priority(priority, weight)) return -1;
+
+    p2p_mutex_lock(&mux->lock);
+    mux_stream_t* stream = find_stream(mux, stream_id);
+    if (stream) {
+        if (stream->priority != priority) {
+            stream->vtime = mux->vclock[priority];     // Join the new level fresh
+        }
+        stream->priority = priority;
+        stream->weight = weight;
+    }
+    p2p_mutex_unlock(&mux->lock);
+
+    return stream ? 0 : -1;
+}
+
+int p2p_mux_write(p2p_mux_t* mux, uint32_t stream_id, const void* data, size_t length) {
+    if (!mux || (!data && length > 0)) return -1;
+    if (length == 0) return 0;
+
+    mux_segment_t* seg = (mux_segment_t*)malloc(sizeof(*seg) + length);
+    if (!seg) return -1;
+    seg->next = NULL;
+    seg->length = length;
+    seg->offset = 0;
+    memcpy(seg->data, data, length);
+
+    p2p_mutex_lock(&mux->lock);
+    mux_stream_t* stream = find_stream(mux, stream_id);
+    if (!stream || stream->fin_queued) {
+        p2p_mutex_unlock(&mux->lock);
+        free(seg);
+        return -1;
+    }
+
+    wake_stream(mux, stream);
+    if (stream->tail) stream->tail->next = seg;
+    else stream->head = seg;
+    stream->tail = seg;
+    stream->queued += length;
+    mux->pending += length;
+    p2p_cond_signal(&mux->sendable);
+    p2p_mutex_unlock(&mux->lock);
+
+    return 0;
+}
+
+int p2p_mux_close(p2p_mux_t* mux, uint32_t stream_id) {
+    if (!mux) return -1;
+
+    p2p_mutex_lock(&mux->lock);
+    mux_stream_t* stream = find_stream(mux, stream_id);
+    int rc = -1;
+    if (stream && !stream->fin_queued) {
+        wake_stream(mux, stream);
+        stream->fin_queued = 1;
+        p2p_cond_signal(&mux->sendable);
+        rc = 0;
+    }
+    p2p_mutex_unlock(&mux->lock);
+
+    return rc;
+}
+
+size_t p2p_mux_write_space(p2p_mux_t* mux, uint32_t stream_id) {
+    if (!mux) return 0;
+
+    p2p_mutex_lock(&mux->lock);
+    mux_stream_t* stream = find_stream(mux, stream_id);
+    int64_t space = 0;
+    if (stream && !stream->fin_queued) {
+        space = stream->send_credit < mux->conn_credit ? stream->send_credit : mux->conn_credit;
+        space -= (int64_t)stream->queued;
+    }
+    p2p_mutex_unlock(&mux->lock);
+
+    return space > 0 ? (size_t)space : 0;
+}
+
+size_t p2p_mux_pending(p2p_mux_t* mux) {
+    if (!mux) return 0;
+
+    p2p_mutex_lock(&mux->lock);
+    size_t pending = mux->pending;
+    p2p_mutex_unlock(&mux->lock);
+    return pending;
+}
+
+int p2p_mux_stream_count(p2p_mux_t* mux) {
+    if (!mux) return 0;
+
+    p2p_mutex_lock(&mux->lock);
+    int count = mux->num_streams;
+    p2p_mutex_unlock(&mux->lock);
+    return count;
+}
+
+// ============================================================================
+// Send
+// ============================================================================
+
+/**
+ * Move up to `limit` bytes of the stream's queue into the frame buffer
+ */
+static size_t fill_chunk(p2p_mux_t* mux, mux_stream_t* stream, size_t limit) {
+    uint8_t* out = mux->frame + P2P_MUX_HEADER_SIZE;
+    size_t filled = 0;
+
+    while (stream->head && filled < limit) {
+        mux_segment_t* seg = stream->head;
+        size_t n = seg->length - seg->offset;
+        if (n > limit - filled) n = limit - filled;
+
+        memcpy(out + filled, seg->data + seg->offset, n);
+        seg->offset += n;
+        filled += n;
+
+        if (seg->offset == seg->length) {
+            stream->head = seg->next;
+            if (!stream->head) stream->tail = NULL;
+            free(seg);
+        }
+    }
+
+    stream->queued -= filled;
+    stream->send_credit -= (int64_t)filled;
+    mux->conn_credit -= (int64_t)filled;
+    mux->pending -= filled;
+    return filled;
+}
+
+static int send_frame(p2p_mux_t* mux, size_t length) {
+    if (mux->session) {
+        return p2p_session_send(mux->session, mux->sock, mux->frame, length);
+    }
+    p2p_message_t msg = {.length = (uint32_t)length, .data = mux->frame};
+    return p2p_message_send(mux->sock, &msg);
+}
+
+typedef struct {
+    uint32_t id;
+    uint32_t increment;
+} window_update_t;
+
+/**
+ * Collect due window updates (lock held); the credit counts as returned
+ */
+static int collect_updates(p2p_mux_t* mux, window_update_t* out, int max) {
+    int count = 0;
+
+    if (mux->conn_grant >= P2P_MUX_CONN_WINDOW / 2) {
+        out[count].id = CONN_STREAM_ID;
+        out[count].increment = (uint32_t)mux->conn_grant;
+        mux->conn_recv_window += (int64_t)mux->conn_grant;
+        mux->conn_grant = 0;
+        count++;
+    }
+
+    for (int i = 0; i < mux->num_streams && count < max; i++) {
+        mux_stream_t* s = mux->streams[i];
+        if (s->grant < P2P_MUX_STREAM_WINDOW / 2) continue;
+
+        out[count].id = s->id;
+        out[count].increment = (uint32_t)s->grant;
+        s->recv_window += (int64_t)s->grant;
+        s->grant = 0;
+        count++;
+    }
+
+    if (count < max) mux->updates_due = 0;      // Everything due was collected
+    return count;
+}
+
+/**
+ * Send due window updates (send_lock held)
+ */
+static int flush_updates(p2p_mux_t* mux) {
+    window_update_t updates[UPDATE_BATCH];
+    int count;
+
+    do {
+        p2p_mutex_lock(&mux->lock);
+        count = mux->updates_due ? collect_updates(mux, updates, UPDATE_BATCH) : 0;
+        p2p_mutex_unlock(&mux->lock);
+
+        for (int i = 0; i < count; i++) {
+            p2p_frame_encode_header(updates[i].id, mux->frame);
+            mux->frame[4] = MUX_FLAG_WINDOW_UPDATE;
+            p2p_frame_encode_header(updates[i].increment, mux->frame + P2P_MUX_HEADER_SIZE);
+            if (send_frame(mux, P2P_MUX_HEADER_SIZE + WINDOW_UPDATE_SIZE) != 0) return -1;
+        }
+    } while (count == UPDATE_BATCH);
+
+    return 0;
+}
+
+/**
+ * Send window updates now if no sender holds the socket; otherwise the
+ * sender picks them up before it lets go (see p2p_mux_send_pending())
+ */
+static int try_flush_updates(p2p_mux_t* mux) {
+    if (p2p_mutex_trylock(&mux->send_lock) != 0) return 0;
+
+    int rc = flush_updates(mux);
+    p2p_mutex_unlock(&mux->send_lock);
+    return rc;
+}
+
+intptr_t p2p_mux_send_pending(p2p_mux_t* mux, size_t max_bytes) {
+    if (!mux) return -1;
+
+    size_t total = 0;
+    int due;
+
+    do {
+        p2p_mutex_lock(&mux->send_lock);
+
+        while (max_bytes == 0 || total < max_bytes) {
+            if (flush_updates(mux) != 0) {
+                p2p_mutex_unlock(&mux->send_lock);
+                return -1;
+            }
+
+            p2p_mutex_lock(&mux->lock);
+            mux_stream_t* stream = pick_stream(mux);
+            if (!stream) {
+                p2p_mutex_unlock(&mux->lock);
+                break;
+            }
+
+            size_t limit = P2P_MUX_CHUNK_SIZE;
+            if ((int64_t)limit > stream->send_credit) limit = (size_t)stream->send_credit;
+            if ((int64_t)limit > mux->conn_credit) limit = (size_t)mux->conn_credit;
+
+            size_t n = fill_chunk(mux, stream, limit);
+            int fin = stream->fin_queued && stream->queued == 0;
+
+            p2p_frame_encode_header(stream->id, mux->frame);
+            mux->frame[4] = fin ? MUX_FLAG_FIN : 0;
+
+            // Charge the stream for what it sent (header too, so FINs aren't free)
+            mux->vclock[stream->priority] = stream->vtime;
+            stream->vtime += (uint64_t)(n + P2P_MUX_HEADER_SIZE) * VTIME_SCALE / (uint64_t)stream->weight;
+
+            if (fin) {
+                stream->fin_sent = 1;
+                maybe_remove(mux, stream);
+            }
+            p2p_mutex_unlock(&mux->lock);
+
+            if (send_frame(mux, P2P_MUX_HEADER_SIZE + n) != 0) {
+                p2p_mutex_unlock(&mux->send_lock);
+                return -1;
+            }
+            total += n;
+        }
+
+        p2p_mutex_unlock(&mux->send_lock);
+
+        // A receiver may have queued updates while we held the socket
+        p2p_mutex_lock(&mux->lock);
+        due = mux->updates_due;
+        p2p_mutex_unlock(&mux->lock);
+    } while (due);
+
+    return (intptr_t)total;
+}
+
+int p2p_mux_wait_sendable(p2p_mux_t* mux) {
+    if (!mux) return -1;
+
+    p2p_mutex_lock(&mux->lock);
+    while (!mux->broken && !mux->updates_due && !pick_stream(mux)) {
+        p2p_cond_wait(&mux->sendable, &mux->lock);
+    }
+    int rc = mux->broken ? -1 : 0;
+    p2p_mutex_unlock(&mux->lock);
+
+    return rc;
+}
+
+// ============================================================================
+// Receive
+// ============================================================================
+
+/**
+ * Account consumed bytes (lock held); returns 1 if updates became due
+ */
+static int add_grant(p2p_mux_t* mux, mux_stream_t* stream, size_t bytes) {
+    mux->conn_unconsumed -= bytes;
+    mux->conn_grant += bytes;
+    if (mux->conn_grant >= P2P_MUX_CONN_WINDOW / 2) mux->updates_due = 1;
+
+    if (stream && !stream->fin_received) {
+        stream->unconsumed -= bytes;
+        stream->grant += bytes;
+        if (stream->grant >= P2P_MUX_STREAM_WINDOW / 2) mux->updates_due = 1;
+    }
+
+    if (mux->updates_due) p2p_cond_signal(&mux->sendable);
+    return mux->updates_due;
+}
+
+void p2p_mux_set_auto_consume(p2p_mux_t* mux, int enabled) {
+    if (!mux) return;
+
+    p2p_mutex_lock(&mux->lock);
+    mux->auto_consume = enabled ? 1 : 0;
+    p2p_mutex_unlock(&mux->lock);
+}
+
+int p2p_mux_consume(p2p_mux_t* mux, uint32_t stream_id, size_t bytes) {
+    if (!mux) return -1;
+    if (bytes == 0) return 0;
+
+    p2p_mutex_lock(&mux->lock);
+    mux_stream_t* stream = find_stream(mux, stream_id);
+    if (bytes > mux->conn_unconsumed || (stream && !stream->fin_received && bytes > stream->unconsumed)) {
+        p2p_mutex_unlock(&mux->lock);
+        return -1;
+    }
+    int due = add_grant(mux, stream, bytes);
+    p2p_mutex_unlock(&mux->lock);
+
+    return due ? try_flush_updates(mux) : 0;
+}
+
+/**
+ * Apply a window update from the peer (lock held)
+ */
+static int apply_window_update(p2p_mux_t* mux, uint32_t id, const uint8_t* data) {
+    int64_t increment = p2p_frame_decode_header(data);
+    int64_t* credit = &mux->conn_credit;
+
+    if (id != CONN_STREAM_ID) {
+        mux_stream_t* stream = find_stream(mux, id);
+        if (!stream) return 0;          // Already finished here
+        credit = &stream->send_credit;
+    }
+
+    if (increment == 0 || *credit + increment > MAX_CREDIT) return -1;
+
+    *credit += increment;
+    p2p_cond_signal(&mux->sendable);
+    return 0;
+}
+
+/**
+ * Data frame bookkeeping (lock held): find/open the stream, enforce windows
+ */
+static int accept_data(p2p_mux_t* mux, uint32_t id, size_t length, int fin) {
+    if (id == CONN_STREAM_ID) return -1;
+    if (length == 0 && !fin) return -1;                 // Nothing to deliver, costs no credit
+
+    mux_stream_t* stream = find_stream(mux, id);
+    if (!stream) {
+        // Only the peer opens its own ids, and only new ones
+        if (is_own(mux, id) || id <= mux->peer_max_id) return -1;
+        if (mux->peer_streams >= P2P_MUX_MAX_STREAMS) {
+            P2P_LOG_WARN("MUX", "Peer opened more than %d streams", P2P_MUX_MAX_STREAMS);
+            return -1;
+        }
+
+        stream = add_stream(mux, id, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT);
+        if (!stream) return -1;
+        mux->peer_max_id = id;
+    }
+
+    if (stream->fin_received) return -1;                // Data after FIN
+    if ((int64_t)length > stream->recv_window ||
+        (int64_t)length > mux->conn_recv_window) {
+        P2P_LOG_WARN("MUX", "Flow control violation on stream %u (%zu bytes)", id, length);
+        return -1;
+    }
+
+    stream->recv_window -= (int64_t)length;
+    stream->unconsumed += length;
+    mux->conn_recv_window -= (int64_t)length;
+    mux->conn_unconsumed += length;
+
+    if (fin) {
+        stream->fin_received = 1;
+        maybe_remove(mux, stream);
+    }
+    return 0;
+}
+
+static int recv_failed(p2p_mux_t* mux) {
+    p2p_mutex_lock(&mux->lock);
+    mux->broken = 1;
+    p2p_cond_broadcast(&mux->sendable);
+    p2p_mutex_unlock(&mux->lock);
+    return -1;
+}
+
+int p2p_mux_recv(p2p_mux_t* mux) {
+    if (!mux) return -1;
+
+    p2p_message_t* msg = mux->session ? p2p_session_recv(mux->session, mux->sock)
+                                      : p2p_message_recv(mux->sock);
+    if (!msg) return recv_failed(mux);
+
+    if (msg->length < P2P_MUX_HEADER_SIZE ||
+        msg->length > P2P_MUX_HEADER_SIZE + P2P_MUX_CHUNK_SIZE) {
+        P2P_LOG_WARN("MUX", "Invalid mux frame: %u bytes", msg->length);
+        p2p_message_free(msg);
+        return recv_failed(mux);
+    }
+
+    uint32_t id = p2p_frame_decode_header(msg->data);
+    uint8_t flags = msg->data[4];
+    size_t length = msg->length - P2P_MUX_HEADER_SIZE;
+    int fin = (flags & MUX_FLAG_FIN) != 0;
+    int ok;
+
+    p2p_mutex_lock(&mux->lock);
+    if (flags == MUX_FLAG_WINDOW_UPDATE) {
+        ok = length == WINDOW_UPDATE_SIZE &&
+             apply_window_update(mux, id, msg->data + P2P_MUX_HEADER_SIZE) == 0;
+    } else {
+        ok = (flags & ~MUX_FLAG_FIN) == 0 && accept_data(mux, id, length, fin) == 0;
+    }
+    int auto_consume = mux->auto_consume;
+    p2p_mutex_unlock(&mux->lock);
+
+    if (!ok) {
+        P2P_LOG_WARN("MUX", "Protocol error on stream %u (flags 0x%02x)", id, flags);
+        p2p_message_free(msg);
+        return recv_failed(mux);
+    }
+
+    if (flags == MUX_FLAG_WINDOW_UPDATE) {
+        p2p_message_free(msg);
+        return 0;
+    }
+
+    mux->on_data(mux, id, msg->data + P2P_MUX_HEADER_SIZE, length, fin, mux->user_data);
+    p2p_message_free(msg);
+
+    if (auto_consume && length > 0) {
+        p2p_mutex_lock(&mux->lock);
+        int due = add_grant(mux, find_stream(mux, id), length);
+        p2p_mutex_unlock(&mux->lock);
+
+        if (due && try_flush_updates(mux) != 0) return recv_failed(mux);
+    }
+
+    return 0;
+}
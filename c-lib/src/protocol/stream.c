@@ -0,0 +1,340 @@
+#include "p2pnet/stream.h"
+#include "p2pnet/encryption.h"
+#include "p2pnet/log.h"
+#include "frame.h"
+#include "../util/metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STREAM_MAGIC "P2PS"
+#define STREAM_BEGIN_SIZE 16            // magic + u64 length + u32 window
+
+// Chunk frame types (first payload byte)
+#define STREAM_DATA  0x00
+#define STREAM_END   0x01
+#define STREAM_ABORT 0x02
+
+struct p2p_stream_writer {
+    p2p_socket_t* sock;
+    p2p_session_t* session;             // NULL = plaintext
+    uint64_t total_length;              // P2P_STREAM_UNKNOWN_LENGTH if open-ended
+    uint64_t written;                   // Bytes accepted by p2p_stream_write()
+    size_t window;
+    size_t buffered;                    // Data bytes in buffer (after the type byte)
+    int failed;
+    uint8_t* buffer;                    // [type][window bytes of data]
+};
+
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+/**
+ * Send one frame (plaintext frame or encrypted record)
+ */
+static int send_frame(p2p_socket_t* sock, p2p_session_t* session,
+                      const uint8_t* data, size_t length) {
+    if (session) {
+        return p2p_session_send(session, sock, data, length);
+    }
+    p2p_message_t msg = {.length = (uint32_t)length, .data = (uint8_t*)data};
+    return p2p_message_send(sock, &msg);
+}
+
+static int send_control(p2p_stream_writer_t* writer, uint8_t type) {
+    return send_frame(writer->sock, writer->session, &type, 1);
+}
+
+/**
+ * Send the buffered data as one chunk frame
+ */
+static int flush_window(p2p_stream_writer_t* writer) {
+    if (writer->buffered == 0) return 0;
+
+    writer->buffer[0] = STREAM_DATA;
+    if (send_frame(writer->sock, writer->session, writer->buffer, 1 + writer->buffered) != 0) {
+        writer->failed = 1;
+        return -1;
+    }
+
+    writer->buffered = 0;
+    return 0;
+}
+
+/**
+ * Plaintext only: send a full window straight from the caller's memory
+ */
+static int send_direct(p2p_stream_writer_t* writer, const uint8_t* data) {
+    uint8_t prefix[P2P_FRAME_HEADER_SIZE + 1];
+    p2p_frame_encode_header((uint32_t)(1 + writer->window), prefix);
+    prefix[P2P_FRAME_HEADER_SIZE] = STREAM_DATA;
+
+    if (p2p_send_exact(writer->sock, prefix, sizeof(prefix)) != 0 ||
+        p2p_send_exact(writer->sock, data, writer->window) != 0) {
+        writer->failed = 1;
+        return -1;
+    }
+
+    p2p_metric_add(p2p_socket_counters(writer->sock), P2P_METRIC_MESSAGES_OUT, 1);
+    return 0;
+}
+
+// ============================================================================
+// Sender
+// ============================================================================
+
+p2p_stream_writer_t* p2p_stream_begin(p2p_socket_t* sock, p2p_session_t* session,
+                                      uint64_t total_length, size_t window) {
+    if (!sock) return NULL;
+    if (window == 0) window = P2P_STREAM_DEFAULT_WINDOW;
+    if (window > P2P_STREAM_MAX_WINDOW) {
+        P2P_LOG_WARN("STREAM", "Window too large: %zu bytes (max: %d)",
+                     window, P2P_STREAM_MAX_WINDOW);
+        return NULL;
+    }
+
+    p2p_stream_writer_t* writer = (p2p_stream_writer_t*)calloc(1, sizeof(*writer));
+    if (!writer) return NULL;
+
+    writer->buffer = (uint8_t*)malloc(1 + window);
+    if (!writer->buffer) {
+        free(writer);
+        return NULL;
+    }
+    p2p_metric_add(NULL, P2P_METRIC_ALLOCATIONS, 1);
+
+    writer->sock = sock;
+    writer->session = session;
+    writer->total_length = total_length;
+    writer->window = window;
+
+    uint8_t begin[STREAM_BEGIN_SIZE];
+    memcpy(begin, STREAM_MAGIC, 4);
+    for (int i = 0; i < 8; i++) {
+        begin[4 + i] = (uint8_t)(total_length >> (56 - 8 * i));
+    }
+    p2p_frame_encode_header((uint32_t)window, begin + 12);
+
+    if (send_frame(sock, session, begin, sizeof(begin)) != 0) {
+        free(writer->buffer);
+        free(writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+int p2p_stream_write(p2p_stream_writer_t* writer, const void* data, size_t length) {
+    if (!writer || writer->failed || (!data && length > 0)) return -1;
+
+    if (writer->total_length != P2P_STREAM_UNKNOWN_LENGTH &&
+        length > writer->total_length - writer->written) {
+        P2P_LOG_WARN("STREAM", "Write past declared length (%llu bytes)",
+                     (unsigned long long)writer->total_length);
+        writer->failed = 1;
+        return -1;
+    }
+
+    const uint8_t* ptr = (const uint8_t*)data;
+    writer->written += length;
+
+    while (length > 0) {
+        // Whole windows skip the buffer on plaintext streams
+        if (!writer->session && writer->buffered == 0 && length >= writer->window) {
+            if (send_direct(writer, ptr) != 0) return -1;
+            ptr += writer->window;
+            length -= writer->window;
+            continue;
+        }
+
+        size_t space = writer->window - writer->buffered;
+        size_t n = length < space ? length : space;
+        memcpy(writer->buffer + 1 + writer->buffered, ptr, n);
+        writer->buffered += n;
+        ptr += n;
+        length -= n;
+
+        if (writer->buffered == writer->window && flush_window(writer) != 0) return -1;
+    }
+
+    return 0;
+}
+
+static void writer_free(p2p_stream_writer_t* writer) {
+    free(writer->buffer);
+    free(writer);
+}
+
+int p2p_stream_end(p2p_stream_writer_t* writer) {
+    if (!writer) return -1;
+
+    int rc = writer->failed ? -1 : flush_window(writer);
+
+    if (rc == 0 && writer->total_length != P2P_STREAM_UNKNOWN_LENGTH &&
+        writer->written != writer->total_length) {
+        P2P_LOG_WARN("STREAM", "Stream ended after %llu of %llu bytes",
+                     (unsigned long long)writer->written,
+                     (unsigned long long)writer->total_length);
+        rc = -1;
+    }
+
+    if (rc == 0) {
+        rc = send_control(writer, STREAM_END);
+    } else {
+        send_control(writer, STREAM_ABORT);     // Best effort
+    }
+
+    writer_free(writer);
+    return rc;
+}
+
+void p2p_stream_abort(p2p_stream_writer_t* writer) {
+    if (!writer) return;
+
+    send_control(writer, STREAM_ABORT);
+    writer_free(writer);
+}
+
+// ============================================================================
+// Receiver
+// ============================================================================
+
+/**
+ * Parse the begin frame
+ */
+static int parse_begin(const uint8_t* data, size_t length, uint64_t max_length,
+                       uint64_t* total_length, uint32_t* window) {
+    if (length != STREAM_BEGIN_SIZE || memcmp(data, STREAM_MAGIC, 4) != 0) {
+        P2P_LOG_WARN("STREAM", "Not a stream begin frame");
+        return -1;
+    }
+
+    *total_length = 0;
+    for (int i = 0; i < 8; i++) {
+        *total_length = (*total_length << 8) | data[4 + i];
+    }
+    *window = p2p_frame_decode_header(data + 12);
+
+    if (*window == 0 || *window > P2P_STREAM_MAX_WINDOW) {
+        P2P_LOG_WARN("STREAM", "Invalid stream window: %u", *window);
+        return -1;
+    }
+    if (*total_length != P2P_STREAM_UNKNOWN_LENGTH && *total_length > max_length) {
+        P2P_LOG_WARN("STREAM", "Stream too large: %llu bytes (max: %llu)",
+                     (unsigned long long)*total_length, (unsigned long long)max_length);
+        return -1;
+    }
+
+    return 0;
+}
+
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_session_t* session;
+    uint32_t window;
+    uint8_t* buffer;                    // Plaintext: one window
+} stream_reader_t;
+
+/**
+ * Read the next chunk frame. Data lands in *data (reader buffer or *msg).
+ *
+ * @return Frame type, or -1 on error/disconnect
+ */
+static int read_chunk(stream_reader_t* reader, const uint8_t** data, size_t* length,
+                      p2p_message_t** msg) {
+    *msg = NULL;
+
+    if (reader->session) {
+        *msg = p2p_session_recv(reader->session, reader->sock);
+        if (!*msg) return -1;
+        if ((*msg)->length > 1 + (size_t)reader->window) {
+            P2P_LOG_WARN("STREAM", "Chunk larger than window: %u bytes", (*msg)->length);
+            return -1;
+        }
+        *data = (*msg)->data + 1;
+        *length = (*msg)->length - 1;
+        return (*msg)->data[0];
+    }
+
+    uint8_t prefix[P2P_FRAME_HEADER_SIZE + 1];
+    if (p2p_recv_exact(reader->sock, prefix, sizeof(prefix)) != 0) return -1;
+
+    uint32_t frame_length = p2p_frame_decode_header(prefix);
+    if (frame_length == 0 || frame_length > 1 + reader->window) {
+        P2P_LOG_WARN("STREAM", "Invalid chunk frame: %u bytes", frame_length);
+        return -1;
+    }
+
+    *data = reader->buffer;
+    *length = frame_length - 1;
+    if (*length > 0 && p2p_recv_exact(reader->sock, reader->buffer, *length) != 0) return -1;
+
+    p2p_metric_add(p2p_socket_counters(reader->sock), P2P_METRIC_MESSAGES_IN, 1);
+    return prefix[P2P_FRAME_HEADER_SIZE];
+}
+
+int64_t p2p_stream_recv(p2p_socket_t* sock, p2p_session_t* session,
+                        p2p_stream_chunk_fn on_chunk, void* user_data,
+                        uint64_t max_length) {
+    if (!sock || !on_chunk) return -1;
+
+    p2p_message_t* begin = session ? p2p_session_recv(session, sock) : p2p_message_recv(sock);
+    if (!begin) return -1;
+
+    uint64_t total_length;
+    uint32_t window;
+    int rc = parse_begin(begin->data, begin->length, max_length, &total_length, &window);
+    p2p_message_free(begin);
+    if (rc != 0) return -1;
+
+    stream_reader_t reader = {sock, session, window, NULL};
+    if (!session) {
+        reader.buffer = (uint8_t*)malloc(window);
+        if (!reader.buffer) return -1;
+    }
+
+    uint64_t received = 0;
+    int64_t result = -1;
+
+    for (;;) {
+        const uint8_t* data = NULL;
+        size_t length = 0;
+        p2p_message_t* msg = NULL;
+        int type = read_chunk(&reader, &data, &length, &msg);
+
+        if (type == STREAM_DATA && length > 0) {
+            if (length > max_length - received ||
+                (total_length != P2P_STREAM_UNKNOWN_LENGTH && length > total_length - received)) {
+                P2P_LOG_WARN("STREAM", "Stream exceeds its length limit");
+                p2p_message_free(msg);
+                break;
+            }
+
+            int stop = on_chunk(data, length, received, user_data);
+            p2p_message_free(msg);
+            if (stop) break;
+
+            received += length;
+            continue;
+        }
+
+        p2p_message_free(msg);
+
+        if (type == STREAM_END && length == 0) {
+            if (total_length == P2P_STREAM_UNKNOWN_LENGTH || received == total_length) {
+                result = (int64_t)received;
+            } else {
+                P2P_LOG_WARN("STREAM", "Stream ended after %llu of %llu bytes",
+                             (unsigned long long)received, (unsigned long long)total_length);
+            }
+        } else if (type == STREAM_ABORT) {
+            P2P_LOG_WARN("STREAM", "Stream aborted by sender");
+        } else if (type >= 0) {
+            P2P_LOG_WARN("STREAM", "Invalid chunk frame type: %d", type);
+        }
+        break;
+    }
+
+    free(reader.buffer);
+    return result;
+}
@@ -0,0 +1,260 @@
+#include "histogram.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+/**
+ * Bucket layout
+ *
+ * Values below SUB_COUNT get one bucket each. Above that, the range
+ * [2^e, 2^(e+1)) is split into SUB_COUNT equal buckets, up to 2^MAX_EXP
+ * ns (~39 hours); larger values land in the last bucket.
+ */
+#define SUB_BITS    4
+#define SUB_COUNT   (1 << SUB_BITS)
+#define MAX_EXP     47
+#define NUM_BUCKETS (SUB_COUNT + (MAX_EXP - SUB_BITS + 1) * SUB_COUNT)
+
+/**
+ * Histogram internal structure
+ */
+struct p2p_histogram {
+    atomic_uint_fast64_t buckets[NUM_BUCKETS];
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t sum;
+    atomic_uint_fast64_t min_inv;   // UINT64_MAX - min, so zero means empty
+    atomic_uint_fast64_t max;
+};
+
+static const char* const latency_names[P2P_LATENCY_COUNT] = {
+    "hs_server_keygen",
+    "hs_server_recv_hello",
+    "hs_server_send_hello",
+    "hs_server_recv_key_exchange",
+    "hs_server_verify",
+    "hs_server_sign",
+    "hs_server_send_accept",
+    "hs_server_derive",
+    "hs_server_total",
+    "hs_client_total",
+    "loop_iteration",
+    "loop_dispatch_delay",
+    "loop_callback",
+    "encrypt_64",
+    "encrypt_1k",
+    "encrypt_16k",
+    "encrypt_large",
+    "decrypt_64",
+    "decrypt_1k",
+    "decrypt_16k",
+    "decrypt_large",
+};
+
+// Built-in histograms (all-zero is a valid empty histogram)
+static struct p2p_histogram g_latency[P2P_LATENCY_COUNT];
+
+atomic_int p2p_latency_on = 0;
+
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+/**
+ * Index of most significant set bit (value must be non-zero)
+ */
+static int msb_index(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+static size_t bucket_index(uint64_t value) {
+    if (value < SUB_COUNT) {
+        return (size_t)value;
+    }
+
+    int exp = msb_index(value);
+    if (exp > MAX_EXP) {
+        return NUM_BUCKETS - 1;
+    }
+
+    // Top SUB_BITS bits below the leading one select the sub-bucket
+    size_t sub = (size_t)(value >> (exp - SUB_BITS)) - SUB_COUNT;
+    return SUB_COUNT + (size_t)(exp - SUB_BITS) * SUB_COUNT + sub;
+}
+
+/**
+ * Highest value that maps to bucket
+ */
+static uint64_t bucket_upper(size_t index) {
+    if (index < SUB_COUNT) {
+        return index;
+    }
+
+    int shift = (int)((index - SUB_COUNT) / SUB_COUNT);
+    uint64_t sub = (index - SUB_COUNT) % SUB_COUNT + SUB_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+static void update_max(atomic_uint_fast64_t* slot, uint64_t value) {
+    uint64_t cur = atomic_load_explicit(slot, memory_order_relaxed);
+    while (value > cur &&
+           !atomic_compare_exchange_weak_explicit(slot, &cur, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+// ============================================================================
+// Internal
+// ============================================================================
+
+uint64_t p2p_latency_lap_since(p2p_latency_t id, uint64_t start_ns) {
+    uint64_t now = p2p_clock_ns();
+    if (atomic_load_explicit(&p2p_latency_on, memory_order_relaxed)) {
+        p2p_histogram_record(&g_latency[id], now - start_ns);
+    }
+    return now;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+p2p_histogram_t* p2p_histogram_create(void) {
+    p2p_histogram_t* hist = (p2p_histogram_t*)malloc(sizeof(p2p_histogram_t));
+    if (!hist) return NULL;
+
+    p2p_histogram_reset(hist);
+    return hist;
+}
+
+void p2p_histogram_free(p2p_histogram_t* hist) {
+    free(hist);
+}
+
+void p2p_histogram_record(p2p_histogram_t* hist, uint64_t value) {
+    if (!hist) return;
+
+    atomic_fetch_add_explicit(&hist->buckets[bucket_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum, value, memory_order_relaxed);
+    update_max(&hist->min_inv, UINT64_MAX - value);
+    update_max(&hist->max, value);
+}
+
+void p2p_histogram_reset(p2p_histogram_t* hist) {
+    if (!hist) return;
+
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        atomic_store_explicit(&hist->buckets[i], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&hist->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&hist->sum, 0, memory_order_relaxed);
+    atomic_store_explicit(&hist->min_inv, 0, memory_order_relaxed);
+    atomic_store_explicit(&hist->max, 0, memory_order_relaxed);
+}
+
+void p2p_histogram_merge(p2p_histogram_t* dst, const p2p_histogram_t* src) {
+    if (!dst || !src) return;
+
+    p2p_histogram_t* s = (p2p_histogram_t*)src;
+    uint64_t count = atomic_load_explicit(&s->count, memory_order_relaxed);
+    if (count == 0) return;
+
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        uint64_t n = atomic_load_explicit(&s->buckets[i], memory_order_relaxed);
+        if (n) {
+            atomic_fetch_add_explicit(&dst->buckets[i], n, memory_order_relaxed);
+        }
+    }
+    atomic_fetch_add_explicit(&dst->count, count, memory_order_relaxed);
+    atomic_fetch_add_explicit(&dst->sum,
+                              atomic_load_explicit(&s->sum, memory_order_relaxed),
+                              memory_order_relaxed);
+    update_max(&dst->min_inv, UINT64_MAX - p2p_histogram_min(src));
+    update_max(&dst->max, p2p_histogram_max(src));
+}
+
+uint64_t p2p_histogram_count(const p2p_histogram_t* hist) {
+    if (!hist) return 0;
+    return atomic_load_explicit(&((p2p_histogram_t*)hist)->count, memory_order_relaxed);
+}
+
+uint64_t p2p_histogram_min(const p2p_histogram_t* hist) {
+    if (p2p_histogram_count(hist) == 0) return 0;
+    return UINT64_MAX - atomic_load_explicit(&((p2p_histogram_t*)hist)->min_inv,
+                                             memory_order_relaxed);
+}
+
+uint64_t p2p_histogram_max(const p2p_histogram_t* hist) {
+    if (p2p_histogram_count(hist) == 0) return 0;
+    return atomic_load_explicit(&((p2p_histogram_t*)hist)->max, memory_order_relaxed);
+}
+
+double p2p_histogram_mean(const p2p_histogram_t* hist) {
+    uint64_t count = p2p_histogram_count(hist);
+    if (count == 0) return 0.0;
+
+    uint64_t sum = atomic_load_explicit(&((p2p_histogram_t*)hist)->sum, memory_order_relaxed);
+    return (double)sum / (double)count;
+}
+
+uint64_t p2p_histogram_percentile(const p2p_histogram_t* hist, double percentile) {
+    uint64_t count = p2p_histogram_count(hist);
+    if (count == 0) return 0;
+
+    if (percentile < 0.0) percentile = 0.0;
+    if (percentile > 100.0) percentile = 100.0;
+
+    // Rank of the value we want (1-based, rounded up, at least 1)
+    double exact = (percentile / 100.0) * (double)count;
+    uint64_t rank = (uint64_t)exact;
+    if ((double)rank < exact) rank++;
+    if (rank == 0) rank = 1;
+
+    p2p_histogram_t* h = (p2p_histogram_t*)hist;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(i);
+            uint64_t max = p2p_histogram_max(hist);
+            return upper < max ? upper : max;
+        }
+    }
+
+    return p2p_histogram_max(hist);
+}
+
+p2p_histogram_t* p2p_latency_histogram(p2p_latency_t id) {
+    if ((int)id < 0 || id >= P2P_LATENCY_COUNT) {
+        return NULL;
+    }
+    return &g_latency[id];
+}
+
+const char* p2p_latency_name(p2p_latency_t id) {
+    if ((int)id < 0 || id >= P2P_LATENCY_COUNT) {
+        return NULL;
+    }
+    return latency_names[id];
+}
+
+void p2p_latency_reset(void) {
+    for (int i = 0; i < P2P_LATENCY_COUNT; i++) {
+        p2p_histogram_reset(&g_latency[i]);
+    }
+}
+
+void p2p_latency_set_enabled(int enabled) {
+    atomic_store_explicit(&p2p_latency_on, enabled ? 1 : 0, memory_order_relaxed);
+}
@@ -0,0 +1,44 @@
+#ifndef P2PNET_UTIL_HISTOGRAM_H
+#define P2PNET_UTIL_HISTOGRAM_H
+
+/**
+ * Latency recording helpers (internal, not part of public API)
+ */
+
+#include "p2pnet/histogram.h"
+#include "../platform/clock.h"
+#include <stdatomic.h>
+
+/**
+ * Built-in recording switch (p2p_latency_set_enabled())
+ */
+extern atomic_int p2p_latency_on;
+
+/**
+ * Start time for a timed section, 0 with recording off (no clock read)
+ */
+static inline uint64_t p2p_latency_start(void) {
+    return atomic_load_explicit(&p2p_latency_on, memory_order_relaxed) ? p2p_clock_ns() : 0;
+}
+
+/**
+ * Out-of-line part of p2p_latency_lap()
+ */
+uint64_t p2p_latency_lap_since(p2p_latency_t id, uint64_t start_ns);
+
+/**
+ * Record (now - start_ns) into built-in histogram if recording is on
+ *
+ * start_ns == 0 (p2p_latency_start() with recording off) does nothing and
+ * returns 0. A caller that needs the time anyway passes p2p_clock_ns()
+ * and gets now back either way.
+ *
+ * @return now, so consecutive phases can be chained:
+ *   t = p2p_latency_lap(P2P_LATENCY_A, t);
+ *   t = p2p_latency_lap(P2P_LATENCY_B, t);
+ */
+static inline uint64_t p2p_latency_lap(p2p_latency_t id, uint64_t start_ns) {
+    return start_ns ? p2p_latency_lap_since(id, start_ns) : 0;
+}
+
+#endif /* P2PNET_UTIL_HISTOGRAM_H */
@@ -0,0 +1,303 @@
+#include "p2pnet/log.h"
+#include "../platform/thread.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * One message in the async ring
+ *
+ * seq follows the bounded MPMC queue scheme (Vyukov): a slot is free for
+ * the producer at position p when seq == p, and ready for the consumer
+ * when seq == p + 1.
+ */
+typedef struct {
+    atomic_size_t seq;
+    int level;
+    const char* tag;
+    char text[P2P_LOG_LINE_MAX];
+} log_slot_t;
+
+/**
+ * Async ring + background thread
+ */
+typedef struct {
+    log_slot_t* slots;
+    size_t mask;
+    atomic_size_t enqueue_pos;      // Producers (any thread)
+    size_t dequeue_pos;             // Consumer (background thread only)
+    atomic_int stop;
+    atomic_int sleeping;            // Consumer is (about to be) parked on wake
+    p2p_mutex_t lock;               // Guards the park/wake handoff only
+    p2p_cond_t wake;
+    p2p_thread_t thread;
+    p2p_log_sink downstream;
+    void* ctx;
+} log_ring_t;
+
+// Default: silent. A plain int in the public header (C++ and MSVC
+// consumers read it in the log macros); written here with relaxed atomics.
+volatile int p2p_log_threshold = P2P_LOG_LEVEL_OFF;
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define threshold_store(level) __atomic_store_n(&p2p_log_threshold, (level), __ATOMIC_RELAXED)
+    #define threshold_load() __atomic_load_n(&p2p_log_threshold, __ATOMIC_RELAXED)
+#else
+    // MSVC: aligned volatile int accesses are atomic
+    #define threshold_store(level) (p2p_log_threshold = (level))
+    #define threshold_load() (p2p_log_threshold)
+#endif
+
+// Sync sink + ctx, read as a pair under a seqlock (odd = being replaced)
+static atomic_uint g_sink_seq;
+static _Atomic(p2p_log_sink) g_sink = NULL;
+static _Atomic(void*) g_sink_ctx = NULL;
+static _Atomic(log_ring_t*) g_ring = NULL;
+static atomic_size_t g_dropped;
+
+// ============================================================================
+// Async ring
+// ============================================================================
+
+/**
+ * Producer: format straight into a free slot (never blocks)
+ */
+static void ring_write(log_ring_t* ring, int level, const char* tag,
+                       const char* fmt, va_list args) {
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    log_slot_t* slot;
+
+    for (;;) {
+        slot = &ring->slots[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;  // Slot claimed
+            }
+        } else if (diff < 0) {
+            // Ring full - drop instead of stalling the caller
+            atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->tag = tag;
+    vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+
+    // Publish. Sequentially consistent against ring_park(): either the
+    // consumer sees this slot before parking, or we see it parked and wake it
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->sleeping, memory_order_seq_cst)) {
+        p2p_mutex_lock(&ring->lock);
+        p2p_cond_signal(&ring->wake);
+        p2p_mutex_unlock(&ring->lock);
+    }
+}
+
+/**
+ * Consumer: pop one message into sink, returns 0 if ring is empty
+ */
+static int ring_drain_one(log_ring_t* ring) {
+    log_slot_t* slot = &ring->slots[ring->dequeue_pos & ring->mask];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+    if (seq != ring->dequeue_pos + 1) {
+        return 0;  // Empty (or producer still formatting)
+    }
+
+    if (ring->downstream) {
+        ring->downstream(slot->level, slot->tag, slot->text, ring->ctx);
+    }
+
+    // Free slot for the producer one lap ahead
+    atomic_store_explicit(&slot->seq, ring->dequeue_pos + ring->mask + 1,
+                          memory_order_release);
+    ring->dequeue_pos++;
+
+    return 1;
+}
+
+/**
+ * Consumer: block until the next slot is published or stop is requested
+ */
+static void ring_park(log_ring_t* ring) {
+    p2p_mutex_lock(&ring->lock);
+    atomic_store_explicit(&ring->sleeping, 1, memory_order_seq_cst);
+
+    log_slot_t* slot = &ring->slots[ring->dequeue_pos & ring->mask];
+    if (atomic_load_explicit(&slot->seq, memory_order_seq_cst) != ring->dequeue_pos + 1 &&
+        !atomic_load_explicit(&ring->stop, memory_order_acquire)) {
+        p2p_cond_wait(&ring->wake, &ring->lock);
+    }
+
+    atomic_store_explicit(&ring->sleeping, 0, memory_order_relaxed);
+    p2p_mutex_unlock(&ring->lock);
+}
+
+static P2P_THREAD_FUNC(drain_main) {
+    log_ring_t* ring = (log_ring_t*)arg;
+
+    while (!atomic_load_explicit(&ring->stop, memory_order_acquire)) {
+        if (!ring_drain_one(ring)) {
+            ring_park(ring);
+        }
+    }
+
+    // Flush whatever is left
+    while (ring_drain_one(ring)) {
+    }
+
+    P2P_THREAD_EXIT;
+}
+
+// ============================================================================
+// Sync sink
+// ============================================================================
+
+/**
+ * Consistent snapshot of sink and ctx (never the new sink with the old ctx)
+ */
+static p2p_log_sink sink_load(void** ctx) {
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&g_sink_seq, memory_order_acquire);
+        if (seq & 1) continue;              // Writer in progress
+
+        p2p_log_sink sink = atomic_load_explicit(&g_sink, memory_order_relaxed);
+        *ctx = atomic_load_explicit(&g_sink_ctx, memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&g_sink_seq, memory_order_relaxed) == seq) {
+            return sink;
+        }
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void p2p_log_set_level(int level) {
+    threshold_store(level);
+}
+
+void p2p_log_set_sink(p2p_log_sink sink, void* ctx) {
+    // Take the seqlock (odd); concurrent setters wait for each other
+    unsigned seq = atomic_load_explicit(&g_sink_seq, memory_order_relaxed);
+    for (;;) {
+        if (!(seq & 1) &&
+            atomic_compare_exchange_weak_explicit(&g_sink_seq, &seq, seq + 1,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            break;
+        }
+        seq = atomic_load_explicit(&g_sink_seq, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&g_sink, sink, memory_order_relaxed);
+    atomic_store_explicit(&g_sink_ctx, ctx, memory_order_relaxed);
+
+    atomic_store_explicit(&g_sink_seq, seq + 2, memory_order_release);
+}
+
+void p2p_log_stderr_sink(int level, const char* tag, const char* message, void* ctx) {
+    (void)level;
+    (void)ctx;
+    fprintf(stderr, "[%s] %s\n", tag ? tag : "P2P", message);
+}
+
+int p2p_log_async_start(size_t capacity, p2p_log_sink downstream, void* ctx) {
+    if (atomic_load_explicit(&g_ring, memory_order_acquire) || capacity == 0) {
+        return -1;
+    }
+
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    log_ring_t* ring = (log_ring_t*)calloc(1, sizeof(log_ring_t));
+    if (!ring) return -1;
+
+    ring->slots = (log_slot_t*)calloc(size, sizeof(log_slot_t));
+    if (!ring->slots) {
+        free(ring);
+        return -1;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&ring->slots[i].seq, i);
+    }
+
+    ring->mask = size - 1;
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->stop, 0);
+    atomic_init(&ring->sleeping, 0);
+    p2p_mutex_init(&ring->lock);
+    p2p_cond_init(&ring->wake);
+    ring->downstream = downstream;
+    ring->ctx = ctx;
+
+    if (p2p_thread_start(&ring->thread, drain_main, ring) != 0) {
+        p2p_cond_destroy(&ring->wake);
+        p2p_mutex_destroy(&ring->lock);
+        free(ring->slots);
+        free(ring);
+        return -1;
+    }
+
+    atomic_store_explicit(&g_ring, ring, memory_order_release);
+    return 0;
+}
+
+void p2p_log_async_stop(void) {
+    log_ring_t* ring = atomic_exchange_explicit(&g_ring, NULL, memory_order_acq_rel);
+    if (!ring) return;
+
+    atomic_store_explicit(&ring->stop, 1, memory_order_release);
+    p2p_mutex_lock(&ring->lock);
+    p2p_cond_signal(&ring->wake);
+    p2p_mutex_unlock(&ring->lock);
+    p2p_thread_join(ring->thread);
+
+    p2p_cond_destroy(&ring->wake);
+    p2p_mutex_destroy(&ring->lock);
+    free(ring->slots);
+    free(ring);
+}
+
+size_t p2p_log_dropped(void) {
+    return atomic_load_explicit(&g_dropped, memory_order_relaxed);
+}
+
+void p2p_log_write(int level, const char* tag, const char* fmt, ...) {
+    if (level < threshold_load()) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+
+    log_ring_t* ring = atomic_load_explicit(&g_ring, memory_order_acquire);
+    void* ctx;
+    p2p_log_sink sink;
+    if (ring) {
+        ring_write(ring, level, tag, fmt, args);
+    } else if ((sink = sink_load(&ctx)) != NULL) {
+        char text[P2P_LOG_LINE_MAX];
+        vsnprintf(text, sizeof(text), fmt, args);
+        sink(level, tag, text, ctx);
+    }
+
+    va_end(args);
+}
@@ -0,0 +1,137 @@
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const metric_names[P2P_METRIC_COUNT] = {
+    "bytes_in",
+    "bytes_out",
+    "messages_in",
+    "messages_out",
+    "syscalls",
+    "partial_reads",
+    "partial_writes",
+    "aead_failures",
+    "replay_rejects",
+    "handshakes_started",
+    "handshakes_completed",
+    "handshakes_failed",
+    "allocations",
+    "loop_iterations",
+    "callbacks",
+    "zerocopy_sends",
+    "zerocopy_copied",
+    "accept_rejects",
+};
+
+P2P_THREAD_LOCAL p2p_counters_t* p2p_metrics_shard = NULL;
+
+/**
+ * Thread shard (p2p_metrics_shard points at `counters`)
+ */
+typedef struct metrics_shard {
+    p2p_counters_t counters;
+    struct metrics_shard* next_free;
+} metrics_shard_t;
+
+// All shards ever created (push-only, summed by p2p_metrics_global())
+static _Atomic(p2p_counters_t*) g_shards = NULL;
+
+// Shards of exited threads. Their totals stay in place and the next thread
+// to take one keeps counting on top, so shards are bounded by peak thread
+// count and the lock-free reader never sees totals move between shards.
+static p2p_mutex_t g_free_lock = P2P_MUTEX_INITIALIZER;
+static metrics_shard_t* g_free_shards = NULL;
+static p2p_tls_key_t g_exit_key;
+static int g_exit_key_state = 0;       // 0 = not created, 1 = ok, -1 = failed
+
+// ============================================================================
+// Internal
+// ============================================================================
+
+/**
+ * Thread exit: hand the shard to the next thread
+ */
+static P2P_TLS_DESTRUCTOR(shard_retire) {
+    metrics_shard_t* shard = (metrics_shard_t*)value;
+    p2p_metrics_shard = NULL;           // Later exit callbacks get a fresh shard
+
+    p2p_mutex_lock(&g_free_lock);
+    shard->next_free = g_free_shards;
+    g_free_shards = shard;
+    p2p_mutex_unlock(&g_free_lock);
+}
+
+p2p_counters_t* p2p_metrics_shard_create(void) {
+    p2p_mutex_lock(&g_free_lock);
+    if (g_exit_key_state == 0) {
+        g_exit_key_state = p2p_tls_key_create(&g_exit_key, shard_retire) == 0 ? 1 : -1;
+    }
+    int recycle = g_exit_key_state == 1;
+    metrics_shard_t* shard = g_free_shards;
+    if (shard) {
+        g_free_shards = shard->next_free;
+    }
+    p2p_mutex_unlock(&g_free_lock);
+
+    if (!shard) {
+        shard = (metrics_shard_t*)malloc(sizeof(metrics_shard_t));
+        if (!shard) return NULL;
+
+        p2p_counters_init(&shard->counters);
+
+        // Lock-free push
+        p2p_counters_t* head = atomic_load_explicit(&g_shards, memory_order_relaxed);
+        do {
+            shard->counters.next = head;
+        } while (!atomic_compare_exchange_weak_explicit(&g_shards, &head, &shard->counters,
+                                                        memory_order_release,
+                                                        memory_order_relaxed));
+    }
+
+    // Without an exit callback the shard just stays with this thread
+    if (recycle) {
+        p2p_tls_set(g_exit_key, shard);
+    }
+
+    p2p_metrics_shard = &shard->counters;
+    return &shard->counters;
+}
+
+void p2p_counters_init(p2p_counters_t* counters) {
+    for (int i = 0; i < P2P_METRIC_COUNT; i++) {
+        atomic_init(&counters->values[i], 0);
+    }
+    counters->next = NULL;
+}
+
+void p2p_counters_read(const p2p_counters_t* counters, p2p_metrics_t* out) {
+    for (int i = 0; i < P2P_METRIC_COUNT; i++) {
+        out->values[i] = atomic_load_explicit(
+            (atomic_uint_fast64_t*)&counters->values[i], memory_order_relaxed);
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+const char* p2p_metric_name(p2p_metric_t metric) {
+    if ((int)metric < 0 || metric >= P2P_METRIC_COUNT) {
+        return NULL;
+    }
+    return metric_names[metric];
+}
+
+void p2p_metrics_global(p2p_metrics_t* out) {
+    if (!out) return;
+
+    memset(out, 0, sizeof(*out));
+
+    p2p_counters_t* shard = atomic_load_explicit(&g_shards, memory_order_acquire);
+    while (shard) {
+        for (int i = 0; i < P2P_METRIC_COUNT; i++) {
+            out->values[i] += atomic_load_explicit(&shard->values[i], memory_order_relaxed);
+        }
+        shard = shard->next;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef P2PNET_UTIL_METRICS_H
+#define P2PNET_UTIL_METRICS_H
+
+/**
+ * Counter storage (internal, not part of public API)
+ *
+ * Objects (socket, loop) embed a p2p_counters_t. p2p_metric_add()
+ * bumps the object's counter and the calling thread's global shard, so
+ * global totals never contend on a shared cache line.
+ */
+
+#include "p2pnet/metrics.h"
+#include "../platform/thread.h"
+#include <stdatomic.h>
+
+/**
+ * One set of counters
+ */
+typedef struct p2p_counters {
+    atomic_uint_fast64_t values[P2P_METRIC_COUNT];
+    struct p2p_counters* next;      // Shard list link (thread shards only)
+} p2p_counters_t;
+
+/**
+ * Calling thread's shard (NULL until first use)
+ */
+extern P2P_THREAD_LOCAL p2p_counters_t* p2p_metrics_shard;
+
+/**
+ * Allocate and register shard for calling thread (slow path)
+ */
+p2p_counters_t* p2p_metrics_shard_create(void);
+
+/**
+ * Zero all counters
+ */
+void p2p_counters_init(p2p_counters_t* counters);
+
+/**
+ * Copy counters to snapshot
+ */
+void p2p_counters_read(const p2p_counters_t* counters, p2p_metrics_t* out);
+
+/**
+ * Add n to metric on object (can be NULL) and on this thread's shard
+ */
+static inline void p2p_metric_add(p2p_counters_t* obj, p2p_metric_t metric, uint64_t n) {
+    if (obj) {
+        atomic_fetch_add_explicit(&obj->values[metric], n, memory_order_relaxed);
+    }
+
+    p2p_counters_t* shard = p2p_metrics_shard;
+    if (!shard) {
+        shard = p2p_metrics_shard_create();
+        if (!shard) return;
+    }
+
+    // Only this thread writes its shard: load + store, no locked RMW
+    uint64_t v = atomic_load_explicit(&shard->values[metric], memory_order_relaxed);
+    atomic_store_explicit(&shard->values[metric], v + n, memory_order_relaxed);
+}
+
+/**
+ * Socket counters (socket_*.c)
+ */
+p2p_counters_t* p2p_socket_counters(p2p_socket_t* sock);
+
+#endif /* P2PNET_UTIL_METRICS_H */
@@ -0,0 +1,81 @@
+#ifndef P2PNET_UTIL_MPSC_H
+#define P2PNET_UTIL_MPSC_H
+
+/**
+ * Lock-free multi-producer single-consumer queue (internal, not part of
+ * public API)
+ *
+ * Intrusive: embed a p2p_mpsc_node_t as the first member of the queued
+ * struct. Push is one atomic exchange plus one store, wait-free for any
+ * number of producer threads; pop is consumer-only and never locks.
+ * FIFO per producer (Vyukov's MPSC list with a stub node).
+ *
+ * Pop can briefly return NULL while a push is half done (exchanged the
+ * head but not yet linked); the producer always finishes, so callers
+ * pair the queue with a wakeup that is signalled after push returns.
+ */
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+typedef struct p2p_mpsc_node {
+    _Atomic(struct p2p_mpsc_node*) next;
+} p2p_mpsc_node_t;
+
+typedef struct {
+    _Atomic(p2p_mpsc_node_t*) head;     // Last pushed (producers)
+    p2p_mpsc_node_t* tail;              // Next to pop (consumer)
+    p2p_mpsc_node_t stub;
+} p2p_mpsc_queue_t;
+
+static inline void p2p_mpsc_init(p2p_mpsc_queue_t* queue) {
+    atomic_init(&queue->stub.next, NULL);
+    atomic_init(&queue->head, &queue->stub);
+    queue->tail = &queue->stub;
+}
+
+/**
+ * Append node (any thread)
+ */
+static inline void p2p_mpsc_push(p2p_mpsc_queue_t* queue, p2p_mpsc_node_t* node) {
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    p2p_mpsc_node_t* prev = atomic_exchange_explicit(&queue->head, node, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+/**
+ * Remove oldest node (consumer thread only)
+ *
+ * @return Node, or NULL if empty (or a push is in progress)
+ */
+static inline p2p_mpsc_node_t* p2p_mpsc_pop(p2p_mpsc_queue_t* queue) {
+    p2p_mpsc_node_t* tail = queue->tail;
+    p2p_mpsc_node_t* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    if (tail == &queue->stub) {
+        if (!next) return NULL;
+        queue->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+
+    // tail is the last node: only take it after re-inserting the stub behind it
+    if (tail != atomic_load_explicit(&queue->head, memory_order_acquire)) {
+        return NULL;
+    }
+
+    p2p_mpsc_push(queue, &queue->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+#endif /* P2PNET_UTIL_MPSC_H */
@@ -53,6 +53,11 @@ MU_TEST(test_keypair_fingerprint)
     // Base64 of 32 bytes = 43 chars (no padding)
     mu_check(strlen(fp) == 43);
 
+    // Round trip back to the public key
+    uint8_t pubkey[32];
+    mu_check(p2p_pubkey_from_fingerprint(pubkey, fp) == 0);
+    mu_check(memcmp(pubkey, kp->public_key, 32) == 0);
+
     p2p_keypair_free(kp);
     return NULL; // ← Legg til
 }
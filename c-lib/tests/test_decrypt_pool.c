@@ -0,0 +1,344 @@
+#include "minunit.h"
+#include <p2pnet/p2pnet.h>
+#include <sodium.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>
+    #define THREAD_RETURN unsigned int __stdcall
+    #define THREAD_HANDLE HANDLE
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #define THREAD_RETURN void*
+    #define THREAD_HANDLE pthread_t
+#endif
+
+static THREAD_HANDLE start_thread(THREAD_RETURN (*fn)(void*), void* arg) {
+    #ifdef _WIN32
+        return (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    #else
+        THREAD_HANDLE thread;
+        pthread_create(&thread, NULL, fn, arg);
+        return thread;
+    #endif
+}
+
+static void wait_for_thread(THREAD_HANDLE thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+static void sleep_ms(int ms) {
+    #ifdef _WIN32
+        Sleep(ms);
+    #else
+        usleep(ms * 1000);
+    #endif
+}
+
+// ============================================================================
+// Test link: sender session -> relay pair -> receive pair
+// ============================================================================
+
+#define LINK_RING (8 * 1024 * 1024)
+
+typedef struct {
+    p2p_session_t* tx;          // Seals records
+    p2p_session_t* rx;          // Same key, opens them through the pool
+    p2p_socket_t* relay_in;     // tx writes here
+    p2p_socket_t* relay_out;    // Raw records read back here
+    p2p_socket_t* wire_in;      // Records (maybe tampered) forwarded here
+    p2p_socket_t* wire_out;     // p2p_session_recv_async() reads here
+} link_t;
+
+static int link_open(link_t* link) {
+    uint8_t key[32];
+    uint8_t pubkey[32];
+    randombytes_buf(key, sizeof(key));
+    randombytes_buf(pubkey, sizeof(pubkey));
+
+    memset(link, 0, sizeof(*link));
+    link->tx = p2p_session_create(key, pubkey);
+    link->rx = p2p_session_create(key, pubkey);
+    if (!link->tx || !link->rx) return -1;
+    if (p2p_socket_pair_memory(&link->relay_in, &link->relay_out, LINK_RING) != 0) return -1;
+    if (p2p_socket_pair_memory(&link->wire_in, &link->wire_out, LINK_RING) != 0) return -1;
+    return 0;
+}
+
+static void link_close(link_t* link) {
+    p2p_socket_close(link->relay_in);
+    p2p_socket_close(link->relay_out);
+    p2p_socket_close(link->wire_in);
+    p2p_socket_close(link->wire_out);
+    p2p_session_free(link->tx);
+    p2p_session_free(link->rx);
+}
+
+static int recv_all(p2p_socket_t* sock, uint8_t* buf, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = p2p_socket_recv(sock, buf + done, length - done);
+        if (n <= 0) return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Seal record `seq` (payload starts with seq) onto the wire, flipping the
+ * last MAC byte if `tamper`
+ */
+static int link_send(link_t* link, uint32_t seq, size_t length, int tamper) {
+    uint8_t* data = (uint8_t*)malloc(length);
+    if (!data) return -1;
+    memset(data, (int)(seq & 0xff), length);
+    memcpy(data, &seq, sizeof(seq));
+    int rc = p2p_session_send(link->tx, link->relay_in, data, length);
+    free(data);
+    if (rc != 0) return -1;
+
+    // Length header, then nonce + ciphertext + MAC
+    uint8_t header[4];
+    if (recv_all(link->relay_out, header, sizeof(header)) != 0) return -1;
+    size_t record_len = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) |
+                        ((size_t)header[2] << 8) | header[3];
+
+    uint8_t* record = (uint8_t*)malloc(sizeof(header) + record_len);
+    if (!record) return -1;
+    memcpy(record, header, sizeof(header));
+    rc = recv_all(link->relay_out, record + sizeof(header), record_len);
+    if (rc == 0 && tamper) {
+        record[sizeof(header) + record_len - 1] ^= 0x01;
+    }
+    if (rc == 0 && p2p_socket_send(link->wire_in, record, sizeof(header) + record_len) !=
+                   (ssize_t)(sizeof(header) + record_len)) {
+        rc = -1;
+    }
+    free(record);
+    return rc;
+}
+
+// ============================================================================
+// Delivery bookkeeping
+// ============================================================================
+
+#define MAX_RECORDS 64
+
+typedef struct {
+    volatile int delivered;
+    int failed_at[MAX_RECORDS];         // 1 if delivered as NULL
+    int out_of_order;
+    volatile int gate_closed;           // Callback spins while set
+    int slow;                           // Callback sleeps 1 ms per record
+} sink_t;
+
+static void on_message(p2p_session_t* session, p2p_message_t* msg, void* user_data) {
+    (void)session;
+    sink_t* sink = (sink_t*)user_data;
+
+    while (sink->gate_closed) {
+        sleep_ms(1);
+    }
+    if (sink->slow) {
+        sleep_ms(1);
+    }
+
+    int seq = sink->delivered;
+    if (msg) {
+        uint32_t got;
+        memcpy(&got, msg->data, sizeof(got));
+        if ((int)got != seq) sink->out_of_order = 1;
+        p2p_message_free(msg);
+    } else if (seq < MAX_RECORDS) {
+        sink->failed_at[seq] = 1;
+    }
+    sink->delivered = seq + 1;
+}
+
+// ============================================================================
+// Test 1: In-order delivery while workers finish out of order
+// ============================================================================
+
+MU_TEST(test_decrypt_pool_order) {
+    link_t link;
+    mu_check(link_open(&link) == 0);
+
+    sink_t sink = {0};
+    p2p_decrypt_pool_t* pool = p2p_decrypt_pool_create(4, 0);
+    mu_check(pool != NULL);
+
+    // A large record first: the small ones behind it finish on other workers
+    // long before it does, and must still wait for it
+    for (uint32_t seq = 0; seq < 32; seq++) {
+        size_t length = seq % 8 == 0 ? P2P_MAX_MESSAGE_SIZE : 16;
+        mu_check(link_send(&link, seq, length, 0) == 0);
+        mu_check(p2p_session_recv_async(pool, link.rx, link.wire_out, on_message, &sink) == 0);
+    }
+
+    p2p_decrypt_pool_flush(pool);
+    mu_check(sink.delivered == 32);
+    mu_check(!sink.out_of_order);
+    for (int i = 0; i < 32; i++) {
+        mu_check(!sink.failed_at[i]);
+    }
+
+    p2p_decrypt_pool_free(pool);
+    link_close(&link);
+    return NULL;
+}
+
+// ============================================================================
+// Test 2: MAC failure is delivered in its place, later records still open
+// ============================================================================
+
+MU_TEST(test_decrypt_pool_mac_failure) {
+    link_t link;
+    mu_check(link_open(&link) == 0);
+
+    sink_t sink = {0};
+    p2p_decrypt_pool_t* pool = p2p_decrypt_pool_create(3, 0);
+    mu_check(pool != NULL);
+
+    for (uint32_t seq = 0; seq < 10; seq++) {
+        mu_check(link_send(&link, seq, seq == 5 ? 64 * 1024 : 100, seq == 5) == 0);
+        mu_check(p2p_session_recv_async(pool, link.rx, link.wire_out, on_message, &sink) == 0);
+    }
+
+    p2p_decrypt_pool_flush(pool);
+    mu_check(sink.delivered == 10);
+    for (int i = 0; i < 10; i++) {
+        mu_check(sink.failed_at[i] == (i == 5));
+    }
+    mu_check(!sink.out_of_order);
+
+    p2p_decrypt_pool_free(pool);
+    link_close(&link);
+    return NULL;
+}
+
+// ============================================================================
+// Test 3: Submit blocks once max_in_flight records are undelivered
+// ============================================================================
+
+#define WINDOW 4
+#define BACKPRESSURE_RECORDS 12
+
+typedef struct {
+    p2p_decrypt_pool_t* pool;
+    link_t* link;
+    sink_t* sink;
+    volatile int submitted;
+} submitter_t;
+
+static THREAD_RETURN submit_thread(void* arg) {
+    submitter_t* s = (submitter_t*)arg;
+    for (int i = 0; i < BACKPRESSURE_RECORDS; i++) {
+        if (p2p_session_recv_async(s->pool, s->link->rx, s->link->wire_out,
+                                   on_message, s->sink) != 0) {
+            break;
+        }
+        s->submitted = i + 1;
+    }
+    return 0;
+}
+
+MU_TEST(test_decrypt_pool_backpressure) {
+    link_t link;
+    mu_check(link_open(&link) == 0);
+    for (uint32_t seq = 0; seq < BACKPRESSURE_RECORDS; seq++) {
+        mu_check(link_send(&link, seq, 32, 0) == 0);
+    }
+
+    sink_t sink = {0};
+    sink.gate_closed = 1;                       // First delivery blocks
+    p2p_decrypt_pool_t* pool = p2p_decrypt_pool_create(2, WINDOW);
+    mu_check(pool != NULL);
+
+    submitter_t submitter = {pool, &link, &sink, 0};
+    THREAD_HANDLE thread = start_thread(submit_thread, &submitter);
+
+    for (int i = 0; i < 2000 && submitter.submitted < WINDOW; i++) {
+        sleep_ms(1);
+    }
+    sleep_ms(50);                               // Would overrun by now if unbounded
+    mu_check(submitter.submitted == WINDOW);
+    mu_check(sink.delivered == 0);
+
+    sink.gate_closed = 0;
+    wait_for_thread(thread);
+    mu_check(submitter.submitted == BACKPRESSURE_RECORDS);
+
+    p2p_decrypt_pool_flush(pool);
+    mu_check(sink.delivered == BACKPRESSURE_RECORDS);
+    mu_check(!sink.out_of_order);
+
+    p2p_decrypt_pool_free(pool);
+    link_close(&link);
+    return NULL;
+}
+
+// ============================================================================
+// Test 4: Free with records in flight delivers them all first
+// ============================================================================
+
+MU_TEST(test_decrypt_pool_free_in_flight) {
+    link_t link;
+    mu_check(link_open(&link) == 0);
+
+    sink_t sink = {0};
+    sink.slow = 1;
+    p2p_decrypt_pool_t* pool = p2p_decrypt_pool_create(2, 16);
+    mu_check(pool != NULL);
+
+    for (uint32_t seq = 0; seq < 16; seq++) {
+        mu_check(link_send(&link, seq, 256, 0) == 0);
+        mu_check(p2p_session_recv_async(pool, link.rx, link.wire_out, on_message, &sink) == 0);
+    }
+    mu_check(sink.delivered < 16);              // Slow callback: still in flight
+
+    p2p_decrypt_pool_free(pool);
+    mu_check(sink.delivered == 16);
+    mu_check(!sink.out_of_order);
+
+    // Flush on an idle pool returns at once; NULL pool is a no-op
+    pool = p2p_decrypt_pool_create(1, 0);
+    p2p_decrypt_pool_flush(pool);
+    p2p_decrypt_pool_free(pool);
+    p2p_decrypt_pool_flush(NULL);
+    p2p_decrypt_pool_free(NULL);
+    mu_check(p2p_decrypt_pool_create(0, 0) == NULL);
+
+    link_close(&link);
+    return NULL;
+}
+
+MU_TEST_SUITE(decrypt_pool_suite) {
+    MU_RUN_TEST(test_decrypt_pool_order);
+    MU_RUN_TEST(test_decrypt_pool_mac_failure);
+    MU_RUN_TEST(test_decrypt_pool_backpressure);
+    MU_RUN_TEST(test_decrypt_pool_free_in_flight);
+    return NULL;
+}
+
+int main() {
+    printf("========================================\n");
+    printf(" Running Decrypt Pool Tests             \n");
+    printf("========================================\n\n");
+
+    if (p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    MU_RUN_SUITE(decrypt_pool_suite);
+    MU_REPORT();
+
+    return MU_EXIT_CODE;
+}
@@ -2,6 +2,56 @@
 #include <p2pnet/p2pnet.h>
 #include <string.h>
 
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>
+    #define THREAD_RETURN unsigned int __stdcall
+    #define THREAD_HANDLE HANDLE
+#else
+    #include <pthread.h>
+    #include <time.h>
+    #include <unistd.h>
+    #define THREAD_RETURN void*
+    #define THREAD_HANDLE pthread_t
+#endif
+
+static THREAD_HANDLE start_thread(THREAD_RETURN (*fn)(void*), void* arg) {
+    #ifdef _WIN32
+        return (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    #else
+        THREAD_HANDLE thread;
+        pthread_create(&thread, NULL, fn, arg);
+        return thread;
+    #endif
+}
+
+static void wait_for_thread(THREAD_HANDLE thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+static uint64_t now_ms(void) {
+    #ifdef _WIN32
+        return GetTickCount64();
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+    #endif
+}
+
+static void sleep_ms(int ms) {
+    #ifdef _WIN32
+        Sleep(ms);
+    #else
+        usleep(ms * 1000);
+    #endif
+}
+
 // Global state for testing
 static int callback_invoked = 0;
 static int error_callback_invoked = 0;
@@ -281,6 +331,438 @@ MU_TEST(test_event_loop_add_duplicate) {
     return NULL;
 }
 
+// ============================================================================
+// Test 9: Batch Delivery
+// ============================================================================
+
+#define BATCH_MESSAGES 100
+#define BATCH_MAX 16
+
+typedef struct {
+    p2p_event_loop_t* loop;
+    p2p_socket_t* sock;
+    int received;
+    int callbacks;
+    size_t largest;
+    int corrupt;
+    int error;                  // Last on_error code, 1 = not called
+    int remove_after;           // Remove the socket after N callbacks (0 = never)
+    size_t largest_bytes;       // Most payload bytes in one callback
+    int last_sequence;          // Loop-wide callback number of the last callback
+} batch_sink_t;
+
+static int batch_sequence = 0;
+
+static void batch_read(p2p_socket_t* sock, const p2p_message_t* messages,
+                       size_t count, void* user_data) {
+    batch_sink_t* sink = (batch_sink_t*)user_data;
+    
+    for (size_t i = 0; i < count; i++) {
+        // Message k is k+1 bytes of the value k
+        int k = sink->received + (int)i;
+        if (messages[i].length != (uint32_t)(k + 1) || messages[i].data[0] != (uint8_t)k ||
+            messages[i].data[k] != (uint8_t)k) {
+            sink->corrupt = 1;
+        }
+    }
+    
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) bytes += messages[i].length;
+    
+    sink->received += (int)count;
+    sink->callbacks++;
+    sink->last_sequence = ++batch_sequence;
+    if (count > sink->largest) sink->largest = count;
+    if (bytes > sink->largest_bytes) sink->largest_bytes = bytes;
+    
+    if (sink->remove_after && sink->callbacks == sink->remove_after) {
+        p2p_event_loop_remove_socket(sink->loop, sock);
+    }
+}
+
+static void batch_error(p2p_socket_t* sock, int error, void* user_data) {
+    batch_sink_t* sink = (batch_sink_t*)user_data;
+    sink->error = error;
+    p2p_event_loop_remove_socket(sink->loop, sock);
+}
+
+static void send_numbered(p2p_socket_t* sock, int count) {
+    uint8_t data[BATCH_MESSAGES];
+    for (int k = 0; k < count; k++) {
+        memset(data, k, (size_t)k + 1);
+        p2p_message_t msg = {.length = (uint32_t)(k + 1), .data = data};
+        p2p_message_send(sock, &msg);
+    }
+}
+
+MU_TEST(test_event_loop_batch) {
+    p2p_init();
+    
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+    
+    // Everything queued before the loop runs, then the peer goes away
+    send_numbered(a, BATCH_MESSAGES);
+    p2p_socket_close(a);
+    
+    batch_sink_t sink = {p2p_event_loop_create(), b, 0, 0, 0, 0, 1, 0, 0, 0};
+    mu_check(p2p_event_loop_add_socket_batch(sink.loop, b, batch_read, batch_error,
+                                             BATCH_MAX, &sink) == 0);
+    p2p_event_loop_run(sink.loop);      // Returns once on_error removed the socket
+    
+    mu_check(sink.received == BATCH_MESSAGES);
+    mu_check(!sink.corrupt);
+    mu_check(sink.largest == BATCH_MAX);
+    mu_check(sink.callbacks < BATCH_MESSAGES);
+    mu_check(sink.error == 0);          // Orderly close after the last message
+    
+    p2p_event_loop_free(sink.loop);
+    p2p_socket_close(b);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
+// ============================================================================
+// Test 10: Batch Fairness, Removal and Bad Frames
+// ============================================================================
+
+MU_TEST(test_event_loop_batch_fairness) {
+    p2p_init();
+    
+    p2p_event_loop_t* loop = p2p_event_loop_create();
+    p2p_socket_t* a[2];
+    p2p_socket_t* b[2];
+    batch_sink_t sinks[2];
+    
+    for (int i = 0; i < 2; i++) {
+        mu_check(p2p_socket_pair(&a[i], &b[i]) == 0);
+        send_numbered(a[i], BATCH_MESSAGES);
+        batch_sink_t init = {loop, b[i], 0, 0, 0, 0, 1, 0, 0, 0};
+        sinks[i] = init;
+        mu_check(p2p_event_loop_add_socket_batch(loop, b[i], batch_read, batch_error,
+                                                 10, &sinks[i]) == 0);
+    }
+    
+    // The first socket is removed from inside its own callback after 3 batches;
+    // the second must still have been served in between
+    sinks[0].remove_after = 3;
+    p2p_socket_close(a[1]);
+    p2p_event_loop_run(loop);
+    
+    mu_check(sinks[0].received == 30);
+    mu_check(sinks[0].error == 1);
+    mu_check(sinks[1].received == BATCH_MESSAGES);
+    mu_check(!sinks[0].corrupt && !sinks[1].corrupt);
+    mu_check(sinks[1].largest == 10);
+    
+    // A zero length header is a protocol error
+    uint8_t bad[4] = {0, 0, 0, 0};
+    p2p_socket_send(a[0], bad, sizeof(bad));
+    batch_sink_t sink = {loop, b[0], 0, 0, 0, 0, 1, 0, 0, 0};
+    mu_check(p2p_event_loop_add_socket_batch(loop, b[0], batch_read, batch_error, 0, &sink) == 0);
+    p2p_event_loop_run(loop);
+    mu_check(sink.error == -1);
+    
+    mu_check(p2p_event_loop_add_socket_batch(loop, b[0], NULL, NULL, 0, NULL) == -1);
+    
+    p2p_event_loop_free(loop);
+    for (int i = 0; i < 2; i++) {
+        if (i == 0) p2p_socket_close(a[i]);
+        p2p_socket_close(b[i]);
+    }
+    p2p_cleanup();
+    
+    return NULL;
+}
+
+// ============================================================================
+// Test 11: Read Budget and Round-Robin
+// ============================================================================
+
+MU_TEST(test_event_loop_read_budget) {
+    p2p_init();
+    
+    p2p_event_loop_t* loop = p2p_event_loop_create();
+    p2p_event_loop_set_read_budget(loop, 0, 4);
+    
+    // One flooding peer and one quiet peer, both ready in the first round
+    p2p_socket_t* a[2];
+    p2p_socket_t* b[2];
+    batch_sink_t sinks[2];
+    int counts[2] = {BATCH_MESSAGES, 3};
+    
+    for (int i = 0; i < 2; i++) {
+        mu_check(p2p_socket_pair(&a[i], &b[i]) == 0);
+        send_numbered(a[i], counts[i]);
+        p2p_socket_close(a[i]);
+        batch_sink_t init = {loop, b[i], 0, 0, 0, 0, 1, 0, 0, 0};
+        sinks[i] = init;
+        mu_check(p2p_event_loop_add_socket_batch(loop, b[i], batch_read, batch_error,
+                                                 0, &sinks[i]) == 0);
+    }
+    
+    batch_sequence = 0;
+    p2p_event_loop_run(loop);
+    
+    mu_check(sinks[0].received == BATCH_MESSAGES && sinks[1].received == 3);
+    mu_check(!sinks[0].corrupt && !sinks[1].corrupt);
+    mu_check(sinks[0].largest == 4);                // Frame budget, not max_batch
+    mu_check(sinks[1].last_sequence <= 2);          // Not queued behind the flood
+    
+    // Byte budget: stops once the budget is reached (at least one message)
+    p2p_socket_t* c = NULL;
+    p2p_socket_t* d = NULL;
+    mu_check(p2p_socket_pair(&c, &d) == 0);
+    send_numbered(c, BATCH_MESSAGES);
+    p2p_socket_close(c);
+    
+    p2p_event_loop_set_read_budget(loop, 200, 0);
+    batch_sink_t sink = {loop, d, 0, 0, 0, 0, 1, 0, 0, 0};
+    mu_check(p2p_event_loop_add_socket_batch(loop, d, batch_read, batch_error, 0, &sink) == 0);
+    p2p_event_loop_run(loop);
+    
+    mu_check(sink.received == BATCH_MESSAGES);
+    mu_check(!sink.corrupt);
+    mu_check(sink.largest_bytes < 200 + BATCH_MESSAGES);
+    
+    p2p_event_loop_free(loop);
+    p2p_socket_close(b[0]);
+    p2p_socket_close(b[1]);
+    p2p_socket_close(d);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
+// ============================================================================
+// Test 12: Cross-Thread Posting
+// ============================================================================
+
+#define POST_THREADS 4
+#define POSTS_PER_THREAD 2000
+
+typedef struct {
+    p2p_event_loop_t* loop;
+    int last[POST_THREADS];     // Last sequence number run per producer
+    int total;
+    int out_of_order;
+} post_state_t;
+
+typedef struct {
+    post_state_t* state;
+    int thread;
+    int seq;
+} post_task_t;
+
+static post_task_t post_tasks[POST_THREADS][POSTS_PER_THREAD];
+
+static void run_post_task(void* arg) {
+    post_task_t* task = (post_task_t*)arg;
+    post_state_t* state = task->state;
+    
+    if (task->seq != state->last[task->thread] + 1) state->out_of_order = 1;
+    state->last[task->thread] = task->seq;
+    
+    if (++state->total == POST_THREADS * POSTS_PER_THREAD) {
+        p2p_event_loop_stop(state->loop);
+    }
+}
+
+typedef struct {
+    post_state_t* state;
+    int thread;
+} producer_t;
+
+static THREAD_RETURN producer_thread(void* arg) {
+    producer_t* producer = (producer_t*)arg;
+    for (int i = 0; i < POSTS_PER_THREAD; i++) {
+        post_task_t* task = &post_tasks[producer->thread][i];
+        task->state = producer->state;
+        task->thread = producer->thread;
+        task->seq = i;
+        p2p_event_loop_post(producer->state->loop, run_post_task, task);
+    }
+    return 0;
+}
+
+static void ignore_read(p2p_socket_t* sock, void* user_data) {
+    (void)sock;
+    (void)user_data;
+}
+
+MU_TEST(test_event_loop_post) {
+    p2p_init();
+    
+    // An idle socket keeps the loop running; all work arrives through post
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+    
+    post_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.loop = p2p_event_loop_create();
+    for (int t = 0; t < POST_THREADS; t++) state.last[t] = -1;
+    mu_check(p2p_event_loop_add_socket(state.loop, b, ignore_read, NULL, NULL) == 0);
+    
+    producer_t producers[POST_THREADS];
+    THREAD_HANDLE threads[POST_THREADS];
+    for (int t = 0; t < POST_THREADS; t++) {
+        producers[t].state = &state;
+        producers[t].thread = t;
+        threads[t] = start_thread(producer_thread, &producers[t]);
+    }
+    
+    p2p_event_loop_run(state.loop);
+    for (int t = 0; t < POST_THREADS; t++) wait_for_thread(threads[t]);
+    
+    mu_check(state.total == POST_THREADS * POSTS_PER_THREAD);
+    mu_check(!state.out_of_order);              // FIFO per producer
+    mu_check(p2p_event_loop_post(state.loop, NULL, NULL) == -1);
+    mu_check(p2p_event_loop_post(NULL, run_post_task, NULL) == -1);
+    
+    // Never run: dropped with the loop
+    p2p_event_loop_post(state.loop, run_post_task, &post_tasks[0][0]);
+    p2p_event_loop_free(state.loop);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
+// ============================================================================
+// Test 13: Stop From Another Thread Wakes the Loop
+// ============================================================================
+
+static THREAD_RETURN stop_thread(void* arg) {
+    sleep_ms(20);
+    p2p_event_loop_stop((p2p_event_loop_t*)arg);
+    return 0;
+}
+
+MU_TEST(test_event_loop_stop_wakeup) {
+    p2p_init();
+    
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+    
+    p2p_event_loop_t* loop = p2p_event_loop_create();
+    mu_check(p2p_event_loop_add_socket(loop, b, ignore_read, NULL, NULL) == 0);
+    
+    uint64_t start = now_ms();
+    THREAD_HANDLE thread = start_thread(stop_thread, loop);
+    p2p_event_loop_run(loop);
+    uint64_t elapsed = now_ms() - start;
+    wait_for_thread(thread);
+    
+    mu_check(elapsed < 500);                    // Not the 1 s poll timeout
+    
+    p2p_event_loop_free(loop);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
+// ============================================================================
+// Test 14: Posts Run Without Sockets, Early Stop Is Kept
+// ============================================================================
+
+static void count_task(void* arg) {
+    (*(int*)arg)++;
+}
+
+MU_TEST(test_event_loop_no_sockets) {
+    p2p_init();
+    
+    // Posted before run() on an empty loop: run() executes them, then returns
+    p2p_event_loop_t* loop = p2p_event_loop_create();
+    int ran = 0;
+    for (int i = 0; i < 3; i++) {
+        mu_check(p2p_event_loop_post(loop, count_task, &ran) == 0);
+    }
+    p2p_event_loop_run(loop);
+    mu_check(ran == 3);
+    
+    // Stop before run(): returns at once although a socket is registered
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+    mu_check(p2p_event_loop_add_socket(loop, b, ignore_read, NULL, NULL) == 0);
+    p2p_event_loop_stop(loop);
+    uint64_t start = now_ms();
+    p2p_event_loop_run(loop);
+    mu_check(now_ms() - start < 500);
+    
+    // The stop was consumed: the next run() waits for a new one
+    THREAD_HANDLE thread = start_thread(stop_thread, loop);
+    start = now_ms();
+    p2p_event_loop_run(loop);
+    mu_check(now_ms() - start >= 15);
+    wait_for_thread(thread);
+    
+    p2p_event_loop_free(loop);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
+// ============================================================================
+// Test 15: Busy-Poll Mode
+// ============================================================================
+
+static THREAD_RETURN slow_sender_thread(void* arg) {
+    p2p_socket_t* sock = (p2p_socket_t*)arg;
+    for (int k = 0; k < 20; k++) {
+        sleep_ms(1);                            // Gaps the loop has to wait through
+        uint8_t data[BATCH_MESSAGES];
+        memset(data, k, (size_t)k + 1);
+        p2p_message_t msg = {.length = (uint32_t)(k + 1), .data = data};
+        p2p_message_send(sock, &msg);
+    }
+    p2p_socket_close(sock);
+    return 0;
+}
+
+MU_TEST(test_event_loop_busy_poll) {
+    p2p_init();
+    
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+    
+    p2p_event_loop_t* loop = p2p_event_loop_create();
+    p2p_event_loop_set_busy_poll(loop, 200 * 1000, 0);
+    
+    batch_sink_t sink = {loop, b, 0, 0, 0, 0, 1, 0, 0, 0};
+    mu_check(p2p_event_loop_add_socket_batch(loop, b, batch_read, batch_error, 0, &sink) == 0);
+    
+    THREAD_HANDLE thread = start_thread(slow_sender_thread, a);
+    p2p_event_loop_run(loop);
+    wait_for_thread(thread);
+    
+    mu_check(sink.received == 20);
+    mu_check(!sink.corrupt);
+    mu_check(sink.error == 0);
+    
+    // Spinning shows up as extra non-blocking polls per iteration
+    p2p_metrics_t metrics;
+    mu_check(p2p_event_loop_metrics(loop, &metrics) == 0);
+    mu_check(metrics.values[P2P_METRIC_SYSCALLS] > metrics.values[P2P_METRIC_LOOP_ITERATIONS]);
+    
+    p2p_event_loop_free(loop);
+    p2p_socket_close(b);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
 // ============================================================================
 // Test Suite
 // ============================================================================
@@ -294,6 +776,13 @@ MU_TEST_SUITE(event_loop_suite) {
     MU_RUN_TEST(test_event_loop_socket_count);
     MU_RUN_TEST(test_event_loop_null_safety);
     MU_RUN_TEST(test_event_loop_add_duplicate);
+    MU_RUN_TEST(test_event_loop_batch);
+    MU_RUN_TEST(test_event_loop_batch_fairness);
+    MU_RUN_TEST(test_event_loop_read_budget);
+    MU_RUN_TEST(test_event_loop_post);
+    MU_RUN_TEST(test_event_loop_stop_wakeup);
+    MU_RUN_TEST(test_event_loop_no_sockets);
+    MU_RUN_TEST(test_event_loop_busy_poll);
     return NULL;
 }
 
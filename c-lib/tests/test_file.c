@@ -0,0 +1,324 @@
+#include "minunit.h"
+#include <p2pnet/p2pnet.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>
+    #include <io.h>
+    #define THREAD_RETURN unsigned int __stdcall
+    #define THREAD_HANDLE HANDLE
+    #define lseek _lseeki64
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #define THREAD_RETURN void*
+    #define THREAD_HANDLE pthread_t
+#endif
+
+static THREAD_HANDLE start_thread(THREAD_RETURN (*fn)(void*), void* arg) {
+    #ifdef _WIN32
+        return (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    #else
+        THREAD_HANDLE thread;
+        pthread_create(&thread, NULL, fn, arg);
+        return thread;
+    #endif
+}
+
+static void wait_for_thread(THREAD_HANDLE thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+#define FILE_SIZE (P2P_FILE_CHUNK_SIZE * 2 + P2P_FILE_CHUNK_SIZE / 2)   // 2.5 chunks
+#define SEND_OFFSET 100
+#define RECV_OFFSET 7
+
+static uint8_t pattern_byte(size_t i) {
+    return (uint8_t)((i * 31) ^ (i >> 11));
+}
+
+/**
+ * Temporary file filled with a known pattern
+ */
+static FILE* pattern_file(size_t size) {
+    FILE* f = tmpfile();
+    if (!f) return NULL;
+
+    uint8_t block[4096];
+    for (size_t pos = 0; pos < size; pos += sizeof(block)) {
+        size_t n = size - pos < sizeof(block) ? size - pos : sizeof(block);
+        for (size_t i = 0; i < n; i++) block[i] = pattern_byte(pos + i);
+        fwrite(block, 1, n, f);
+    }
+    fflush(f);
+    rewind(f);
+    return f;
+}
+
+/**
+ * Does `f` hold pattern[from .. from+length) at `at`?
+ */
+static int matches_pattern(FILE* f, long at, size_t from, size_t length) {
+    uint8_t block[4096];
+    if (fseek(f, at, SEEK_SET) != 0) return 0;
+
+    for (size_t done = 0; done < length; ) {
+        size_t n = length - done < sizeof(block) ? length - done : sizeof(block);
+        if (fread(block, 1, n, f) != n) return 0;
+        for (size_t i = 0; i < n; i++) {
+            if (block[i] != pattern_byte(from + done + i)) return 0;
+        }
+        done += n;
+    }
+    return 1;
+}
+
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_session_t* session;         // NULL = plaintext
+    p2p_keypair_t* keypair;
+    FILE* file;
+    uint64_t offset;
+    uint64_t length;
+    int result;
+} sender_t;
+
+static THREAD_RETURN sender_thread(void* arg) {
+    sender_t* s = (sender_t*)arg;
+    int fd = fileno(s->file);
+    s->result = s->session
+        ? p2p_session_send_file(s->session, s->sock, fd, s->offset, s->length)
+        : p2p_send_file(s->sock, fd, s->offset, s->length);
+    return 0;
+}
+
+/**
+ * Plaintext transfer over a socket pair, checked byte by byte
+ */
+static int transfer_plain(p2p_socket_t* a, p2p_socket_t* b) {
+    FILE* src = pattern_file(FILE_SIZE);
+    FILE* dst = tmpfile();
+    if (!src || !dst) return 0;
+
+    sender_t sender = {a, NULL, NULL, src, SEND_OFFSET, FILE_SIZE - SEND_OFFSET, -1};
+    THREAD_HANDLE thread = start_thread(sender_thread, &sender);
+
+    int64_t received = p2p_recv_file(b, fileno(dst), RECV_OFFSET, FILE_SIZE);
+    wait_for_thread(thread);
+
+    int ok = sender.result == 0 &&
+             received == FILE_SIZE - SEND_OFFSET &&
+             lseek(fileno(src), 0, SEEK_CUR) == 0 &&        // Positions untouched
+             lseek(fileno(dst), 0, SEEK_CUR) == 0 &&
+             matches_pattern(dst, RECV_OFFSET, SEND_OFFSET, FILE_SIZE - SEND_OFFSET);
+
+    fclose(src);
+    fclose(dst);
+    return ok;
+}
+
+// ============================================================================
+// Test 1: Plaintext over a socket pair (sendfile/splice on Linux)
+// ============================================================================
+
+MU_TEST(test_file_socket_pair) {
+    p2p_init();
+
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+    mu_check(transfer_plain(a, b));
+
+    // Framing is intact afterwards
+    p2p_message_t msg = {.length = 5, .data = (uint8_t*)"after"};
+    mu_check(p2p_message_send(a, &msg) == 0);
+    p2p_message_t* next = p2p_message_recv(b);
+    mu_check(next != NULL && next->length == 5 && memcmp(next->data, "after", 5) == 0);
+    p2p_message_free(next);
+
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    p2p_cleanup();
+    return NULL;
+}
+
+// ============================================================================
+// Test 2: Plaintext over the memory transport (copy fallback)
+// ============================================================================
+
+MU_TEST(test_file_memory_fallback) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 64 * 1024) == 0);
+    mu_check(transfer_plain(a, b));
+
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 3: Encrypted transfer
+// ============================================================================
+
+static THREAD_RETURN handshake_thread(void* arg) {
+    sender_t* s = (sender_t*)arg;
+    s->session = p2p_handshake_server(s->sock, s->keypair, NULL, 0);
+    return 0;
+}
+
+MU_TEST(test_file_encrypted) {
+    sender_t server = {0};
+    p2p_socket_t* client_sock = NULL;
+    mu_check(p2p_socket_pair_memory(&client_sock, &server.sock, 0) == 0);
+
+    p2p_keypair_t* client_kp = p2p_keypair_generate();
+    server.keypair = p2p_keypair_generate();
+
+    THREAD_HANDLE thread = start_thread(handshake_thread, &server);
+    p2p_session_t* client = p2p_handshake_client(client_sock, client_kp, server.keypair->public_key);
+    wait_for_thread(thread);
+    mu_check(client != NULL && server.session != NULL);
+
+    server.file = pattern_file(FILE_SIZE);
+    server.offset = SEND_OFFSET;
+    server.length = FILE_SIZE - SEND_OFFSET;
+    FILE* dst = tmpfile();
+    mu_check(server.file != NULL && dst != NULL);
+
+    thread = start_thread(sender_thread, &server);
+    int64_t received = p2p_session_recv_file(client, client_sock, fileno(dst), RECV_OFFSET, FILE_SIZE);
+    wait_for_thread(thread);
+
+    mu_check(server.result == 0);
+    mu_check(received == FILE_SIZE - SEND_OFFSET);
+    mu_check(matches_pattern(dst, RECV_OFFSET, SEND_OFFSET, FILE_SIZE - SEND_OFFSET));
+
+    fclose(server.file);
+    fclose(dst);
+    p2p_session_free(client);
+    p2p_session_free(server.session);
+    p2p_keypair_free(client_kp);
+    p2p_keypair_free(server.keypair);
+    p2p_socket_close(client_sock);
+    p2p_socket_close(server.sock);
+    return NULL;
+}
+
+// ============================================================================
+// Test 4: Limits and short files
+// ============================================================================
+
+MU_TEST(test_file_errors) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+
+    FILE* src = pattern_file(1000);
+    FILE* dst = tmpfile();
+    mu_check(src != NULL && dst != NULL);
+
+    // Larger than the receiver accepts
+    mu_check(p2p_send_file(a, fileno(src), 0, 1000) == 0);
+    mu_check(p2p_recv_file(b, fileno(dst), 0, 500) == -1);
+
+    // Range past the end of the file
+    p2p_socket_t* c = NULL;
+    p2p_socket_t* d = NULL;
+    mu_check(p2p_socket_pair_memory(&c, &d, 0) == 0);
+    mu_check(p2p_send_file(c, fileno(src), 500, 1000) == -1);
+    p2p_socket_close(c);
+    p2p_socket_close(d);
+
+    // Empty transfer
+    mu_check(p2p_socket_pair_memory(&c, &d, 0) == 0);
+    mu_check(p2p_send_file(c, fileno(src), 0, 0) == 0);
+    mu_check(p2p_recv_file(d, fileno(dst), 0, 0) == 0);
+    p2p_socket_close(c);
+    p2p_socket_close(d);
+
+    mu_check(p2p_send_file(a, -1, 0, 10) == -1);
+    mu_check(p2p_recv_file(NULL, fileno(dst), 0, 10) == -1);
+
+    fclose(src);
+    fclose(dst);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 5: A stalled sender hits the receiver's SO_RCVTIMEO
+// ============================================================================
+
+static int set_recv_timeout(p2p_socket_t* sock, int ms) {
+#ifdef _WIN32
+    DWORD timeout = (DWORD)ms;
+#else
+    struct timeval timeout = {ms / 1000, (ms % 1000) * 1000};
+#endif
+    return setsockopt(p2p_socket_get_handle(sock), SOL_SOCKET, SO_RCVTIMEO,
+                      (const char*)&timeout, sizeof(timeout));
+}
+
+MU_TEST(test_file_recv_timeout) {
+    p2p_init();
+
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+    mu_check(set_recv_timeout(b, 100) == 0);
+
+    // Header for 1000 bytes, one chunk frame, then only 10 bytes of it
+    uint8_t header[16] = {'P', '2', 'P', 'F', 0, 0, 0, 0, 0, 0, 0x03, 0xe8};
+    header[12] = (uint8_t)(P2P_FILE_CHUNK_SIZE >> 24);
+    header[13] = (uint8_t)(P2P_FILE_CHUNK_SIZE >> 16);
+    header[14] = (uint8_t)(P2P_FILE_CHUNK_SIZE >> 8);
+    header[15] = (uint8_t)P2P_FILE_CHUNK_SIZE;
+    p2p_message_t msg = {.length = sizeof(header), .data = header};
+    mu_check(p2p_message_send(a, &msg) == 0);
+    uint8_t partial[4 + 10] = {0, 0, 0x03, 0xe8};
+    mu_check(p2p_socket_send(a, partial, sizeof(partial)) == (intptr_t)sizeof(partial));
+
+    FILE* dst = tmpfile();
+    mu_check(dst != NULL);
+    mu_check(p2p_recv_file(b, fileno(dst), 0, 1000) == -1);   // Returns instead of hanging
+
+    fclose(dst);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    p2p_cleanup();
+    return NULL;
+}
+
+MU_TEST_SUITE(file_suite) {
+    MU_RUN_TEST(test_file_socket_pair);
+    MU_RUN_TEST(test_file_memory_fallback);
+    MU_RUN_TEST(test_file_encrypted);
+    MU_RUN_TEST(test_file_errors);
+    MU_RUN_TEST(test_file_recv_timeout);
+    return NULL;
+}
+
+int main() {
+    printf("========================================\n");
+    printf(" Running File Transfer Tests            \n");
+    printf("========================================\n\n");
+
+    if (p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    MU_RUN_SUITE(file_suite);
+    MU_REPORT();
+
+    return MU_EXIT_CODE;
+}
@@ -0,0 +1,168 @@
+#include "minunit.h"
+#include <p2pnet/p2pnet.h>
+#include <string.h>
+
+// Value is within bucket resolution (1/16) of expected
+static int close_to(uint64_t value, uint64_t expected) {
+    uint64_t diff = value > expected ? value - expected : expected - value;
+    return diff <= expected / 16 + 1;
+}
+
+// ============================================================================
+// Test 1: Empty histogram
+// ============================================================================
+
+MU_TEST(test_histogram_empty) {
+    p2p_histogram_t* hist = p2p_histogram_create();
+    mu_check(hist != NULL);
+
+    mu_check(p2p_histogram_count(hist) == 0);
+    mu_check(p2p_histogram_min(hist) == 0);
+    mu_check(p2p_histogram_max(hist) == 0);
+    mu_check(p2p_histogram_percentile(hist, 99.0) == 0);
+
+    p2p_histogram_free(hist);
+    return NULL;
+}
+
+// ============================================================================
+// Test 2: Percentiles on uniform 1..100000
+// ============================================================================
+
+MU_TEST(test_histogram_percentiles) {
+    p2p_histogram_t* hist = p2p_histogram_create();
+    mu_check(hist != NULL);
+
+    for (uint64_t v = 1; v <= 100000; v++) {
+        p2p_histogram_record(hist, v);
+    }
+
+    mu_check(p2p_histogram_count(hist) == 100000);
+    mu_check(p2p_histogram_min(hist) == 1);
+    mu_check(p2p_histogram_max(hist) == 100000);
+    mu_check(close_to((uint64_t)p2p_histogram_mean(hist), 50000));
+
+    mu_check(close_to(p2p_histogram_percentile(hist, 50.0), 50000));
+    mu_check(close_to(p2p_histogram_percentile(hist, 99.0), 99000));
+    mu_check(close_to(p2p_histogram_percentile(hist, 99.9), 99900));
+    mu_check(p2p_histogram_percentile(hist, 100.0) == 100000);
+
+    // Small values are exact
+    p2p_histogram_reset(hist);
+    p2p_histogram_record(hist, 3);
+    p2p_histogram_record(hist, 7);
+    mu_check(p2p_histogram_percentile(hist, 50.0) == 3);
+    mu_check(p2p_histogram_percentile(hist, 100.0) == 7);
+
+    p2p_histogram_free(hist);
+    return NULL;
+}
+
+// ============================================================================
+// Test 3: Merge
+// ============================================================================
+
+MU_TEST(test_histogram_merge) {
+    p2p_histogram_t* a = p2p_histogram_create();
+    p2p_histogram_t* b = p2p_histogram_create();
+    mu_check(a != NULL && b != NULL);
+
+    p2p_histogram_record(a, 1000);
+    p2p_histogram_record(b, 10);
+    p2p_histogram_record(b, 1000000);
+
+    p2p_histogram_merge(a, b);
+
+    mu_check(p2p_histogram_count(a) == 3);
+    mu_check(p2p_histogram_min(a) == 10);
+    mu_check(p2p_histogram_max(a) == 1000000);
+
+    p2p_histogram_free(a);
+    p2p_histogram_free(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 4: Built-in latency histograms
+// ============================================================================
+
+MU_TEST(test_latency_builtin) {
+    for (int i = 0; i < P2P_LATENCY_COUNT; i++) {
+        mu_check(p2p_latency_histogram((p2p_latency_t)i) != NULL);
+        mu_check(p2p_latency_name((p2p_latency_t)i) != NULL);
+    }
+
+    mu_check(p2p_latency_histogram(P2P_LATENCY_COUNT) == NULL);
+    mu_check(strcmp(p2p_latency_name(P2P_LATENCY_HS_SERVER_VERIFY), "hs_server_verify") == 0);
+
+    p2p_latency_reset();
+    mu_check(p2p_histogram_count(p2p_latency_histogram(P2P_LATENCY_LOOP_CALLBACK)) == 0);
+    return NULL;
+}
+
+// ============================================================================
+// Test 5: Built-in recording is off until enabled
+// ============================================================================
+
+MU_TEST(test_latency_opt_in) {
+    uint8_t key[32] = {1};
+    uint8_t pubkey[32] = {2};
+    p2p_session_t* tx = p2p_session_create(key, pubkey);
+    p2p_session_t* rx = p2p_session_create(key, pubkey);
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(tx != NULL && rx != NULL);
+    mu_check(p2p_socket_pair_memory(&a, &b, 64 * 1024) == 0);
+
+    p2p_histogram_t* enc = p2p_latency_histogram(P2P_LATENCY_ENCRYPT_64);
+    p2p_histogram_t* dec = p2p_latency_histogram(P2P_LATENCY_DECRYPT_64);
+    p2p_latency_reset();
+
+    // Off by default: seal/open leave the histograms untouched
+    mu_check(p2p_session_send(tx, a, (const uint8_t*)"ping", 4) == 0);
+    p2p_message_t* msg = p2p_session_recv(rx, b);
+    mu_check(msg != NULL);
+    p2p_message_free(msg);
+    mu_check(p2p_histogram_count(enc) == 0);
+    mu_check(p2p_histogram_count(dec) == 0);
+
+    p2p_latency_set_enabled(1);
+    mu_check(p2p_session_send(tx, a, (const uint8_t*)"ping", 4) == 0);
+    msg = p2p_session_recv(rx, b);
+    mu_check(msg != NULL);
+    p2p_message_free(msg);
+    mu_check(p2p_histogram_count(enc) == 1);
+    mu_check(p2p_histogram_count(dec) == 1);
+
+    p2p_latency_set_enabled(0);
+    p2p_latency_reset();
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    p2p_session_free(tx);
+    p2p_session_free(rx);
+    return NULL;
+}
+
+MU_TEST_SUITE(histogram_suite) {
+    MU_RUN_TEST(test_histogram_empty);
+    MU_RUN_TEST(test_histogram_percentiles);
+    MU_RUN_TEST(test_histogram_merge);
+    MU_RUN_TEST(test_latency_builtin);
+    MU_RUN_TEST(test_latency_opt_in);
+    return NULL;
+}
+
+int main() {
+    printf("========================================\n");
+    printf(" Running Histogram Tests                \n");
+    printf("========================================\n\n");
+
+    if (p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    MU_RUN_SUITE(histogram_suite);
+    MU_REPORT();
+
+    return MU_EXIT_CODE;
+}
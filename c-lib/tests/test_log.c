@@ -0,0 +1,230 @@
+#include "minunit.h"
+#include <p2pnet/p2pnet.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>
+    #define sleep_ms(ms) Sleep(ms)
+    #define THREAD_RETURN unsigned int __stdcall
+    #define THREAD_HANDLE HANDLE
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #define sleep_ms(ms) usleep((ms) * 1000)
+    #define THREAD_RETURN void*
+    #define THREAD_HANDLE pthread_t
+#endif
+
+static THREAD_HANDLE start_thread(THREAD_RETURN (*fn)(void*), void* arg) {
+    #ifdef _WIN32
+        return (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    #else
+        THREAD_HANDLE thread;
+        pthread_create(&thread, NULL, fn, arg);
+        return thread;
+    #endif
+}
+
+static void wait_for_thread(THREAD_HANDLE thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+// Capture sink: remembers last message and counts calls
+typedef struct {
+    volatile int calls;
+    int last_level;
+    char last_tag[32];
+    char last_message[P2P_LOG_LINE_MAX];
+} capture_t;
+
+static void capture_sink(int level, const char* tag, const char* message, void* ctx) {
+    capture_t* cap = (capture_t*)ctx;
+    cap->calls++;
+    cap->last_level = level;
+    strncpy(cap->last_tag, tag, sizeof(cap->last_tag) - 1);
+    strncpy(cap->last_message, message, sizeof(cap->last_message) - 1);
+}
+
+// ============================================================================
+// Test 1: Silent by default
+// ============================================================================
+
+MU_TEST(test_log_default_silent) {
+    capture_t cap;
+    memset(&cap, 0, sizeof(cap));
+
+    p2p_log_set_sink(capture_sink, &cap);
+
+    // Threshold defaults to OFF
+    P2P_LOG_ERROR("TEST", "should not appear");
+    mu_check(cap.calls == 0);
+
+    p2p_log_set_sink(NULL, NULL);
+    return NULL;
+}
+
+// ============================================================================
+// Test 2: Threshold filters by level
+// ============================================================================
+
+MU_TEST(test_log_threshold) {
+    capture_t cap;
+    memset(&cap, 0, sizeof(cap));
+
+    p2p_log_set_sink(capture_sink, &cap);
+    p2p_log_set_level(P2P_LOG_LEVEL_WARN);
+
+    P2P_LOG_INFO("TEST", "filtered");
+    mu_check(cap.calls == 0);
+
+    P2P_LOG_WARN("TEST", "value=%d", 42);
+    mu_check(cap.calls == 1);
+    mu_check(cap.last_level == P2P_LOG_LEVEL_WARN);
+    mu_check(strcmp(cap.last_tag, "TEST") == 0);
+    mu_check(strcmp(cap.last_message, "value=42") == 0);
+
+    p2p_log_set_level(P2P_LOG_LEVEL_OFF);
+    p2p_log_set_sink(NULL, NULL);
+    return NULL;
+}
+
+// ============================================================================
+// Test 3: Async sink delivers everything on stop
+// ============================================================================
+
+MU_TEST(test_log_async) {
+    capture_t cap;
+    memset(&cap, 0, sizeof(cap));
+
+    mu_check(p2p_log_async_start(256, capture_sink, &cap) == 0);
+
+    // Second start is rejected
+    mu_check(p2p_log_async_start(256, capture_sink, &cap) == -1);
+
+    p2p_log_set_level(P2P_LOG_LEVEL_DEBUG);
+
+    for (int i = 0; i < 100; i++) {
+        P2P_LOG_DEBUG("ASYNC", "message %d", i);
+    }
+
+    sleep_ms(10);
+    p2p_log_async_stop();
+
+    mu_check(cap.calls == 100);
+    mu_check(strcmp(cap.last_message, "message 99") == 0);
+    mu_check(p2p_log_dropped() == 0);
+
+    p2p_log_set_level(P2P_LOG_LEVEL_OFF);
+    return NULL;
+}
+
+// ============================================================================
+// Test 4: Idle drain thread wakes for a new message
+// ============================================================================
+
+MU_TEST(test_log_async_wakeup) {
+    capture_t cap;
+    memset(&cap, 0, sizeof(cap));
+
+    mu_check(p2p_log_async_start(16, capture_sink, &cap) == 0);
+    p2p_log_set_level(P2P_LOG_LEVEL_INFO);
+
+    // Several rounds with the drain thread parked in between
+    for (int round = 1; round <= 5; round++) {
+        sleep_ms(20);
+        P2P_LOG_INFO("ASYNC", "round %d", round);
+        for (int i = 0; i < 1000 && cap.calls < round; i++) {
+            sleep_ms(1);
+        }
+        mu_check(cap.calls == round);
+    }
+
+    p2p_log_async_stop();
+    mu_check(cap.calls == 5);
+
+    // Stop on an idle ring returns promptly
+    mu_check(p2p_log_async_start(16, capture_sink, &cap) == 0);
+    sleep_ms(20);
+    p2p_log_async_stop();
+
+    p2p_log_set_level(P2P_LOG_LEVEL_OFF);
+    return NULL;
+}
+
+// ============================================================================
+// Test 5: Sink swapped while another thread logs keeps sink and ctx paired
+// ============================================================================
+
+typedef struct {
+    int id;
+    volatile int mismatches;
+} tagged_ctx_t;
+
+static tagged_ctx_t g_ctx_a = {1, 0};
+static tagged_ctx_t g_ctx_b = {2, 0};
+static volatile int g_swap_stop;
+
+static void sink_a(int level, const char* tag, const char* message, void* ctx) {
+    (void)level; (void)tag; (void)message;
+    if (((tagged_ctx_t*)ctx)->id != 1) g_ctx_a.mismatches++;
+}
+
+static void sink_b(int level, const char* tag, const char* message, void* ctx) {
+    (void)level; (void)tag; (void)message;
+    if (((tagged_ctx_t*)ctx)->id != 2) g_ctx_b.mismatches++;
+}
+
+static THREAD_RETURN swap_thread(void* arg) {
+    (void)arg;
+    while (!g_swap_stop) {
+        p2p_log_set_sink(sink_a, &g_ctx_a);
+        p2p_log_set_sink(sink_b, &g_ctx_b);
+    }
+    return 0;
+}
+
+MU_TEST(test_log_sink_swap) {
+    p2p_log_set_sink(sink_a, &g_ctx_a);
+    p2p_log_set_level(P2P_LOG_LEVEL_INFO);
+
+    g_swap_stop = 0;
+    THREAD_HANDLE thread = start_thread(swap_thread, NULL);
+    for (int i = 0; i < 2000000; i++) {
+        P2P_LOG_INFO("SWAP", "message");
+    }
+    g_swap_stop = 1;
+    wait_for_thread(thread);
+
+    mu_check(g_ctx_a.mismatches == 0);
+    mu_check(g_ctx_b.mismatches == 0);
+
+    p2p_log_set_level(P2P_LOG_LEVEL_OFF);
+    p2p_log_set_sink(NULL, NULL);
+    return NULL;
+}
+
+MU_TEST_SUITE(log_suite) {
+    MU_RUN_TEST(test_log_default_silent);
+    MU_RUN_TEST(test_log_threshold);
+    MU_RUN_TEST(test_log_async);
+    MU_RUN_TEST(test_log_async_wakeup);
+    MU_RUN_TEST(test_log_sink_swap);
+    return NULL;
+}
+
+int main() {
+    printf("========================================\n");
+    printf(" Running Logging Tests                  \n");
+    printf("========================================\n\n");
+
+    MU_RUN_SUITE(log_suite);
+    MU_REPORT();
+
+    return MU_EXIT_CODE;
+}
@@ -1,6 +1,7 @@
 #include "minunit.h"
 #include <p2pnet/p2pnet.h>
 #include <string.h>
+#include <stdlib.h>
 
 MU_TEST(test_message_create) {
     const char* data = "Hello World";
@@ -49,11 +50,138 @@ MU_TEST(test_message_create_large) {
     return NULL;
 }
 
+static int release_count = 0;
+
+static void count_release(void* ctx) {
+    release_count++;
+    free(ctx);
+}
+
+MU_TEST(test_message_wrap) {
+    char* buffer = (char*)malloc(5);
+    memcpy(buffer, "wrap!", 5);
+    
+    release_count = 0;
+    p2p_message_t* msg = p2p_message_wrap(buffer, 5, count_release, buffer);
+    mu_check(msg != NULL);
+    mu_check(msg->data == (uint8_t*)buffer);    // No copy
+    mu_check(msg->length == 5);
+    
+    p2p_message_free(msg);
+    mu_check(release_count == 1);
+    
+    // Borrowed buffer: never freed by the library
+    static char borrowed[] = "borrowed";
+    msg = p2p_message_wrap(borrowed, sizeof(borrowed), NULL, NULL);
+    mu_check(msg != NULL);
+    p2p_message_free(msg);
+    mu_check(borrowed[0] == 'b');
+    
+    mu_check(p2p_message_wrap(borrowed, 0, NULL, NULL) == NULL);
+    mu_check(p2p_message_wrap(borrowed, P2P_MAX_MESSAGE_SIZE + 1, NULL, NULL) == NULL);
+    return NULL;
+}
+
+MU_TEST(test_message_recv_into) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+    
+    // Owned wrapped message goes out through the normal send path
+    char* buffer = (char*)malloc(12);
+    memcpy(buffer, "into buffer!", 12);
+    release_count = 0;
+    mu_check(p2p_message_send_owned(a, p2p_message_wrap(buffer, 12, count_release, buffer)) == 0);
+    mu_check(release_count == 1);
+    
+    uint32_t length = 0;
+    mu_check(p2p_message_recv_header(b, &length) == 0);
+    mu_check(length == 12);
+    
+    char dest[12];
+    mu_check(p2p_message_recv_into(b, dest, length) == 0);
+    mu_check(memcmp(dest, "into buffer!", 12) == 0);
+    
+    // Stream stays in sync for the next frame
+    p2p_message_t next = {.length = 3, .data = (uint8_t*)"abc"};
+    mu_check(p2p_message_send(a, &next) == 0);
+    p2p_message_t* got = p2p_message_recv(b);
+    mu_check(got != NULL && got->length == 3);
+    p2p_message_free(got);
+    
+    p2p_socket_close(a);
+    mu_check(p2p_message_recv_header(b, &length) == -1);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+MU_TEST(test_shared_message_refs) {
+    p2p_shared_message_t* msg = p2p_shared_message_create("shared", 6);
+    mu_check(msg != NULL);
+    
+    size_t length = 0;
+    const uint8_t* data = p2p_shared_message_data(msg, &length);
+    mu_check(length == 6);
+    mu_check(memcmp(data, "shared", 6) == 0);
+    
+    mu_check(p2p_shared_message_ref(msg) == msg);
+    p2p_shared_message_unref(msg);
+    p2p_shared_message_unref(msg);      // Last reference frees
+    p2p_shared_message_unref(NULL);
+    
+    mu_check(p2p_shared_message_create("", 0) == NULL);
+    mu_check(p2p_shared_message_create("x", P2P_MAX_MESSAGE_SIZE + 1) == NULL);
+    return NULL;
+}
+
+#define BROADCAST_PEERS 8
+
+MU_TEST(test_shared_message_broadcast) {
+    p2p_socket_t* senders[BROADCAST_PEERS];
+    p2p_socket_t* receivers[BROADCAST_PEERS];
+    for (int i = 0; i < BROADCAST_PEERS; i++) {
+        mu_check(p2p_socket_pair_memory(&senders[i], &receivers[i], 0) == 0);
+    }
+    
+    char text[1000];
+    memset(text, 'B', sizeof(text));
+    p2p_shared_message_t* msg = p2p_shared_message_create(text, sizeof(text));
+    mu_check(msg != NULL);
+    
+    // One closed peer: the others still get it
+    p2p_socket_close(receivers[3]);
+    receivers[3] = NULL;
+    mu_check(p2p_message_broadcast(senders, BROADCAST_PEERS, msg) == BROADCAST_PEERS - 1);
+    p2p_shared_message_unref(msg);      // Sends hold no reference after completing
+    
+    for (int i = 0; i < BROADCAST_PEERS; i++) {
+        if (!receivers[i]) continue;
+        
+        // Same wire format as p2p_message_send()
+        p2p_message_t* got = p2p_message_recv(receivers[i]);
+        mu_check(got != NULL);
+        mu_check(got->length == sizeof(text));
+        mu_check(memcmp(got->data, text, sizeof(text)) == 0);
+        p2p_message_free(got);
+        p2p_socket_close(receivers[i]);
+    }
+    
+    for (int i = 0; i < BROADCAST_PEERS; i++) {
+        p2p_socket_close(senders[i]);
+    }
+    mu_check(p2p_message_broadcast(NULL, 1, NULL) == -1);
+    return NULL;
+}
+
 MU_TEST_SUITE(message_suite) {
     MU_RUN_TEST(test_message_create);
     MU_RUN_TEST(test_message_create_empty_returns_null);
     MU_RUN_TEST(test_message_create_single_char);
     MU_RUN_TEST(test_message_create_large);
+    MU_RUN_TEST(test_message_wrap);
+    MU_RUN_TEST(test_message_recv_into);
+    MU_RUN_TEST(test_shared_message_refs);
+    MU_RUN_TEST(test_shared_message_broadcast);
     return NULL;
 }
 
@@ -0,0 +1,190 @@
+#include "minunit.h"
+#include <p2pnet/p2pnet.h>
+#include <sodium.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>
+    #define THREAD_RETURN unsigned int __stdcall
+    #define THREAD_HANDLE HANDLE
+#else
+    #include <pthread.h>
+    #define THREAD_RETURN void*
+    #define THREAD_HANDLE pthread_t
+#endif
+
+static THREAD_HANDLE start_thread(THREAD_RETURN (*fn)(void*), void* arg) {
+    #ifdef _WIN32
+        return (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    #else
+        THREAD_HANDLE thread;
+        pthread_create(&thread, NULL, fn, arg);
+        return thread;
+    #endif
+}
+
+static void wait_for_thread(THREAD_HANDLE thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+// ============================================================================
+// Test 1: Counter names
+// ============================================================================
+
+MU_TEST(test_metric_names) {
+    for (int i = 0; i < P2P_METRIC_COUNT; i++) {
+        mu_check(p2p_metric_name((p2p_metric_t)i) != NULL);
+    }
+
+    mu_check(strcmp(p2p_metric_name(P2P_METRIC_BYTES_IN), "bytes_in") == 0);
+    mu_check(p2p_metric_name(P2P_METRIC_COUNT) == NULL);
+    return NULL;
+}
+
+// ============================================================================
+// Test 2: Global counters see allocations from this thread
+// ============================================================================
+
+MU_TEST(test_metrics_global_allocations) {
+    p2p_metrics_t before, after;
+    p2p_metrics_global(&before);
+
+    p2p_message_t* a = p2p_message_create("one");
+    p2p_message_t* b = p2p_message_create("two");
+    mu_check(a != NULL && b != NULL);
+
+    p2p_metrics_global(&after);
+    mu_check(after.values[P2P_METRIC_ALLOCATIONS] -
+             before.values[P2P_METRIC_ALLOCATIONS] == 2);
+
+    p2p_message_free(a);
+    p2p_message_free(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 3: Per-session counters
+// ============================================================================
+
+MU_TEST(test_metrics_session) {
+    uint8_t key[32];
+    uint8_t pubkey[32];
+    randombytes_buf(key, sizeof(key));
+    randombytes_buf(pubkey, sizeof(pubkey));
+
+    p2p_session_t* session = p2p_session_create(key, pubkey);
+    mu_check(session != NULL);
+
+    p2p_metrics_t m;
+    mu_check(p2p_session_metrics(session, &m) == 0);
+    for (int i = 0; i < P2P_METRIC_COUNT; i++) {
+        mu_check(m.values[i] == 0);
+    }
+
+    mu_check(p2p_session_metrics(NULL, &m) == -1);
+    mu_check(p2p_session_metrics(session, NULL) == -1);
+
+    // Message counts follow the traffic through a second session on the same key
+    p2p_session_t* peer = p2p_session_create(key, pubkey);
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(peer != NULL);
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+    for (int i = 0; i < 3; i++) {
+        mu_check(p2p_session_send(session, a, (const uint8_t*)"ping", 4) == 0);
+        p2p_message_t* msg = p2p_session_recv(peer, b);
+        mu_check(msg != NULL);
+        p2p_message_free(msg);
+    }
+
+    mu_check(p2p_session_metrics(session, &m) == 0);
+    mu_check(m.values[P2P_METRIC_MESSAGES_OUT] == 3);
+    mu_check(m.values[P2P_METRIC_MESSAGES_IN] == 0);
+    mu_check(p2p_session_metrics(peer, &m) == 0);
+    mu_check(m.values[P2P_METRIC_MESSAGES_IN] == 3);
+    mu_check(m.values[P2P_METRIC_AEAD_FAILURES] == 0);
+    mu_check(m.values[P2P_METRIC_REPLAY_REJECTS] == 0);
+
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    p2p_session_free(peer);
+    p2p_session_free(session);
+    return NULL;
+}
+
+// ============================================================================
+// Test 4: Per-loop counters start at zero
+// ============================================================================
+
+MU_TEST(test_metrics_event_loop) {
+    p2p_event_loop_t* loop = p2p_event_loop_create();
+    mu_check(loop != NULL);
+
+    p2p_metrics_t m;
+    mu_check(p2p_event_loop_metrics(loop, &m) == 0);
+    mu_check(m.values[P2P_METRIC_LOOP_ITERATIONS] == 0);
+    mu_check(m.values[P2P_METRIC_CALLBACKS] == 0);
+
+    p2p_event_loop_free(loop);
+    return NULL;
+}
+
+// ============================================================================
+// Test 5: Counts from exited threads stay in the global totals
+// ============================================================================
+
+#define SHORT_THREADS 200
+
+static THREAD_RETURN allocate_thread(void* arg) {
+    (void)arg;
+    for (int i = 0; i < 10; i++) {
+        p2p_message_free(p2p_message_create("x"));
+    }
+    return 0;
+}
+
+MU_TEST(test_metrics_thread_exit) {
+    p2p_metrics_t before, after;
+    p2p_metrics_global(&before);
+
+    // Exited threads' shards are handed on, their counts stay in place
+    for (int i = 0; i < SHORT_THREADS; i += 2) {
+        THREAD_HANDLE a = start_thread(allocate_thread, NULL);
+        THREAD_HANDLE b = start_thread(allocate_thread, NULL);
+        wait_for_thread(a);
+        wait_for_thread(b);
+    }
+
+    p2p_metrics_global(&after);
+    mu_check(after.values[P2P_METRIC_ALLOCATIONS] -
+             before.values[P2P_METRIC_ALLOCATIONS] == SHORT_THREADS * 10);
+    return NULL;
+}
+
+MU_TEST_SUITE(metrics_suite) {
+    MU_RUN_TEST(test_metric_names);
+    MU_RUN_TEST(test_metrics_global_allocations);
+    MU_RUN_TEST(test_metrics_session);
+    MU_RUN_TEST(test_metrics_event_loop);
+    MU_RUN_TEST(test_metrics_thread_exit);
+    return NULL;
+}
+
+int main() {
+    printf("========================================\n");
+    printf(" Running Metrics Tests                  \n");
+    printf("========================================\n\n");
+
+    p2p_crypto_init();
+
+    MU_RUN_SUITE(metrics_suite);
+    MU_REPORT();
+
+    return MU_EXIT_CODE;
+}
@@ -0,0 +1,568 @@
+#include "minunit.h"
+#include <p2pnet/p2pnet.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>
+    #define THREAD_RETURN unsigned int __stdcall
+    #define THREAD_HANDLE HANDLE
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #define THREAD_RETURN void*
+    #define THREAD_HANDLE pthread_t
+#endif
+
+static THREAD_HANDLE start_thread(THREAD_RETURN (*fn)(void*), void* arg) {
+    #ifdef _WIN32
+        return (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    #else
+        THREAD_HANDLE thread;
+        pthread_create(&thread, NULL, fn, arg);
+        return thread;
+    #endif
+}
+
+static void wait_for_thread(THREAD_HANDLE thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+// ============================================================================
+// Receive-side bookkeeping
+// ============================================================================
+
+#define MAX_TRACKED 8
+
+typedef struct {
+    uint32_t id;
+    size_t bytes;
+    int fin;
+    int corrupt;
+} tracked_t;
+
+typedef struct {
+    tracked_t streams[MAX_TRACKED];
+    int count;
+    int frames;
+    uint32_t first_fin_id;          // Stream that finished first
+    size_t bulk_before_chat;        // Bulk bytes received before chat data arrived
+    uint32_t chat_id;
+    uint32_t bulk_id;
+    int chat_seen;
+} sink_t;
+
+static tracked_t* track(sink_t* sink, uint32_t id) {
+    for (int i = 0; i < sink->count; i++) {
+        if (sink->streams[i].id == id) return &sink->streams[i];
+    }
+    if (sink->count == MAX_TRACKED) return NULL;
+    tracked_t* t = &sink->streams[sink->count++];
+    memset(t, 0, sizeof(*t));
+    t->id = id;
+    return t;
+}
+
+static void on_data(p2p_mux_t* mux, uint32_t stream_id, const uint8_t* data,
+                    size_t length, int fin, void* user_data) {
+    (void)mux;
+    sink_t* sink = (sink_t*)user_data;
+    tracked_t* t = track(sink, stream_id);
+    if (!t) return;
+
+    // Every stream carries bytes equal to (offset + id) & 0xFF
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] != (uint8_t)(t->bytes + i + stream_id)) {
+            t->corrupt = 1;
+            break;
+        }
+    }
+
+    if (stream_id == sink->chat_id && length > 0) sink->chat_seen = 1;
+    if (stream_id == sink->bulk_id && !sink->chat_seen) sink->bulk_before_chat += length;
+
+    t->bytes += length;
+    if (fin) {
+        t->fin = 1;
+        if (!sink->first_fin_id) sink->first_fin_id = stream_id;
+    }
+    sink->frames++;
+}
+
+static int write_pattern(p2p_mux_t* mux, uint32_t id, size_t offset, size_t length) {
+    uint8_t* buf = (uint8_t*)malloc(length);
+    if (!buf) return -1;
+    for (size_t i = 0; i < length; i++) buf[i] = (uint8_t)(offset + i + id);
+    int rc = p2p_mux_write(mux, id, buf, length);
+    free(buf);
+    return rc;
+}
+
+typedef struct {
+    p2p_mux_t* mux;
+    intptr_t sent;
+} pump_t;
+
+/**
+ * Sender side: one thread sends, one receives (window updates come back
+ * there), until the peer closes the connection
+ */
+static THREAD_RETURN pump_thread(void* arg) {
+    pump_t* pump = (pump_t*)arg;
+    while (p2p_mux_wait_sendable(pump->mux) == 0) {
+        intptr_t n = p2p_mux_send_pending(pump->mux, 0);
+        if (n < 0) break;
+        pump->sent += n;
+    }
+    return 0;
+}
+
+static THREAD_RETURN recv_thread(void* arg) {
+    p2p_mux_t* mux = (p2p_mux_t*)arg;
+    while (p2p_mux_recv(mux) == 0) {
+    }
+    return 0;
+}
+
+// ============================================================================
+// Test 1: Streams both ways, FIN and cleanup
+// ============================================================================
+
+MU_TEST(test_mux_basic) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+
+    sink_t sink_a = {0}, sink_b = {0};
+    p2p_mux_t* ma = p2p_mux_create(a, NULL, 1, on_data, &sink_a);
+    p2p_mux_t* mb = p2p_mux_create(b, NULL, 0, on_data, &sink_b);
+    mu_check(ma && mb);
+
+    uint32_t s1 = p2p_mux_open(ma, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT);
+    uint32_t s2 = p2p_mux_open(ma, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT);
+    uint32_t s3 = p2p_mux_open(mb, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT);
+    mu_check(s1 == 1 && s2 == 3 && s3 == 2);        // Odd/even ids per side
+
+    mu_check(write_pattern(ma, s1, 0, 40000) == 0);  // Three chunks
+    mu_check(write_pattern(ma, s2, 0, 10) == 0);
+    mu_check(p2p_mux_close(ma, s1) == 0);
+    mu_check(p2p_mux_write(ma, s1, "x", 1) == -1);   // Closed for writing
+    mu_check(p2p_mux_pending(ma) == 40010);
+
+    mu_check(p2p_mux_send_pending(ma, 0) == 40010);
+    mu_check(p2p_mux_pending(ma) == 0);
+
+    while (sink_b.frames < 4) {
+        mu_check(p2p_mux_recv(mb) == 0);
+    }
+    tracked_t* t1 = track(&sink_b, s1);
+    tracked_t* t2 = track(&sink_b, s2);
+    mu_check(t1->bytes == 40000 && t1->fin && !t1->corrupt);
+    mu_check(t2->bytes == 10 && !t2->fin && !t2->corrupt);
+
+    // Peer-opened streams appear on the other side; reply and close both ways
+    mu_check(p2p_mux_stream_count(mb) == 3);
+    mu_check(write_pattern(mb, s1, 0, 5) == 0);
+    mu_check(p2p_mux_close(mb, s1) == 0);
+    mu_check(write_pattern(mb, s3, 0, 7) == 0);
+    mu_check(p2p_mux_send_pending(mb, 0) == 12);
+    while (sink_a.frames < 2) {
+        mu_check(p2p_mux_recv(ma) == 0);
+    }
+    mu_check(track(&sink_a, s1)->fin && track(&sink_a, s1)->bytes == 5);
+    mu_check(track(&sink_a, s3)->bytes == 7);
+
+    // s1 closed in both directions: gone on both ends
+    mu_check(p2p_mux_stream_count(ma) == 2);
+    mu_check(p2p_mux_stream_count(mb) == 2);
+    mu_check(p2p_mux_write(ma, s1, "x", 1) == -1);
+
+    // Invalid arguments
+    mu_check(p2p_mux_open(ma, P2P_MUX_PRIORITIES, 1) == 0);
+    mu_check(p2p_mux_open(ma, 0, 0) == 0);
+    mu_check(p2p_mux_set_priority(ma, 999, 0, 1) == -1);
+
+    p2p_mux_free(ma);
+    p2p_mux_free(mb);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 2: Interactive stream overtakes a bulk transfer in progress
+// ============================================================================
+
+#define BULK_SIZE (4 * 1024 * 1024)
+#define RING_SIZE (64 * 1024)
+
+MU_TEST(test_mux_priority) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, RING_SIZE) == 0);
+
+    sink_t sink = {0};
+    p2p_mux_t* tx = p2p_mux_create(a, NULL, 1, on_data, NULL);
+    p2p_mux_t* rx = p2p_mux_create(b, NULL, 0, on_data, &sink);
+
+    uint32_t bulk = p2p_mux_open(tx, P2P_MUX_PRIORITY_BULK, P2P_MUX_WEIGHT_DEFAULT);
+    uint32_t chat = p2p_mux_open(tx, P2P_MUX_PRIORITY_INTERACTIVE, P2P_MUX_WEIGHT_DEFAULT);
+    sink.bulk_id = bulk;
+    sink.chat_id = chat;
+
+    mu_check(write_pattern(tx, bulk, 0, BULK_SIZE) == 0);
+    mu_check(p2p_mux_close(tx, bulk) == 0);
+
+    pump_t pump = {tx, 0};
+    THREAD_HANDLE thread = start_thread(pump_thread, &pump);
+    THREAD_HANDLE receiver = start_thread(recv_thread, tx);
+
+    // Let the transfer get going, then send a chat message mid-transfer
+    while (track(&sink, bulk)->bytes < 256 * 1024) {
+        mu_check(p2p_mux_recv(rx) == 0);
+    }
+    size_t bulk_at_chat = track(&sink, bulk)->bytes;
+    mu_check(write_pattern(tx, chat, 0, 100) == 0);
+
+    while (!track(&sink, bulk)->fin) {
+        mu_check(p2p_mux_recv(rx) == 0);
+    }
+    p2p_socket_close(b);                // Stops the sender threads
+    wait_for_thread(thread);
+    wait_for_thread(receiver);
+
+    // Chat waited for the ring plus at most a chunk or two, not the rest of 4 MB
+    mu_check(sink.chat_seen);
+    mu_check(sink.bulk_before_chat - bulk_at_chat <= RING_SIZE + 2 * P2P_MUX_CHUNK_SIZE);
+    mu_check(track(&sink, bulk)->bytes == BULK_SIZE && !track(&sink, bulk)->corrupt);
+    mu_check(pump.sent == BULK_SIZE + 100);
+
+    p2p_mux_free(tx);
+    p2p_mux_free(rx);
+    p2p_socket_close(a);
+    return NULL;
+}
+
+// ============================================================================
+// Test 3: Weighted sharing within a level (encrypted)
+// ============================================================================
+
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_keypair_t* keypair;
+    p2p_session_t* session;
+} peer_t;
+
+static THREAD_RETURN handshake_thread(void* arg) {
+    peer_t* p = (peer_t*)arg;
+    p->session = p2p_handshake_server(p->sock, p->keypair, NULL, 0);
+    return 0;
+}
+
+#define SHARE_SIZE (1024 * 1024)
+
+MU_TEST(test_mux_weights) {
+    peer_t server = {0};
+    p2p_socket_t* client_sock = NULL;
+    // Small ring: the link, not flow control credit, is the bottleneck
+    mu_check(p2p_socket_pair_memory(&client_sock, &server.sock, RING_SIZE) == 0);
+
+    p2p_keypair_t* client_kp = p2p_keypair_generate();
+    server.keypair = p2p_keypair_generate();
+    THREAD_HANDLE thread = start_thread(handshake_thread, &server);
+    p2p_session_t* client = p2p_handshake_client(client_sock, client_kp, server.keypair->public_key);
+    wait_for_thread(thread);
+    mu_check(client && server.session);
+
+    sink_t sink = {0};
+    p2p_mux_t* tx = p2p_mux_create(server.sock, server.session, 0, on_data, NULL);
+    p2p_mux_t* rx = p2p_mux_create(client_sock, client, 1, on_data, &sink);
+
+    uint32_t heavy = p2p_mux_open(tx, P2P_MUX_PRIORITY_DEFAULT, 48);
+    uint32_t light = p2p_mux_open(tx, P2P_MUX_PRIORITY_DEFAULT, 16);
+    mu_check(write_pattern(tx, heavy, 0, SHARE_SIZE) == 0);
+    mu_check(write_pattern(tx, light, 0, SHARE_SIZE) == 0);
+    mu_check(p2p_mux_close(tx, heavy) == 0);
+    mu_check(p2p_mux_close(tx, light) == 0);
+
+    pump_t pump = {tx, 0};
+    thread = start_thread(pump_thread, &pump);
+    THREAD_HANDLE receiver = start_thread(recv_thread, tx);
+
+    size_t light_at_heavy_done = 0;
+    while (!track(&sink, light)->fin) {
+        mu_check(p2p_mux_recv(rx) == 0);
+        if (track(&sink, heavy)->fin && !light_at_heavy_done) {
+            light_at_heavy_done = track(&sink, light)->bytes;
+        }
+    }
+    p2p_socket_close(client_sock);
+    wait_for_thread(thread);
+    wait_for_thread(receiver);
+
+    // 3:1 weights: light had about a third of heavy's bytes when heavy finished
+    mu_check(sink.first_fin_id == heavy);
+    mu_check(light_at_heavy_done > SHARE_SIZE / 4);
+    mu_check(light_at_heavy_done < SHARE_SIZE * 2 / 5);
+    mu_check(!track(&sink, heavy)->corrupt && !track(&sink, light)->corrupt);
+    mu_check(track(&sink, light)->bytes == SHARE_SIZE);
+
+    p2p_mux_free(tx);
+    p2p_mux_free(rx);
+    p2p_session_free(client);
+    p2p_session_free(server.session);
+    p2p_keypair_free(client_kp);
+    p2p_keypair_free(server.keypair);
+    p2p_socket_close(server.sock);
+    return NULL;
+}
+
+// ============================================================================
+// Test 4: Credit-based flow control
+// ============================================================================
+
+static int recv_until(p2p_mux_t* mux, sink_t* sink, size_t total) {
+    size_t have;
+    do {
+        if (p2p_mux_recv(mux) != 0) return -1;
+        have = 0;
+        for (int i = 0; i < sink->count; i++) have += sink->streams[i].bytes;
+    } while (have < total);
+    return 0;
+}
+
+MU_TEST(test_mux_flow_control) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 2 * P2P_MUX_CONN_WINDOW) == 0);
+
+    sink_t sink_tx = {0}, sink = {0};
+    p2p_mux_t* tx = p2p_mux_create(a, NULL, 1, on_data, &sink_tx);
+    p2p_mux_t* rx = p2p_mux_create(b, NULL, 0, on_data, &sink);
+    p2p_mux_set_auto_consume(rx, 0);
+
+    // One stream: stops after one stream window
+    uint32_t s = p2p_mux_open(tx, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT);
+    mu_check(p2p_mux_write_space(tx, s) == P2P_MUX_STREAM_WINDOW);
+    mu_check(write_pattern(tx, s, 0, P2P_MUX_CONN_WINDOW) == 0);
+    mu_check(p2p_mux_write_space(tx, s) == 0);
+    mu_check(p2p_mux_send_pending(tx, 0) == P2P_MUX_STREAM_WINDOW);
+    mu_check(p2p_mux_send_pending(tx, 0) == 0);
+    mu_check(recv_until(rx, &sink, P2P_MUX_STREAM_WINDOW) == 0);
+
+    // Credit comes back once half a window is consumed
+    mu_check(p2p_mux_consume(rx, s, P2P_MUX_STREAM_WINDOW / 4) == 0);
+    mu_check(p2p_mux_consume(rx, s, P2P_MUX_STREAM_WINDOW / 4) == 0);
+    mu_check(p2p_mux_consume(rx, s, P2P_MUX_STREAM_WINDOW) == -1);     // More than received
+    mu_check(p2p_mux_recv(tx) == 0);                                    // Window update
+    mu_check(p2p_mux_send_pending(tx, 0) == P2P_MUX_STREAM_WINDOW / 2);
+    mu_check(recv_until(rx, &sink, P2P_MUX_STREAM_WINDOW * 3 / 2) == 0);
+
+    // More streams: the connection window caps the total in flight
+    for (int i = 0; i < 3; i++) {
+        uint32_t extra = p2p_mux_open(tx, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT);
+        mu_check(write_pattern(tx, extra, 0, P2P_MUX_STREAM_WINDOW) == 0);
+    }
+    size_t conn_left = P2P_MUX_CONN_WINDOW - P2P_MUX_STREAM_WINDOW * 3 / 2;
+    mu_check(p2p_mux_send_pending(tx, 0) == (intptr_t)conn_left);
+    mu_check(p2p_mux_send_pending(tx, 0) == 0);
+    mu_check(recv_until(rx, &sink, P2P_MUX_CONN_WINDOW) == 0);
+
+    for (int i = 0; i < sink.count; i++) {
+        mu_check(!sink.streams[i].corrupt);
+        mu_check(p2p_mux_consume(rx, sink.streams[i].id, sink.streams[i].bytes -
+                                 (sink.streams[i].id == s ? P2P_MUX_STREAM_WINDOW / 2 : 0)) == 0);
+    }
+
+    // Sending resumes once the connection update arrives
+    intptr_t resumed = 0;
+    for (int i = 0; i < 8 && resumed == 0; i++) {
+        mu_check(p2p_mux_recv(tx) == 0);
+        resumed = p2p_mux_send_pending(tx, 0);
+    }
+    mu_check(resumed > 0);
+
+    p2p_mux_free(tx);
+    p2p_mux_free(rx);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+MU_TEST(test_mux_window_overrun) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 2 * P2P_MUX_STREAM_WINDOW) == 0);
+
+    sink_t sink = {0};
+    p2p_mux_t* rx = p2p_mux_create(b, NULL, 0, on_data, &sink);
+    p2p_mux_set_auto_consume(rx, 0);
+
+    // A peer ignoring the window: one chunk too many is a protocol error
+    uint8_t* frame = (uint8_t*)calloc(1, P2P_MUX_HEADER_SIZE + P2P_MUX_CHUNK_SIZE);
+    frame[3] = 1;
+    p2p_message_t msg = {.length = P2P_MUX_HEADER_SIZE + P2P_MUX_CHUNK_SIZE, .data = frame};
+
+    int chunks = P2P_MUX_STREAM_WINDOW / P2P_MUX_CHUNK_SIZE;
+    for (int i = 0; i <= chunks; i++) {
+        mu_check(p2p_message_send(a, &msg) == 0);
+    }
+    for (int i = 0; i < chunks; i++) {
+        mu_check(p2p_mux_recv(rx) == 0);
+    }
+    mu_check(p2p_mux_recv(rx) == -1);
+    mu_check(p2p_mux_wait_sendable(rx) == -1);      // Sender threads see the failure
+
+    free(frame);
+    p2p_mux_free(rx);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 5: Protocol errors
+// ============================================================================
+
+MU_TEST(test_mux_protocol_errors) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+
+    sink_t sink = {0};
+    p2p_mux_t* rx = p2p_mux_create(b, NULL, 0, on_data, &sink);
+
+    // Stream id with our own parity that we never opened
+    uint8_t frame[P2P_MUX_HEADER_SIZE] = {0, 0, 0, 2, 0};
+    p2p_message_t msg = {.length = sizeof(frame), .data = frame};
+    mu_check(p2p_message_send(a, &msg) == 0);
+    mu_check(p2p_mux_recv(rx) == -1);
+
+    // Unknown flags
+    uint8_t flags[P2P_MUX_HEADER_SIZE] = {0, 0, 0, 1, 0x80};
+    msg.data = flags;
+    mu_check(p2p_message_send(a, &msg) == 0);
+    mu_check(p2p_mux_recv(rx) == -1);
+
+    // Data after FIN
+    uint8_t fin[P2P_MUX_HEADER_SIZE] = {0, 0, 0, 5, 0x01};
+    msg.data = fin;
+    mu_check(p2p_message_send(a, &msg) == 0);
+    mu_check(p2p_mux_recv(rx) == 0);
+    mu_check(p2p_message_send(a, &msg) == 0);
+    mu_check(p2p_mux_recv(rx) == -1);
+    mu_check(sink.frames == 1);
+
+    p2p_mux_free(rx);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 6: Concurrent stream cap and empty data frames
+// ============================================================================
+
+MU_TEST(test_mux_stream_limits) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+
+    sink_t sink_a = {0}, sink_b = {0};
+    p2p_mux_t* ma = p2p_mux_create(a, NULL, 1, on_data, &sink_a);
+    p2p_mux_t* mb = p2p_mux_create(b, NULL, 0, on_data, &sink_b);
+    mu_check(ma && mb);
+
+    // Our own opens stop at the cap; a stream closed both ways frees a slot
+    for (int i = 0; i < P2P_MUX_MAX_STREAMS; i++) {
+        mu_check(p2p_mux_open(ma, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT) != 0);
+    }
+    mu_check(p2p_mux_open(ma, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT) == 0);
+
+    mu_check(p2p_mux_close(ma, 1) == 0);
+    mu_check(p2p_mux_send_pending(ma, 0) == 0);
+    mu_check(p2p_mux_recv(mb) == 0);
+    mu_check(p2p_mux_close(mb, 1) == 0);
+    mu_check(p2p_mux_send_pending(mb, 0) == 0);
+    mu_check(p2p_mux_recv(ma) == 0);
+    mu_check(p2p_mux_stream_count(ma) == P2P_MUX_MAX_STREAMS - 1);
+    mu_check(p2p_mux_open(ma, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT) != 0);
+    mu_check(p2p_mux_open(ma, P2P_MUX_PRIORITY_DEFAULT, P2P_MUX_WEIGHT_DEFAULT) == 0);
+
+    // Every stream is still found after the removal reshuffled the table
+    for (uint32_t id = 3; id <= 2 * P2P_MUX_MAX_STREAMS + 1; id += 2) {
+        mu_check(p2p_mux_write_space(ma, id) > 0);
+    }
+
+    p2p_mux_free(ma);
+    p2p_mux_free(mb);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+
+    // A peer opening one stream too many is a protocol error
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+    p2p_mux_t* rx = p2p_mux_create(b, NULL, 0, on_data, &sink_b);
+    uint8_t frame[P2P_MUX_HEADER_SIZE + 1] = {0};
+    p2p_message_t msg = {.length = sizeof(frame), .data = frame};
+    for (uint32_t i = 0; i <= P2P_MUX_MAX_STREAMS; i++) {
+        uint32_t id = 2 * i + 1;
+        frame[2] = (uint8_t)(id >> 8);
+        frame[3] = (uint8_t)id;
+        mu_check(p2p_message_send(a, &msg) == 0);
+        mu_check(p2p_mux_recv(rx) == (i < P2P_MUX_MAX_STREAMS ? 0 : -1));
+    }
+    mu_check(p2p_mux_stream_count(rx) == P2P_MUX_MAX_STREAMS);
+    p2p_mux_free(rx);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+
+    // Zero-length frame without FIN carries nothing: rejected; with FIN it is fine
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+    rx = p2p_mux_create(b, NULL, 0, on_data, &sink_b);
+    uint8_t fin[P2P_MUX_HEADER_SIZE] = {0, 0, 0, 1, 0x01};
+    msg.length = sizeof(fin);
+    msg.data = fin;
+    mu_check(p2p_message_send(a, &msg) == 0);
+    mu_check(p2p_mux_recv(rx) == 0);
+    uint8_t empty[P2P_MUX_HEADER_SIZE] = {0, 0, 0, 3, 0};
+    msg.data = empty;
+    mu_check(p2p_message_send(a, &msg) == 0);
+    mu_check(p2p_mux_recv(rx) == -1);
+    mu_check(p2p_mux_stream_count(rx) == 1);
+    p2p_mux_free(rx);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+MU_TEST_SUITE(mux_suite) {
+    MU_RUN_TEST(test_mux_basic);
+    MU_RUN_TEST(test_mux_priority);
+    MU_RUN_TEST(test_mux_weights);
+    MU_RUN_TEST(test_mux_flow_control);
+    MU_RUN_TEST(test_mux_window_overrun);
+    MU_RUN_TEST(test_mux_protocol_errors);
+    MU_RUN_TEST(test_mux_stream_limits);
+    return NULL;
+}
+
+int main() {
+    printf("========================================\n");
+    printf(" Running Mux Tests                      \n");
+    printf("========================================\n\n");
+
+    if (p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    MU_RUN_SUITE(mux_suite);
+    MU_REPORT();
+
+    return MU_EXIT_CODE;
+}
@@ -0,0 +1,208 @@
+#include "minunit.h"
+#include <p2pnet/p2pnet.h>
+#include <sodium.h>
+#include <string.h>
+
+// Helper: create heap session with random key and peer identity
+static p2p_session_t* make_session(uint8_t* pubkey_out) {
+    uint8_t key[32];
+    uint8_t pubkey[32];
+    randombytes_buf(key, sizeof(key));
+    randombytes_buf(pubkey, sizeof(pubkey));
+
+    if (pubkey_out) {
+        memcpy(pubkey_out, pubkey, 32);
+    }
+
+    return p2p_session_create(key, pubkey);
+}
+
+// ============================================================================
+// Test 1: Create and free table
+// ============================================================================
+
+MU_TEST(test_session_table_create) {
+    p2p_session_table_t* table = p2p_session_table_create(16);
+
+    mu_check(table != NULL);
+    mu_check(p2p_session_table_count(table) == 0);
+    mu_check(p2p_session_table_memory_usage(table) > 0);
+
+    p2p_session_table_free(table);
+
+    // Zero capacity is invalid
+    mu_check(p2p_session_table_create(0) == NULL);
+    return NULL;
+}
+
+// ============================================================================
+// Test 2: Adopt and look up by connection id and peer key
+// ============================================================================
+
+MU_TEST(test_session_table_adopt_and_find) {
+    p2p_session_table_t* table = p2p_session_table_create(16);
+    mu_check(table != NULL);
+
+    uint8_t pubkey[32];
+    p2p_session_t* heap = make_session(pubkey);
+    mu_check(heap != NULL);
+
+    uint8_t key[32];
+    memcpy(key, p2p_session_key(heap), 32);
+
+    p2p_session_t* session = p2p_session_table_adopt(table, heap, 42);
+    mu_check(session != NULL);
+    mu_check(p2p_session_table_count(table) == 1);
+    mu_check(p2p_session_conn_id(session) == 42);
+
+    // Contents moved with the session
+    mu_check(memcmp(p2p_session_key(session), key, 32) == 0);
+    mu_check(memcmp(p2p_session_peer_pubkey(session), pubkey, 32) == 0);
+
+    mu_check(p2p_session_table_find_conn(table, 42) == session);
+    mu_check(p2p_session_table_find_peer(table, pubkey) == session);
+    mu_check(p2p_session_table_find_conn(table, 43) == NULL);
+
+    p2p_session_table_free(table);
+    return NULL;
+}
+
+// ============================================================================
+// Test 3: Remove keeps other sessions reachable
+// ============================================================================
+
+MU_TEST(test_session_table_remove) {
+    p2p_session_table_t* table = p2p_session_table_create(64);
+    mu_check(table != NULL);
+
+    uint8_t pubkeys[50][32];
+    for (int i = 0; i < 50; i++) {
+        p2p_session_t* s = p2p_session_table_adopt(table, make_session(pubkeys[i]),
+                                                   (uint64_t)i + 1);
+        mu_check(s != NULL);
+    }
+
+    // Remove every other session (one via p2p_session_free)
+    for (int i = 0; i < 50; i += 2) {
+        p2p_session_t* s = p2p_session_table_find_conn(table, (uint64_t)i + 1);
+        mu_check(s != NULL);
+        if (i == 0) {
+            p2p_session_free(s);
+        } else {
+            mu_check(p2p_session_table_remove(table, s) == 0);
+        }
+    }
+
+    mu_check(p2p_session_table_count(table) == 25);
+
+    for (int i = 0; i < 50; i++) {
+        p2p_session_t* by_conn = p2p_session_table_find_conn(table, (uint64_t)i + 1);
+        p2p_session_t* by_peer = p2p_session_table_find_peer(table, pubkeys[i]);
+
+        if (i % 2 == 0) {
+            mu_check(by_conn == NULL);
+            mu_check(by_peer == NULL);
+        } else {
+            mu_check(by_conn != NULL);
+            mu_check(by_conn == by_peer);
+        }
+    }
+
+    p2p_session_table_free(table);
+    return NULL;
+}
+
+// ============================================================================
+// Test 4: Full table and duplicate connection id are rejected
+// ============================================================================
+
+MU_TEST(test_session_table_limits) {
+    p2p_session_table_t* table = p2p_session_table_create(2);
+    mu_check(table != NULL);
+
+    mu_check(p2p_session_table_adopt(table, make_session(NULL), 1) != NULL);
+
+    // Duplicate conn_id: heap session is left untouched
+    p2p_session_t* dup = make_session(NULL);
+    mu_check(p2p_session_table_adopt(table, dup, 1) == NULL);
+
+    mu_check(p2p_session_table_adopt(table, dup, 2) != NULL);
+
+    // Full
+    p2p_session_t* extra = make_session(NULL);
+    mu_check(p2p_session_table_adopt(table, extra, 3) == NULL);
+    p2p_session_free(extra);
+
+    p2p_session_table_free(table);
+    return NULL;
+}
+
+// ============================================================================
+// Test 5: Several sessions for one peer (reconnect overlap)
+// ============================================================================
+
+static p2p_session_t* adopt_for_peer(p2p_session_table_t* table, const uint8_t* pubkey,
+                                     uint64_t conn_id) {
+    uint8_t key[32];
+    randombytes_buf(key, sizeof(key));
+    return p2p_session_table_adopt(table, p2p_session_create(key, pubkey), conn_id);
+}
+
+MU_TEST(test_session_table_same_peer) {
+    p2p_session_table_t* table = p2p_session_table_create(16);
+    mu_check(table != NULL);
+
+    uint8_t pubkey[32];
+    randombytes_buf(pubkey, sizeof(pubkey));
+
+    p2p_session_t* first = adopt_for_peer(table, pubkey, 1);
+    p2p_session_t* second = adopt_for_peer(table, pubkey, 2);
+    mu_check(first && second);
+    mu_check(p2p_session_table_find_peer(table, pubkey) == second);
+
+    // Newest gone: the older session is found again
+    mu_check(p2p_session_table_remove(table, second) == 0);
+    mu_check(p2p_session_table_find_peer(table, pubkey) == first);
+
+    // Middle of three removed, then the newest
+    second = adopt_for_peer(table, pubkey, 2);
+    p2p_session_t* third = adopt_for_peer(table, pubkey, 3);
+    mu_check(second && third);
+    mu_check(p2p_session_table_remove(table, second) == 0);
+    mu_check(p2p_session_table_find_peer(table, pubkey) == third);
+    mu_check(p2p_session_table_remove(table, third) == 0);
+    mu_check(p2p_session_table_find_peer(table, pubkey) == first);
+
+    // Oldest removed while a newer one exists
+    second = adopt_for_peer(table, pubkey, 2);
+    mu_check(p2p_session_table_remove(table, first) == 0);
+    mu_check(p2p_session_table_find_peer(table, pubkey) == second);
+    p2p_session_free(second);
+    mu_check(p2p_session_table_find_peer(table, pubkey) == NULL);
+    mu_check(p2p_session_table_count(table) == 0);
+
+    p2p_session_table_free(table);
+    return NULL;
+}
+
+MU_TEST_SUITE(session_table_suite) {
+    MU_RUN_TEST(test_session_table_create);
+    MU_RUN_TEST(test_session_table_adopt_and_find);
+    MU_RUN_TEST(test_session_table_remove);
+    MU_RUN_TEST(test_session_table_limits);
+    MU_RUN_TEST(test_session_table_same_peer);
+    return NULL;
+}
+
+int main() {
+    printf("========================================\n");
+    printf(" Running Session Table Tests            \n");
+    printf("========================================\n\n");
+
+    p2p_crypto_init();
+
+    MU_RUN_SUITE(session_table_suite);
+    MU_REPORT();
+
+    return MU_EXIT_CODE;
+}
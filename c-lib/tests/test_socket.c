@@ -1,5 +1,14 @@
 #include "minunit.h"
 #include <p2pnet/p2pnet.h>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <sys/resource.h>
+    #include <unistd.h>
+#endif
+
+#define ACCEPT_TEST_PORT 47460
+#define ACCEPT_CLIENTS 8
 
 MU_TEST(test_socket_create) {
     p2p_init();
@@ -44,10 +53,292 @@ MU_TEST(test_socket_listen) {
     return NULL;  // ← Legg til
 }
 
+MU_TEST(test_socket_pair) {
+    p2p_init();
+    
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+    mu_check(a != NULL && b != NULL);
+    
+    // Begge retninger
+    char buf[8] = {0};
+    mu_check(p2p_socket_send(a, "ping", 4) == 4);
+    mu_check(p2p_socket_recv(b, buf, sizeof(buf)) == 4);
+    mu_check(memcmp(buf, "ping", 4) == 0);
+    
+    mu_check(p2p_socket_send(b, "pong", 4) == 4);
+    mu_check(p2p_socket_recv(a, buf, sizeof(buf)) == 4);
+    mu_check(memcmp(buf, "pong", 4) == 0);
+    
+    // Lukket ende gir EOF
+    p2p_socket_close(a);
+    mu_check(p2p_socket_recv(b, buf, sizeof(buf)) == 0);
+    
+    p2p_socket_close(b);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
+static p2p_socket_t* accept_listener(void) {
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    if (!listener ||
+        p2p_socket_bind(listener, "127.0.0.1", ACCEPT_TEST_PORT) != 0 ||
+        p2p_socket_listen(listener, 64) != 0 ||
+        p2p_socket_set_nonblocking(listener, 1) != 0) {
+        p2p_socket_close(listener);
+        return NULL;
+    }
+    return listener;
+}
+
+static p2p_socket_t* accept_client(void) {
+    p2p_socket_t* client = p2p_socket_create(P2P_TCP);
+    if (client && p2p_socket_connect(client, "127.0.0.1", ACCEPT_TEST_PORT) != 0) {
+        p2p_socket_close(client);
+        return NULL;
+    }
+    return client;
+}
+
+// Tømmer accept-køen, i små batcher
+static int accept_all(p2p_socket_t* listener, p2p_socket_t** out, int max,
+                      p2p_admission_t* admission) {
+    int total = 0;
+    for (;;) {
+        int n = p2p_socket_accept_batch(listener, out + total,
+                                        max - total < 3 ? max - total : 3, admission, 0);
+        if (n <= 0) return n < 0 ? -1 : total;
+        total += n;
+    }
+}
+
+MU_TEST(test_socket_accept_batch) {
+    p2p_init();
+    
+    p2p_socket_t* listener = accept_listener();
+    mu_check(listener != NULL);
+    
+    // Tom kø: 0, ikke blokkering
+    p2p_socket_t* accepted[ACCEPT_CLIENTS + 1];
+    mu_check(p2p_socket_accept_batch(listener, accepted, ACCEPT_CLIENTS, NULL, 0) == 0);
+    
+    p2p_socket_t* clients[ACCEPT_CLIENTS];
+    for (int i = 0; i < ACCEPT_CLIENTS; i++) {
+        clients[i] = accept_client();
+        mu_check(clients[i] != NULL);
+    }
+    
+    mu_check(accept_all(listener, accepted, ACCEPT_CLIENTS + 1, NULL) == ACCEPT_CLIENTS);
+    
+    // Aksepterte sockets er blokkerende og virker som fra p2p_socket_accept
+    char buf[8] = {0};
+    mu_check(p2p_socket_send(clients[0], "ping", 4) == 4);
+    int found = 0;
+    for (int i = 0; i < ACCEPT_CLIENTS; i++) {
+        p2p_socket_set_nonblocking(accepted[i], 1);
+        if (p2p_socket_recv(accepted[i], buf, sizeof(buf)) == 4) found++;
+        p2p_socket_set_nonblocking(accepted[i], 0);
+    }
+    mu_check(found == 1);
+    mu_check(memcmp(buf, "ping", 4) == 0);
+    
+    // Lukkede socket-strukturer gjenbrukes: ingen nye allokeringer
+    for (int i = 0; i < ACCEPT_CLIENTS; i++) {
+        p2p_socket_close(accepted[i]);
+        p2p_socket_close(clients[i]);
+    }
+    p2p_metrics_t before, after;
+    p2p_metrics_global(&before);
+    for (int i = 0; i < ACCEPT_CLIENTS; i++) {
+        clients[i] = accept_client();
+        mu_check(clients[i] != NULL);
+    }
+    mu_check(accept_all(listener, accepted, ACCEPT_CLIENTS + 1, NULL) == ACCEPT_CLIENTS);
+    p2p_metrics_global(&after);
+    mu_check(after.values[P2P_METRIC_ALLOCATIONS] == before.values[P2P_METRIC_ALLOCATIONS]);
+    
+    for (int i = 0; i < ACCEPT_CLIENTS; i++) {
+        p2p_socket_close(accepted[i]);
+        p2p_socket_close(clients[i]);
+    }
+    p2p_socket_close(listener);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
+MU_TEST(test_socket_admission) {
+    p2p_init();
+    
+    p2p_socket_t* listener = accept_listener();
+    mu_check(listener != NULL);
+    
+    p2p_socket_t* clients[ACCEPT_CLIENTS];
+    p2p_socket_t* accepted[ACCEPT_CLIENTS];
+    int pending = -1;
+    uint64_t rejected = 0;
+    
+    // Maks 3 ventende handshakes
+    p2p_admission_t* admission = p2p_admission_create(3, 0);
+    mu_check(admission != NULL);
+    
+    for (int i = 0; i < 5; i++) {
+        clients[i] = accept_client();
+        mu_check(clients[i] != NULL);
+    }
+    mu_check(accept_all(listener, accepted, ACCEPT_CLIENTS, admission) == 3);
+    mu_check(p2p_admission_stats(admission, &pending, &rejected) == 0);
+    mu_check(pending == 3);
+    mu_check(rejected == 2);
+    
+    p2p_metrics_t metrics;
+    p2p_socket_metrics(listener, &metrics);
+    mu_check(metrics.values[P2P_METRIC_ACCEPT_REJECTS] == 2);
+    
+    // Ferdig handshake frigjør plassen (to ganger er ufarlig)
+    p2p_socket_admitted(accepted[0]);
+    p2p_socket_admitted(accepted[0]);
+    p2p_admission_stats(admission, &pending, NULL);
+    mu_check(pending == 2);
+    
+    clients[5] = accept_client();
+    mu_check(clients[5] != NULL);
+    mu_check(accept_all(listener, accepted + 3, ACCEPT_CLIENTS - 3, admission) == 1);
+    
+    // Lukket ventende socket frigjør også plassen
+    p2p_socket_close(accepted[1]);
+    p2p_admission_stats(admission, &pending, NULL);
+    mu_check(pending == 2);
+    
+    // Reglene lever til siste socket er lukket
+    p2p_admission_free(admission);
+    p2p_socket_close(accepted[0]);
+    p2p_socket_close(accepted[2]);
+    p2p_socket_close(accepted[3]);
+    for (int i = 0; i < 6; i++) {
+        p2p_socket_close(clients[i]);
+    }
+    
+    // Maks 2 tilkoblinger per IP (alle fra 127.0.0.1)
+    admission = p2p_admission_create(0, 2);
+    for (int i = 0; i < 3; i++) {
+        clients[i] = accept_client();
+        mu_check(clients[i] != NULL);
+    }
+    mu_check(accept_all(listener, accepted, ACCEPT_CLIENTS, admission) == 2);
+    p2p_admission_stats(admission, NULL, &rejected);
+    mu_check(rejected == 1);
+    
+    // Per-IP-plassen holdes til socketen lukkes, ikke bare til handshake
+    p2p_socket_admitted(accepted[0]);
+    clients[3] = accept_client();
+    mu_check(clients[3] != NULL);
+    mu_check(accept_all(listener, accepted + 2, ACCEPT_CLIENTS - 2, admission) == 0);
+    
+    p2p_socket_close(accepted[0]);
+    clients[4] = accept_client();
+    mu_check(clients[4] != NULL);
+    mu_check(accept_all(listener, accepted + 2, ACCEPT_CLIENTS - 2, admission) == 1);
+    p2p_admission_stats(admission, NULL, &rejected);
+    mu_check(rejected == 2);
+    
+    p2p_socket_close(accepted[1]);
+    p2p_socket_close(accepted[2]);
+    for (int i = 0; i < 5; i++) {
+        p2p_socket_close(clients[i]);
+    }
+    p2p_admission_free(admission);
+    p2p_socket_close(listener);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
+MU_TEST(test_socket_accept_limits) {
+    p2p_init();
+    
+    // Blokkerende listener avvises i stedet for å henge
+    p2p_socket_t* blocking = p2p_socket_create(P2P_TCP);
+    mu_check(blocking != NULL);
+    mu_check(p2p_socket_bind(blocking, "127.0.0.1", 0) == 0);
+    mu_check(p2p_socket_listen(blocking, 4) == 0);
+    p2p_socket_t* accepted[ACCEPT_CLIENTS];
+    mu_check(p2p_socket_accept_batch(blocking, accepted, ACCEPT_CLIENTS, NULL, 0) == -1);
+    p2p_socket_close(blocking);
+    
+    // Avviste tilkoblinger bruker av forsøkene: max 2 gir høyst 2 accept() per kall
+    p2p_socket_t* listener = accept_listener();
+    mu_check(listener != NULL);
+    p2p_admission_t* admission = p2p_admission_create(1, 0);
+    p2p_socket_t* clients[ACCEPT_CLIENTS];
+    for (int i = 0; i < 5; i++) {
+        clients[i] = accept_client();
+        mu_check(clients[i] != NULL);
+    }
+    uint64_t rejected = 0;
+    mu_check(p2p_socket_accept_batch(listener, accepted, 2, admission, 0) == 1);
+    p2p_admission_stats(admission, NULL, &rejected);
+    mu_check(rejected == 1);
+    mu_check(p2p_socket_accept_batch(listener, accepted + 1, 2, admission, 0) == 0);
+    p2p_admission_stats(admission, NULL, &rejected);
+    mu_check(rejected == 3);
+    mu_check(p2p_socket_accept_batch(listener, accepted + 1, 2, admission, 0) == 0);
+    p2p_admission_stats(admission, NULL, &rejected);
+    mu_check(rejected == 4);
+    
+    p2p_socket_close(accepted[0]);
+    for (int i = 0; i < 5; i++) {
+        p2p_socket_close(clients[i]);
+    }
+    p2p_admission_free(admission);
+    
+#ifndef _WIN32
+    // Tom for fd-er: køen tømmes med reserve-fd-en i stedet for å spinne
+    for (int i = 0; i < 3; i++) {
+        clients[i] = accept_client();
+        mu_check(clients[i] != NULL);
+    }
+    struct rlimit saved, limit;
+    mu_check(getrlimit(RLIMIT_NOFILE, &saved) == 0);
+    int lowest_free = dup(0);
+    mu_check(lowest_free >= 0);
+    close(lowest_free);
+    limit = saved;
+    limit.rlim_cur = (rlim_t)lowest_free;           // Ingen ny fd kan åpnes
+    mu_check(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+    
+    p2p_metrics_t before, after;
+    p2p_socket_metrics(listener, &before);
+    int n = p2p_socket_accept_batch(listener, accepted, ACCEPT_CLIENTS, NULL, 0);
+    p2p_socket_metrics(listener, &after);
+    mu_check(setrlimit(RLIMIT_NOFILE, &saved) == 0);
+    
+    mu_check(n == 0);
+    mu_check(after.values[P2P_METRIC_ACCEPT_REJECTS] -
+             before.values[P2P_METRIC_ACCEPT_REJECTS] == 3);
+    mu_check(p2p_socket_accept_batch(listener, accepted, ACCEPT_CLIENTS, NULL, 0) == 0);
+    
+    for (int i = 0; i < 3; i++) {
+        p2p_socket_close(clients[i]);
+    }
+#endif
+    
+    p2p_socket_close(listener);
+    p2p_cleanup();
+    
+    return NULL;
+}
+
 MU_TEST_SUITE(socket_suite) {
     MU_RUN_TEST(test_socket_create);
     MU_RUN_TEST(test_socket_bind);
     MU_RUN_TEST(test_socket_listen);
+    MU_RUN_TEST(test_socket_pair);
+    MU_RUN_TEST(test_socket_accept_batch);
+    MU_RUN_TEST(test_socket_admission);
+    MU_RUN_TEST(test_socket_accept_limits);
     return NULL;  // ← Legg til
 }
 
@@ -0,0 +1,277 @@
+#include "minunit.h"
+#include <p2pnet/p2pnet.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>
+    #define THREAD_RETURN unsigned int __stdcall
+    #define THREAD_HANDLE HANDLE
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #define THREAD_RETURN void*
+    #define THREAD_HANDLE pthread_t
+#endif
+
+static THREAD_HANDLE start_thread(THREAD_RETURN (*fn)(void*), void* arg) {
+    #ifdef _WIN32
+        return (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    #else
+        THREAD_HANDLE thread;
+        pthread_create(&thread, NULL, fn, arg);
+        return thread;
+    #endif
+}
+
+static void wait_for_thread(THREAD_HANDLE thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+#define STREAM_SIZE (3 * P2P_MAX_MESSAGE_SIZE + 12345)     // Larger than any single message
+#define TEST_WINDOW (48 * 1024)
+
+static uint8_t pattern_byte(uint64_t i) {
+    return (uint8_t)((i * 131) ^ (i >> 9));
+}
+
+// ============================================================================
+// Sender / receiver helpers
+// ============================================================================
+
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_session_t* session;
+    p2p_keypair_t* keypair;
+    uint64_t declared;              // Length passed to begin
+    uint64_t length;                // Bytes actually written
+    size_t window;
+    int result;
+} sender_t;
+
+static THREAD_RETURN sender_thread(void* arg) {
+    sender_t* s = (sender_t*)arg;
+    s->result = -1;
+
+    p2p_stream_writer_t* writer = p2p_stream_begin(s->sock, s->session, s->declared, s->window);
+    if (!writer) return 0;
+
+    // Odd-sized writes so chunks and writes never line up
+    uint8_t block[7777];
+    uint64_t pos = 0;
+    while (pos < s->length) {
+        size_t n = s->length - pos < sizeof(block) ? (size_t)(s->length - pos) : sizeof(block);
+        for (size_t i = 0; i < n; i++) block[i] = pattern_byte(pos + i);
+        if (p2p_stream_write(writer, block, n) != 0) {
+            p2p_stream_abort(writer);
+            return 0;
+        }
+        pos += n;
+    }
+
+    s->result = p2p_stream_end(writer);
+    return 0;
+}
+
+typedef struct {
+    uint64_t next_offset;
+    size_t max_chunk;
+    int chunks;
+    int corrupt;
+    int stop_after;                 // Stop after N chunks (0 = never)
+} sink_t;
+
+static int check_chunk(const uint8_t* data, size_t length, uint64_t offset, void* user_data) {
+    sink_t* sink = (sink_t*)user_data;
+
+    if (offset != sink->next_offset) sink->corrupt = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] != pattern_byte(offset + i)) {
+            sink->corrupt = 1;
+            break;
+        }
+    }
+
+    sink->next_offset += length;
+    if (length > sink->max_chunk) sink->max_chunk = length;
+    sink->chunks++;
+
+    return sink->stop_after && sink->chunks >= sink->stop_after;
+}
+
+// ============================================================================
+// Test 1: Plaintext stream larger than P2P_MAX_MESSAGE_SIZE
+// ============================================================================
+
+MU_TEST(test_stream_plain) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 64 * 1024) == 0);
+
+    sender_t sender = {a, NULL, NULL, STREAM_SIZE, STREAM_SIZE, TEST_WINDOW, -1};
+    THREAD_HANDLE thread = start_thread(sender_thread, &sender);
+
+    sink_t sink = {0};
+    int64_t received = p2p_stream_recv(b, NULL, check_chunk, &sink, UINT64_MAX);
+    wait_for_thread(thread);
+
+    mu_check(sender.result == 0);
+    mu_check(received == STREAM_SIZE);
+    mu_check(!sink.corrupt);
+    mu_check(sink.max_chunk <= TEST_WINDOW);       // Bounded by the window
+
+    // Ordinary messages still work afterwards
+    p2p_message_t msg = {.length = 2, .data = (uint8_t*)"ok"};
+    mu_check(p2p_message_send(a, &msg) == 0);
+    p2p_message_t* next = p2p_message_recv(b);
+    mu_check(next != NULL && next->length == 2);
+    p2p_message_free(next);
+
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 2: Encrypted stream of unknown length
+// ============================================================================
+
+static THREAD_RETURN handshake_thread(void* arg) {
+    sender_t* s = (sender_t*)arg;
+    s->session = p2p_handshake_server(s->sock, s->keypair, NULL, 0);
+    return 0;
+}
+
+MU_TEST(test_stream_encrypted) {
+    sender_t server = {0};
+    p2p_socket_t* client_sock = NULL;
+    mu_check(p2p_socket_pair_memory(&client_sock, &server.sock, 0) == 0);
+
+    p2p_keypair_t* client_kp = p2p_keypair_generate();
+    server.keypair = p2p_keypair_generate();
+
+    THREAD_HANDLE thread = start_thread(handshake_thread, &server);
+    p2p_session_t* client = p2p_handshake_client(client_sock, client_kp, server.keypair->public_key);
+    wait_for_thread(thread);
+    mu_check(client != NULL && server.session != NULL);
+
+    server.declared = P2P_STREAM_UNKNOWN_LENGTH;
+    server.length = STREAM_SIZE;
+    server.window = 0;                              // Default window
+    thread = start_thread(sender_thread, &server);
+
+    sink_t sink = {0};
+    int64_t received = p2p_stream_recv(client_sock, client, check_chunk, &sink, UINT64_MAX);
+    wait_for_thread(thread);
+
+    mu_check(server.result == 0);
+    mu_check(received == STREAM_SIZE);
+    mu_check(!sink.corrupt);
+    mu_check(sink.max_chunk <= P2P_STREAM_DEFAULT_WINDOW);
+
+    p2p_session_free(client);
+    p2p_session_free(server.session);
+    p2p_keypair_free(client_kp);
+    p2p_keypair_free(server.keypair);
+    p2p_socket_close(client_sock);
+    p2p_socket_close(server.sock);
+    return NULL;
+}
+
+// ============================================================================
+// Test 3: Length checks, abort, callback stop
+// ============================================================================
+
+static int run_pair(sender_t* sender, sink_t* sink, uint64_t max_length) {
+    p2p_socket_t* b = NULL;
+    if (p2p_socket_pair_memory(&sender->sock, &b, 0) != 0) return -2;
+
+    THREAD_HANDLE thread = start_thread(sender_thread, sender);
+    int64_t received = p2p_stream_recv(b, NULL, check_chunk, sink, max_length);
+
+    // Unblock a sender still writing after the receiver gave up
+    p2p_socket_close(b);
+    wait_for_thread(thread);
+    p2p_socket_close(sender->sock);
+    return (int)received;
+}
+
+MU_TEST(test_stream_errors) {
+    // Writes beyond the declared length
+    sender_t over = {NULL, NULL, NULL, 1000, 2000, 256, 0};
+    sink_t sink = {0};
+    mu_check(run_pair(&over, &sink, UINT64_MAX) == -1);
+    mu_check(over.result == -1);
+    mu_check(sink.next_offset <= 1000);
+
+    // Fewer bytes than declared
+    sender_t under = {NULL, NULL, NULL, 1000, 500, 256, 0};
+    memset(&sink, 0, sizeof(sink));
+    mu_check(run_pair(&under, &sink, UINT64_MAX) == -1);
+    mu_check(under.result == -1);
+
+    // Declared length above the receiver's limit
+    sender_t big = {NULL, NULL, NULL, 5000, 5000, 256, 0};
+    memset(&sink, 0, sizeof(sink));
+    mu_check(run_pair(&big, &sink, 4000) == -1);
+    mu_check(sink.chunks == 0);
+
+    // Unknown length that runs past the receiver's limit
+    sender_t open = {NULL, NULL, NULL, P2P_STREAM_UNKNOWN_LENGTH, 5000, 256, 0};
+    memset(&sink, 0, sizeof(sink));
+    mu_check(run_pair(&open, &sink, 4000) == -1);
+    mu_check(sink.next_offset <= 4000);
+
+    // Callback stops early
+    sender_t stop = {NULL, NULL, NULL, 5000, 5000, 256, 0};
+    memset(&sink, 0, sizeof(sink));
+    sink.stop_after = 2;
+    mu_check(run_pair(&stop, &sink, UINT64_MAX) == -1);
+    mu_check(sink.chunks == 2);
+
+    // Empty stream
+    sender_t empty = {NULL, NULL, NULL, 0, 0, 256, -1};
+    memset(&sink, 0, sizeof(sink));
+    mu_check(run_pair(&empty, &sink, UINT64_MAX) == 0);
+    mu_check(empty.result == 0 && sink.chunks == 0);
+
+    // Bad windows
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+    mu_check(p2p_stream_begin(a, NULL, 10, P2P_STREAM_MAX_WINDOW + 1) == NULL);
+    mu_check(p2p_stream_begin(NULL, NULL, 10, 0) == NULL);
+    mu_check(p2p_stream_write(NULL, "x", 1) == -1);
+    mu_check(p2p_stream_end(NULL) == -1);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+MU_TEST_SUITE(stream_suite) {
+    MU_RUN_TEST(test_stream_plain);
+    MU_RUN_TEST(test_stream_encrypted);
+    MU_RUN_TEST(test_stream_errors);
+    return NULL;
+}
+
+int main() {
+    printf("========================================\n");
+    printf(" Running Stream Tests                   \n");
+    printf("========================================\n\n");
+
+    if (p2p_crypto_init() < 0) {
+        return 1;
+    }
+
+    MU_RUN_SUITE(stream_suite);
+    MU_REPORT();
+
+    return MU_EXIT_CODE;
+}
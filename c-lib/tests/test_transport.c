@@ -0,0 +1,829 @@
+#include "minunit.h"
+#include <p2pnet/p2pnet.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>
+    #define THREAD_RETURN unsigned int __stdcall
+    #define THREAD_HANDLE HANDLE
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #define THREAD_RETURN void*
+    #define THREAD_HANDLE pthread_t
+#endif
+
+static THREAD_HANDLE start_thread(THREAD_RETURN (*fn)(void*), void* arg) {
+    #ifdef _WIN32
+        return (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    #else
+        THREAD_HANDLE thread;
+        pthread_create(&thread, NULL, fn, arg);
+        return thread;
+    #endif
+}
+
+static void wait_for_thread(THREAD_HANDLE thread) {
+    #ifdef _WIN32
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    #else
+        pthread_join(thread, NULL);
+    #endif
+}
+
+// ============================================================================
+// Test 1: Memory pair basics
+// ============================================================================
+
+MU_TEST(test_memory_pair) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 0) == 0);
+    mu_check(strcmp(p2p_socket_transport(a), "memory") == 0);
+
+    char buf[8] = {0};
+    mu_check(p2p_socket_send(a, "ping", 4) == 4);
+    mu_check(p2p_socket_recv(b, buf, sizeof(buf)) == 4);
+    mu_check(memcmp(buf, "ping", 4) == 0);
+
+    mu_check(p2p_socket_send(b, "pong", 4) == 4);
+    mu_check(p2p_socket_recv(a, buf, sizeof(buf)) == 4);
+    mu_check(memcmp(buf, "pong", 4) == 0);
+
+    // Buffered data is still delivered after close, then EOF
+    mu_check(p2p_socket_send(a, "bye", 3) == 3);
+    p2p_socket_close(a);
+    mu_check(p2p_socket_recv(b, buf, sizeof(buf)) == 3);
+    mu_check(p2p_socket_recv(b, buf, sizeof(buf)) == 0);
+    mu_check(p2p_socket_send(b, "x", 1) == -1);
+
+    p2p_socket_close(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 2: Transport names
+// ============================================================================
+
+MU_TEST(test_transport_names) {
+    p2p_init();
+
+    p2p_socket_t* tcp = p2p_socket_create(P2P_TCP);
+    mu_check(strcmp(p2p_socket_transport(tcp), "tcp") == 0);
+    p2p_socket_close(tcp);
+
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+#ifdef _WIN32
+    mu_check(strcmp(p2p_socket_transport(a), "tcp") == 0);
+#else
+    mu_check(strcmp(p2p_socket_transport(a), "unix") == 0);
+#endif
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+
+    mu_check(p2p_socket_transport(NULL) == NULL);
+
+    p2p_cleanup();
+    return NULL;
+}
+
+// ============================================================================
+// Test 3: Framing through a small ring (wraps and blocks)
+// ============================================================================
+
+#define STREAM_MESSAGES 200
+
+static THREAD_RETURN framed_sender(void* arg) {
+    p2p_socket_t* sock = (p2p_socket_t*)arg;
+    uint8_t payload[1000];
+
+    for (int i = 0; i < STREAM_MESSAGES; i++) {
+        memset(payload, i & 0xFF, sizeof(payload));
+        p2p_message_t msg = {.length = (uint32_t)(100 + i * 4), .data = payload};
+        if (p2p_message_send(sock, &msg) != 0) break;
+    }
+
+    return 0;
+}
+
+MU_TEST(test_memory_framing) {
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair_memory(&a, &b, 256) == 0);
+
+    THREAD_HANDLE sender = start_thread(framed_sender, a);
+
+    int ok = 1;
+    for (int i = 0; i < STREAM_MESSAGES && ok; i++) {
+        p2p_message_t* msg = p2p_message_recv(b);
+        ok = msg && msg->length == (uint32_t)(100 + i * 4) &&
+             msg->data[0] == (uint8_t)i && msg->data[msg->length - 1] == (uint8_t)i;
+        p2p_message_free(msg);
+    }
+    mu_check(ok);
+
+    wait_for_thread(sender);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+    return NULL;
+}
+
+// ============================================================================
+// Test 4: Handshake + encrypted session in memory
+// ============================================================================
+
+typedef struct {
+    p2p_socket_t* sock;
+    p2p_keypair_t* keypair;
+    p2p_session_t* session;
+} peer_t;
+
+static THREAD_RETURN handshake_server_thread(void* arg) {
+    peer_t* server = (peer_t*)arg;
+    server->session = p2p_handshake_server(server->sock, server->keypair, NULL, 0);
+
+    // Echo one message
+    if (server->session) {
+        p2p_message_t* msg = p2p_session_recv(server->session, server->sock);
+        if (msg) {
+            p2p_session_send(server->session, server->sock, msg->data, msg->length);
+            p2p_message_free(msg);
+        }
+    }
+
+    return 0;
+}
+
+MU_TEST(test_memory_handshake) {
+    peer_t client = {0};
+    peer_t server = {0};
+    mu_check(p2p_socket_pair_memory(&client.sock, &server.sock, 0) == 0);
+
+    client.keypair = p2p_keypair_generate();
+    server.keypair = p2p_keypair_generate();
+
+    THREAD_HANDLE thread = start_thread(handshake_server_thread, &server);
+
+    client.session = p2p_handshake_client(client.sock, client.keypair, server.keypair->public_key);
+    mu_check(client.session != NULL);
+
+    const uint8_t text[] = "hello over memory";
+    mu_check(p2p_session_send(client.session, client.sock, text, sizeof(text)) == 0);
+
+    p2p_message_t* echo = p2p_session_recv(client.session, client.sock);
+    mu_check(echo != NULL);
+    mu_check(echo->length == sizeof(text));
+    mu_check(memcmp(echo->data, text, sizeof(text)) == 0);
+    p2p_message_free(echo);
+
+    wait_for_thread(thread);
+    mu_check(server.session != NULL);
+
+    p2p_session_free(client.session);
+    p2p_session_free(server.session);
+    p2p_keypair_free(client.keypair);
+    p2p_keypair_free(server.keypair);
+    p2p_socket_close(client.sock);
+    p2p_socket_close(server.sock);
+    return NULL;
+}
+
+// ============================================================================
+// Test 8: Loopback TCP upgraded to shared memory
+// ============================================================================
+
+#ifndef _WIN32
+
+// ============================================================================
+// Test 5: Unix domain sockets (handshake, session, event loop)
+// ============================================================================
+
+typedef struct {
+    p2p_event_loop_t* loop;
+    uint32_t length;
+} loop_read_t;
+
+static void unix_on_read(p2p_socket_t* sock, void* user_data) {
+    loop_read_t* read = (loop_read_t*)user_data;
+    p2p_message_t* msg = p2p_message_recv(sock);
+    read->length = msg ? msg->length : 0;
+    p2p_message_free(msg);
+    p2p_event_loop_stop(read->loop);
+}
+
+static void unix_on_error(p2p_socket_t* sock, int error, void* user_data) {
+    (void)sock;
+    (void)error;
+    p2p_event_loop_stop(((loop_read_t*)user_data)->loop);
+}
+
+static THREAD_RETURN unix_server_thread(void* arg) {
+    peer_t* server = (peer_t*)arg;
+    p2p_socket_t* conn = p2p_socket_accept(server->sock);
+    if (!conn) return 0;
+
+    server->session = p2p_handshake_server(conn, server->keypair, NULL, 0);
+    if (server->session) {
+        p2p_message_t* msg = p2p_session_recv(server->session, conn);
+        if (msg) {
+            p2p_session_send(server->session, conn, msg->data, msg->length);
+            p2p_message_free(msg);
+        }
+    }
+
+    p2p_socket_close(conn);
+    return 0;
+}
+
+MU_TEST(test_unix_socket) {
+    p2p_init();
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/p2pnet-test-%d.sock", (int)getpid());
+
+    peer_t server = {0};
+    server.sock = p2p_socket_create_unix();
+    mu_check(server.sock != NULL);
+    mu_check(strcmp(p2p_socket_transport(server.sock), "unix") == 0);
+    mu_check(p2p_socket_bind_unix(server.sock, path) == 0);
+    mu_check(p2p_socket_listen(server.sock, 4) == 0);
+    server.keypair = p2p_keypair_generate();
+
+    // Handshake + encrypted echo
+    THREAD_HANDLE thread = start_thread(unix_server_thread, &server);
+
+    p2p_keypair_t* client_kp = p2p_keypair_generate();
+    p2p_socket_t* client = p2p_socket_create_unix();
+    mu_check(p2p_socket_connect_unix(client, path) == 0);
+    mu_check(p2p_socket_set_nodelay(client, 1) == 0);
+
+    p2p_session_t* session = p2p_handshake_client(client, client_kp, server.keypair->public_key);
+    mu_check(session != NULL);
+
+    const uint8_t text[] = "hello over AF_UNIX";
+    mu_check(p2p_session_send(session, client, text, sizeof(text)) == 0);
+    p2p_message_t* echo = p2p_session_recv(session, client);
+    mu_check(echo != NULL && echo->length == sizeof(text));
+    mu_check(memcmp(echo->data, text, sizeof(text)) == 0);
+    p2p_message_free(echo);
+
+    wait_for_thread(thread);
+    p2p_session_free(session);
+    p2p_session_free(server.session);
+    p2p_socket_close(client);
+
+    // Accepted unix socket in the event loop
+    client = p2p_socket_create_unix();
+    mu_check(p2p_socket_connect_unix(client, path) == 0);
+    p2p_socket_t* conn = p2p_socket_accept(server.sock);
+    mu_check(conn != NULL);
+
+    p2p_message_t* msg = p2p_message_create("ping");
+    mu_check(p2p_message_send(client, msg) == 0);
+
+    loop_read_t read = {p2p_event_loop_create(), 0};
+    mu_check(p2p_event_loop_add_socket(read.loop, conn, unix_on_read, unix_on_error, &read) == 0);
+    p2p_event_loop_run(read.loop);
+    mu_check(read.length == msg->length);
+
+    p2p_message_free(msg);
+    p2p_event_loop_free(read.loop);
+    p2p_socket_close(conn);
+    p2p_socket_close(client);
+
+    // A second bind to the same path finds a live listener and fails
+    p2p_socket_t* other = p2p_socket_create_unix();
+    mu_check(p2p_socket_bind_unix(other, path) == -1);
+    p2p_socket_close(other);
+
+    // After close the file is stale, so a new server can take it over
+    p2p_socket_close(server.sock);
+    other = p2p_socket_create_unix();
+    mu_check(p2p_socket_bind_unix(other, path) == 0);
+    p2p_socket_close(other);
+    unlink(path);
+
+    p2p_keypair_free(client_kp);
+    p2p_keypair_free(server.keypair);
+    p2p_cleanup();
+    return NULL;
+}
+
+// ============================================================================
+// Test 6: Passing sockets between processes (SCM_RIGHTS)
+// ============================================================================
+
+#define PASS_TEST_PORT 19401
+
+MU_TEST(test_socket_passing) {
+    p2p_init();
+
+    p2p_socket_t* front = NULL;
+    p2p_socket_t* worker = NULL;
+    mu_check(p2p_socket_pair(&front, &worker) == 0);
+
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_bind(listener, "127.0.0.1", PASS_TEST_PORT) == 0);
+    mu_check(p2p_socket_listen(listener, 4) == 0);
+
+    p2p_socket_t* client = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_connect(client, "127.0.0.1", PASS_TEST_PORT) == 0);
+
+    // Front accepts and hands the connection over, then drops its copy
+    p2p_socket_t* accepted = p2p_socket_accept(listener);
+    mu_check(accepted != NULL);
+    mu_check(p2p_socket_send_socket(front, accepted) == 0);
+    p2p_socket_close(accepted);
+
+    p2p_socket_t* handed = p2p_socket_recv_socket(worker);
+    mu_check(handed != NULL);
+    mu_check(strcmp(p2p_socket_transport(handed), "tcp") == 0);
+
+    p2p_message_t* msg = p2p_message_create("routed");
+    mu_check(p2p_message_send(client, msg) == 0);
+    p2p_message_t* got = p2p_message_recv(handed);
+    mu_check(got != NULL && got->length == msg->length);
+    mu_check(memcmp(got->data, msg->data, msg->length) == 0);
+    p2p_message_free(got);
+    p2p_message_free(msg);
+
+    // A listener keeps its listen mode
+    mu_check(p2p_socket_send_socket(front, listener) == 0);
+    p2p_socket_t* listener_copy = p2p_socket_recv_socket(worker);
+    mu_check(listener_copy != NULL);
+    p2p_socket_t* client2 = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_connect(client2, "127.0.0.1", PASS_TEST_PORT) == 0);
+    p2p_socket_t* accepted2 = p2p_socket_accept(listener_copy);
+    mu_check(accepted2 != NULL);
+
+    // Plain data is not a socket
+    mu_check(p2p_socket_send(front, "x", 1) == 1);
+    mu_check(p2p_socket_recv_socket(worker) == NULL);
+
+    p2p_socket_close(accepted2);
+    p2p_socket_close(client2);
+    p2p_socket_close(listener_copy);
+    p2p_socket_close(handed);
+    p2p_socket_close(client);
+    p2p_socket_close(listener);
+    p2p_socket_close(front);
+    p2p_socket_close(worker);
+    p2p_cleanup();
+    return NULL;
+}
+
+// ============================================================================
+// Test 7: Zero-copy sends (MSG_ZEROCOPY)
+// ============================================================================
+
+#define ZC_TEST_PORT 19402
+#define ZC_SMALL 1000
+#define ZC_LARGE (256 * 1024)
+
+typedef struct {
+    p2p_socket_t* sock;
+    int ok;
+} zc_receiver_t;
+
+static THREAD_RETURN zc_receiver_thread(void* arg) {
+    zc_receiver_t* r = (zc_receiver_t*)arg;
+    const uint32_t expected[] = {ZC_SMALL, ZC_LARGE, ZC_LARGE, ZC_LARGE};
+
+    r->ok = 1;
+    for (int i = 0; i < 4; i++) {
+        p2p_message_t* msg = p2p_message_recv(r->sock);
+        if (!msg || msg->length != expected[i] ||
+            msg->data[0] != (uint8_t)i || msg->data[msg->length - 1] != (uint8_t)i) {
+            r->ok = 0;
+        }
+        p2p_message_free(msg);
+    }
+
+    return 0;
+}
+
+static int g_released;
+
+static void count_release(void* ctx) {
+    g_released++;
+    free(ctx);
+}
+
+static p2p_message_t* filled_message(size_t size, uint8_t value) {
+    uint8_t* data = (uint8_t*)malloc(size);
+    memset(data, value, size);
+    p2p_message_t* msg = p2p_message_create_binary(data, size);
+    free(data);
+    return msg;
+}
+
+MU_TEST(test_zerocopy_send) {
+    p2p_init();
+
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_bind(listener, "127.0.0.1", ZC_TEST_PORT) == 0);
+    mu_check(p2p_socket_listen(listener, 1) == 0);
+
+    p2p_socket_t* client = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_connect(client, "127.0.0.1", ZC_TEST_PORT) == 0);
+    zc_receiver_t receiver = {p2p_socket_accept(listener), 0};
+    mu_check(receiver.sock != NULL);
+
+    // Only TCP sockets can use it
+    p2p_socket_t* a = NULL;
+    p2p_socket_t* b = NULL;
+    mu_check(p2p_socket_pair(&a, &b) == 0);
+    mu_check(p2p_socket_set_zerocopy(a, 16384) == -1);
+    p2p_socket_close(a);
+    p2p_socket_close(b);
+
+    int enabled = p2p_socket_set_zerocopy(client, 16384) == 0;
+    if (!enabled) {
+        printf("  (MSG_ZEROCOPY unavailable: %s - testing copy fallback)\n", p2p_get_error());
+    }
+
+    THREAD_HANDLE thread = start_thread(zc_receiver_thread, &receiver);
+
+    // Below the threshold: copy path, released at once
+    mu_check(p2p_message_send_owned(client, filled_message(ZC_SMALL, 0)) == 0);
+    p2p_metrics_t metrics;
+    p2p_socket_metrics(client, &metrics);
+    mu_check(metrics.values[P2P_METRIC_ZEROCOPY_SENDS] == 0);
+
+    mu_check(p2p_message_send_owned(client, filled_message(ZC_LARGE, 1)) == 0);
+    mu_check(p2p_message_send_owned(client, filled_message(ZC_LARGE, 2)) == 0);
+
+    // Raw buffer with own release callback
+    g_released = 0;
+    uint8_t header[4] = {0, (ZC_LARGE >> 16) & 0xFF, (ZC_LARGE >> 8) & 0xFF, ZC_LARGE & 0xFF};
+    uint8_t* raw = (uint8_t*)malloc(ZC_LARGE);
+    memset(raw, 3, ZC_LARGE);
+    mu_check(p2p_socket_send(client, header, sizeof(header)) == sizeof(header));
+    mu_check(p2p_socket_send_zerocopy(client, raw, ZC_LARGE, count_release, raw) == 0);
+
+    wait_for_thread(thread);
+    mu_check(receiver.ok);
+
+    // Everything has been read, so the kernel releases the buffers shortly
+    for (int i = 0; i < 200 && p2p_socket_zerocopy_reap(client) > 0; i++) {
+        usleep(5000);
+    }
+    mu_check(p2p_socket_zerocopy_reap(client) == 0);
+    mu_check(g_released == 1);
+
+    p2p_socket_metrics(client, &metrics);
+    mu_check(!enabled || metrics.values[P2P_METRIC_ZEROCOPY_SENDS] >= 3);
+
+    p2p_socket_close(receiver.sock);
+    p2p_socket_close(client);
+    p2p_socket_close(listener);
+    p2p_cleanup();
+    return NULL;
+}
+
+#define ZC_PARKED_TEST_PORT 19311
+#define ZC_PARKED_SIZE (256 * 1024)
+
+MU_TEST(test_zerocopy_close_in_flight) {
+    p2p_init();
+
+    // Tiny receive window and a receiver that does not read: the pages stay in the send queue
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    int small = 4096;
+    setsockopt(p2p_socket_get_handle(listener), SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+    mu_check(p2p_socket_bind(listener, "127.0.0.1", ZC_PARKED_TEST_PORT) == 0);
+    mu_check(p2p_socket_listen(listener, 1) == 0);
+
+    p2p_socket_t* client = p2p_socket_create(P2P_TCP);
+    int large = 4 * ZC_PARKED_SIZE;
+    setsockopt(p2p_socket_get_handle(client), SOL_SOCKET, SO_SNDBUF, &large, sizeof(large));
+    mu_check(p2p_socket_connect(client, "127.0.0.1", ZC_PARKED_TEST_PORT) == 0);
+    p2p_socket_t* server = p2p_socket_accept(listener);
+    mu_check(server != NULL);
+
+    if (p2p_socket_set_zerocopy(client, 16384) != 0) {
+        printf("  (MSG_ZEROCOPY unavailable - skipping)\n");
+    } else {
+        g_released = 0;
+        uint8_t* raw = (uint8_t*)malloc(ZC_PARKED_SIZE);
+        memset(raw, 5, ZC_PARKED_SIZE);
+        mu_check(p2p_socket_send_zerocopy(client, raw, ZC_PARKED_SIZE, count_release, raw) == 0);
+
+        // Close times out with the kernel still holding the pages: not released
+        p2p_socket_close(client);
+        mu_check(g_released == 0);
+        mu_check(p2p_socket_zerocopy_reap(NULL) == 0 && g_released == 0);
+
+        // Draining the receiver lets the kernel finish; a later reap releases it
+        uint8_t buf[16384];
+        size_t total = 0;
+        intptr_t n;
+        while ((n = p2p_socket_recv(server, buf, sizeof(buf))) > 0) {
+            total += (size_t)n;
+        }
+        mu_check(total == ZC_PARKED_SIZE);
+        for (int i = 0; i < 200 && g_released == 0; i++) {
+            p2p_socket_zerocopy_reap(NULL);
+            usleep(5000);
+        }
+        mu_check(g_released == 1);
+        client = NULL;
+    }
+
+    p2p_socket_close(server);
+    p2p_socket_close(client);
+    p2p_socket_close(listener);
+    p2p_cleanup();
+    return NULL;
+}
+
+#endif
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+#define SHM_TEST_PORT 19400
+#define SHM_TEST_SIZE (300 * 1024)     // Larger than one ring, wraps and blocks
+
+static THREAD_RETURN shm_echo_thread(void* arg) {
+    p2p_socket_t* listener = (p2p_socket_t*)arg;
+    p2p_socket_t* conn = p2p_socket_accept(listener);
+
+    // Echo framed messages until the client closes
+    if (conn && p2p_socket_upgrade_local(conn, 0) == 1) {
+        p2p_message_t* msg;
+        while ((msg = p2p_message_recv(conn)) != NULL) {
+            int rc = p2p_message_send(conn, msg);
+            p2p_message_free(msg);
+            if (rc != 0) break;
+        }
+    }
+
+    p2p_socket_close(conn);
+    return 0;
+}
+
+MU_TEST(test_shm_upgrade) {
+    p2p_init();
+
+    // Not connected: nothing to upgrade
+    p2p_socket_t* idle = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_upgrade_local(idle, 1) == 0);
+    mu_check(strcmp(p2p_socket_transport(idle), "tcp") == 0);
+    p2p_socket_close(idle);
+
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_bind(listener, "127.0.0.1", SHM_TEST_PORT) == 0);
+    mu_check(p2p_socket_listen(listener, 1) == 0);
+
+    THREAD_HANDLE thread = start_thread(shm_echo_thread, listener);
+
+    p2p_socket_t* client = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_connect(client, "127.0.0.1", SHM_TEST_PORT) == 0);
+    mu_check(p2p_socket_upgrade_local(client, 1) == 1);
+    mu_check(strcmp(p2p_socket_transport(client), "shm") == 0);
+
+    uint8_t* payload = (uint8_t*)malloc(SHM_TEST_SIZE);
+    for (size_t i = 0; i < SHM_TEST_SIZE; i++) payload[i] = (uint8_t)(i * 7);
+
+    for (int round = 0; round < 3; round++) {
+        p2p_message_t msg = {.length = SHM_TEST_SIZE - (uint32_t)round, .data = payload};
+        mu_check(p2p_message_send(client, &msg) == 0);
+
+        p2p_message_t* echo = p2p_message_recv(client);
+        mu_check(echo != NULL);
+        mu_check(echo->length == msg.length);
+        mu_check(memcmp(echo->data, payload, msg.length) == 0);
+        p2p_message_free(echo);
+    }
+
+    // Server sees EOF and exits
+    p2p_socket_close(client);
+    wait_for_thread(thread);
+
+    free(payload);
+    p2p_socket_close(listener);
+    p2p_cleanup();
+    return NULL;
+}
+
+#define SHM_HOSTILE_PORT 19401
+#define SHM_HOSTILE_CAPACITY 4096
+#define SHM_HOSTILE_SIZE (sizeof(hostile_header_t) + 2 * SHM_HOSTILE_CAPACITY)
+
+/**
+ * Segment layout as seen by the peer (mirrors transport_shm.c)
+ */
+typedef struct {
+    _Alignas(64) uint64_t write_pos;
+    uint32_t data_seq, consumer_waiting, closed;
+    _Alignas(64) uint64_t read_pos;
+    uint32_t space_seq, producer_waiting, reader_closed;
+} hostile_ring_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t capacity;
+    hostile_ring_t rings[2];
+} hostile_header_t;
+
+/**
+ * Upgrade an accepted connection against a hand-rolled initiator (the
+ * test) that keeps write access to the segment
+ */
+static hostile_header_t* hostile_link(p2p_socket_t* listener, int id,
+                                      p2p_socket_t** client, p2p_socket_t** conn) {
+    *client = p2p_socket_create(P2P_TCP);
+    if (p2p_socket_connect(*client, "127.0.0.1", SHM_HOSTILE_PORT) != 0) return NULL;
+    *conn = p2p_socket_accept(listener);
+    if (!*conn) return NULL;
+
+    char offer[64] = "P2PSHM1";
+    snprintf(offer + 8, sizeof(offer) - 8, "/p2pnet-hostile-%d-%d", (int)getpid(), id);
+    int fd = shm_open(offer + 8, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return NULL;
+    void* map = MAP_FAILED;
+    if (ftruncate(fd, (off_t)SHM_HOSTILE_SIZE) == 0) {
+        map = mmap(NULL, SHM_HOSTILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(offer + 8);
+        return NULL;
+    }
+
+    hostile_header_t* header = (hostile_header_t*)map;
+    header->magic = 0x31534850u;
+    header->capacity = SHM_HOSTILE_CAPACITY;
+
+    uint8_t accepted = 0;
+    int ok = p2p_socket_send(*client, offer, sizeof(offer)) == sizeof(offer) &&
+             p2p_socket_upgrade_local(*conn, 0) == 1 &&
+             p2p_socket_recv(*client, &accepted, 1) == 1 && accepted == 1;
+    shm_unlink(offer + 8);
+    if (!ok) {
+        munmap(map, SHM_HOSTILE_SIZE);
+        return NULL;
+    }
+    return header;
+}
+
+MU_TEST(test_shm_hostile_peer) {
+    p2p_init();
+
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_bind(listener, "127.0.0.1", SHM_HOSTILE_PORT) == 0);
+    mu_check(p2p_socket_listen(listener, 2) == 0);
+
+    p2p_socket_t* client = NULL;
+    p2p_socket_t* conn = NULL;
+    hostile_header_t* header = hostile_link(listener, 0, &client, &conn);
+    mu_check(header != NULL);
+
+    // Legit data still arrives after the peer inflates capacity past the mapping
+    uint8_t* data = (uint8_t*)(header + 1);
+    memcpy(data, "hello", 5);
+    __atomic_store_n(&header->rings[0].write_pos, 5, __ATOMIC_RELEASE);
+    header->capacity = 1u << 30;
+
+    char buf[64];
+    mu_check(p2p_socket_recv(conn, buf, sizeof(buf)) == 5);
+    mu_check(memcmp(buf, "hello", 5) == 0);
+
+    // Our own index rewritten by the peer is ignored
+    header->rings[0].read_pos = 1u << 29;
+    data[5] = '!';
+    __atomic_store_n(&header->rings[0].write_pos, 6, __ATOMIC_RELEASE);
+    mu_check(p2p_socket_recv(conn, buf, sizeof(buf)) == 1);
+    mu_check(buf[0] == '!');
+
+    // Peer write_pos claiming more than the ring holds breaks the link for good
+    __atomic_store_n(&header->rings[0].write_pos, 6 + (1ull << 30), __ATOMIC_RELEASE);
+    mu_check(p2p_socket_recv(conn, buf, sizeof(buf)) < 0);
+    __atomic_store_n(&header->rings[0].write_pos, 6, __ATOMIC_RELEASE);
+    mu_check(p2p_socket_recv(conn, buf, sizeof(buf)) < 0);
+    mu_check(p2p_socket_send(conn, "x", 1) < 0);
+
+    p2p_socket_close(conn);
+    p2p_socket_close(client);
+    munmap(header, SHM_HOSTILE_SIZE);
+
+    // Send side: peer read_pos ahead of what was written would mean space > capacity
+    header = hostile_link(listener, 1, &client, &conn);
+    mu_check(header != NULL);
+    header->capacity = 1u << 30;
+    __atomic_store_n(&header->rings[1].read_pos, 1ull << 40, __ATOMIC_RELEASE);
+    mu_check(p2p_socket_send(conn, "x", 1) < 0);
+
+    p2p_socket_close(conn);
+    p2p_socket_close(client);
+    munmap(header, SHM_HOSTILE_SIZE);
+    p2p_socket_close(listener);
+    p2p_cleanup();
+    return NULL;
+}
+
+#define SHM_ONE_SIDED_PORT 19403
+
+// transport_shm.c test hook: this thread treats every peer as remote
+extern _Thread_local int p2p_shm_assume_remote;
+
+typedef struct {
+    p2p_socket_t* listener;
+    int assume_remote;
+    int upgraded;
+} one_sided_t;
+
+static THREAD_RETURN one_sided_server(void* arg) {
+    one_sided_t* s = (one_sided_t*)arg;
+    p2p_shm_assume_remote = s->assume_remote;
+    p2p_socket_t* conn = p2p_socket_accept(s->listener);
+
+    s->upgraded = conn ? p2p_socket_upgrade_local(conn, 0) : -1;
+    if (s->upgraded == 0) {
+        p2p_message_t* msg = p2p_message_recv(conn);
+        if (msg) p2p_message_send(conn, msg);
+        p2p_message_free(msg);
+    }
+
+    p2p_socket_close(conn);
+    return 0;
+}
+
+/**
+ * One end considers the link local, the other does not (port-forward,
+ * proxy): both fall back to TCP and the stream stays in sync
+ */
+MU_TEST(test_shm_one_sided_locality) {
+    p2p_init();
+
+    p2p_socket_t* listener = p2p_socket_create(P2P_TCP);
+    mu_check(p2p_socket_bind(listener, "127.0.0.1", SHM_ONE_SIDED_PORT) == 0);
+    mu_check(p2p_socket_listen(listener, 2) == 0);
+
+    for (int remote_side = 0; remote_side < 2; remote_side++) {
+        one_sided_t server = {listener, remote_side == 0, -2};
+        THREAD_HANDLE thread = start_thread(one_sided_server, &server);
+
+        p2p_shm_assume_remote = remote_side == 1;
+        p2p_socket_t* client = p2p_socket_create(P2P_TCP);
+        mu_check(p2p_socket_connect(client, "127.0.0.1", SHM_ONE_SIDED_PORT) == 0);
+        mu_check(p2p_socket_upgrade_local(client, 1) == 0);
+        mu_check(strcmp(p2p_socket_transport(client), "tcp") == 0);
+        p2p_shm_assume_remote = 0;
+
+        p2p_message_t msg = {.length = 5, .data = (uint8_t*)"hello"};
+        mu_check(p2p_message_send(client, &msg) == 0);
+        p2p_message_t* echo = p2p_message_recv(client);
+        mu_check(echo != NULL && echo->length == 5 && memcmp(echo->data, "hello", 5) == 0);
+        p2p_message_free(echo);
+
+        p2p_socket_close(client);
+        wait_for_thread(thread);
+        mu_check(server.upgraded == 0);
+    }
+
+    p2p_socket_close(listener);
+    p2p_cleanup();
+    return NULL;
+}
+
+#endif
+
+MU_TEST_SUITE(transport_suite) {
+    MU_RUN_TEST(test_memory_pair);
+    MU_RUN_TEST(test_transport_names);
+    MU_RUN_TEST(test_memory_framing);
+    MU_RUN_TEST(test_memory_handshake);
+#ifndef _WIN32
+    MU_RUN_TEST(test_unix_socket);
+    MU_RUN_TEST(test_socket_passing);
+    MU_RUN_TEST(test_zerocopy_send);
+    MU_RUN_TEST(test_zerocopy_close_in_flight);
+#endif
+#ifdef __linux__
+    MU_RUN_TEST(test_shm_upgrade);
+    MU_RUN_TEST(test_shm_hostile_peer);
+    MU_RUN_TEST(test_shm_one_sided_locality);
+#endif
+    return NULL;
+}
+
+int main() {
+    printf("========================================\n");
+    printf(" Running Transport Tests                \n");
+    printf("========================================\n\n");
+
+    MU_RUN_SUITE(transport_suite);
+    MU_REPORT();
+
+    return MU_EXIT_CODE;
+}